@@ -0,0 +1,249 @@
+# Copyright Advanced Micro Devices, Inc.
+# SPDX-License-Identifier: MIT
+
+"""Adaptive concurrency for bulk transfers (uploads, downloads, copies).
+
+A fixed number of concurrent transfers is either too few for a host with a
+fast link or too many for a shared runner, where extra connections only get
+throttled and retried. `AdaptiveConcurrency` starts at an initial limit and
+adjusts it from the throughput measured over fixed time windows:
+
+* While throughput keeps improving, the limit grows (doubling at first, like
+  TCP slow start, then one transfer at a time).
+* When an increase did not pay off, the limit is reverted and held.
+* On throttling errors (S3 `SlowDown`, HTTP 429/503, timeouts) or when
+  throughput collapses (e.g. from latency spikes), the limit is halved.
+
+Transfers either take a slot (`slot()`, for thread pools that only do
+transfers) or the limit is applied elsewhere through `on_change` (e.g. a
+`ConnectionBudget`). Either way, transferred bytes are reported with
+`record()` and errors with `record_error()`. `summary()` describes the
+achieved throughput and the limits used. Transfers paced by something other
+than the network (e.g. uploads streamed while their data is still being
+compressed) report with `record(..., adapt=False)`, so that their slow
+progress is not mistaken for a saturated link.
+
+Passing `maximum == initial` keeps the limit fixed (throughput is still
+measured).
+"""
+
+import contextlib
+import threading
+import time
+from typing import Callable, Optional
+
+DEFAULT_WINDOW_SECONDS = 2.0
+DEFAULT_MAX_CONCURRENCY = 64
+
+# Relative throughput change between windows that counts as a change.
+_TOLERANCE = 0.1
+# Throughput below this fraction of the previous window counts as a collapse.
+_COLLAPSE_FRACTION = 0.5
+
+_THROTTLING_ERROR_CODES = {
+    "RequestLimitExceeded",
+    "RequestTimeout",
+    "ServiceUnavailable",
+    "SlowDown",
+    "Throttling",
+    "ThrottlingException",
+    "TooManyRequestsException",
+}
+_THROTTLING_STATUS_CODES = {429, 503}
+_TIMEOUT_ERROR_NAMES = {
+    "ConnectTimeoutError",
+    "ReadTimeoutError",
+    "ConnectionClosedError",
+    "TimeoutError",
+}
+
+
+def is_throttling_error(error: BaseException) -> bool:
+    """Whether `error` (or an exception it was raised from) signals overload."""
+    seen = set()
+    while error is not None and id(error) not in seen:
+        seen.add(id(error))
+        if type(error).__name__ in _TIMEOUT_ERROR_NAMES:
+            return True
+        response = getattr(error, "response", None)
+        if isinstance(response, dict):
+            if response.get("Error", {}).get("Code") in _THROTTLING_ERROR_CODES:
+                return True
+            status = response.get("ResponseMetadata", {}).get("HTTPStatusCode")
+            if status in _THROTTLING_STATUS_CODES:
+                return True
+        error = error.__cause__ or error.__context__
+    return False
+
+
+def _format_size(size: float) -> str:
+    for unit in ["B", "KiB", "MiB", "GiB"]:
+        if size < 1024 or unit == "GiB":
+            return f"{size:.1f} {unit}"
+        size /= 1024
+
+
+class AdaptiveConcurrency:
+    """AIMD controller for the number of concurrent transfers."""
+
+    def __init__(
+        self,
+        initial: int,
+        maximum: Optional[int] = None,
+        *,
+        minimum: int = 1,
+        window_seconds: float = DEFAULT_WINDOW_SECONDS,
+        on_change: Optional[Callable[[int], None]] = None,
+        clock: Callable[[], float] = time.monotonic,
+    ):
+        maximum = initial if maximum is None else maximum
+        if not 1 <= minimum <= initial <= maximum:
+            raise ValueError(
+                f"Invalid concurrency limits: minimum={minimum} "
+                f"initial={initial} maximum={maximum}"
+            )
+        self.initial = initial
+        self.minimum = minimum
+        self.maximum = maximum
+        self.limit = initial
+        self.peak = initial
+        self.throttles = 0
+        self.total_bytes = 0
+        self._window_seconds = window_seconds
+        self._on_change = on_change
+        self._clock = clock
+        self._cond = threading.Condition()
+        self._in_use = 0
+        self._slow_start = True
+        self._last_increase: Optional[int] = None  # Limit before the last increase
+        self._last_throughput: Optional[float] = None
+        self._window_start: Optional[float] = None
+        self._window_bytes = 0
+        self._first_record: Optional[float] = None
+        self._last_record: Optional[float] = None
+        self._last_decrease = float("-inf")
+
+    @property
+    def adaptive(self) -> bool:
+        return self.maximum > self.initial
+
+    @contextlib.contextmanager
+    def slot(self):
+        """Holds one of `limit` transfer slots, blocking until one is free."""
+        with self._cond:
+            while self._in_use >= self.limit:
+                self._cond.wait()
+            self._in_use += 1
+            if self._first_record is None:
+                self._first_record = self._clock()
+        try:
+            yield
+        finally:
+            with self._cond:
+                self._in_use -= 1
+                self._cond.notify()
+
+    def record(self, num_bytes: int, *, adapt: bool = True):
+        """Reports `num_bytes` transferred (at any granularity).
+
+        With `adapt=False`, the bytes only count towards `summary()`, not
+        towards the throughput the limit is adapted to.
+        """
+        with self._cond:
+            now = self._clock()
+            if self._first_record is None:
+                self._first_record = now
+            self._last_record = now
+            self.total_bytes += num_bytes
+            if not adapt:
+                return
+            if self._window_start is None:
+                self._window_start = self._first_record
+            self._window_bytes += num_bytes
+            elapsed = now - self._window_start
+            if elapsed >= self._window_seconds:
+                self._end_window(self._window_bytes / elapsed)
+                self._window_start = now
+                self._window_bytes = 0
+
+    def record_error(self, error: BaseException):
+        """Reports a failed transfer; throttling errors halve the limit."""
+        if not is_throttling_error(error):
+            return
+        with self._cond:
+            self.throttles += 1
+            if not self.adaptive:
+                return
+            now = self._clock()
+            # One backoff per window, so a burst of errors counts once.
+            if now - self._last_decrease < self._window_seconds:
+                return
+            self._decrease(max(self.minimum, self.limit // 2), now)
+
+    def _end_window(self, throughput: float):
+        last = self._last_throughput
+        self._last_throughput = throughput
+        if not self.adaptive:
+            return
+        if last is None:
+            # First window, or the first at a reduced limit: only probe
+            # further while still in slow start.
+            if self._slow_start:
+                self._increase()
+        elif throughput > last * (1 + _TOLERANCE):
+            self._increase()
+        elif throughput < last * _COLLAPSE_FRACTION:
+            self._decrease(max(self.minimum, self.limit // 2), self._clock())
+        elif throughput < last * (1 - _TOLERANCE) and self._last_increase is not None:
+            # The last increase made things worse.
+            self._decrease(self._last_increase, self._clock())
+        else:
+            # Plateau: more transfers don't help, keep the limit.
+            self._slow_start = False
+            self._last_increase = None
+
+    def _increase(self):
+        if self._slow_start:
+            new_limit = min(self.maximum, self.limit * 2)
+        else:
+            new_limit = min(self.maximum, self.limit + 1)
+        if new_limit != self.limit:
+            self._last_increase = self.limit
+            self._set_limit(new_limit)
+
+    def _decrease(self, new_limit: int, now: float):
+        self._slow_start = False
+        self._last_increase = None
+        self._last_decrease = now
+        # Start measuring afresh at the new limit.
+        self._last_throughput = None
+        self._window_start = now
+        self._window_bytes = 0
+        self._set_limit(new_limit)
+
+    def _set_limit(self, new_limit: int):
+        if new_limit == self.limit:
+            return
+        self.limit = new_limit
+        self.peak = max(self.peak, new_limit)
+        self._cond.notify_all()
+        if self._on_change is not None:
+            self._on_change(new_limit)
+
+    def summary(self) -> str:
+        """E.g. "1.2 GiB in 4.0s (300.0 MiB/s), concurrency 10 -> 40 (peak 40)"."""
+        with self._cond:
+            elapsed = 0.0
+            if self._last_record is not None:
+                elapsed = self._last_record - self._first_record
+            rate = self.total_bytes / elapsed if elapsed > 0 else 0.0
+            text = (
+                f"{_format_size(self.total_bytes)} in {elapsed:.1f}s "
+                f"({_format_size(rate)}/s), "
+                f"concurrency {self.initial} -> {self.limit}"
+            )
+            if self.adaptive:
+                text += f" (peak {self.peak})"
+            if self.throttles:
+                text += f", {self.throttles} throttled"
+            return text
@@ -1,10 +1,85 @@
 # Copyright Advanced Micro Devices, Inc.
 # SPDX-License-Identifier: MIT
 
-"""Utilities for reading and writing zstd/xz compressed tar archives."""
+"""Utilities for reading and writing zstd/xz compressed tar archives.
 
+Archives may be written as a sequence of independently compressed frames
+(zstd frames or xz streams, see `open_archive_for_write(frame_size=...)`).
+Such multi-frame archives remain decodable by the standard tools, and
+`open_archive_for_read` decompresses them on several threads ahead of the tar
+reader.
+
+`ParallelGzipWriter` compresses gzip files on several threads (like pigz),
+e.g. for release tarballs, which are gzip for compatibility with consumers.
+
+Zstd archives may optionally be compressed against a trained dictionary (see
+`train_zstd_dict`). Such archives start with a zstd skippable frame that
+references the dictionary by id (or embeds it, which costs the dictionary's
+size in every archive), so that `open_archive_for_read` can decompress them
+transparently given the directories holding referenced dictionaries.
+Conforming zstd decoders ignore skippable frames, so these archives remain
+decodable by `zstd -D <dict>` as well.
+"""
+
+import bisect
+import bz2
+import collections
+import concurrent.futures
+from dataclasses import dataclass
+import gzip
+import io
+import lzma
+import mmap
 from pathlib import Path
+import os
+import queue
+import struct
 import tarfile
+import threading
+from typing import BinaryIO, Callable, Iterable, Sequence
+import zlib
+
+# Skippable frame magic used to carry dictionary information ahead of the
+# compressed tar stream. Any value in 0x184D2A50..0x184D2A5F is skipped by
+# conforming zstd decoders.
+ZSTD_DICT_FRAME_MAGIC = 0x184D2A5E
+# Payload prefix identifying our dictionary frame (vs other skippable frames).
+ZSTD_DICT_FRAME_TAG = b"TRZD"
+ZSTD_DICT_EMBED = b"E"
+ZSTD_DICT_REFERENCE = b"R"
+ZSTD_DICT_MODES = ("reference", "embed")
+# Length of the dictionary id in reference frames.
+_ZSTD_DICT_ID_SIZE = 4
+
+# File extension for trained dictionaries. Referenced dictionaries are looked up
+# by id among the files with this extension in the directories given to readers.
+ZSTD_DICT_EXTENSION = ".zdict"
+
+# Defaults for dictionary training. Files larger than the sample limit are
+# skipped: dictionaries only help small inputs, and large samples slow
+# training down without improving the result.
+DEFAULT_ZSTD_DICT_SIZE = 112640
+DEFAULT_ZSTD_DICT_MAX_SAMPLE_SIZE = 128 * 1024
+DEFAULT_ZSTD_DICT_MAX_TOTAL_SAMPLES_SIZE = 128 * 1024 * 1024
+
+# Suggested uncompressed bytes per independent frame (zstd) or stream (xz) in
+# multi-frame archives, which are opt-in. A few times the default zstd window /
+# xz dictionary size, so that restarting the compressor costs little ratio (xz
+# -T uses 3x the dictionary).
+DEFAULT_ZSTD_FRAME_SIZE = 16 * 1024 * 1024
+DEFAULT_XZ_FRAME_SIZE = 24 * 1024 * 1024
+# Threads used by `open_archive_for_read` to decompress multi-frame archives.
+DEFAULT_DECOMPRESS_THREADS = min(4, os.cpu_count() or 1)
+# Decompressed bytes that multi-frame readers may hold ahead of their read
+# position, in total across all open readers of the process (e.g. concurrent
+# extractions). A reader always decompresses the frame it reads next.
+DEFAULT_PREFETCH_MEMORY = 128 * 1024 * 1024
+
+# Uncompressed bytes per block of `ParallelGzipWriter`. Each block is primed
+# with the previous block's last 32 KiB (the deflate window), so block
+# boundaries cost almost no ratio; larger blocks only reduce overhead.
+DEFAULT_GZIP_BLOCK_SIZE = 1024 * 1024
+_DEFLATE_WINDOW_SIZE = 32 * 1024
 
 
 def _get_pyzstd():
@@ -28,9 +103,24 @@ class ZstdTarFile(tarfile.TarFile):
     os.unlink() calls from succeeding.
     """
 
-    def __init__(self, path: Path, mode: str = "rb", **zstd_kwargs) -> None:
+    def __init__(
+        self,
+        path: Path,
+        mode: str = "rb",
+        *,
+        dict_frame: bytes | None = None,
+        **zstd_kwargs,
+    ) -> None:
         pyzstd = _get_pyzstd()
-        self._zstd_file = pyzstd.ZstdFile(path, mode=mode, **zstd_kwargs)
+        self._raw_file: BinaryIO | None = None
+        if dict_frame is not None:
+            # The dictionary frame must precede the compressed data, so manage
+            # the underlying file ourselves.
+            self._raw_file = open(path, mode)
+            self._raw_file.write(dict_frame)
+            self._zstd_file = pyzstd.ZstdFile(self._raw_file, mode=mode, **zstd_kwargs)
+        else:
+            self._zstd_file = pyzstd.ZstdFile(path, mode=mode, **zstd_kwargs)
 
         # Trim mode from ZstdFile format to TarFile format
         #   * https://pyzstd.readthedocs.io/en/stable/pyzstd.html#open
@@ -43,27 +133,982 @@ class ZstdTarFile(tarfile.TarFile):
     def close(self) -> None:
         super().close()
         self._zstd_file.close()
+        if self._raw_file is not None:
+            self._raw_file.close()
+
+
+# =============================================================================
+# Zstd dictionaries
+# =============================================================================
+
+
+def load_zstd_dict(path: Path):
+    """Load a trained dictionary file as a `pyzstd.ZstdDict`."""
+    pyzstd = _get_pyzstd()
+    return pyzstd.ZstdDict(Path(path).read_bytes())
+
+
+def train_zstd_dict(
+    sample_paths: Iterable[Path],
+    dict_size: int = DEFAULT_ZSTD_DICT_SIZE,
+    *,
+    max_sample_size: int = DEFAULT_ZSTD_DICT_MAX_SAMPLE_SIZE,
+    max_total_samples_size: int = DEFAULT_ZSTD_DICT_MAX_TOTAL_SAMPLES_SIZE,
+) -> bytes:
+    """Train a zstd dictionary from sample files and return its content.
+
+    Empty files and files larger than `max_sample_size` are skipped. Sampling
+    stops once `max_total_samples_size` bytes have been collected.
+    """
+    pyzstd = _get_pyzstd()
+    samples: list[bytes] = []
+    total_size = 0
+    for sample_path in sample_paths:
+        size = os.lstat(sample_path).st_size
+        if size == 0 or size > max_sample_size:
+            continue
+        if total_size + size > max_total_samples_size:
+            break
+        samples.append(Path(sample_path).read_bytes())
+        total_size += size
+    if not samples:
+        raise ValueError("No suitable samples found to train a zstd dictionary")
+    return pyzstd.train_dict(samples, dict_size).dict_content
+
+
+def _make_zstd_dict_frame(zstd_dict, mode: str) -> bytes:
+    if mode == "embed":
+        payload = ZSTD_DICT_FRAME_TAG + ZSTD_DICT_EMBED + zstd_dict.dict_content
+    elif mode == "reference":
+        payload = (
+            ZSTD_DICT_FRAME_TAG
+            + ZSTD_DICT_REFERENCE
+            + struct.pack("<I", zstd_dict.dict_id)
+        )
+    else:
+        raise ValueError(f"Unknown zstd dictionary mode: {mode}")
+    return struct.pack("<II", ZSTD_DICT_FRAME_MAGIC, len(payload)) + payload
+
+
+def _find_zstd_dict_by_id(dict_id: int, zstd_dict_dirs: Sequence[Path] | None):
+    pyzstd = _get_pyzstd()
+    dirs = [Path(d) for d in zstd_dict_dirs or ()]
+    for d in dirs:
+        if not d.is_dir():
+            continue
+        for candidate in sorted(d.glob(f"*{ZSTD_DICT_EXTENSION}")):
+            zstd_dict = pyzstd.ZstdDict(candidate.read_bytes())
+            if zstd_dict.dict_id == dict_id:
+                return zstd_dict
+    raise FileNotFoundError(
+        f"zstd dictionary with id {dict_id} not found (searched "
+        f"{[str(d) for d in dirs]})"
+    )
+
+
+def _read_exact(f: BinaryIO, size: int) -> bytes:
+    """Reads `size` bytes, or fewer at EOF (streams may return short reads)."""
+    data = b""
+    while len(data) < size:
+        chunk = f.read(size - len(data))
+        if not chunk:
+            break
+        data += chunk
+    return data
+
+
+def _read_zstd_dict_header(
+    f: BinaryIO, zstd_dict_dirs: Sequence[Path] | None, name: str
+) -> tuple[object | None, bytes]:
+    """Reads a leading dictionary frame from `f`, if present.
+
+    Returns `(zstd_dict, unconsumed)`, where `unconsumed` holds bytes that were
+    read from `f` but belong to the compressed stream (non-empty only if
+    there is no dictionary frame).
+    """
+    header = _read_exact(f, 8)
+    if len(header) < 8:
+        return None, header
+    magic, size = struct.unpack("<II", header)
+    if magic != ZSTD_DICT_FRAME_MAGIC:
+        return None, header
+    payload = _read_exact(f, size)
+    if len(payload) < size:
+        raise IOError(f"Truncated skippable frame at the start of {name}")
+    if not payload.startswith(ZSTD_DICT_FRAME_TAG):
+        # Some other skippable frame: the decompressor skips it as well.
+        return None, header + payload
+    kind = payload[len(ZSTD_DICT_FRAME_TAG) : len(ZSTD_DICT_FRAME_TAG) + 1]
+    content = payload[len(ZSTD_DICT_FRAME_TAG) + 1 :]
+    if kind == ZSTD_DICT_EMBED:
+        return _get_pyzstd().ZstdDict(content), b""
+    elif kind == ZSTD_DICT_REFERENCE:
+        if len(content) != _ZSTD_DICT_ID_SIZE:
+            raise IOError(
+                f"Malformed zstd dictionary reference in {name}: expected a "
+                f"{_ZSTD_DICT_ID_SIZE} byte id, got {len(content)} bytes"
+            )
+        (dict_id,) = struct.unpack("<I", content)
+        return _find_zstd_dict_by_id(dict_id, zstd_dict_dirs), b""
+    else:
+        raise IOError(f"Unknown zstd dictionary frame kind {kind!r} in {name}")
+
+
+def read_zstd_dict_frame(path: Path, zstd_dict_dirs: Sequence[Path] | None = None):
+    """Return the dictionary an archive was compressed with, or None.
+
+    Embedded dictionaries are loaded from the archive itself. Referenced
+    dictionaries are resolved by id from the `.zdict` files in
+    `zstd_dict_dirs`.
+    """
+    with open(path, "rb") as f:
+        zstd_dict, _ = _read_zstd_dict_header(f, zstd_dict_dirs, str(path))
+    return zstd_dict
+
+
+# =============================================================================
+# Multi-frame archives
+# =============================================================================
+
+_ZSTD_FRAME_MAGIC = 0xFD2FB528
+_ZSTD_MAX_FRAME_HEADER_SIZE = 18
+_XZ_HEADER_MAGIC = b"\xfd7zXZ\x00"
+_XZ_FOOTER_MAGIC = b"YZ"
+
+
+@dataclass(frozen=True)
+class _Frame:
+    """An independently decompressible chunk of a multi-frame archive."""
+
+    offset: int
+    size: int
+    uncompressed_offset: int
+    uncompressed_size: int
+    # xz only: needed to wrap a block into a standalone stream.
+    xz_stream_flags: bytes = b""
+    xz_unpadded_size: int = 0
+
+
+class _FramedWriter(io.RawIOBase):
+    """Compresses every `frame_size` bytes written into an independent frame.
+
+    With `threads` > 1, frames are compressed concurrently (the compressors
+    release the GIL) and written in order. The output does not depend on
+    `threads`.
+    """
+
+    def __init__(
+        self,
+        raw: BinaryIO,
+        compress_frame: Callable[[bytes], bytes],
+        frame_size: int,
+        *,
+        threads: int = 1,
+    ):
+        self._raw = raw
+        self._compress_frame = compress_frame
+        self._frame_size = frame_size
+        self._buffer = bytearray()
+        self._pos = 0
+        self._frame_count = 0
+        self._executor = None
+        if threads > 1:
+            self._executor = concurrent.futures.ThreadPoolExecutor(
+                max_workers=threads, thread_name_prefix="compress"
+            )
+        # Frames in flight, in output order. Bounded to limit memory use.
+        self._pending: collections.deque[concurrent.futures.Future] = (
+            collections.deque()
+        )
+        self._max_pending = 2 * threads
+
+    def writable(self) -> bool:
+        return True
+
+    def write(self, b) -> int:
+        self._buffer += b
+        self._pos += len(b)
+        while len(self._buffer) >= self._frame_size:
+            self._emit(bytes(self._buffer[: self._frame_size]))
+            del self._buffer[: self._frame_size]
+        return len(b)
+
+    def tell(self) -> int:
+        return self._pos
+
+    def _emit(self, data: bytes):
+        self._frame_count += 1
+        if self._executor is None:
+            self._raw.write(self._compress_frame(data))
+            return
+        self._pending.append(self._executor.submit(self._compress_frame, data))
+        while len(self._pending) > self._max_pending:
+            self._raw.write(self._pending.popleft().result())
+
+    def close(self):
+        if self.closed:
+            return
+        try:
+            # Always emit at least one frame, so that empty archives are valid.
+            if self._buffer or self._frame_count == 0:
+                self._emit(bytes(self._buffer))
+                self._buffer.clear()
+            while self._pending:
+                self._raw.write(self._pending.popleft().result())
+        finally:
+            if self._executor is not None:
+                self._executor.shutdown(cancel_futures=True)
+            self._raw.close()
+            super().close()
+
+
+def _scan_zstd_frames(buf) -> list[_Frame] | None:
+    """Lists the frames of a zstd file, or None if they can't be used.
+
+    Skippable frames (e.g. the dictionary frame) are skipped. Frames must
+    declare their decompressed size, which one-shot compression always does.
+    """
+    pyzstd = _get_pyzstd()
+    frames = []
+    offset = 0
+    uncompressed_offset = 0
+    with memoryview(buf) as view:
+        while offset < len(view):
+            (magic,) = struct.unpack_from("<I", view, offset)
+            if magic & 0xFFFFFFF0 == 0x184D2A50:
+                (size,) = struct.unpack_from("<I", view, offset + 4)
+                offset += 8 + size
+                continue
+            if magic != _ZSTD_FRAME_MAGIC:
+                return None
+            frame_size = pyzstd.get_frame_size(view[offset:])
+            info = pyzstd.get_frame_info(
+                view[offset : offset + _ZSTD_MAX_FRAME_HEADER_SIZE]
+            )
+            if info.decompressed_size is None:
+                return None
+            frames.append(
+                _Frame(offset, frame_size, uncompressed_offset, info.decompressed_size)
+            )
+            offset += frame_size
+            uncompressed_offset += info.decompressed_size
+    return frames
+
+
+def _decode_xz_varint(buf, pos: int) -> tuple[int, int]:
+    value = 0
+    shift = 0
+    while True:
+        byte = buf[pos]
+        pos += 1
+        value |= (byte & 0x7F) << shift
+        if not byte & 0x80:
+            return value, pos
+        shift += 7
+        if shift > 63:
+            raise ValueError("Invalid xz varint")
+
+
+def _encode_xz_varint(value: int) -> bytes:
+    out = bytearray()
+    while value >= 0x80:
+        out.append((value & 0x7F) | 0x80)
+        value >>= 7
+    out.append(value)
+    return bytes(out)
+
+
+def _scan_xz_blocks(buf) -> list[_Frame] | None:
+    """Lists the blocks of all streams of an xz file, or None on parse errors.
+
+    Streams are walked backwards from the end of the file using the stream
+    footers and indexes, which record each block's compressed and
+    uncompressed size without needing to decompress anything.
+    """
+    streams = []
+    end = len(buf)
+    while end > 0:
+        # Stream padding (multiples of 4 null bytes) may follow each stream.
+        while end >= 4 and buf[end - 4 : end] == b"\0\0\0\0":
+            end -= 4
+        if end == 0:
+            break
+        if end < 24 or buf[end - 2 : end] != _XZ_FOOTER_MAGIC:
+            return None
+        (backward_size,) = struct.unpack_from("<I", buf, end - 8)
+        index_size = (backward_size + 1) * 4
+        stream_flags = bytes(buf[end - 4 : end - 2])
+        pos = end - 12 - index_size
+        if pos < 0 or buf[pos] != 0:
+            return None
+        record_count, pos = _decode_xz_varint(buf, pos + 1)
+        records = []
+        for _ in range(record_count):
+            unpadded_size, pos = _decode_xz_varint(buf, pos)
+            uncompressed_size, pos = _decode_xz_varint(buf, pos)
+            records.append((unpadded_size, uncompressed_size))
+        blocks_size = sum((u + 3) & ~3 for u, _ in records)
+        stream_start = end - 12 - index_size - blocks_size - 12
+        if stream_start < 0 or buf[stream_start : stream_start + 6] != _XZ_HEADER_MAGIC:
+            return None
+        streams.append((stream_start, stream_flags, records))
+        end = stream_start
+
+    frames = []
+    uncompressed_offset = 0
+    for stream_start, stream_flags, records in reversed(streams):
+        offset = stream_start + 12
+        for unpadded_size, uncompressed_size in records:
+            padded_size = (unpadded_size + 3) & ~3
+            frames.append(
+                _Frame(
+                    offset,
+                    padded_size,
+                    uncompressed_offset,
+                    uncompressed_size,
+                    xz_stream_flags=stream_flags,
+                    xz_unpadded_size=unpadded_size,
+                )
+            )
+            offset += padded_size
+            uncompressed_offset += uncompressed_size
+    return frames
 
 
-def open_archive_for_read(path: Path) -> tarfile.TarFile:
-    """Open a tar archive for reading, auto-detecting compression from extension."""
+def _decompress_xz_block(frame: _Frame, block: bytes) -> bytes:
+    """Decompresses one xz block by wrapping it into a single-block stream."""
+    flags = frame.xz_stream_flags
+    header = _XZ_HEADER_MAGIC + flags + struct.pack("<I", zlib.crc32(flags))
+    index = (
+        b"\0"
+        + _encode_xz_varint(1)
+        + _encode_xz_varint(frame.xz_unpadded_size)
+        + _encode_xz_varint(frame.uncompressed_size)
+    )
+    index += b"\0" * (-len(index) % 4)
+    index += struct.pack("<I", zlib.crc32(index))
+    backward_size = struct.pack("<I", len(index) // 4 - 1)
+    footer = (
+        struct.pack("<I", zlib.crc32(backward_size + flags))
+        + backward_size
+        + flags
+        + _XZ_FOOTER_MAGIC
+    )
+    return lzma.decompress(header + block + index + footer, format=lzma.FORMAT_XZ)
+
+
+class _PrefetchBudget:
+    """Decompressed bytes that may be prefetched, shared by all readers."""
+
+    def __init__(self, limit: int):
+        self.limit = limit
+        self.used = 0
+        self._lock = threading.Lock()
+
+    def try_acquire(self, size: int) -> bool:
+        with self._lock:
+            if self.used + size > self.limit:
+                return False
+            self.used += size
+            return True
+
+    def acquire(self, size: int):
+        """Acquires `size` bytes even if that exceeds the limit."""
+        with self._lock:
+            self.used += size
+
+    def release(self, size: int):
+        with self._lock:
+            self.used -= size
+
+
+_prefetch_budget = _PrefetchBudget(DEFAULT_PREFETCH_MEMORY)
+
+
+class _ParallelFrameReader(io.RawIOBase):
+    """Seekable reader of a multi-frame file that decompresses ahead.
+
+    Up to `2 * threads` frames following the current read position are
+    decompressed concurrently, as far as `budget` allows (the next frame is
+    always decompressed); frames are consumed strictly in order. Seeking
+    outside of the prefetched range restarts prefetching at the target frame,
+    so random access (e.g. `TarFile.getmember`) still works.
+    """
+
+    def __init__(
+        self,
+        path: Path,
+        frames: list[_Frame],
+        decompress_frame: Callable[[_Frame, bytes], bytes],
+        threads: int,
+        budget: _PrefetchBudget | None = None,
+    ):
+        self._file = open(path, "rb")
+        self._mmap = mmap.mmap(self._file.fileno(), 0, access=mmap.ACCESS_READ)
+        self._frames = frames
+        self._frame_starts = [f.uncompressed_offset for f in frames]
+        self._size = frames[-1].uncompressed_offset + frames[-1].uncompressed_size
+        self._decompress_frame = decompress_frame
+        self._executor = concurrent.futures.ThreadPoolExecutor(
+            max_workers=threads, thread_name_prefix="decompress"
+        )
+        self._max_pending = 2 * threads
+        self._budget = budget or _prefetch_budget
+        # (future, budgeted size) of the frames decompressed ahead.
+        self._pending: collections.deque = collections.deque()
+        self._next_submit = 0
+        self._frame_index = -1
+        self._frame_data = b""
+        self._pos = 0
+
+    def readable(self) -> bool:
+        return True
+
+    def seekable(self) -> bool:
+        return True
+
+    def tell(self) -> int:
+        return self._pos
+
+    def seek(self, offset: int, whence: int = io.SEEK_SET) -> int:
+        if whence == io.SEEK_SET:
+            pos = offset
+        elif whence == io.SEEK_CUR:
+            pos = self._pos + offset
+        elif whence == io.SEEK_END:
+            pos = self._size + offset
+        else:
+            raise ValueError(f"Invalid whence: {whence}")
+        if pos < 0:
+            raise ValueError(f"Negative seek position {pos}")
+        self._pos = pos
+        return pos
+
+    def _decompress(self, frame: _Frame) -> bytes:
+        data = self._decompress_frame(
+            frame, self._mmap[frame.offset : frame.offset + frame.size]
+        )
+        if len(data) != frame.uncompressed_size:
+            raise IOError(
+                f"Frame at offset {frame.offset} decompressed to {len(data)} "
+                f"bytes, expected {frame.uncompressed_size}"
+            )
+        return data
+
+    def _submit_ahead(self):
+        while len(self._pending) < self._max_pending and self._next_submit < len(
+            self._frames
+        ):
+            frame = self._frames[self._next_submit]
+            if not self._pending:
+                self._budget.acquire(frame.uncompressed_size)
+            elif not self._budget.try_acquire(frame.uncompressed_size):
+                break
+            self._pending.append(
+                (
+                    self._executor.submit(self._decompress, frame),
+                    frame.uncompressed_size,
+                )
+            )
+            self._next_submit += 1
+
+    def _cancel_pending(self):
+        for future, size in self._pending:
+            future.cancel()
+            self._budget.release(size)
+        self._pending.clear()
+
+    def _load_frame(self, index: int):
+        if index != self._next_submit - len(self._pending):
+            # Not the next prefetched frame: restart prefetching there.
+            self._cancel_pending()
+            self._next_submit = index
+        self._submit_ahead()
+        future, size = self._pending.popleft()
+        try:
+            self._frame_data = future.result()
+        finally:
+            self._budget.release(size)
+        self._frame_index = index
+        self._submit_ahead()
+
+    def readinto(self, b) -> int:
+        if self._pos >= self._size:
+            return 0
+        index = bisect.bisect_right(self._frame_starts, self._pos) - 1
+        if index != self._frame_index:
+            self._load_frame(index)
+        start = self._pos - self._frames[index].uncompressed_offset
+        n = min(len(b), len(self._frame_data) - start)
+        b[:n] = memoryview(self._frame_data)[start : start + n]
+        self._pos += n
+        return n
+
+    def close(self):
+        if self.closed:
+            return
+        self._cancel_pending()
+        self._executor.shutdown(wait=True)
+        self._mmap.close()
+        self._file.close()
+        super().close()
+
+
+def _open_multi_frame_for_read(
+    path: Path,
+    scan_frames: Callable[[mmap.mmap], list[_Frame] | None],
+    decompress_frame: Callable[[_Frame, bytes], bytes],
+    threads: int,
+) -> tarfile.TarFile | None:
+    """Opens `path` with parallel decompression if it has several frames."""
+    if threads <= 1 or os.path.getsize(path) == 0:
+        return None
+    with open(path, "rb") as f, mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ) as m:
+        try:
+            frames = scan_frames(m)
+        except (ValueError, IndexError, struct.error, _get_pyzstd().ZstdError):
+            # Let the sequential reader report on malformed files.
+            frames = None
+    if not frames or len(frames) < 2:
+        return None
+    reader = io.BufferedReader(
+        _ParallelFrameReader(path, frames, decompress_frame, threads),
+        buffer_size=1 << 20,
+    )
+    try:
+        tf = _OwningTarFile(fileobj=reader, mode="r")
+    except BaseException:
+        reader.close()
+        raise
+    tf._owned_files = (reader,)
+    return tf
+
+
+def _open_framed_for_write(
+    path: Path,
+    compress_frame: Callable[[bytes], bytes],
+    frame_size: int,
+    *,
+    raw_mode: str = "wb",
+    prefix: bytes = b"",
+) -> tarfile.TarFile:
+    raw = open(path, raw_mode)
+    try:
+        raw.write(prefix)
+        writer = _FramedWriter(raw, compress_frame, frame_size)
+        tf = _OwningTarFile(fileobj=writer, mode="w")
+    except BaseException:
+        raw.close()
+        raise
+    tf._owned_files = (writer,)
+    return tf
+
+
+# =============================================================================
+# Parallel gzip
+# =============================================================================
+
+
+def _deflate_block(block: bytes, zdict: bytes, level: int) -> bytes:
+    if zdict:
+        compressor = zlib.compressobj(level, zlib.DEFLATED, -15, zdict=zdict)
+    else:
+        compressor = zlib.compressobj(level, zlib.DEFLATED, -15)
+    # A sync flush ends the block on a byte boundary without ending the
+    # stream, so the blocks can simply be concatenated.
+    return compressor.compress(block) + compressor.flush(zlib.Z_SYNC_FLUSH)
+
+
+class ParallelGzipWriter(io.RawIOBase):
+    """Writes a gzip file, compressing blocks on several threads (like pigz).
+
+    Input is cut into `block_size` blocks that are deflated concurrently, each
+    primed with the last 32 KiB of the block before it. The output is a single
+    ordinary gzip member (readable by any gunzip) with a ratio typically within
+    a fraction of a percent of single-threaded gzip at the same level. The header
+    carries no file name or mtime, so the output only depends on the input and
+    the level. Closing it closes `raw`.
+    """
+
+    def __init__(
+        self,
+        raw: BinaryIO,
+        *,
+        level: int = 6,
+        threads: int | None = None,
+        block_size: int = DEFAULT_GZIP_BLOCK_SIZE,
+    ):
+        self._raw = raw
+        self._level = level
+        self._block_size = block_size
+        threads = threads or os.cpu_count() or 1
+        self._executor = concurrent.futures.ThreadPoolExecutor(
+            max_workers=threads, thread_name_prefix="gzip"
+        )
+        # Blocks in flight, in output order. Bounded to limit memory use.
+        self._pending: collections.deque[concurrent.futures.Future] = (
+            collections.deque()
+        )
+        self._max_pending = 2 * threads
+        self._buffer = bytearray()
+        self._window = b""
+        self._crc = 0
+        self._size = 0
+        # Magic, deflate, no flags, no mtime, no extra flags, unknown OS.
+        self._raw.write(b"\x1f\x8b\x08\x00\x00\x00\x00\x00\x00\xff")
+
+    def writable(self) -> bool:
+        return True
+
+    def write(self, b) -> int:
+        self._buffer += b
+        while len(self._buffer) >= self._block_size:
+            self._submit(bytes(self._buffer[: self._block_size]))
+            del self._buffer[: self._block_size]
+        return len(b)
+
+    def tell(self) -> int:
+        return self._size + len(self._buffer)
+
+    def _submit(self, block: bytes):
+        self._crc = zlib.crc32(block, self._crc)
+        self._size += len(block)
+        self._pending.append(
+            self._executor.submit(_deflate_block, block, self._window, self._level)
+        )
+        self._window = (self._window + block)[-_DEFLATE_WINDOW_SIZE:]
+        while len(self._pending) > self._max_pending:
+            self._raw.write(self._pending.popleft().result())
+
+    def close(self):
+        if self.closed:
+            return
+        try:
+            if self._buffer:
+                self._submit(bytes(self._buffer))
+                self._buffer.clear()
+            while self._pending:
+                self._raw.write(self._pending.popleft().result())
+            # An empty final block ends the deflate stream.
+            self._raw.write(zlib.compressobj(self._level, zlib.DEFLATED, -15).flush())
+            self._raw.write(struct.pack("<II", self._crc, self._size & 0xFFFFFFFF))
+        finally:
+            self._executor.shutdown(cancel_futures=True)
+            self._raw.close()
+            super().close()
+
+
+# =============================================================================
+# Archive open helpers
+# =============================================================================
+
+
+def open_archive_for_read(
+    path: Path,
+    *,
+    zstd_dict_dirs: Sequence[Path] | None = None,
+    threads: int | None = None,
+) -> tarfile.TarFile:
+    """Open a tar archive for reading, auto-detecting compression from extension.
+
+    Zstd archives compressed against a dictionary are handled transparently
+    (see `read_zstd_dict_frame`). Multi-frame archives are decompressed by up
+    to `threads` threads (default `DEFAULT_DECOMPRESS_THREADS`) ahead of the
+    tar reader; single-frame archives are read sequentially.
+    """
+    if threads is None:
+        threads = DEFAULT_DECOMPRESS_THREADS
     if path.name.endswith(".tar.zst"):
+        zstd_dict = read_zstd_dict_frame(path, zstd_dict_dirs)
+        pyzstd = _get_pyzstd()
+        tf = _open_multi_frame_for_read(
+            path,
+            _scan_zstd_frames,
+            lambda frame, data: pyzstd.decompress(data, zstd_dict),
+            threads,
+        )
+        if tf is not None:
+            return tf
+        if zstd_dict is not None:
+            return ZstdTarFile(path, mode="rb", zstd_dict=zstd_dict)
         return ZstdTarFile(path, mode="rb")
     elif path.name.endswith(".tar.xz"):
+        tf = _open_multi_frame_for_read(
+            path, _scan_xz_blocks, _decompress_xz_block, threads
+        )
+        if tf is not None:
+            return tf
         return tarfile.TarFile.open(path, mode="r:xz")
     else:
         raise ValueError(f"Unknown archive format: {path}")
 
 
+class _PrefixedReader:
+    """Reader that replays already-consumed bytes before the rest of `f`."""
+
+    def __init__(self, prefix: bytes, f: BinaryIO):
+        self._prefix = prefix
+        self._f = f
+
+    def read(self, size: int = -1) -> bytes:
+        if not self._prefix:
+            return self._f.read(size)
+        if size < 0:
+            data = self._prefix + self._f.read()
+            self._prefix = b""
+            return data
+        data, self._prefix = self._prefix[:size], self._prefix[size:]
+        return data
+
+    def readable(self) -> bool:
+        return True
+
+
+class _ReadAheadReader(io.RawIOBase):
+    """Reads `f` on a background thread, up to `depth` chunks ahead.
+
+    Stacked on a network body and on a decompressor, this overlaps
+    downloading, decompressing and extracting (all of which release the GIL
+    for their heavy lifting). An error is raised to the reader, on this and
+    every later read. Closing waits for the thread to stop (after the read in
+    progress, if any), so `f` may be closed next, but does not close `f`.
+    """
+
+    def __init__(self, f: BinaryIO, chunk_size: int = 1 << 20, depth: int = 8):
+        self._f = f
+        self._chunk_size = chunk_size
+        self._queue = queue.Queue(maxsize=depth)
+        self._stop = threading.Event()
+        self._buffer = memoryview(b"")
+        self._eof = False
+        self._error: BaseException | None = None
+        self._thread = threading.Thread(target=self._produce, daemon=True)
+        self._thread.start()
+
+    def _produce(self):
+        try:
+            while not self._stop.is_set():
+                chunk = self._f.read(self._chunk_size)
+                self._put(chunk)
+                if not chunk:
+                    return
+        except BaseException as e:
+            self._put(e)
+
+    def _put(self, item):
+        while not self._stop.is_set():
+            try:
+                self._queue.put(item, timeout=0.1)
+                return
+            except queue.Full:
+                pass
+
+    def readable(self) -> bool:
+        return True
+
+    def readinto(self, b) -> int:
+        if self._error is not None:
+            raise self._error
+        if not self._buffer and not self._eof:
+            item = self._queue.get()
+            if isinstance(item, BaseException):
+                self._error = item
+                raise item
+            if not item:
+                self._eof = True
+            self._buffer = memoryview(item)
+        size = min(len(b), len(self._buffer))
+        b[:size] = self._buffer[:size]
+        self._buffer = self._buffer[size:]
+        return size
+
+    def close(self):
+        self._stop.set()
+        self._thread.join()
+        super().close()
+
+
+class _OwningTarFile(tarfile.TarFile):
+    """TarFile that also closes the file objects it was opened on."""
+
+    _owned_files: tuple = ()
+
+    def close(self) -> None:
+        try:
+            super().close()
+        finally:
+            for f in self._owned_files:
+                f.close()
+
+    def __exit__(self, type, value, traceback):
+        if type is None:
+            self.close()
+        else:
+            # TarFile leaves external file objects open on error.
+            super().__exit__(type, value, traceback)
+            for f in self._owned_files:
+                f.close()
+
+
+def open_archive_stream_for_read(
+    fileobj: BinaryIO, name: str, *, zstd_dict_dirs: Sequence[Path] | None = None
+) -> tarfile.TarFile:
+    """Open a non-seekable archive stream (e.g. an HTTP body) for reading.
+
+    `name` is the archive's file name, used to detect the compression. The
+    returned TarFile only supports sequential access (iterating members and
+    extracting each one as it is reached), which avoids landing the archive
+    on disk. Reading `fileobj` and decompressing run on their own threads,
+    ahead of the tar reader. Besides our zstd/xz archives, gzip tarballs
+    (`.tar.gz`, `.tgz`, e.g. release tarballs) are supported. Closing it
+    closes `fileobj`.
+    """
+    # Closed in this order (readers before what they read from).
+    owned_files = [fileobj]
+    try:
+        if name.endswith(".tar.zst"):
+            zstd_dict, unconsumed = _read_zstd_dict_header(
+                fileobj, zstd_dict_dirs, name
+            )
+            source = _PrefixedReader(unconsumed, fileobj) if unconsumed else fileobj
+            zstd_kwargs = {} if zstd_dict is None else {"zstd_dict": zstd_dict}
+            source = _ReadAheadReader(source)
+            owned_files.insert(0, source)
+            decompressed = _get_pyzstd().ZstdFile(source, mode="rb", **zstd_kwargs)
+        elif name.endswith(".tar.xz"):
+            source = _ReadAheadReader(fileobj)
+            owned_files.insert(0, source)
+            # LZMAFile (unlike tarfile's "r|xz") reads concatenated streams.
+            decompressed = lzma.LZMAFile(source, mode="rb")
+        elif name.endswith((".tar.gz", ".tgz")):
+            source = _ReadAheadReader(fileobj)
+            owned_files.insert(0, source)
+            # GzipFile (like LZMAFile) reads concatenated members.
+            decompressed = gzip.GzipFile(fileobj=source, mode="rb")
+        else:
+            raise ValueError(f"Unknown archive format: {name}")
+        owned_files.insert(0, decompressed)
+        decompressed = _ReadAheadReader(decompressed)
+        owned_files.insert(0, decompressed)
+        tf = _OwningTarFile.open(fileobj=decompressed, mode="r|")
+        tf._owned_files = tuple(owned_files)
+    except BaseException:
+        for f in owned_files:
+            f.close()
+        raise
+    return tf
+
+
+def open_compressed_for_write(
+    path: Path, compression_level: int | None = None, *, threads: int | None = None
+) -> BinaryIO:
+    """Open `path` for writing a stream compressed according to its extension.
+
+    Supports `.tar` (uncompressed), `.tar.gz`/`.tgz`, `.tar.bz2`, `.tar.xz` and
+    `.tar.zst`, all compressed on up to `threads` threads (default: all
+    CPUs). bzip2 and xz are written as a sequence of independently compressed
+    streams (see `_FramedWriter`), which standard decompressors read as one.
+    Compression parameters are fixed and no names or timestamps are embedded,
+    so the same input always produces the same bytes, regardless of
+    `threads`.
+    """
+    threads = threads or os.cpu_count() or 1
+    name = path.name
+    if name.endswith(".tar"):
+        return open(path, "wb")
+    elif name.endswith(".tar.gz") or name.endswith(".tgz"):
+        level = compression_level if compression_level is not None else 6
+        return ParallelGzipWriter(open(path, "wb"), level=level, threads=threads)
+    elif name.endswith(".tar.bz2"):
+        level = compression_level if compression_level is not None else 9
+        # Concatenated streams of one bzip2 block each (like pbzip2).
+        return _FramedWriter(
+            open(path, "wb"),
+            lambda data: bz2.compress(data, level),
+            level * 100_000,
+            threads=threads,
+        )
+    elif name.endswith(".tar.xz"):
+        level = compression_level if compression_level is not None else 6
+        return _FramedWriter(
+            open(path, "wb"),
+            lambda data: lzma.compress(data, format=lzma.FORMAT_XZ, preset=level),
+            DEFAULT_XZ_FRAME_SIZE,
+            threads=threads,
+        )
+    elif name.endswith(".tar.zst"):
+        pyzstd = _get_pyzstd()
+        level = compression_level if compression_level is not None else 3
+        # zstd output differs between single-threaded mode (nbWorkers=0) and
+        # worker mode, but not between worker counts, so always use workers.
+        return pyzstd.ZstdFile(
+            path,
+            "wb",
+            level_or_option={
+                pyzstd.CParameter.compressionLevel: level,
+                pyzstd.CParameter.nbWorkers: threads,
+            },
+        )
+    else:
+        raise ValueError(f"Unsupported archive file extension for: {name}")
+
+
 def open_archive_for_write(
-    path: Path, compression_type: str, compression_level: int | None = None
+    path: Path,
+    compression_type: str,
+    compression_level: int | None = None,
+    *,
+    zstd_dict_path: Path | None = None,
+    zstd_dict_mode: str = "reference",
+    frame_size: int | None = None,
 ) -> tarfile.TarFile:
-    """Open a tar archive for writing with the specified compression."""
+    """Open a tar archive for writing with the specified compression.
+
+    If `zstd_dict_path` is given (zstd only), the archive is compressed against
+    that dictionary, which is referenced by id (readers then need it, see
+    `open_archive_for_read(zstd_dict_dirs=...)`) or embedded in the archive,
+    according to `zstd_dict_mode`.
+
+    If `frame_size` is given, every `frame_size` uncompressed bytes are
+    compressed independently (as a zstd frame or an xz stream), so that
+    readers can decompress the archive in parallel.
+    """
     if compression_type == "zstd":
         level = compression_level if compression_level is not None else 3
+        if frame_size:
+            pyzstd = _get_pyzstd()
+            zstd_dict = None
+            prefix = b""
+            if zstd_dict_path is not None:
+                zstd_dict = load_zstd_dict(zstd_dict_path)
+                prefix = _make_zstd_dict_frame(zstd_dict, zstd_dict_mode)
+            return _open_framed_for_write(
+                path,
+                lambda data: pyzstd.compress(data, level, zstd_dict),
+                frame_size,
+                prefix=prefix,
+            )
+        if zstd_dict_path is not None:
+            zstd_dict = load_zstd_dict(zstd_dict_path)
+            return ZstdTarFile(
+                path,
+                "wb",
+                dict_frame=_make_zstd_dict_frame(zstd_dict, zstd_dict_mode),
+                level_or_option=level,
+                zstd_dict=zstd_dict,
+            )
         return ZstdTarFile(path, "wb", level_or_option=level)
     elif compression_type == "xz":
+        if zstd_dict_path is not None:
+            raise ValueError("zstd dictionaries are only supported for zstd")
         level = compression_level if compression_level is not None else 6
+        if frame_size:
+            return _open_framed_for_write(
+                path,
+                lambda data: lzma.compress(data, format=lzma.FORMAT_XZ, preset=level),
+                frame_size,
+                raw_mode="xb",
+            )
         return tarfile.TarFile.open(path, mode="x:xz", preset=level)
     else:
         raise ValueError(f"Unknown compression type: {compression_type}")
@@ -18,10 +18,15 @@ Environment-based switching:
 from abc import ABC, abstractmethod
 from dataclasses import dataclass
 from pathlib import Path
-from typing import List, Optional, Set
+from typing import BinaryIO, Dict, Iterable, List, Optional, Set
+import concurrent.futures
 import os
-import shutil
+import tempfile
+import threading
+import time
 
+from .content_store import DELTA_SUFFIX, INDEX_SUFFIX
+from .os_util import LINK_MODES, copy_file, replace_with_link_or_copy
 from .workflow_outputs import WorkflowOutputRoot
 
 
@@ -33,9 +38,46 @@ class ArtifactLocation:
     full_path: str  # Backend-specific full path/URI
 
 
+@dataclass
+class ArtifactStat:
+    """Size and, when the backend provides one, ETag of a stored artifact."""
+
+    size: int
+    etag: Optional[str] = None
+
+
+# Default size of the S3 client's connection pool
+DEFAULT_S3_MAX_POOL_CONNECTIONS = 100
+
+# Parts of multipart objects copied or uploaded at a time by one S3 backend
+# (shared by all artifacts being transferred).
+DEFAULT_PART_CONCURRENCY = 16
+
+# Size above which boto3 uploads in parts (its default `multipart_threshold`).
+_S3_MULTIPART_THRESHOLD = 8 * 1024 * 1024
+# Part size of streamed uploads: boto3's default `multipart_chunksize` (and
+# `multipart_threshold`), so a streamed archive gets the same ETag as one
+# uploaded from a file.
+_S3_STREAM_PART_SIZE = 8 * 1024 * 1024
+# Parts of one streamed upload buffered in memory at a time.
+_S3_STREAM_PARTS_IN_FLIGHT = 4
+_S3_MAX_PARTS = 10000
+
 # Supported artifact archive extensions (in order of preference)
 ARTIFACT_EXTENSIONS = (".tar.zst", ".tar.xz")
 
+# Optional companion files stored next to an artifact archive.
+ARTIFACT_SIDECAR_SUFFIXES = (".sha256sum", INDEX_SUFFIX, DELTA_SUFFIX)
+
+
+# How long a backend reuses its listing to answer list, exists and stat
+# queries. Artifacts of a run are only added, so this just bounds how late
+# artifacts pushed by other jobs are seen.
+DEFAULT_LISTING_TTL_SECONDS = 60.0
+
+# Guards the listing cache of all backends (refreshes are rare).
+_LISTING_LOCK = threading.Lock()
+
 
 def _is_artifact_archive(filename: str) -> bool:
     """Check if a filename is a recognized artifact archive."""
@@ -43,7 +85,67 @@ def _is_artifact_archive(filename: str) -> bool:
 
 
 class ArtifactBackend(ABC):
-    """Abstract base for artifact storage backends."""
+    """Abstract base for artifact storage backends.
+
+    One listing of the run (every archive and sidecar, with sizes and ETags)
+    is cached for `listing_ttl_seconds`. While it is fresh, `list_*`,
+    `artifact_exists` and `stat_artifact` are answered from memory instead
+    of a request each, and uploads through this backend are added to it.
+    """
+
+    listing_ttl_seconds: float = DEFAULT_LISTING_TTL_SECONDS
+    _listing: Optional[Dict[str, ArtifactStat]] = None
+    _listing_time: float = 0.0
+
+    @abstractmethod
+    def _list_objects(self) -> Dict[str, ArtifactStat]:
+        """List every file of the run (archives and sidecars), uncached."""
+        pass
+
+    def list_objects(self, refresh: bool = False) -> Dict[str, ArtifactStat]:
+        """Return the cached listing of the run, listing it if stale."""
+        with _LISTING_LOCK:
+            listing = None if refresh else self.cached_listing()
+            if listing is None:
+                listing = self._list_objects()
+                self._listing = listing
+                self._listing_time = time.monotonic()
+            return listing
+
+    def seed_listing(self, files: Dict[str, ArtifactStat]) -> None:
+        """Use `files` (e.g. from the run index) as a fresh listing of the run."""
+        with _LISTING_LOCK:
+            self._listing = dict(files)
+            self._listing_time = time.monotonic()
+
+    @abstractmethod
+    def list_directory(self, subdir: str) -> Dict[str, ArtifactStat]:
+        """List the files directly in `subdir` of the run, uncached.
+
+        Returns an empty dict if the directory doesn't exist.
+        """
+        pass
+
+    def cached_listing(self) -> Optional[Dict[str, ArtifactStat]]:
+        """Return the listing if it is still fresh, else None."""
+        if self._listing is None:
+            return None
+        if time.monotonic() - self._listing_time >= self.listing_ttl_seconds:
+            return None
+        return self._listing
+
+    def _record_object(self, filename: str, stat: Optional[ArtifactStat]) -> None:
+        """Add a file written through this backend to the cached listing.
+
+        If its `stat` is unknown, the listing is dropped instead.
+        """
+        with _LISTING_LOCK:
+            if self._listing is None:
+                return
+            if stat is None:
+                self._listing = None
+            else:
+                self._listing[filename] = stat
 
     @abstractmethod
     def list_artifacts(self, name_filter: Optional[str] = None) -> List[str]:
@@ -57,6 +159,22 @@ class ArtifactBackend(ABC):
         """
         pass
 
+    def list_artifact_stats(
+        self, name_filter: Optional[str] = None
+    ) -> Dict[str, ArtifactStat]:
+        """Like `list_artifacts`, with each artifact's size and ETag.
+
+        The metadata comes with the listing, without a request per artifact.
+        """
+        return {
+            filename: stat
+            for filename, stat in self.list_objects().items()
+            # Skip non-artifact files (also excludes .sha256sum files)
+            if _is_artifact_archive(filename)
+            # Apply name filter if provided
+            and (name_filter is None or filename.startswith(f"{name_filter}_"))
+        }
+
     @abstractmethod
     def download_artifact(self, artifact_key: str, dest_path: Path) -> None:
         """Download/copy an artifact to a local path.
@@ -67,6 +185,31 @@ class ArtifactBackend(ABC):
         """
         pass
 
+    @abstractmethod
+    def open_artifact(
+        self, artifact_key: str, start: int = 0, length: Optional[int] = None
+    ) -> BinaryIO:
+        """Open an artifact for sequential reading, without landing it on disk.
+
+        The returned object only needs to support `read()` and `close()`.
+
+        Args:
+            artifact_key: The artifact filename
+            start: Byte offset to start reading at (e.g. to resume a download)
+            length: Number of bytes the caller will read (default: to the
+                end). Lets remote backends request just that range; the
+                stream may extend past it.
+
+        Raises:
+            FileNotFoundError: If the artifact doesn't exist.
+        """
+        pass
+
+    @abstractmethod
+    def stat_artifact(self, artifact_key: str) -> Optional[ArtifactStat]:
+        """Return the artifact's size and ETag, or None if it doesn't exist."""
+        pass
+
     @abstractmethod
     def upload_artifact(self, source_path: Path, artifact_key: str) -> None:
         """Upload/copy a local artifact to the backend.
@@ -77,6 +220,23 @@ class ArtifactBackend(ABC):
         """
         pass
 
+    def upload_artifact_stream(
+        self, chunks: Iterable[bytes], artifact_key: str
+    ) -> ArtifactStat:
+        """Upload an artifact from chunks produced while it is being written.
+
+        Unlike `upload_artifact`, sidecars are not uploaded. If `chunks`
+        raises, nothing is stored. The default implementation spools the
+        chunks to a temporary file and uploads that.
+        """
+        with tempfile.TemporaryDirectory() as temp_dir:
+            spool_path = Path(temp_dir) / artifact_key
+            with open(spool_path, "wb") as f:
+                for chunk in chunks:
+                    f.write(chunk)
+            self.upload_artifact(spool_path, artifact_key)
+            return ArtifactStat(size=spool_path.stat().st_size)
+
     @abstractmethod
     def artifact_exists(self, artifact_key: str) -> bool:
         """Check if an artifact exists in the backend."""
@@ -85,14 +245,18 @@ class ArtifactBackend(ABC):
     @abstractmethod
     def copy_artifact(
         self, artifact_key: str, source_backend: "ArtifactBackend"
-    ) -> None:
+    ) -> bool:
         """Copy an artifact from source_backend into this backend (server-side when possible).
 
-        Also copies the companion .sha256sum file if it exists in the source.
+        Also copies the companion .sha256sum, .index.json and .delta files if
+        they exist in the source.
 
         Args:
             artifact_key: The artifact filename (e.g., "blas_lib_gfx94X.tar.zst")
             source_backend: The backend to copy from
+
+        Returns:
+            False if everything was already identical in this backend.
         """
         pass
 
@@ -110,11 +274,26 @@ class LocalDirectoryBackend(ArtifactBackend):
 
         {staging_dir}/{output_root.prefix}/
             {artifact_name}_{component}_{target_family}.tar.zst
+
+    Archives are transferred with `link_mode` (see `os_util.link_or_copy`):
+    by default as a reflink or hard link when both sides are on the same
+    filesystem, else copied with `copy_file_range`. Destinations are always
+    replaced rather than written to, so a hard-linked archive is never
+    modified through another name. Sidecars are small and rewritten in place
+    by the tools that produce them, so they are always copied.
     """
 
-    def __init__(self, staging_dir: Path, output_root: WorkflowOutputRoot):
+    def __init__(
+        self,
+        staging_dir: Path,
+        output_root: WorkflowOutputRoot,
+        link_mode: str = "auto",
+    ):
+        if link_mode not in LINK_MODES:
+            raise ValueError(f"Unknown link mode: {link_mode}")
         self.staging_dir = Path(staging_dir)
         self.output_root = output_root
+        self.link_mode = link_mode
         self.base_path.mkdir(parents=True, exist_ok=True)
 
     @property
@@ -132,48 +311,111 @@ class LocalDirectoryBackend(ArtifactBackend):
 
     def list_artifacts(self, name_filter: Optional[str] = None) -> List[str]:
         """List artifacts in local staging directory."""
-        artifacts = []
-        if not self.base_path.exists():
-            return artifacts
-        for p in self.base_path.iterdir():
-            filename = p.name
-            # Skip non-artifact files (also excludes .sha256sum files)
-            if not _is_artifact_archive(filename):
-                continue
-            # Apply name filter if provided
-            if name_filter is not None and not filename.startswith(f"{name_filter}_"):
-                continue
-            artifacts.append(filename)
-        return sorted(artifacts)
+        return sorted(self.list_artifact_stats(name_filter))
+
+    def _list_objects(self) -> Dict[str, ArtifactStat]:
+        """List files in local staging directory with their sizes."""
+        return self._scan_files(self.base_path)
+
+    def list_directory(self, subdir: str) -> Dict[str, ArtifactStat]:
+        return self._scan_files(self.base_path / subdir)
+
+    @staticmethod
+    def _scan_files(path: Path) -> Dict[str, ArtifactStat]:
+        files = {}
+        if not path.exists():
+            return files
+        for entry in os.scandir(path):
+            if entry.is_file():
+                files[entry.name] = ArtifactStat(size=entry.stat().st_size)
+        return files
+
+    def _transfer(self, src: Path, dest: Path) -> str:
+        """Link or copy an archive to `dest`, replacing it if it exists."""
+        return replace_with_link_or_copy(src, dest, self.link_mode)
 
     def download_artifact(self, artifact_key: str, dest_path: Path) -> None:
-        """Copy artifact from staging to destination."""
+        """Link or copy artifact from staging to destination."""
+        self.materialize_artifact(artifact_key, dest_path)
+        # Also copy sidecars if they exist
+        for suffix in ARTIFACT_SIDECAR_SUFFIXES:
+            sidecar_src = self._artifact_path(f"{artifact_key}{suffix}")
+            if sidecar_src.exists():
+                copy_file(sidecar_src, dest_path.parent / f"{artifact_key}{suffix}")
+
+    def materialize_artifact(self, artifact_key: str, dest_path: Path) -> str:
+        """Link or copy just the archive to `dest_path`, without sidecars.
+
+        Returns the method used ("reflink", "hardlink" or "copy").
+        """
         src = self._artifact_path(artifact_key)
         if not src.exists():
             raise FileNotFoundError(f"Artifact not found in local staging: {src}")
         dest_path.parent.mkdir(parents=True, exist_ok=True)
-        shutil.copy2(src, dest_path)
-        # Also copy sha256sum if it exists
-        sha_src = self._artifact_path(f"{artifact_key}.sha256sum")
-        if sha_src.exists():
-            shutil.copy2(sha_src, dest_path.parent / f"{artifact_key}.sha256sum")
+        return self._transfer(src, dest_path)
+
+    def open_artifact(
+        self, artifact_key: str, start: int = 0, length: Optional[int] = None
+    ) -> BinaryIO:
+        """Open an artifact in staging for reading."""
+        src = self._artifact_path(artifact_key)
+        if not src.exists():
+            raise FileNotFoundError(f"Artifact not found in local staging: {src}")
+        f = open(src, "rb")
+        if start:
+            f.seek(start)
+        return f
+
+    def stat_artifact(self, artifact_key: str) -> Optional[ArtifactStat]:
+        """Stat an artifact in staging (local files have no ETag)."""
+        listing = self.cached_listing()
+        if listing is not None:
+            return listing.get(artifact_key)
+        try:
+            return ArtifactStat(size=self._artifact_path(artifact_key).stat().st_size)
+        except FileNotFoundError:
+            return None
 
     def upload_artifact(self, source_path: Path, artifact_key: str) -> None:
-        """Copy artifact from source to staging."""
+        """Link or copy artifact from source to staging."""
         if not source_path.exists():
             raise FileNotFoundError(f"Source artifact not found: {source_path}")
         dest = self._artifact_path(artifact_key)
         dest.parent.mkdir(parents=True, exist_ok=True)
-        shutil.copy2(source_path, dest)
-        # Also copy sha256sum if it exists
-        sha_src = source_path.parent / f"{source_path.name}.sha256sum"
-        if sha_src.exists():
-            shutil.copy2(sha_src, self._artifact_path(f"{artifact_key}.sha256sum"))
+        self._transfer(source_path, dest)
+        self._record_object(artifact_key, ArtifactStat(size=dest.stat().st_size))
+        # Also copy sidecars if they exist
+        for suffix in ARTIFACT_SIDECAR_SUFFIXES:
+            sidecar_src = source_path.parent / f"{source_path.name}{suffix}"
+            if sidecar_src.exists():
+                sidecar_dest = self._artifact_path(f"{artifact_key}{suffix}")
+                copy_file(sidecar_src, sidecar_dest)
+                self._record_object(
+                    sidecar_dest.name, ArtifactStat(size=sidecar_dest.stat().st_size)
+                )
+
+    def upload_artifact_stream(
+        self, chunks: Iterable[bytes], artifact_key: str
+    ) -> ArtifactStat:
+        """Write the chunks to staging, renaming into place when complete."""
+        dest = self._artifact_path(artifact_key)
+        dest.parent.mkdir(parents=True, exist_ok=True)
+        partial = dest.with_name(f"{dest.name}.partial")
+        try:
+            with open(partial, "wb") as f:
+                for chunk in chunks:
+                    f.write(chunk)
+            os.replace(partial, dest)
+        finally:
+            partial.unlink(missing_ok=True)
+        stat = ArtifactStat(size=dest.stat().st_size)
+        self._record_object(artifact_key, stat)
+        return stat
 
     def copy_artifact(
         self, artifact_key: str, source_backend: "ArtifactBackend"
-    ) -> None:
-        """Copy artifact from another local backend."""
+    ) -> bool:
+        """Link or copy artifact from another local backend."""
         if not isinstance(source_backend, LocalDirectoryBackend):
             raise TypeError(
                 f"Cannot copy from {type(source_backend).__name__} to LocalDirectoryBackend"
@@ -183,14 +425,24 @@ class LocalDirectoryBackend(ArtifactBackend):
             raise FileNotFoundError(f"Artifact not found in source backend: {src}")
         dest = self.base_path / artifact_key
         dest.parent.mkdir(parents=True, exist_ok=True)
-        shutil.copy2(src, dest)
-        # Also copy sha256sum if it exists
-        sha_src = source_backend.base_path / f"{artifact_key}.sha256sum"
-        if sha_src.exists():
-            shutil.copy2(sha_src, self.base_path / f"{artifact_key}.sha256sum")
+        self._transfer(src, dest)
+        self._record_object(artifact_key, ArtifactStat(size=dest.stat().st_size))
+        # Also copy sidecars if they exist
+        for suffix in ARTIFACT_SIDECAR_SUFFIXES:
+            sidecar_key = f"{artifact_key}{suffix}"
+            if source_backend.artifact_exists(sidecar_key):
+                sidecar_dest = self.base_path / sidecar_key
+                copy_file(source_backend.base_path / sidecar_key, sidecar_dest)
+                self._record_object(
+                    sidecar_key, ArtifactStat(size=sidecar_dest.stat().st_size)
+                )
+        return True
 
     def artifact_exists(self, artifact_key: str) -> bool:
         """Check if artifact exists in local staging."""
+        listing = self.cached_listing()
+        if listing is not None:
+            return artifact_key in listing
         return self._artifact_path(artifact_key).exists()
 
 
@@ -203,9 +455,18 @@ class S3Backend(ArtifactBackend):
             {artifact_name}_{component}_{target_family}.tar.zst
     """
 
-    def __init__(self, output_root: WorkflowOutputRoot):
+    def __init__(
+        self,
+        output_root: WorkflowOutputRoot,
+        max_pool_connections: int = DEFAULT_S3_MAX_POOL_CONNECTIONS,
+        part_concurrency: int = DEFAULT_PART_CONCURRENCY,
+    ):
         self.output_root = output_root
+        self.max_pool_connections = max_pool_connections
+        self.part_concurrency = part_concurrency
         self._s3_client = None
+        self._parts_executor = None
+        self._parts_lock = threading.Lock()
 
     @property
     def bucket(self) -> str:
@@ -243,13 +504,16 @@ class S3Backend(ArtifactBackend):
                 self._s3_client = session.client(
                     "s3",
                     verify=True,
-                    config=Config(max_pool_connections=100),
+                    config=Config(max_pool_connections=self.max_pool_connections),
                 )
             else:
                 self._s3_client = session.client(
                     "s3",
                     verify=True,
-                    config=Config(max_pool_connections=100, signature_version=UNSIGNED),
+                    config=Config(
+                        max_pool_connections=self.max_pool_connections,
+                        signature_version=UNSIGNED,
+                    ),
                 )
         return self._s3_client
 
@@ -259,30 +523,32 @@ class S3Backend(ArtifactBackend):
 
     def list_artifacts(self, name_filter: Optional[str] = None) -> List[str]:
         """List S3 artifacts."""
-        paginator = self.s3_client.get_paginator("list_objects_v2")
-        page_iterator = paginator.paginate(Bucket=self.bucket, Prefix=self.s3_prefix)
+        return sorted(self.list_artifact_stats(name_filter))
 
-        artifacts = []
-        for page in page_iterator:
-            if "Contents" not in page:
-                continue
-            for obj in page["Contents"]:
-                key = obj["Key"]
-                # Extract filename from full key
-                if "/" in key:
-                    filename = key.split("/")[-1]
-                else:
-                    filename = key
-                # Skip non-artifact files (also excludes .sha256sum files)
-                if not _is_artifact_archive(filename):
-                    continue
-                # Apply name filter if provided
-                if name_filter is not None and not filename.startswith(
-                    f"{name_filter}_"
-                ):
-                    continue
-                artifacts.append(filename)
-        return sorted(set(artifacts))
+    def _list_objects(self) -> Dict[str, ArtifactStat]:
+        """List the S3 objects directly under the run with the size and ETag
+        from the listing.
+
+        Objects in subdirectories of the run (e.g. `artifact_index/`) are not
+        artifacts and are left out, as in `LocalDirectoryBackend`.
+        """
+        return self._list_prefix(f"{self.s3_prefix}/")
+
+    def list_directory(self, subdir: str) -> Dict[str, ArtifactStat]:
+        """List the objects directly under `subdir` of the run."""
+        return self._list_prefix(f"{self.s3_prefix}/{subdir}/")
+
+    def _list_prefix(self, prefix: str) -> Dict[str, ArtifactStat]:
+        paginator = self.s3_client.get_paginator("list_objects_v2")
+        files = {}
+        for page in paginator.paginate(
+            Bucket=self.bucket, Prefix=prefix, Delimiter="/"
+        ):
+            for obj in page.get("Contents", []):
+                files[obj["Key"][len(prefix) :]] = ArtifactStat(
+                    size=obj.get("Size", 0), etag=obj.get("ETag", "").strip('"') or None
+                )
+        return files
 
     def download_artifact(self, artifact_key: str, dest_path: Path) -> None:
         """Download from S3."""
@@ -290,38 +556,259 @@ class S3Backend(ArtifactBackend):
         dest_path.parent.mkdir(parents=True, exist_ok=True)
         self.s3_client.download_file(self.bucket, loc.relative_path, str(dest_path))
 
+    def open_artifact(
+        self, artifact_key: str, start: int = 0, length: Optional[int] = None
+    ) -> BinaryIO:
+        """Stream the object body from S3 (a ranged GET for partial reads)."""
+        from botocore.exceptions import ClientError
+
+        loc = self.output_root.artifact(artifact_key)
+        kwargs = {}
+        if length is not None:
+            kwargs["Range"] = f"bytes={start}-{start + length - 1}"
+        elif start:
+            kwargs["Range"] = f"bytes={start}-"
+        try:
+            response = self.s3_client.get_object(
+                Bucket=self.bucket, Key=loc.relative_path, **kwargs
+            )
+        except ClientError as e:
+            if e.response.get("Error", {}).get("Code") in ("404", "NoSuchKey"):
+                raise FileNotFoundError(f"Artifact not found in S3: {loc.s3_uri}")
+            raise
+        return response["Body"]
+
     def upload_artifact(self, source_path: Path, artifact_key: str) -> None:
         """Upload to S3."""
         loc = self.output_root.artifact(artifact_key)
         self.s3_client.upload_file(str(source_path), self.bucket, loc.relative_path)
+        # The ETag of a multipart upload is not known without a HEAD.
+        self._record_object(artifact_key, ArtifactStat(size=source_path.stat().st_size))
+
+    def upload_artifact_stream(
+        self, chunks: Iterable[bytes], artifact_key: str
+    ) -> ArtifactStat:
+        """Multipart upload, sending each part as soon as it is filled.
+
+        Like boto3's `upload_file`, an artifact smaller than the multipart
+        threshold is sent with a single `PutObject` instead (once the stream
+        ends), so it gets the same ETag as a regular upload.
+        """
+        key = self.output_root.artifact(artifact_key).relative_path
+        upload_id = None
+        in_flight = threading.BoundedSemaphore(_S3_STREAM_PARTS_IN_FLIGHT)
+
+        def upload_part(part_number: int, data: bytes) -> dict:
+            try:
+                response = self.s3_client.upload_part(
+                    Bucket=self.bucket,
+                    Key=key,
+                    UploadId=upload_id,
+                    PartNumber=part_number,
+                    Body=data,
+                )
+                return {"PartNumber": part_number, "ETag": response["ETag"]}
+            finally:
+                in_flight.release()
+
+        executor = self._part_executor()
+        futures = []
+        size = 0
+
+        def submit(data: bytes):
+            nonlocal upload_id
+            if len(futures) == _S3_MAX_PARTS:
+                raise ValueError(
+                    f"{artifact_key} needs more than {_S3_MAX_PARTS} parts"
+                )
+            if upload_id is None:
+                upload_id = self.s3_client.create_multipart_upload(
+                    Bucket=self.bucket, Key=key
+                )["UploadId"]
+            # Bounds memory when uploading is slower than writing.
+            in_flight.acquire()
+            futures.append(executor.submit(upload_part, len(futures) + 1, data))
+
+        try:
+            buffer = bytearray()
+            for chunk in chunks:
+                size += len(chunk)
+                buffer += chunk
+                # boto3 uploads in parts from the threshold on (inclusive).
+                while len(buffer) >= _S3_STREAM_PART_SIZE:
+                    submit(bytes(buffer[:_S3_STREAM_PART_SIZE]))
+                    del buffer[:_S3_STREAM_PART_SIZE]
+            if upload_id is None:
+                response = self.s3_client.put_object(
+                    Bucket=self.bucket, Key=key, Body=bytes(buffer)
+                )
+            else:
+                # The last part may be short.
+                if buffer:
+                    submit(bytes(buffer))
+                parts = [future.result() for future in futures]
+                response = self.s3_client.complete_multipart_upload(
+                    Bucket=self.bucket,
+                    Key=key,
+                    UploadId=upload_id,
+                    MultipartUpload={"Parts": parts},
+                )
+        except BaseException:
+            if upload_id is not None:
+                self._abort_multipart_upload(key, upload_id, futures)
+            raise
+        stat = ArtifactStat(size=size, etag=response.get("ETag", "").strip('"') or None)
+        self._record_object(artifact_key, stat)
+        return stat
+
+    def _abort_multipart_upload(
+        self, key: str, upload_id: str, futures: List[concurrent.futures.Future]
+    ) -> None:
+        for future in futures:
+            future.cancel()
+        try:
+            self.s3_client.abort_multipart_upload(
+                Bucket=self.bucket, Key=key, UploadId=upload_id
+            )
+        except Exception:
+            pass
 
     def copy_artifact(
         self, artifact_key: str, source_backend: "ArtifactBackend"
-    ) -> None:
-        """Server-side copy from another S3 backend (cross-bucket supported)."""
+    ) -> bool:
+        """Server-side copy from another S3 backend (cross-bucket supported).
+
+        The archive and its sidecars are looked up in the source listing (no
+        HEAD per sidecar). Objects whose size and ETag already match in this
+        backend are skipped. Multipart objects are copied with parallel
+        `UploadPartCopy` requests using the source's part layout, so the copy
+        keeps the source's ETag and copying it again is skipped.
+        """
         if not isinstance(source_backend, S3Backend):
             raise TypeError(
                 f"Cannot copy from {type(source_backend).__name__} to S3Backend"
             )
+        source_listing = source_backend.list_objects()
+        dest_listing = self.list_objects()
+        if artifact_key not in source_listing:
+            raise FileNotFoundError(
+                f"Artifact not found in source backend: "
+                f"{source_backend.output_root.artifact(artifact_key).s3_uri}"
+            )
+        copied = False
+        for key in [artifact_key] + [
+            f"{artifact_key}{suffix}" for suffix in ARTIFACT_SIDECAR_SUFFIXES
+        ]:
+            stat = source_listing.get(key)
+            if stat is None:
+                continue
+            if stat.etag is not None and dest_listing.get(key) == stat:
+                continue
+            self._copy_object(source_backend, key, stat)
+            self._record_object(key, stat)
+            copied = True
+        return copied
+
+    def _copy_object(
+        self, source_backend: "S3Backend", key: str, stat: ArtifactStat
+    ) -> None:
         copy_source = {
             "Bucket": source_backend.bucket,
-            "Key": f"{source_backend.s3_prefix}/{artifact_key}",
+            "Key": f"{source_backend.s3_prefix}/{key}",
         }
-        dest_key = f"{self.s3_prefix}/{artifact_key}"
-        self.s3_client.copy(copy_source, self.bucket, dest_key)
-        # Also copy sha256sum if it exists
-        sha_key = f"{artifact_key}.sha256sum"
-        if source_backend.artifact_exists(sha_key):
-            sha_copy_source = {
-                "Bucket": source_backend.bucket,
-                "Key": f"{source_backend.s3_prefix}/{sha_key}",
+        dest_key = f"{self.s3_prefix}/{key}"
+        # Objects uploaded in parts have ETags like "<md5>-<part count>".
+        if stat.etag is not None:
+            multipart = "-" in stat.etag
+        else:
+            multipart = stat.size > _S3_MULTIPART_THRESHOLD
+        if multipart:
+            first_part = self.s3_client.head_object(**copy_source, PartNumber=1)
+            if first_part.get("PartsCount"):
+                self._copy_parts(copy_source, dest_key, stat.size, first_part)
+                return
+        self.s3_client.copy_object(
+            CopySource=copy_source, Bucket=self.bucket, Key=dest_key
+        )
+
+    def _copy_parts(
+        self, copy_source: dict, dest_key: str, size: int, first_part: dict
+    ) -> None:
+        """Multipart copy with the part size of `first_part` (a HEAD response)."""
+        part_size = first_part["ContentLength"]
+        extra_args = {"Metadata": first_part.get("Metadata", {})}
+        if "ContentType" in first_part:
+            extra_args["ContentType"] = first_part["ContentType"]
+        upload_id = self.s3_client.create_multipart_upload(
+            Bucket=self.bucket, Key=dest_key, **extra_args
+        )["UploadId"]
+
+        def copy_part(part_number: int, start: int) -> dict:
+            end = min(start + part_size, size) - 1
+            response = self.s3_client.upload_part_copy(
+                Bucket=self.bucket,
+                Key=dest_key,
+                UploadId=upload_id,
+                PartNumber=part_number,
+                CopySource=copy_source,
+                CopySourceRange=f"bytes={start}-{end}",
+            )
+            return {
+                "PartNumber": part_number,
+                "ETag": response["CopyPartResult"]["ETag"],
             }
-            self.s3_client.copy(
-                sha_copy_source, self.bucket, f"{self.s3_prefix}/{sha_key}"
+
+        executor = self._part_executor()
+        futures = [
+            executor.submit(copy_part, part_number, start)
+            for part_number, start in enumerate(range(0, size, part_size), start=1)
+        ]
+        try:
+            parts = [future.result() for future in futures]
+            self.s3_client.complete_multipart_upload(
+                Bucket=self.bucket,
+                Key=dest_key,
+                UploadId=upload_id,
+                MultipartUpload={"Parts": parts},
             )
+        except BaseException:
+            self._abort_multipart_upload(dest_key, upload_id, futures)
+            raise
+
+    def _part_executor(self) -> concurrent.futures.ThreadPoolExecutor:
+        with self._parts_lock:
+            if self._parts_executor is None:
+                self._parts_executor = concurrent.futures.ThreadPoolExecutor(
+                    max_workers=self.part_concurrency,
+                    thread_name_prefix="s3-part",
+                )
+            return self._parts_executor
+
+    def stat_artifact(self, artifact_key: str) -> Optional[ArtifactStat]:
+        """HEAD the object in S3 (unless the listing is cached)."""
+        from botocore.exceptions import ClientError
+
+        listing = self.cached_listing()
+        if listing is not None:
+            return listing.get(artifact_key)
+        loc = self.output_root.artifact(artifact_key)
+        try:
+            response = self.s3_client.head_object(
+                Bucket=self.bucket, Key=loc.relative_path
+            )
+        except ClientError as e:
+            if e.response.get("Error", {}).get("Code") in ("404", "NoSuchKey"):
+                return None
+            raise
+        return ArtifactStat(
+            size=response["ContentLength"], etag=response.get("ETag", "").strip('"')
+        )
 
     def artifact_exists(self, artifact_key: str) -> bool:
         """Check if artifact exists in S3."""
+        listing = self.cached_listing()
+        if listing is not None:
+            return artifact_key in listing
         try:
             loc = self.output_root.artifact(artifact_key)
             self.s3_client.head_object(Bucket=self.bucket, Key=loc.relative_path)
@@ -334,16 +821,20 @@ def create_backend_from_env(
     run_id: Optional[str] = None,
     github_repository: Optional[str] = None,
     platform: Optional[str] = None,
+    max_connections: Optional[int] = None,
 ) -> ArtifactBackend:
     """Create the appropriate backend based on environment variables.
 
     Environment variables:
     - THEROCK_LOCAL_STAGING_DIR: If set, use local backend
+    - THEROCK_LOCAL_STAGING_LINK_MODE: How the local backend transfers
+      archives: auto (default), reflink, hardlink or copy
     - THEROCK_RUN_ID: Override run ID (default: "local" or GITHUB_RUN_ID)
     - THEROCK_PLATFORM: Override platform (default: current platform)
 
     For S3 backend (when THEROCK_LOCAL_STAGING_DIR is not set):
     - Uses WorkflowOutputRoot.from_workflow_run() for bucket selection
+    - The connection pool holds at least `max_connections` connections
     """
     import platform as platform_module
 
@@ -360,9 +851,13 @@ def create_backend_from_env(
         return LocalDirectoryBackend(
             staging_dir=Path(local_staging),
             output_root=output_root,
+            link_mode=os.getenv("THEROCK_LOCAL_STAGING_LINK_MODE", "auto"),
         )
 
     output_root = WorkflowOutputRoot.from_workflow_run(
         run_id=run_id, platform=platform_name, github_repository=github_repository
     )
-    return S3Backend(output_root=output_root)
+    return S3Backend(
+        output_root=output_root,
+        max_pool_connections=max(DEFAULT_S3_MAX_POOL_CONNECTIONS, max_connections or 0),
+    )
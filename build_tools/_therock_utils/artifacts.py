@@ -23,15 +23,29 @@ contains one relative path per line. That path represents a path into a TheRock
 build directory that its contents are subset from.
 """
 
-from typing import Callable, Optional, Sequence
+from dataclasses import dataclass, field
+from typing import BinaryIO, Callable, Optional, Sequence, TYPE_CHECKING
 
 import os
 import re
 from pathlib import Path, PurePosixPath
-
-from .archive_util import open_archive_for_read
+import shutil
+import tarfile
+
+from .archive_util import (
+    open_archive_for_read,
+    open_archive_for_write,
+    open_archive_stream_for_read,
+)
 from .pattern_match import PatternMatcher, MatchPredicate
 
+if TYPE_CHECKING:
+    from .content_store import ArtifactFileIndex, ContentStore
+
+# Chunk size when writing extracted files, bounding memory use for large
+# members (notably when extracting from a stream).
+_COPY_BUFFER_SIZE = 4 << 20
+
 
 class ArtifactName:
     def __init__(self, name: str, component: str, target_family: str):
@@ -75,6 +89,97 @@ class ArtifactName:
         return hash((self.name, self.component, self.target_family))
 
 
+@dataclass
+class ArtifactContents:
+    """The entries of artifact directories to archive, from a single walk.
+
+    The walk also sums up the regular files, so that callers can report (or
+    schedule by) the uncompressed size without walking the directories again.
+    Instances are plain data and can be sent to worker processes.
+    """
+
+    # (arcname, filesystem path) in archive order: each directory's
+    # manifest, then the entries of the paths it lists.
+    entries: list[tuple[str, str]] = field(default_factory=list)
+    # Relative paths of all manifests, for the per-file index.
+    manifest: list[str] = field(default_factory=list)
+    file_count: int = 0
+    file_size: int = 0
+
+    @staticmethod
+    def scan(artifact_dirs: Sequence[Path]) -> "ArtifactContents":
+        contents = ArtifactContents()
+        for artifact_dir in artifact_dirs:
+            manifest_path = artifact_dir / "artifact_manifest.txt"
+            relpaths = [p for p in manifest_path.read_text().splitlines() if p]
+            # Important: The manifest must be stored first.
+            contents._add(manifest_path.name, os.fspath(manifest_path))
+            contents.file_count += 1
+            contents.file_size += manifest_path.stat().st_size
+            contents.manifest.extend(relpaths)
+            for relpath in relpaths:
+                source_dir = artifact_dir / relpath
+                if not source_dir.exists():
+                    continue
+                pm = PatternMatcher()
+                pm.add_basedir(source_dir)
+                for subpath, dir_entry in pm.all.items():
+                    contents._add(f"{relpath}/{subpath}", dir_entry.path)
+                    if dir_entry.is_file(follow_symlinks=False):
+                        contents.file_count += 1
+                        contents.file_size += dir_entry.stat(
+                            follow_symlinks=False
+                        ).st_size
+        return contents
+
+    def _add(self, arcname: str, path: str):
+        self.entries.append((arcname, path))
+
+
+def write_artifact_archive(
+    contents: ArtifactContents,
+    output_path: Path,
+    compression_type: str,
+    compression_level: Optional[int] = None,
+    *,
+    zstd_dict_path: Optional[Path] = None,
+    zstd_dict_mode: str = "reference",
+    frame_size: Optional[int] = None,
+    index_path: Optional[Path] = None,
+):
+    """Archives `contents` to `output_path` (see `fileset_tool.py artifact-archive`).
+
+    If `index_path` is given, the per-file index (for content-addressed
+    fetching) is written there, hashing files as they are archived.
+    """
+    from .content_store import ArtifactFileIndex, add_to_archive_indexed
+
+    if output_path.exists():
+        output_path.unlink()
+    output_path.parent.mkdir(parents=True, exist_ok=True)
+    index = ArtifactFileIndex() if index_path else None
+    if index is not None:
+        index.manifest.extend(contents.manifest)
+
+    with open_archive_for_write(
+        output_path,
+        compression_type,
+        compression_level,
+        zstd_dict_path=zstd_dict_path,
+        zstd_dict_mode=zstd_dict_mode,
+        frame_size=frame_size,
+    ) as arc:
+        for arcname, path in contents.entries:
+            # Manifests are archived but are not part of the index.
+            if index is not None and arcname != "artifact_manifest.txt":
+                add_to_archive_indexed(arc, path, arcname, index)
+            else:
+                arc.add(path, arcname=arcname, recursive=False)
+
+    if index is not None:
+        index.dump(index_path)
+
+
 class ArtifactCatalog:
     """Scans a directory containing exploded artifact sub-directories.
 
@@ -136,11 +241,18 @@ class ArtifactPopulator:
     """
 
     def __init__(
-        self, *, output_path: Path, verbose: bool = False, flatten: bool = False
+        self,
+        *,
+        output_path: Path,
+        verbose: bool = False,
+        flatten: bool = False,
+        zstd_dict_dirs: Sequence[Path] = (),
     ):
         self.output_path = output_path
         self.verbose = verbose
         self.flatten = flatten
+        # Where dictionaries referenced by zstd archives are looked up.
+        self.zstd_dict_dirs = zstd_dict_dirs
         self.relpaths: set[str] = set()
 
     def on_relpath(self, relpath: str):
@@ -161,6 +273,120 @@ class ArtifactPopulator:
         """Callback that is invoked for every artifact archive encountered."""
         pass
 
+    def _member_dest_path(
+        self, member_name: str, relpaths: list[str]
+    ) -> Optional[Path]:
+        """Maps an archive member name to its output path.
+
+        Returns None if the member is not under any manifest relpath.
+        """
+        for prefix_relpath in relpaths:
+            prefix = prefix_relpath + "/"
+            if member_name.startswith(prefix):
+                output_path = self.output_path
+                if not self.flatten:
+                    output_path = output_path / prefix_relpath
+                return output_path / PurePosixPath(member_name[len(prefix) :])
+        return None
+
+    @staticmethod
+    def _prepare_dest_path(dest_path: Path):
+        if dest_path.is_symlink() or (dest_path.exists() and not dest_path.is_dir()):
+            os.unlink(dest_path)
+        dest_path.parent.mkdir(parents=True, exist_ok=True)
+
+    def _link_member(self, link_target: str, dest_path: Path, relpaths: list[str]):
+        target_dest_path = self._member_dest_path(link_target, relpaths)
+        if target_dest_path is None:
+            raise IOError(
+                f"Hardlink target not in manifest: {dest_path} -> {link_target}"
+            )
+        os.link(target_dest_path, dest_path)
+
+    def populate_from_index(self, index: "ArtifactFileIndex", store: "ContentStore"):
+        """Populates one artifact from its file index and a content store.
+
+        This is the equivalent of processing the artifact archive, except that
+        file contents are materialized from `store` (which must contain all
+        files of the index, see `content_store.populate_store_from_archive`).
+        """
+        relpaths = index.manifest
+        for relpath in relpaths:
+            self.on_relpath(relpath)
+        for entry in index.entries:
+            dest_path = self._member_dest_path(entry.path, relpaths)
+            if dest_path is None:
+                raise IOError(
+                    f"Populating from artifact index, encountered file not in manifest: {entry.path}"
+                )
+            self._prepare_dest_path(dest_path)
+            if entry.type == "file":
+                store.materialize(entry.sha256, entry.executable, dest_path)
+            elif entry.type == "dir":
+                dest_path.mkdir(parents=True, exist_ok=True)
+            elif entry.type == "symlink":
+                dest_path.symlink_to(entry.target)
+            elif entry.type == "hardlink":
+                self._link_member(entry.target, dest_path, relpaths)
+            else:
+                raise IOError(f"Unhandled artifact index entry: {entry}")
+
+    def populate_from_stream(self, fileobj: BinaryIO, name: str):
+        """Populates one artifact from a non-seekable archive stream.
+
+        `name` is the archive file name (used to detect compression). This
+        lets callers extract directly from a network response body without
+        first writing the archive to disk.
+        """
+        with open_archive_stream_for_read(
+            fileobj, name, zstd_dict_dirs=self.zstd_dict_dirs
+        ) as tf:
+            self._populate_from_archive(tf, Path(name))
+
+    def _populate_from_archive(self, tf: tarfile.TarFile, artifact_path: Path):
+        """Populates from an open archive, reading it strictly sequentially."""
+        self.on_artifact_archive(artifact_path)
+        # Read manifest first.
+        manifest_member = tf.next()
+        if manifest_member is None or manifest_member.name != "artifact_manifest.txt":
+            raise IOError(
+                f"Artifact archive {artifact_path} must have artifact_manifest.txt as its first member"
+            )
+        with tf.extractfile(manifest_member) as mf_file:
+            relpaths = mf_file.read().decode().splitlines()
+            for relpath in relpaths:
+                self.on_relpath(relpath)
+        # Iterate over all remaining members.
+        while member := tf.next():
+            dest_path = self._member_dest_path(member.name, relpaths)
+            if dest_path is None:
+                raise IOError(
+                    f"Extracting tar artifact archive, encountered file not in manifest: {member}"
+                )
+            self._prepare_dest_path(dest_path)
+            if member.isfile():
+                exec_mask = member.mode & 0o111
+                with tf.extractfile(member) as member_file:
+                    with open(
+                        dest_path,
+                        "wb",
+                    ) as out_file:
+                        shutil.copyfileobj(member_file, out_file, _COPY_BUFFER_SIZE)
+                        st = os.fstat(out_file.fileno())
+                        if hasattr(os, "fchmod"):
+                            # Windows has no fchmod.
+                            new_mode = st.st_mode | exec_mask
+                            os.fchmod(out_file.fileno(), new_mode)
+            elif member.isdir():
+                dest_path.mkdir(parents=True, exist_ok=True)
+            elif member.issym():
+                dest_path.symlink_to(member.linkname)
+            elif member.islnk():
+                # Hardlink: find the target file's destination path
+                self._link_member(member.linkname, dest_path, relpaths)
+            else:
+                raise IOError(f"Unhandled tar member: {member}")
+
     def __call__(self, *artifact_paths: Sequence[Path]):
         all_root_relpaths: set[str] = set()
         for artifact_path in artifact_paths:
@@ -184,86 +410,8 @@ class ArtifactPopulator:
                     pm.copy_to(destdir=destdir, verbose=self.verbose, remove_dest=False)
             else:
                 # Process as an archive file.
-                with open_archive_for_read(artifact_path) as tf:
-                    self.on_artifact_archive(artifact_path)
-                    # Read manifest first.
-                    manifest_member = tf.next()
-                    if (
-                        manifest_member is None
-                        or manifest_member.name != "artifact_manifest.txt"
-                    ):
-                        raise IOError(
-                            f"Artifact archive {artifact_path} must have artifact_manifest.txt as its first member"
-                        )
-                    with tf.extractfile(manifest_member) as mf_file:
-                        relpaths = mf_file.read().decode().splitlines()
-                        for relpath in relpaths:
-                            self.on_relpath(relpath)
-                    # Iterate over all remaining members.
-                    while member := tf.next():
-                        member_name = member.name
-                        # Figure out which relpath prefix it is a part of.
-                        for prefix_relpath in relpaths:
-                            output_path = self.output_path
-                            if not self.flatten:
-                                output_path = output_path / prefix_relpath
-                            prefix_relpath += "/"
-                            if member_name.startswith(prefix_relpath):
-                                scoped_path = member_name[len(prefix_relpath) :]
-                                dest_path = output_path / PurePosixPath(scoped_path)
-                                if dest_path.is_symlink() or (
-                                    dest_path.exists() and not dest_path.is_dir()
-                                ):
-                                    os.unlink(dest_path)
-                                dest_path.parent.mkdir(parents=True, exist_ok=True)
-                                if member.isfile():
-                                    exec_mask = member.mode & 0o111
-                                    with tf.extractfile(member) as member_file:
-                                        with open(
-                                            dest_path,
-                                            "wb",
-                                        ) as out_file:
-                                            out_file.write(member_file.read())
-                                            st = os.fstat(out_file.fileno())
-                                            if hasattr(os, "fchmod"):
-                                                # Windows has no fchmod.
-                                                new_mode = st.st_mode | exec_mask
-                                                os.fchmod(out_file.fileno(), new_mode)
-                                elif member.isdir():
-                                    dest_path.mkdir(parents=True, exist_ok=True)
-                                elif member.issym():
-                                    dest_path.symlink_to(member.linkname)
-                                elif member.islnk():
-                                    # Hardlink: find the target file's destination path
-                                    link_target = member.linkname
-                                    for target_prefix in relpaths:
-                                        target_prefix_slash = target_prefix + "/"
-                                        if link_target.startswith(target_prefix_slash):
-                                            target_scoped_path = link_target[
-                                                len(target_prefix_slash) :
-                                            ]
-                                            if self.flatten:
-                                                target_dest_path = (
-                                                    self.output_path
-                                                    / PurePosixPath(target_scoped_path)
-                                                )
-                                            else:
-                                                target_dest_path = (
-                                                    self.output_path
-                                                    / target_prefix
-                                                    / PurePosixPath(target_scoped_path)
-                                                )
-                                            os.link(target_dest_path, dest_path)
-                                            break
-                                    else:
-                                        raise IOError(
-                                            f"Hardlink target not in manifest: {member} -> {link_target}"
-                                        )
-                                else:
-                                    raise IOError(f"Unhandled tar member: {member}")
-                                break
-                        else:
-                            raise IOError(
-                                f"Extracting tar artifact archive, encountered file not in manifest: {member}"
-                            )
+                with open_archive_for_read(
+                    artifact_path, zstd_dict_dirs=self.zstd_dict_dirs
+                ) as tf:
+                    self._populate_from_archive(tf, artifact_path)
         return all_root_relpaths
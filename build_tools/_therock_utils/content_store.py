@@ -0,0 +1,341 @@
+# Copyright Advanced Micro Devices, Inc.
+# SPDX-License-Identifier: MIT
+
+"""Content-addressed store of artifact file contents.
+
+Most files are byte-identical between consecutive CI runs and between the
+`_generic` and per-family artifacts, yet every fetch downloads and extracts
+them again. This module lets fetch keep a long-lived store of file contents
+keyed by sha256, and materialize artifact trees from it via reflinks or
+hardlinks.
+
+Two pieces make this work:
+
+* Each artifact archive is accompanied by a per-file index sidecar
+  (`{archive}.index.json`, see `ArtifactFileIndex`) written at archive time. It
+  records the manifest and every tar member with its type, mode and, for
+  regular files, size and sha256.
+* A `ContentStore` directory holds one blob per distinct (sha256, executable)
+  pair::
+
+      {root}/sha256/{digest[:2]}/{digest}      # non-executable contents
+      {root}/sha256/{digest[:2]}/{digest}.x    # executable contents
+
+  Executable and non-executable copies are distinct blobs because hardlinks
+  share permission bits.
+
+Given an index, fetch only needs the archive if some blob is missing from the
+store, and even then only writes the missing blobs before materializing the
+tree from the store.
+
+Push can additionally upload a file-level delta (`{archive}.delta`, see
+`delta_files`): a zstd tar of only the files whose contents are not in the
+previous run's index. A fetch whose store already holds the previous run's
+files then only needs the (usually much smaller) delta.
+
+Blobs are written to a temporary file, verified and renamed into place, so
+concurrent fetches (threads or processes) may share a store. The store has
+no size limit of its own: `ContentStore.prune` removes the oldest blobs down
+to a size, but only while no fetch holds `ContentStore.in_use`. When the store
+materializes files via hardlinks, the output files share an inode with the
+store: tools that modify installed files in place must not be used on such
+trees (use link mode "reflink" or "copy" instead).
+"""
+
+from dataclasses import dataclass, field
+import hashlib
+import json
+import os
+from pathlib import Path
+import tarfile
+import tempfile
+from typing import BinaryIO, Optional
+
+from .os_util import file_lock, link_or_copy
+
+# Suffix of the per-file index sidecar stored next to an artifact archive.
+INDEX_SUFFIX = ".index.json"
+INDEX_VERSION = 1
+# Suffix of the optional file-level delta sidecar (always a zstd tar).
+DELTA_SUFFIX = ".delta"
+
+_COPY_BUFFER_SIZE = 1 << 20
+
+
+@dataclass
+class FileIndexEntry:
+    """One tar member of an artifact archive."""
+
+    path: str  # Tar member name (e.g. "core/stage/lib/libfoo.so")
+    type: str  # One of "file", "dir", "symlink", "hardlink"
+    mode: int = 0o644
+    size: int = 0
+    sha256: Optional[str] = None  # Regular files only
+    target: Optional[str] = None  # Symlink target or hardlink member name
+
+    @property
+    def executable(self) -> bool:
+        return bool(self.mode & 0o111)
+
+    def to_json(self) -> dict:
+        d = {"path": self.path, "type": self.type, "mode": self.mode}
+        if self.type == "file":
+            d["size"] = self.size
+            d["sha256"] = self.sha256
+        if self.target is not None:
+            d["target"] = self.target
+        return d
+
+    @staticmethod
+    def from_json(d: dict) -> "FileIndexEntry":
+        return FileIndexEntry(
+            path=d["path"],
+            type=d["type"],
+            mode=d.get("mode", 0o644),
+            size=d.get("size", 0),
+            sha256=d.get("sha256"),
+            target=d.get("target"),
+        )
+
+
+@dataclass
+class ArtifactFileIndex:
+    """Per-file index of an artifact archive (the `.index.json` sidecar)."""
+
+    manifest: list[str] = field(default_factory=list)
+    entries: list[FileIndexEntry] = field(default_factory=list)
+
+    @property
+    def files(self) -> list[FileIndexEntry]:
+        return [e for e in self.entries if e.type == "file"]
+
+    @property
+    def total_file_size(self) -> int:
+        return sum(e.size for e in self.files)
+
+    def content_keys(self) -> set[tuple[str, bool]]:
+        return {(e.sha256, e.executable) for e in self.files}
+
+    def missing_files(self, store: "ContentStore") -> list[FileIndexEntry]:
+        """Returns file entries whose contents are not yet in the store."""
+        return [e for e in self.files if not store.contains(e.sha256, e.executable)]
+
+    def dumps(self) -> str:
+        return json.dumps(
+            {
+                "version": INDEX_VERSION,
+                "manifest": self.manifest,
+                "entries": [e.to_json() for e in self.entries],
+            },
+            separators=(",", ":"),
+        )
+
+    def dump(self, path: Path):
+        Path(path).write_text(self.dumps())
+
+    @staticmethod
+    def loads(text: str) -> "ArtifactFileIndex":
+        d = json.loads(text)
+        version = d.get("version")
+        if version != INDEX_VERSION:
+            raise ValueError(f"Unsupported artifact index version: {version}")
+        return ArtifactFileIndex(
+            manifest=list(d["manifest"]),
+            entries=[FileIndexEntry.from_json(e) for e in d["entries"]],
+        )
+
+    @staticmethod
+    def load(path: Path) -> "ArtifactFileIndex":
+        return ArtifactFileIndex.loads(Path(path).read_text())
+
+
+def delta_files(
+    index: ArtifactFileIndex, base_index: ArtifactFileIndex
+) -> list[FileIndexEntry]:
+    """Returns the file entries of `index` with contents not in `base_index`.
+
+    Each distinct content is only returned once.
+    """
+    seen = base_index.content_keys()
+    delta = []
+    for entry in index.files:
+        key = (entry.sha256, entry.executable)
+        if key not in seen:
+            seen.add(key)
+            delta.append(entry)
+    return delta
+
+
+class _HashingReader:
+    """File wrapper that hashes everything read through it."""
+
+    def __init__(self, f: BinaryIO):
+        self._f = f
+        self.hasher = hashlib.sha256()
+        self.size = 0
+
+    def read(self, size: int = -1) -> bytes:
+        data = self._f.read(size)
+        self.hasher.update(data)
+        self.size += len(data)
+        return data
+
+
+def add_to_archive_indexed(
+    arc: tarfile.TarFile, name: str, arcname: str, index: ArtifactFileIndex
+):
+    """Adds one filesystem entry to `arc` (like `arc.add(recursive=False)`),
+    recording it in `index`.
+
+    Regular files are hashed as they are streamed into the archive, so no
+    extra pass over the data is needed.
+    """
+    tarinfo = arc.gettarinfo(name, arcname)
+    if tarinfo is None:
+        # Unsupported type (e.g. socket), tarfile.add() skips these too.
+        return
+    if tarinfo.isreg():
+        with open(name, "rb") as f:
+            reader = _HashingReader(f)
+            arc.addfile(tarinfo, reader)
+        entry = FileIndexEntry(
+            tarinfo.name,
+            "file",
+            mode=tarinfo.mode,
+            size=tarinfo.size,
+            sha256=reader.hasher.hexdigest(),
+        )
+    elif tarinfo.isdir():
+        arc.addfile(tarinfo)
+        entry = FileIndexEntry(tarinfo.name, "dir", mode=tarinfo.mode)
+    elif tarinfo.issym():
+        arc.addfile(tarinfo)
+        entry = FileIndexEntry(
+            tarinfo.name, "symlink", mode=tarinfo.mode, target=tarinfo.linkname
+        )
+    elif tarinfo.islnk():
+        arc.addfile(tarinfo)
+        entry = FileIndexEntry(
+            tarinfo.name, "hardlink", mode=tarinfo.mode, target=tarinfo.linkname
+        )
+    else:
+        raise IOError(f"Unsupported file type for artifact index: {name}")
+    index.entries.append(entry)
+
+
+class ContentStore:
+    """Directory of file contents keyed by sha256 (see module docstring)."""
+
+    def __init__(self, root: Path, *, link_mode: str = "auto"):
+        self.root = Path(root)
+        self.link_mode = link_mode
+        self._tmp_dir = self.root / "tmp"
+        self._tmp_dir.mkdir(parents=True, exist_ok=True)
+
+    def blob_path(self, sha256: str, executable: bool) -> Path:
+        suffix = ".x" if executable else ""
+        return self.root / "sha256" / sha256[:2] / f"{sha256}{suffix}"
+
+    def contains(self, sha256: str, executable: bool) -> bool:
+        return self.blob_path(sha256, executable).exists()
+
+    def add_from_fileobj(
+        self, fileobj: BinaryIO, *, expected_sha256: str, executable: bool
+    ) -> Path:
+        """Streams `fileobj` into the store, verifying its digest."""
+        blob_path = self.blob_path(expected_sha256, executable)
+        hasher = hashlib.sha256()
+        fd, tmp_name = tempfile.mkstemp(dir=self._tmp_dir, prefix="blob-")
+        try:
+            with os.fdopen(fd, "wb") as out_file:
+                while chunk := fileobj.read(_COPY_BUFFER_SIZE):
+                    hasher.update(chunk)
+                    out_file.write(chunk)
+            actual_sha256 = hasher.hexdigest()
+            if actual_sha256 != expected_sha256:
+                raise IOError(
+                    f"Content store digest mismatch: expected {expected_sha256}, "
+                    f"got {actual_sha256}"
+                )
+            os.chmod(tmp_name, 0o755 if executable else 0o644)
+            blob_path.parent.mkdir(parents=True, exist_ok=True)
+            os.replace(tmp_name, blob_path)
+        except BaseException:
+            if os.path.exists(tmp_name):
+                os.unlink(tmp_name)
+            raise
+        return blob_path
+
+    def materialize(self, sha256: str, executable: bool, dest_path: Path) -> str:
+        """Creates `dest_path` with the blob's contents (see `link_or_copy`)."""
+        return link_or_copy(
+            self.blob_path(sha256, executable), dest_path, self.link_mode
+        )
+
+    def in_use(self):
+        """Shared lock held while using blobs, keeping `prune` from running."""
+        return file_lock(self.root / "store.lock", shared=True)
+
+    def prune(self, max_bytes: int) -> Optional[tuple[int, int]]:
+        """Removes the oldest blobs until the store holds at most `max_bytes`.
+
+        Blobs are removed in the order they were added. Blobs still
+        hardlinked into fetched trees are kept, as removing them would free
+        no space. Returns the number of blobs and bytes removed, or None
+        (without waiting) if the store is in use.
+        """
+        try:
+            with file_lock(self.root / "store.lock", blocking=False):
+                blobs = []
+                for path in (self.root / "sha256").glob("*/*"):
+                    st = path.stat()
+                    blobs.append((st.st_mtime, st.st_size, st.st_nlink, path))
+                total = sum(size for _, size, _, _ in blobs)
+                removed_count = removed_bytes = 0
+                for _, size, nlink, path in sorted(blobs):
+                    if total <= max_bytes:
+                        break
+                    if nlink > 1:
+                        continue
+                    path.unlink()
+                    total -= size
+                    removed_count += 1
+                    removed_bytes += size
+                return removed_count, removed_bytes
+        except BlockingIOError:
+            return None
+
+
+def populate_store_from_archive(
+    archive: tarfile.TarFile,
+    index: ArtifactFileIndex,
+    store: ContentStore,
+    *,
+    require_complete: bool = True,
+) -> int:
+    """Adds the files of `archive` that are missing from `store`.
+
+    Files are verified against the digests in `index`. Returns the number of
+    blobs added. Unless `require_complete` is False (e.g. for deltas), raises
+    if the archive lacks some of the missing files.
+    """
+    missing = {e.path: e for e in index.missing_files(store)}
+    added = 0
+    for member in archive:
+        entry = missing.pop(member.name, None)
+        if entry is None or not member.isfile():
+            continue
+        if store.contains(entry.sha256, entry.executable):
+            # Same contents as an earlier member.
+            continue
+        with archive.extractfile(member) as f:
+            store.add_from_fileobj(
+                f, expected_sha256=entry.sha256, executable=entry.executable
+            )
+        added += 1
+    if missing and require_complete:
+        raise IOError(
+            f"Archive is missing {len(missing)} files listed in its index "
+            f"(first: {next(iter(missing))})"
+        )
+    return added
@@ -0,0 +1,263 @@
+# Copyright Advanced Micro Devices, Inc.
+# SPDX-License-Identifier: MIT
+
+"""Reading trees and blobs directly from git object stores.
+
+This allows exporting a commit (including its submodules) without checking
+anything out, e.g. from the bare mirrors maintained by `setup_git_mirrors.py`:
+
+* `list_tree_recursive` lists every file of a commit, descending into
+  submodules. The object store of a submodule is its `modules/<name>` dir in
+  the parent's git dir (initialized submodules) or, failing that, the mirror
+  of its URL in a mirror dir (see `git_mirrors.url_to_mirror_relpath`).
+* `BlobReader` reads blobs through one `git cat-file --batch` process per
+  object store. All blobs are requested up front, in the order they will be
+  read, so git streams them back without a round trip per blob.
+"""
+
+from dataclasses import dataclass
+import io
+from pathlib import Path
+import subprocess
+import threading
+from typing import BinaryIO, Sequence
+
+from .git_mirrors import url_to_mirror_relpath
+
+GITLINK_MODE = "160000"
+SYMLINK_MODE = "120000"
+EXECUTABLE_MODE = "100755"
+
+
+@dataclass(frozen=True)
+class GitTreeEntry:
+    """A file of an exported tree.
+
+    `path` is relative to the root of the export (i.e. includes the path of
+    the submodule the file is in) and `git_dir` is the object store to read
+    `oid` from. Gitlinks only appear for submodules that were not descended
+    into.
+    """
+
+    path: str
+    mode: str
+    oid: str
+    size: int
+    git_dir: Path
+
+    @property
+    def is_symlink(self) -> bool:
+        return self.mode == SYMLINK_MODE
+
+    @property
+    def is_gitlink(self) -> bool:
+        return self.mode == GITLINK_MODE
+
+    @property
+    def is_executable(self) -> bool:
+        return self.mode == EXECUTABLE_MODE
+
+
+def _git(git_dir: Path, *args: str, check: bool = True) -> str:
+    return subprocess.run(
+        ["git", f"--git-dir={git_dir}", *args],
+        stdin=subprocess.DEVNULL,
+        capture_output=True,
+        check=check,
+        text=True,
+    ).stdout
+
+
+def git_dir_of(repo_dir: Path) -> Path:
+    """The git dir of a worktree or bare repository."""
+    return Path(
+        subprocess.check_output(
+            ["git", "rev-parse", "--absolute-git-dir"], cwd=str(repo_dir), text=True
+        ).strip()
+    )
+
+
+def resolve_commit(git_dir: Path, revision: str) -> str:
+    return _git(git_dir, "rev-parse", "--verify", f"{revision}^{{commit}}").strip()
+
+
+def commit_time(git_dir: Path, commit: str) -> int:
+    return int(_git(git_dir, "show", "-s", "--format=%ct", commit).strip())
+
+
+def has_commit(git_dir: Path, commit: str) -> bool:
+    return (
+        subprocess.run(
+            ["git", f"--git-dir={git_dir}", "cat-file", "-e", f"{commit}^{{commit}}"],
+            stdin=subprocess.DEVNULL,
+            capture_output=True,
+        ).returncode
+        == 0
+    )
+
+
+def list_tree(git_dir: Path, commit: str) -> list[tuple[str, str, int, str]]:
+    """(mode, oid, size, path) of every blob and gitlink in `commit`."""
+    output = _git(git_dir, "ls-tree", "-r", "-z", "--long", "--full-tree", commit)
+    entries = []
+    for record in output.split("\0"):
+        if not record:
+            continue
+        info, path = record.split("\t", 1)
+        mode, _, oid, size = info.split()
+        entries.append((mode, oid, 0 if size == "-" else int(size), path))
+    return entries
+
+
+def read_gitmodules(git_dir: Path, commit: str) -> dict[str, tuple[str, str]]:
+    """Submodule path -> (name, url) from `.gitmodules` at `commit`."""
+    output = _git(
+        git_dir,
+        "config",
+        f"--blob={commit}:.gitmodules",
+        "--get-regexp",
+        r"^submodule\..*\.(path|url)$",
+        check=False,
+    )
+    paths: dict[str, str] = {}
+    urls: dict[str, str] = {}
+    for line in output.splitlines():
+        key, value = line.split(" ", 1)
+        name, _, attr = key[len("submodule.") :].rpartition(".")
+        (paths if attr == "path" else urls)[name] = value
+    return {path: (name, urls[name]) for name, path in paths.items() if name in urls}
+
+
+def find_submodule_git_dir(
+    parent_git_dir: Path,
+    name: str,
+    url: str,
+    commit: str,
+    mirror_dir: Path | None,
+) -> Path | None:
+    """The first object store containing `commit` of a submodule, if any."""
+    candidates = [parent_git_dir / "modules" / name]
+    if mirror_dir is not None:
+        candidates.append(mirror_dir / url_to_mirror_relpath(url))
+    for candidate in candidates:
+        if candidate.is_dir() and has_commit(candidate, commit):
+            return candidate
+    return None
+
+
+def list_tree_recursive(
+    git_dir: Path,
+    commit: str,
+    *,
+    recurse_submodules: bool = True,
+    mirror_dir: Path | None = None,
+    prefix: str = "",
+) -> list[GitTreeEntry]:
+    """Lists the files of `commit`, including those of its submodules."""
+    gitmodules = read_gitmodules(git_dir, commit) if recurse_submodules else {}
+    entries = []
+    for mode, oid, size, path in list_tree(git_dir, commit):
+        if mode == GITLINK_MODE and recurse_submodules:
+            if path not in gitmodules:
+                raise LookupError(
+                    f"Submodule {prefix}{path} is not listed in .gitmodules"
+                )
+            name, url = gitmodules[path]
+            sub_git_dir = find_submodule_git_dir(git_dir, name, url, oid, mirror_dir)
+            if sub_git_dir is None:
+                raise LookupError(
+                    f"Commit {oid} of submodule {prefix}{path} ({url}) not found in "
+                    f"{git_dir / 'modules' / name}"
+                    + (f" or the mirrors in {mirror_dir}" if mirror_dir else "")
+                )
+            entries.extend(
+                list_tree_recursive(
+                    sub_git_dir,
+                    oid,
+                    mirror_dir=mirror_dir,
+                    prefix=f"{prefix}{path}/",
+                )
+            )
+            continue
+        entries.append(GitTreeEntry(f"{prefix}{path}", mode, oid, size, git_dir))
+    return entries
+
+
+class BlobReader:
+    """Streams blobs of one object store in a fixed order.
+
+    `oids` are all requested when the reader is created; `open_blob()` must
+    then be called for them in the same order. Each returned file object is
+    only valid until the next call.
+    """
+
+    def __init__(self, git_dir: Path, oids: Sequence[str]):
+        self.git_dir = git_dir
+        self._proc = subprocess.Popen(
+            ["git", f"--git-dir={git_dir}", "cat-file", "--batch"],
+            stdin=subprocess.PIPE,
+            stdout=subprocess.PIPE,
+        )
+        self._feeder = threading.Thread(
+            target=self._feed, args=(oids,), name="cat-file-feeder", daemon=True
+        )
+        self._feeder.start()
+        self._current: _BlobStream | None = None
+
+    def _feed(self, oids: Sequence[str]):
+        try:
+            for oid in oids:
+                self._proc.stdin.write(f"{oid}\n".encode())
+            self._proc.stdin.close()
+        except (OSError, ValueError):
+            # The reader was closed early.
+            pass
+
+    def open_blob(self, oid: str) -> BinaryIO:
+        stdout = self._proc.stdout
+        if self._current is not None:
+            self._current.finish()
+        header = stdout.readline().decode().split()
+        if not header or header[0] != oid:
+            raise IOError(f"Expected blob {oid} from {self.git_dir}, got {header}")
+        if header[1] != "blob":
+            raise IOError(f"Object {oid} in {self.git_dir} is {header[1]}, not a blob")
+        self._current = _BlobStream(stdout, int(header[2]))
+        return self._current
+
+    def read_blob(self, oid: str) -> bytes:
+        return self.open_blob(oid).read()
+
+    def close(self):
+        self._proc.stdout.close()
+        self._proc.kill()
+        self._proc.wait()
+        self._feeder.join()
+
+
+class _BlobStream(io.RawIOBase):
+    """The contents of one blob in a `cat-file --batch` output stream."""
+
+    def __init__(self, stdout: BinaryIO, size: int):
+        self._stdout = stdout
+        self._remaining = size
+        self._finished = False
+
+    def readable(self) -> bool:
+        return True
+
+    def readinto(self, b) -> int:
+        n = self._stdout.readinto(memoryview(b)[: self._remaining])
+        if n == 0 and self._remaining:
+            raise IOError("git cat-file output ended early")
+        self._remaining -= n
+        return n
+
+    def finish(self):
+        """Skips the rest of the blob and the newline after it."""
+        if self._finished:
+            return
+        while self._remaining:
+            self.read(min(self._remaining, 1 << 20))
+        self._stdout.read(1)
+        self._finished = True
@@ -0,0 +1,430 @@
+# Copyright Advanced Micro Devices, Inc.
+# SPDX-License-Identifier: MIT
+
+"""Incremental upgrades of an installed ROCm prefix.
+
+Refreshing an install (e.g. moving between two nightlies) used to delete the
+prefix and extract everything again, although most files are unchanged.
+`PrefixUpgrade` instead builds the new version of the prefix in a staging
+directory next to it:
+
+* Files whose contents match the installed file are hardlinked from the
+  current prefix instead of being written. Artifact archives come with a
+  per-file index sidecar (see `content_store.ArtifactFileIndex`) whose sha256
+  is compared with the one in the install manifest, so unchanged members are
+  skipped without being read. Without hashes (release tarballs, or a prefix
+  without a manifest entry), each member is compared against the installed
+  file as it streams by; only on the first differing byte does the member get
+  written (starting with the already compared bytes, taken from the installed
+  file).
+* Files that were installed before (listed in the install manifest) but are
+  no longer provided are dropped. Files in the prefix that were never
+  installed (not in the manifest, e.g. added by hand) are kept. A prefix
+  without a manifest (e.g. from a full install) counts as entirely installed.
+* The staging directory then replaces the prefix. Where the OS supports it
+  (Linux `renameat2(RENAME_EXCHANGE)`), the two are swapped atomically, so
+  readers see either the old or the new install, never a mix. Elsewhere the
+  prefix is renamed away and the staging directory renamed into place, which
+  leaves a brief window without a prefix (but still never a mix).
+* Written files and directories get the mode and mtime of their archive
+  members, like a full extraction. Directory attributes are applied last,
+  once nothing more is written into them. Linked files keep the mtime they
+  were installed with: their inode is still part of the live prefix until
+  the swap, so it is not touched.
+
+The install manifest (`INSTALL_MANIFEST_NAME` in the prefix root) lists every
+installed path with its type, mode, size and sha256, using the same entries as
+the per-file artifact index (see `content_store.FileIndexEntry`).
+"""
+
+from dataclasses import dataclass, field
+import hashlib
+import json
+import os
+from pathlib import Path, PurePosixPath
+import stat
+import tarfile
+from typing import BinaryIO, Optional
+
+from .content_store import ArtifactFileIndex, FileIndexEntry
+from .os_util import exchange_paths, rmtree_with_retry
+
+INSTALL_MANIFEST_NAME = ".therock_install_manifest.json"
+INSTALL_MANIFEST_VERSION = 1
+
+_COPY_BUFFER_SIZE = 1 << 20
+
+
+@dataclass
+class InstallManifest:
+    """Every path installed into a prefix, keyed by its relative path."""
+
+    entries: dict[str, FileIndexEntry] = field(default_factory=dict)
+
+    def dumps(self) -> str:
+        return json.dumps(
+            {
+                "version": INSTALL_MANIFEST_VERSION,
+                "entries": [self.entries[p].to_json() for p in sorted(self.entries)],
+            },
+            separators=(",", ":"),
+        )
+
+    def dump(self, prefix: Path):
+        (Path(prefix) / INSTALL_MANIFEST_NAME).write_text(self.dumps())
+
+    @staticmethod
+    def loads(text: str) -> "InstallManifest":
+        d = json.loads(text)
+        version = d.get("version")
+        if version != INSTALL_MANIFEST_VERSION:
+            raise ValueError(f"Unsupported install manifest version: {version}")
+        entries = [FileIndexEntry.from_json(e) for e in d["entries"]]
+        return InstallManifest({e.path: e for e in entries})
+
+    @staticmethod
+    def load(prefix: Path) -> Optional["InstallManifest"]:
+        """Loads the manifest of `prefix`, or None if it has none."""
+        path = Path(prefix) / INSTALL_MANIFEST_NAME
+        if not path.exists():
+            return None
+        return InstallManifest.loads(path.read_text())
+
+
+@dataclass
+class UpgradeStats:
+    written_files: int = 0
+    written_bytes: int = 0
+    unchanged_files: int = 0
+    unchanged_bytes: int = 0
+    removed_files: int = 0
+    kept_files: int = 0
+
+    def summary(self) -> str:
+        return (
+            f"{self.written_files} files written ({self.written_bytes} bytes), "
+            f"{self.unchanged_files} unchanged ({self.unchanged_bytes} bytes), "
+            f"{self.removed_files} removed, {self.kept_files} not managed and kept"
+        )
+
+
+def _normalize_relpath(relpath: str) -> str:
+    normalized = PurePosixPath(relpath)
+    if normalized.is_absolute() or ".." in normalized.parts:
+        raise IOError(f"Refusing to install outside of the prefix: {relpath}")
+    return normalized.as_posix()
+
+
+class PrefixUpgrade:
+    """Stages a new version of an install prefix and swaps it in.
+
+    Use as a context manager: add every path of the new install with the
+    `add_*` methods (or `add_archive`), then call `commit()`. Leaving the
+    context without committing discards the staging directory and leaves the
+    prefix untouched.
+    """
+
+    def __init__(self, prefix: Path):
+        self.prefix = Path(prefix)
+        self.staging_dir = self.prefix.parent / f".{self.prefix.name}.staging"
+        self._backup_dir = self.prefix.parent / f".{self.prefix.name}.old"
+        # Without a manifest (e.g. installed before upgrades existed), the
+        # whole prefix counts as installed.
+        self.old_manifest = InstallManifest.load(self.prefix)
+        self.manifest = InstallManifest()
+        self.stats = UpgradeStats()
+        # Relpath -> mtime of directories, applied in `commit`.
+        self._dir_mtimes: dict[str, Optional[float]] = {}
+
+    def __enter__(self) -> "PrefixUpgrade":
+        if self.staging_dir.exists():
+            rmtree_with_retry(self.staging_dir)
+        self.staging_dir.mkdir(parents=True)
+        return self
+
+    def __exit__(self, exc_type, exc_value, traceback):
+        if self.staging_dir.exists():
+            rmtree_with_retry(self.staging_dir)
+
+    def _staged_path(self, relpath: str) -> Path:
+        dest_path = self.staging_dir / relpath
+        if dest_path.is_symlink() or (dest_path.exists() and not dest_path.is_dir()):
+            # A later artifact providing the same path wins.
+            dest_path.unlink()
+        dest_path.parent.mkdir(parents=True, exist_ok=True)
+        return dest_path
+
+    def add_dir(self, relpath: str, mode: int = 0o755, mtime: Optional[float] = None):
+        """Adds a directory, whose `mode` and `mtime` are applied on commit."""
+        relpath = _normalize_relpath(relpath)
+        (self.staging_dir / relpath).mkdir(parents=True, exist_ok=True)
+        self.manifest.entries[relpath] = FileIndexEntry(relpath, "dir", mode=mode)
+        self._dir_mtimes[relpath] = mtime
+
+    def add_symlink(self, relpath: str, target: str):
+        relpath = _normalize_relpath(relpath)
+        self._staged_path(relpath).symlink_to(target)
+        self.manifest.entries[relpath] = FileIndexEntry(
+            relpath, "symlink", mode=0o777, target=target
+        )
+
+    def add_hardlink(self, relpath: str, target_relpath: str):
+        relpath = _normalize_relpath(relpath)
+        target_relpath = _normalize_relpath(target_relpath)
+        target = self.manifest.entries.get(target_relpath)
+        if target is None or target.type != "file":
+            raise IOError(
+                f"Hardlink target not installed: {relpath} -> {target_relpath}"
+            )
+        os.link(self.staging_dir / target_relpath, self._staged_path(relpath))
+        self.manifest.entries[relpath] = FileIndexEntry(
+            relpath, "file", mode=target.mode, size=target.size, sha256=target.sha256
+        )
+
+    def _installed_candidate(
+        self, relpath: str, size: int, mode: int
+    ) -> Optional[Path]:
+        """The installed file at `relpath` if it could have the same contents.
+
+        It must also have the same permissions, since it is linked, not copied.
+        """
+        path = self.prefix / relpath
+        try:
+            st = path.lstat()
+        except OSError:
+            return None
+        if not path.is_file() or path.is_symlink() or st.st_size != size:
+            return None
+        if os.name != "nt" and stat.S_IMODE(st.st_mode) != stat.S_IMODE(mode):
+            return None
+        return path
+
+    def _unchanged_installed(
+        self, relpath: str, size: int, mode: int, sha256: str
+    ) -> Optional[Path]:
+        """The installed file at `relpath` if the install manifest records it
+        with contents `sha256`."""
+        if self.old_manifest is None:
+            return None
+        old_entry = self.old_manifest.entries.get(relpath)
+        if (
+            old_entry is None
+            or old_entry.type != "file"
+            or old_entry.size != size
+            or old_entry.sha256 != sha256
+        ):
+            return None
+        return self._installed_candidate(relpath, size, mode)
+
+    def add_file(
+        self,
+        relpath: str,
+        fileobj: BinaryIO,
+        *,
+        size: int,
+        mode: int,
+        mtime: Optional[float] = None,
+        sha256: Optional[str] = None,
+    ):
+        """Adds a regular file, reading its `size` bytes from `fileobj`.
+
+        With the file's `sha256` known ahead (from an artifact index), an
+        unchanged file is linked without reading `fileobj`, and a changed one
+        is written without comparing it to the installed file.
+        """
+        relpath = _normalize_relpath(relpath)
+        dest_path = self._staged_path(relpath)
+        if sha256 is not None:
+            installed = self._unchanged_installed(relpath, size, mode, sha256)
+            if installed is not None:
+                os.link(installed, dest_path)
+                self.stats.unchanged_files += 1
+                self.stats.unchanged_bytes += size
+                self.manifest.entries[relpath] = FileIndexEntry(
+                    relpath, "file", mode=mode, size=size, sha256=sha256
+                )
+                return
+        hasher = hashlib.sha256()
+        installed = (
+            self._installed_candidate(relpath, size, mode) if sha256 is None else None
+        )
+        out_file = None
+        try:
+            if installed is not None:
+                with open(installed, "rb") as installed_file:
+                    compared = 0
+                    while chunk := fileobj.read(_COPY_BUFFER_SIZE):
+                        hasher.update(chunk)
+                        if out_file is None:
+                            if installed_file.read(len(chunk)) == chunk:
+                                compared += len(chunk)
+                                continue
+                            # First difference: write what matched so far.
+                            out_file = open(dest_path, "wb")
+                            installed_file.seek(0)
+                            _copy_exactly(installed_file, out_file, compared)
+                        out_file.write(chunk)
+                if out_file is None:
+                    os.link(installed, dest_path)
+                    self.stats.unchanged_files += 1
+                    self.stats.unchanged_bytes += size
+            else:
+                out_file = open(dest_path, "wb")
+                while chunk := fileobj.read(_COPY_BUFFER_SIZE):
+                    hasher.update(chunk)
+                    out_file.write(chunk)
+            if out_file is not None:
+                if hasattr(os, "fchmod"):
+                    # Windows has no fchmod.
+                    os.fchmod(out_file.fileno(), stat.S_IMODE(mode))
+                self.stats.written_files += 1
+                self.stats.written_bytes += size
+        finally:
+            if out_file is not None:
+                out_file.close()
+        if sha256 is not None and hasher.hexdigest() != sha256:
+            raise IOError(f"Contents of {relpath} do not match the artifact index")
+        if out_file is not None and mtime is not None:
+            # Linked files share their inode with the live install.
+            os.utime(dest_path, (mtime, mtime))
+        self.manifest.entries[relpath] = FileIndexEntry(
+            relpath, "file", mode=mode, size=size, sha256=hasher.hexdigest()
+        )
+
+    def add_archive(
+        self,
+        tf: tarfile.TarFile,
+        *,
+        artifact: bool = False,
+        index: Optional[ArtifactFileIndex] = None,
+    ):
+        """Adds all members of a (possibly streaming) archive.
+
+        With `artifact`, `tf` is an artifact archive and is flattened like
+        `ArtifactPopulator(flatten=True)` does: its leading
+        `artifact_manifest.txt` lists relpaths and members are installed
+        relative to the relpath they are under. Its `index`, if given,
+        provides the sha256 of its files (see `add_file`).
+        """
+        hashes = {}
+        if index is not None:
+            hashes = {e.path: (e.size, e.sha256) for e in index.files}
+        relpaths = None
+        if artifact:
+            manifest_member = tf.next()
+            if (
+                manifest_member is None
+                or manifest_member.name != "artifact_manifest.txt"
+            ):
+                raise IOError(
+                    "Artifact archive must have artifact_manifest.txt as its first member"
+                )
+            with tf.extractfile(manifest_member) as mf_file:
+                relpaths = mf_file.read().decode().splitlines()
+
+        def install_relpath(name: str) -> str:
+            if relpaths is None:
+                return name
+            for prefix_relpath in relpaths:
+                prefix = prefix_relpath + "/"
+                if name.startswith(prefix):
+                    return name[len(prefix) :]
+            raise IOError(f"Encountered file not in artifact manifest: {name}")
+
+        while member := tf.next():
+            relpath = install_relpath(member.name)
+            if member.isdir():
+                self.add_dir(relpath, member.mode, member.mtime)
+            elif member.issym():
+                self.add_symlink(relpath, member.linkname)
+            elif member.islnk():
+                self.add_hardlink(relpath, install_relpath(member.linkname))
+            elif member.isfile():
+                size, sha256 = hashes.get(member.name, (None, None))
+                if size != member.size:
+                    sha256 = None
+                with tf.extractfile(member) as member_file:
+                    self.add_file(
+                        relpath,
+                        member_file,
+                        size=member.size,
+                        mode=member.mode,
+                        mtime=member.mtime,
+                        sha256=sha256,
+                    )
+
+    def _keep_unmanaged(self):
+        """Carries over prefix contents that were never installed."""
+        if not self.prefix.is_dir():
+            return
+        for root, dirs, files in os.walk(self.prefix):
+            root_path = Path(root)
+            for name in dirs + files:
+                path = root_path / name
+                relpath = path.relative_to(self.prefix).as_posix()
+                if relpath == INSTALL_MANIFEST_NAME:
+                    continue
+                if self.old_manifest is None:
+                    old_entry = FileIndexEntry(
+                        relpath, "dir" if path.is_dir() else "file"
+                    )
+                else:
+                    old_entry = self.old_manifest.entries.get(relpath)
+                if old_entry is not None:
+                    if old_entry.type != "dir" and relpath not in self.manifest.entries:
+                        self.stats.removed_files += 1
+                    continue
+                staged_path = self.staging_dir / relpath
+                if staged_path.is_symlink() or staged_path.exists():
+                    continue
+                if path.is_symlink():
+                    staged_path.parent.mkdir(parents=True, exist_ok=True)
+                    staged_path.symlink_to(os.readlink(path))
+                elif path.is_dir():
+                    staged_path.mkdir(parents=True)
+                    continue
+                else:
+                    staged_path.parent.mkdir(parents=True, exist_ok=True)
+                    os.link(path, staged_path)
+                self.stats.kept_files += 1
+            # Don't descend into symlinked directories.
+            dirs[:] = [d for d in dirs if not (root_path / d).is_symlink()]
+
+    def _apply_dir_attributes(self):
+        """Sets the mode and mtime of added directories, deepest first."""
+        for relpath, mtime in sorted(self._dir_mtimes.items(), reverse=True):
+            path = self.staging_dir / relpath
+            if os.name != "nt":
+                os.chmod(path, stat.S_IMODE(self.manifest.entries[relpath].mode))
+            if mtime is not None:
+                os.utime(path, (mtime, mtime))
+
+    def commit(self):
+        """Replaces the prefix with the staged install.
+
+        The two are swapped atomically where supported (see `exchange_paths`).
+        Otherwise the prefix is briefly missing between two renames.
+        """
+        self._keep_unmanaged()
+        self.manifest.dump(self.staging_dir)
+        self._apply_dir_attributes()
+        if self.prefix.exists() and exchange_paths(self.staging_dir, self.prefix):
+            # The staging directory now holds the old install.
+            rmtree_with_retry(self.staging_dir)
+            return
+        if self._backup_dir.exists():
+            rmtree_with_retry(self._backup_dir)
+        if self.prefix.exists():
+            os.rename(self.prefix, self._backup_dir)
+        os.rename(self.staging_dir, self.prefix)
+        if self._backup_dir.exists():
+            rmtree_with_retry(self._backup_dir)
+
+
+def _copy_exactly(src: BinaryIO, dst: BinaryIO, size: int):
+    while size > 0:
+        chunk = src.read(min(size, _COPY_BUFFER_SIZE))
+        if not chunk:
+            raise IOError("Installed file changed while upgrading")
+        dst.write(chunk)
+        size -= len(chunk)
@@ -0,0 +1,300 @@
+# Copyright Advanced Micro Devices, Inc.
+# SPDX-License-Identifier: MIT
+
+"""Read-only install prefix whose artifacts are fetched on first access.
+
+Test jobs often only touch a few binaries of the SDK, yet a flattened fetch
+downloads and extracts every artifact before the job can start. A
+`LazyPrefix` instead builds the flattened tree from the artifacts' file
+index sidecars (see `content_store.ArtifactFileIndex`), which list every
+path with its type, mode and size and are small. Listing directories and
+stat'ing files therefore needs no archive at all. Only when a file is opened
+whose contents are not in the content store yet is its artifact archive
+fetched and added to the store (once). Reads are then served from the
+store's blobs, so a job only pays for the artifacts it actually reads.
+
+The unit of fetching is a whole artifact rather than the frames holding the
+opened file: archives are single-frame unless pushed with `--frame-size`, and
+the index sidecars do not record which frame holds a member, so ranged reads
+of a member are not possible in general. Fetching the artifact once also adds
+all of its files to the store, so opening its other files costs nothing.
+
+`mount` presents a `LazyPrefix` as a read-only FUSE filesystem, served by the
+calling process until unmounted. It needs the optional `fusepy` package (see
+requirements-lazy-mount.txt) and FUSE, and mounts without root through
+`fusermount` (unmount with `fusermount -u <dir>`).
+"""
+
+from dataclasses import dataclass, field, replace
+import errno
+import os
+from pathlib import Path, PurePosixPath
+import stat
+import threading
+import time
+from typing import Callable, Optional, Sequence
+
+from .archive_util import open_archive_for_read
+from .content_store import (
+    INDEX_SUFFIX,
+    ArtifactFileIndex,
+    ContentStore,
+    populate_store_from_archive,
+)
+
+
+def log(msg: str):
+    """Print message and flush."""
+    print(msg, flush=True)
+
+
+@dataclass
+class LazyArtifact:
+    """An artifact of a lazy prefix.
+
+    `fetch_archive` returns the path of the downloaded archive (or of its
+    index, if the download found all of its files in the store already).
+    """
+
+    name: str
+    index: ArtifactFileIndex
+    fetch_archive: Callable[[], Path]
+
+
+@dataclass
+class _Node:
+    type: str  # One of "file", "dir", "symlink"
+    mode: int
+    size: int = 0
+    sha256: Optional[str] = None
+    target: Optional[str] = None
+    # Index into `LazyPrefix.artifacts` of the artifact providing a file.
+    artifact: int = -1
+    children: dict[str, None] = field(default_factory=dict)
+
+    @property
+    def executable(self) -> bool:
+        return bool(self.mode & 0o111)
+
+
+def _flattened_path(member_name: str, relpaths: list[str]) -> Optional[str]:
+    """Like `ArtifactPopulator(flatten=True)`, as a relative POSIX path."""
+    for relpath in relpaths:
+        prefix = relpath + "/"
+        if member_name.startswith(prefix):
+            return PurePosixPath(member_name[len(prefix) :]).as_posix()
+    return None
+
+
+class LazyPrefix:
+    """The flattened tree of several artifacts, with contents fetched lazily.
+
+    Artifacts are layered in order, later ones replacing paths of earlier ones
+    like when extracting them in that order. Paths are relative POSIX paths,
+    with "" for the root.
+    """
+
+    def __init__(
+        self,
+        artifacts: list[LazyArtifact],
+        store: ContentStore,
+        *,
+        zstd_dict_dirs: Sequence[Path] = (),
+    ):
+        self.artifacts = list(artifacts)
+        self.store = store
+        self.zstd_dict_dirs = zstd_dict_dirs
+        self.mtime = int(time.time())
+        self.fetched: set[str] = set()
+        self._nodes: dict[str, _Node] = {"": _Node("dir", 0o755)}
+        self._locks = [threading.Lock() for _ in self.artifacts]
+        for i, artifact in enumerate(self.artifacts):
+            self._add_artifact(i, artifact)
+
+    def _add_artifact(self, i: int, artifact: LazyArtifact):
+        relpaths = artifact.index.manifest
+        for entry in artifact.index.entries:
+            path = _flattened_path(entry.path, relpaths)
+            if path is None:
+                raise IOError(
+                    f"Artifact {artifact.name} has a file not in its manifest: "
+                    f"{entry.path}"
+                )
+            if entry.type == "file":
+                node = _Node(
+                    "file", entry.mode, entry.size, sha256=entry.sha256, artifact=i
+                )
+            elif entry.type == "dir":
+                existing = self._nodes.get(path)
+                if existing is not None and existing.type == "dir":
+                    continue
+                node = _Node("dir", entry.mode)
+            elif entry.type == "symlink":
+                node = _Node("symlink", 0o777, len(entry.target), target=entry.target)
+            elif entry.type == "hardlink":
+                target_path = _flattened_path(entry.target, relpaths)
+                target = self._nodes.get(target_path) if target_path else None
+                if target is None or target.type != "file":
+                    raise IOError(
+                        f"Hardlink target not in {artifact.name}: "
+                        f"{entry.path} -> {entry.target}"
+                    )
+                node = replace(target, children={})
+            else:
+                raise IOError(f"Unhandled artifact index entry: {entry}")
+            self._set(path, node)
+
+    def _set(self, path: str, node: _Node):
+        parent_path, _, name = path.rpartition("/")
+        parent = self._nodes.get(parent_path)
+        if parent is None or parent.type != "dir":
+            parent = _Node("dir", 0o755)
+            self._set(parent_path, parent)
+        parent.children[name] = None
+        self._nodes[path] = node
+
+    def lookup(self, path: str) -> Optional[_Node]:
+        return self._nodes.get(path)
+
+    def listdir(self, path: str) -> list[str]:
+        node = self._nodes.get(path)
+        if node is None or node.type != "dir":
+            raise NotADirectoryError(path)
+        return list(node.children)
+
+    def blob_path(self, path: str) -> Path:
+        """The store blob with the contents of file `path`, fetching if needed."""
+        node = self._nodes.get(path)
+        if node is None or node.type != "file":
+            raise FileNotFoundError(path)
+        if not self.store.contains(node.sha256, node.executable):
+            self._populate(node.artifact)
+        return self.store.blob_path(node.sha256, node.executable)
+
+    def _populate(self, i: int):
+        artifact = self.artifacts[i]
+        with self._locks[i]:
+            if artifact.name in self.fetched:
+                return
+            start_time = time.monotonic()
+            archive_path = artifact.fetch_archive()
+            if not archive_path.name.endswith(INDEX_SUFFIX):
+                with open_archive_for_read(
+                    archive_path, zstd_dict_dirs=self.zstd_dict_dirs
+                ) as tf:
+                    populate_store_from_archive(tf, artifact.index, self.store)
+            self.fetched.add(artifact.name)
+            log(
+                f"Fetched {artifact.name} on first access "
+                f"({time.monotonic() - start_time:.1f}s)"
+            )
+
+
+class LazyPrefixOperations:
+    """Read-only FUSE operations (in fusepy's interface) for a `LazyPrefix`."""
+
+    def __init__(self, prefix: LazyPrefix):
+        self.prefix = prefix
+
+    def __call__(self, op: str, *args):
+        method = getattr(self, op, None)
+        if method is None:
+            raise OSError(errno.ENOSYS, op)
+        return method(*args)
+
+    def _node(self, path: str) -> _Node:
+        node = self.prefix.lookup(path.strip("/"))
+        if node is None:
+            raise OSError(errno.ENOENT, path)
+        return node
+
+    def init(self, path):
+        pass
+
+    def destroy(self, path):
+        pass
+
+    def access(self, path, amode):
+        node = self._node(path)
+        if amode & os.W_OK:
+            raise OSError(errno.EROFS, path)
+        if amode & os.X_OK and node.type == "file" and not node.executable:
+            raise OSError(errno.EACCES, path)
+        return 0
+
+    def getattr(self, path, fh=None):
+        node = self._node(path)
+        type_bits = {
+            "file": stat.S_IFREG,
+            "dir": stat.S_IFDIR,
+            "symlink": stat.S_IFLNK,
+        }[node.type]
+        mtime = self.prefix.mtime
+        return {
+            "st_mode": type_bits | node.mode,
+            "st_nlink": 2 if node.type == "dir" else 1,
+            "st_size": node.size,
+            "st_mtime": mtime,
+            "st_ctime": mtime,
+            "st_atime": mtime,
+            "st_uid": os.getuid() if hasattr(os, "getuid") else 0,
+            "st_gid": os.getgid() if hasattr(os, "getgid") else 0,
+        }
+
+    def readdir(self, path, fh):
+        try:
+            return [".", ".."] + self.prefix.listdir(path.strip("/"))
+        except NotADirectoryError:
+            raise OSError(errno.ENOTDIR, path)
+
+    def readlink(self, path):
+        node = self._node(path)
+        if node.type != "symlink":
+            raise OSError(errno.EINVAL, path)
+        return node.target
+
+    def open(self, path, flags):
+        if flags & (os.O_WRONLY | os.O_RDWR | os.O_APPEND | os.O_TRUNC):
+            raise OSError(errno.EROFS, path)
+        try:
+            blob_path = self.prefix.blob_path(path.strip("/"))
+        except FileNotFoundError:
+            raise OSError(errno.ENOENT, path)
+        except Exception as e:
+            log(f"ERROR: Failed to fetch {path}: {e}")
+            raise OSError(errno.EIO, path)
+        return os.open(blob_path, os.O_RDONLY)
+
+    def read(self, path, size, offset, fh):
+        return os.pread(fh, size, offset)
+
+    def release(self, path, fh):
+        os.close(fh)
+        return 0
+
+    def statfs(self, path):
+        return {"f_bsize": 4096, "f_frsize": 4096, "f_namemax": 255}
+
+
+def mount(prefix: LazyPrefix, mountpoint: Path):
+    """Mounts `prefix` read-only at `mountpoint` and serves it until unmounted.
+
+    The mount is always served in the foreground: daemonizing would fork the
+    process after threads (and the backend's connections) already exist.
+    """
+    try:
+        import fuse
+    except (ImportError, OSError):  # fusepy raises OSError without libfuse
+        raise RuntimeError(
+            "Mounting a lazy prefix requires the fusepy package (pip install "
+            "-r requirements-lazy-mount.txt) and FUSE (libfuse and fusermount)"
+        )
+    Path(mountpoint).mkdir(parents=True, exist_ok=True)
+    fuse.FUSE(
+        LazyPrefixOperations(prefix),
+        str(mountpoint),
+        foreground=True,
+        ro=True,
+        nothreads=False,
+        fsname="therock-lazy-prefix",
+    )
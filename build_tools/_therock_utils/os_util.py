@@ -7,11 +7,29 @@ These include workarounds for platform-specific quirks, particularly Windows
 file locking.
 """
 
+import contextlib
+import ctypes
+import errno
 from pathlib import Path
+import os
 import shutil
 import sys
+import threading
 import time
 
+# Polling interval while waiting for a file lock held elsewhere (Windows).
+_FILE_LOCK_POLL_SECONDS = 0.1
+
+# Modes accepted by `link_or_copy`, in order of preference for "auto".
+LINK_MODES = ("auto", "reflink", "hardlink", "copy")
+
+# Linux FICLONE ioctl request number (_IOW(0x94, 9, int)).
+_FICLONE = 0x40049409
+
+# Linux renameat2() arguments.
+_AT_FDCWD = -100
+_RENAME_EXCHANGE = 1 << 1
+
 # Maximum number of attempts to retry removing a directory.
 RMTREE_MAX_ATTEMPTS: int = 10
 # Base delay between retry attempts in seconds (multiplied by attempt + 2).
@@ -53,3 +71,227 @@ def rmtree_with_retry(
                         file=sys.stderr,
                     )
                 raise
+
+
+@contextlib.contextmanager
+def file_lock(path: Path, *, shared: bool = False, blocking: bool = True):
+    """Holds an exclusive lock on `path` (created if needed) while in scope.
+
+    Serializes processes (and threads) that share files, e.g. a download
+    cache. The lock file is left in place: removing it while another process
+    waits on it would let a third process lock a new file at the same path.
+
+    With `shared`, the lock is only exclusive of non-shared locks (on Windows,
+    shared locks are exclusive too). Unless `blocking`, raises
+    `BlockingIOError` instead of waiting for the lock.
+    """
+    path = Path(path)
+    path.parent.mkdir(parents=True, exist_ok=True)
+    with open(path, "a+b") as f:
+        if sys.platform == "win32":
+            import msvcrt
+
+            f.seek(0)
+            while True:
+                try:
+                    msvcrt.locking(f.fileno(), msvcrt.LK_NBLCK, 1)
+                    break
+                except OSError:
+                    if not blocking:
+                        raise BlockingIOError(f"{path} is locked")
+                    time.sleep(_FILE_LOCK_POLL_SECONDS)
+            try:
+                yield
+            finally:
+                f.seek(0)
+                msvcrt.locking(f.fileno(), msvcrt.LK_UNLCK, 1)
+        else:
+            import fcntl
+
+            operation = fcntl.LOCK_SH if shared else fcntl.LOCK_EX
+            if not blocking:
+                operation |= fcntl.LOCK_NB
+            fcntl.flock(f.fileno(), operation)
+            try:
+                yield
+            finally:
+                fcntl.flock(f.fileno(), fcntl.LOCK_UN)
+
+
+def reflink_file(src: Path, dst: Path) -> bool:
+    """Create `dst` as a copy-on-write clone of `src`, if supported.
+
+    Uses the FICLONE ioctl (btrfs, XFS with reflink=1, bcachefs, ...). Returns
+    False without leaving `dst` behind if the filesystem, platform or pair of
+    paths does not support cloning.
+    """
+    try:
+        import fcntl
+    except ImportError:
+        return False  # Windows
+    try:
+        with open(src, "rb") as src_f:
+            with open(dst, "xb") as dst_f:
+                try:
+                    fcntl.ioctl(dst_f.fileno(), _FICLONE, src_f.fileno())
+                except OSError:
+                    cloned = False
+                else:
+                    cloned = True
+    except OSError:
+        return False
+    if not cloned:
+        os.unlink(dst)
+        return False
+    shutil.copystat(src, dst)
+    return True
+
+
+def exchange_paths(a: Path, b: Path) -> bool:
+    """Atomically swap two existing paths (e.g. directories), if supported.
+
+    Uses renameat2(RENAME_EXCHANGE) (Linux 3.15+ with glibc 2.28+, on most
+    local filesystems). Returns False without changing anything where the
+    platform or filesystem does not support it.
+    """
+    if not sys.platform.startswith("linux"):
+        return False
+    try:
+        renameat2 = ctypes.CDLL(None, use_errno=True).renameat2
+    except (AttributeError, OSError):
+        return False  # glibc before 2.28, or another libc
+    renameat2.argtypes = [
+        ctypes.c_int,
+        ctypes.c_char_p,
+        ctypes.c_int,
+        ctypes.c_char_p,
+        ctypes.c_uint,
+    ]
+    renameat2.restype = ctypes.c_int
+    if (
+        renameat2(
+            _AT_FDCWD, os.fsencode(a), _AT_FDCWD, os.fsencode(b), _RENAME_EXCHANGE
+        )
+        == 0
+    ):
+        return True
+    err = ctypes.get_errno()
+    if err in (errno.ENOSYS, errno.EINVAL, errno.EOPNOTSUPP):
+        return False
+    raise OSError(err, os.strerror(err), os.fspath(a), None, os.fspath(b))
+
+
+def copy_file(src: Path, dst: Path) -> None:
+    """Copy `src` to `dst` (with metadata), in the kernel where possible.
+
+    Uses `copy_file_range` on Linux, which avoids moving data through user
+    space and lets filesystems that support it (XFS, btrfs, NFS 4.2, ...)
+    share extents or copy server-side. Falls back to `shutil.copy2` where it
+    fails or copies less than the whole file.
+    """
+    copy_file_range = getattr(os, "copy_file_range", None)
+    if copy_file_range is None:
+        shutil.copy2(src, dst)
+        return
+    try:
+        with open(src, "rb") as src_f, open(dst, "wb") as dst_f:
+            remaining = os.fstat(src_f.fileno()).st_size
+            while remaining > 0:
+                copied = copy_file_range(
+                    src_f.fileno(), dst_f.fileno(), min(remaining, 1 << 30)
+                )
+                if copied == 0:
+                    break
+                remaining -= copied
+    except OSError:
+        # E.g. EXDEV on kernels before 5.3, or a filesystem without support.
+        shutil.copy2(src, dst)
+        return
+    if remaining > 0:
+        # Stopped short of the size (e.g. procfs or some FUSE filesystems
+        # copy nothing): `dst` is truncated, so copy it again in user space.
+        shutil.copy2(src, dst)
+        return
+    shutil.copystat(src, dst)
+
+
+def link_or_copy(src: Path, dst: Path, mode: str = "auto") -> str:
+    """Materialize `src` at `dst` without copying data when possible.
+
+    Modes:
+      * "reflink": copy-on-write clone, falling back to a copy.
+      * "hardlink": hard link, falling back to a copy (e.g. across filesystems).
+        Note that the result shares an inode with `src`, so in-place writes
+        to one are visible through the other.
+      * "copy": always copy (see `copy_file`).
+      * "auto": reflink, then hardlink, then copy.
+
+    `dst` must not exist. Returns the method that was used ("reflink",
+    "hardlink" or "copy").
+    """
+    if mode not in LINK_MODES:
+        raise ValueError(f"Unknown link mode: {mode}")
+    if mode in ("auto", "reflink") and reflink_file(src, dst):
+        return "reflink"
+    if mode in ("auto", "hardlink"):
+        try:
+            os.link(src, dst)
+            return "hardlink"
+        except OSError:
+            pass
+    copy_file(src, dst)
+    return "copy"
+
+
+def replace_with_link_or_copy(src: Path, dst: Path, mode: str = "auto") -> str:
+    """Like `link_or_copy`, but atomically replaces `dst` if it exists.
+
+    The new file is created next to `dst` and renamed over it, so a hard
+    link that `dst` may be is never written through.
+    """
+    tmp = dst.parent / f".{dst.name}.{os.getpid()}.{threading.get_ident()}.tmp"
+    tmp.unlink(missing_ok=True)
+    try:
+        method = link_or_copy(src, tmp, mode)
+        os.replace(tmp, dst)
+    except BaseException:
+        tmp.unlink(missing_ok=True)
+        raise
+    return method
+
+
+def link_tree(src_dir: Path, dst_dir: Path, mode: str = "auto") -> dict[str, int]:
+    """Recreates the tree `src_dir` at `dst_dir`, materializing files with
+    `link_or_copy`.
+
+    Directories are created and symlinks are recreated (not followed). Files
+    that already exist at `dst_dir` are left alone. Returns how many files
+    were materialized with each method (e.g. `{"hardlink": 10}`).
+    """
+    counts: dict[str, int] = {}
+    src_dir = Path(src_dir)
+    dst_dir = Path(dst_dir)
+    dst_dir.mkdir(parents=True, exist_ok=True)
+    for root, dirs, files in os.walk(src_dir):
+        root_path = Path(root)
+        dst_root = dst_dir / root_path.relative_to(src_dir)
+        for name in list(dirs):
+            src_path = root_path / name
+            if src_path.is_symlink():
+                # os.walk lists symlinks to directories as directories.
+                dirs.remove(name)
+                files.append(name)
+            else:
+                (dst_root / name).mkdir(exist_ok=True)
+        for name in files:
+            src_path = root_path / name
+            dst_path = dst_root / name
+            if dst_path.is_symlink() or dst_path.exists():
+                continue
+            if src_path.is_symlink():
+                dst_path.symlink_to(os.readlink(src_path))
+                method = "symlink"
+            else:
+                method = link_or_copy(src_path, dst_path, mode)
+            counts[method] = counts.get(method, 0) + 1
+    return counts
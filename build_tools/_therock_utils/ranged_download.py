@@ -0,0 +1,469 @@
+# Copyright Advanced Micro Devices, Inc.
+# SPDX-License-Identifier: MIT
+
+"""Multipart, range-parallel downloads that share one connection budget.
+
+A single stream per object leaves one large artifact (e.g. amd-llvm) gating a
+whole fetch once the smaller ones are done. `download_parts` splits an object
+into fixed-size parts and fetches them over several connections, writing each
+part at its offset of the destination file.
+
+All downloads of a fetch draw connections from one `ConnectionBudget`. Each
+download holds one connection for its lifetime (see
+`ConnectionBudget.connection`); a multipart download additionally registers
+itself with the budget, which hands every idle connection to the registered
+download with the most bytes left, up to its per-object limit. So extra
+connections go to the largest remaining downloads first, and the total never
+exceeds the budget.
+
+Completed parts are recorded in a `{path}.parts` progress file, so a failed
+or killed multipart download resumes with only its missing parts.
+
+A `DownloadProgress` tracks the contiguous prefix of a download that is on
+disk, so that a consumer (e.g. extraction) can read the download while it is
+still in progress.
+"""
+
+import collections
+import concurrent.futures
+import contextlib
+from dataclasses import dataclass
+import io
+import json
+from pathlib import Path
+import threading
+from typing import BinaryIO, Callable, Optional
+
+DEFAULT_PART_SIZE = 64 * 1024 * 1024
+DEFAULT_MAX_CONNECTIONS_PER_OBJECT = 8
+PARTS_SUFFIX = ".parts"
+
+_COPY_BUFFER_SIZE = 1 << 20
+
+
+class ConnectionBudget:
+    """Caps the number of concurrent connections across all downloads.
+
+    The limit can be changed up to `max_limit` while downloads are running
+    (see `set_limit`); connections in use above a lowered limit are not
+    interrupted, but are not handed out again once released.
+
+    Downloads queued with `enqueue` are given connections in queue order,
+    even if their threads ask for one in a different order (e.g. when there
+    are more download threads than connections).
+    """
+
+    def __init__(self, limit: int, max_limit: Optional[int] = None):
+        if limit < 1:
+            raise ValueError(f"Connection budget must be positive, got {limit}")
+        self.limit = limit
+        self.max_limit = max(limit, max_limit or limit)
+        self._in_use = 0
+        self._cond = threading.Condition()
+        self._jobs: list["_MultipartJob"] = []
+        self._queue: collections.deque[str] = collections.deque()
+        self._queued: set[str] = set()
+        self._executor = concurrent.futures.ThreadPoolExecutor(
+            max_workers=self.max_limit, thread_name_prefix="download-part"
+        )
+
+    @property
+    def in_use(self) -> int:
+        return self._in_use
+
+    def enqueue(self, keys: list[str]):
+        """Queues downloads of `keys`, to be given connections in this order."""
+        with self._cond:
+            self._queue.extend(keys)
+            self._queued.update(keys)
+
+    def dequeue(self, key: str):
+        """Removes `key` from the queue (e.g. it needs no connection)."""
+        with self._cond:
+            if key in self._queued:
+                self._queued.discard(key)
+                self._cond.notify_all()
+
+    def _is_next_locked(self, key: Optional[str]) -> bool:
+        if key not in self._queued:
+            return True
+        while self._queue[0] not in self._queued:
+            self._queue.popleft()
+        return self._queue[0] == key
+
+    @contextlib.contextmanager
+    def connection(self, key: Optional[str] = None):
+        """Holds one connection of the budget, blocking until one is free.
+
+        If `key` is queued, also waits for the downloads queued before it.
+        """
+        with self._cond:
+            while self._in_use >= self.limit or not self._is_next_locked(key):
+                self._cond.wait()
+            self._in_use += 1
+            if key in self._queued:
+                self._queued.discard(key)
+                self._cond.notify_all()
+        try:
+            yield
+        finally:
+            self._release()
+
+    def set_limit(self, limit: int):
+        if not 1 <= limit <= self.max_limit:
+            raise ValueError(
+                f"Connection budget must be in [1, {self.max_limit}], got {limit}"
+            )
+        with self._cond:
+            self.limit = limit
+            self._cond.notify_all()
+        self._dispatch()
+
+    def shutdown(self):
+        self._executor.shutdown(wait=True)
+
+    def _release(self):
+        with self._cond:
+            self._in_use -= 1
+            self._cond.notify_all()
+        self._dispatch()
+
+    def _add_job(self, job: "_MultipartJob"):
+        with self._cond:
+            self._jobs.append(job)
+        self._dispatch()
+
+    def _remove_job(self, job: "_MultipartJob"):
+        with self._cond:
+            if job in self._jobs:
+                self._jobs.remove(job)
+
+    def _dispatch(self):
+        """Hands idle connections to the jobs with the most bytes left."""
+        while True:
+            with self._cond:
+                if self._in_use >= self.limit:
+                    return
+                jobs = sorted(self._jobs, key=lambda j: j.remaining_bytes, reverse=True)
+                job = next((j for j in jobs if j.add_connection()), None)
+                if job is None:
+                    return
+                self._in_use += 1
+            try:
+                self._executor.submit(self._run_helper, job)
+            except RuntimeError:
+                # Shut down: the job's own thread fetches the remaining parts.
+                job.release_connection()
+                with self._cond:
+                    self._in_use -= 1
+                    self._cond.notify_all()
+                return
+
+    def _run_helper(self, job: "_MultipartJob"):
+        try:
+            job.run()
+        finally:
+            job.release_connection()
+            self._release()
+
+
+@dataclass(frozen=True)
+class _Part:
+    index: int
+    start: int
+    length: int
+
+
+class _MultipartJob:
+    def __init__(
+        self,
+        parts: list[_Part],
+        fetch_part: Callable[[_Part], None],
+        max_connections: int,
+    ):
+        self.lock = threading.Condition()
+        self._parts = collections.deque(parts)
+        self._fetch_part = fetch_part
+        self._max_connections = max_connections
+        self.remaining_bytes = sum(p.length for p in parts)
+        # Includes the connection of the thread that created the job. Only
+        # changed under `lock`, which `wait_for_helpers` waits on.
+        self.connections = 1
+        self.error: Optional[BaseException] = None
+
+    def add_connection(self) -> bool:
+        """Counts one more connection if the job can use it."""
+        with self.lock:
+            if (
+                self.error is None
+                and len(self._parts) >= self.connections
+                and self.connections < self._max_connections
+            ):
+                self.connections += 1
+                return True
+            return False
+
+    def release_connection(self):
+        with self.lock:
+            self.connections -= 1
+            self.lock.notify_all()
+
+    def run(self):
+        """Fetches parts until none are left or one fails."""
+        while True:
+            with self.lock:
+                if self.error is not None or not self._parts:
+                    return
+                part = self._parts.popleft()
+                self.remaining_bytes -= part.length
+            try:
+                self._fetch_part(part)
+            except BaseException as e:
+                with self.lock:
+                    if self.error is None:
+                        self.error = e
+                return
+
+    def wait_for_helpers(self):
+        with self.lock:
+            while self.connections > 1:
+                self.lock.wait()
+
+
+def _parts_path(path: Path) -> Path:
+    return Path(f"{path}{PARTS_SUFFIX}")
+
+
+def _load_completed_parts(
+    path: Path, size: int, part_size: int, identity: Optional[str]
+) -> Optional[set[int]]:
+    """Returns completed part indexes of a resumable download, if any."""
+    parts_path = _parts_path(path)
+    if not path.exists() or not parts_path.exists():
+        return None
+    try:
+        lines = parts_path.read_text().splitlines()
+        header = json.loads(lines[0])
+        if header != {"size": size, "part_size": part_size, "identity": identity}:
+            return None
+        # A trailing line may be truncated if the process was killed.
+        return {int(line) for line in lines[1:] if line.strip().isdigit()}
+    except (OSError, ValueError, IndexError):
+        return None
+
+
+def download_parts(
+    open_range: Callable[[int, int], BinaryIO],
+    size: int,
+    path: Path,
+    budget: ConnectionBudget,
+    *,
+    part_size: int = DEFAULT_PART_SIZE,
+    max_connections: int = DEFAULT_MAX_CONNECTIONS_PER_OBJECT,
+    identity: Optional[str] = None,
+    progress: Optional["DownloadProgress"] = None,
+    on_bytes: Optional[Callable[[int], None]] = None,
+) -> int:
+    """Downloads `size` bytes into `path` as parallel ranged parts.
+
+    `open_range(start, length)` must return a stream of the object's bytes
+    from `start`. The calling thread must hold a connection of `budget`; up to
+    `max_connections - 1` more are used when the budget has idle ones.
+    Completed parts of an earlier attempt at the same object (same `size`,
+    `part_size` and `identity`, e.g. an ETag) are kept. Returns the number of
+    bytes fetched. On success the progress file is removed; on failure it is
+    kept for the next attempt. Written bytes are reported to `progress`, and
+    their count to `on_bytes` (e.g. `AdaptiveConcurrency.record`).
+    """
+    parts_path = _parts_path(path)
+    completed = _load_completed_parts(path, size, part_size, identity)
+    if completed is None:
+        completed = set()
+        with open(path, "wb") as f:
+            f.truncate(size)
+        header = {"size": size, "part_size": part_size, "identity": identity}
+        parts_path.write_text(json.dumps(header) + "\n")
+
+    all_parts = [
+        _Part(index, start, min(part_size, size - start))
+        for index, start in enumerate(range(0, size, part_size))
+    ]
+    parts = [p for p in all_parts if p.index not in completed]
+    if progress is not None:
+        progress.start(
+            path,
+            size,
+            [(p.start, p.length) for p in all_parts if p.index in completed],
+        )
+    parts_lock = threading.Lock()
+
+    def fetch_part(part: _Part):
+        body = open_range(part.start, part.length)
+        try:
+            with open(path, "r+b") as out_file:
+                out_file.seek(part.start)
+                remaining = part.length
+                while remaining:
+                    chunk = body.read(min(_COPY_BUFFER_SIZE, remaining))
+                    if not chunk:
+                        raise IOError(
+                            f"Part {part.index} of {path.name} ended "
+                            f"{remaining} bytes early"
+                        )
+                    out_file.write(chunk)
+                    if progress is not None:
+                        out_file.flush()
+                        progress.add(part.start + part.length - remaining, len(chunk))
+                    if on_bytes is not None:
+                        on_bytes(len(chunk))
+                    remaining -= len(chunk)
+        finally:
+            body.close()
+        with parts_lock:
+            with open(parts_path, "a") as f:
+                f.write(f"{part.index}\n")
+
+    job = _MultipartJob(parts, fetch_part, max_connections)
+    budget._add_job(job)
+    try:
+        job.run()
+    finally:
+        budget._remove_job(job)
+        job.wait_for_helpers()
+    if job.error is not None:
+        raise job.error
+    parts_path.unlink()
+    return sum(p.length for p in parts)
+
+
+def discard_partial(path: Path):
+    """Removes a partial download and its progress file."""
+    Path(path).unlink(missing_ok=True)
+    _parts_path(path).unlink(missing_ok=True)
+
+
+def is_multipart_partial(path: Path) -> bool:
+    return _parts_path(path).exists()
+
+
+class DownloadProgress:
+    """The contiguous prefix of a download that is on disk.
+
+    The downloader calls `start` (again on each attempt), `add` for every
+    written range and finally `finish` or `fail`. `open_reader` returns a
+    stream of the download that blocks until the next bytes are written.
+    `on_start`, if set, is called (outside the lock) on the first `start`,
+    i.e. once there is something to read.
+    """
+
+    def __init__(self, on_start: Optional[Callable[[], None]] = None):
+        self.on_start = on_start
+        self._started = False
+        self._cond = threading.Condition()
+        self._path: Optional[Path] = None
+        self._size = 0
+        self._available = 0
+        self._ranges: dict[int, int] = {}  # Written ranges past the prefix
+        self._done = False
+        self._error: Optional[BaseException] = None
+
+    def start(self, path: Path, size: int, ranges: list[tuple[int, int]] = ()):
+        """Begins an attempt that keeps `ranges` (start, length) of `path`."""
+        with self._cond:
+            previous = self._available
+            self._path = Path(path)
+            self._size = size
+            self._available = 0
+            self._ranges = {}
+            for start, length in ranges:
+                self._add_locked(start, length)
+            if self._available < previous:
+                # Bytes a reader may have consumed were discarded.
+                self._error = IOError(f"Download of {self._path.name} restarted")
+            self._cond.notify_all()
+            first_start = not self._started
+            self._started = True
+        if first_start and self.on_start is not None:
+            self.on_start()
+
+    def add(self, start: int, length: int):
+        with self._cond:
+            self._add_locked(start, length)
+            self._cond.notify_all()
+
+    def _add_locked(self, start: int, length: int):
+        self._ranges[start] = max(self._ranges.get(start, 0), start + length)
+        while self._available in self._ranges:
+            self._available = max(self._available, self._ranges.pop(self._available))
+
+    def finish(self, path: Path, size: int):
+        """Marks the download complete at its final `path`."""
+        with self._cond:
+            self._path = Path(path)
+            self._size = size
+            self._available = size
+            self._done = True
+            self._cond.notify_all()
+
+    def fail(self, error: BaseException):
+        with self._cond:
+            if self._error is None and not self._done:
+                self._error = error
+            self._cond.notify_all()
+
+    @property
+    def error(self) -> Optional[BaseException]:
+        """Why reads failed or may have read discarded bytes, if they did."""
+        with self._cond:
+            return self._error
+
+    def _wait_beyond(self, pos: int) -> tuple[int, Optional[Path]]:
+        """Waits until bytes past `pos` are on disk, or the download ended."""
+        with self._cond:
+            while True:
+                if self._error is not None:
+                    raise IOError(f"Download failed: {self._error}")
+                if self._available > pos or self._done:
+                    return self._available, self._path
+                self._cond.wait()
+
+    def open_reader(self) -> BinaryIO:
+        return io.BufferedReader(_ProgressReader(self), buffer_size=_COPY_BUFFER_SIZE)
+
+
+class _ProgressReader(io.RawIOBase):
+    """Sequential reader of a download that follows its `DownloadProgress`.
+
+    The file is kept open once opened, so the downloader may rename it into
+    place while it is being read (POSIX only).
+    """
+
+    def __init__(self, progress: DownloadProgress):
+        self._progress = progress
+        self._file: Optional[BinaryIO] = None
+        self._pos = 0
+
+    def readable(self) -> bool:
+        return True
+
+    def readinto(self, b) -> int:
+        available, path = self._progress._wait_beyond(self._pos)
+        if available <= self._pos:
+            return 0
+        if self._file is None:
+            try:
+                self._file = open(path, "rb")
+            except FileNotFoundError:
+                # Renamed into place since `_wait_beyond` returned.
+                available, path = self._progress._wait_beyond(self._pos)
+                self._file = open(path, "rb")
+        self._file.seek(self._pos)
+        n = self._file.readinto(memoryview(b)[: available - self._pos])
+        self._pos += n
+        return n
+
+    def close(self):
+        if self._file is not None:
+            self._file.close()
+            self._file = None
+        super().close()
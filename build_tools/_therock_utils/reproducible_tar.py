@@ -0,0 +1,248 @@
+# Copyright Advanced Micro Devices, Inc.
+# SPDX-License-Identifier: MIT
+
+"""Reproducible tar archives.
+
+`ReproducibleTarWriter` writes tar archives whose bytes only depend on the
+archived paths and file contents, not on when, where or by whom they were
+created:
+
+* Members are written sorted by name, whatever order they were added in.
+* mtimes are clamped to a fixed time (see `source_date_epoch`), or all set
+  to it with `clamp_mtime=False` (like `git archive`).
+* Owners are root/root (uid/gid 0, no user or group names).
+* Permissions are normalized to 0755 (directories and executables) or 0644.
+* The GNU tar format is used, which has no per-member extended headers.
+
+Combined with a compressor that has fixed parameters and no embedded
+timestamps (see `archive_util.open_compressed_for_write`), unchanged inputs
+produce byte-identical archives, so they can be compared or deduplicated by
+hash.
+"""
+
+import collections
+import concurrent.futures
+import io
+import os
+from pathlib import Path
+import stat
+import tarfile
+from typing import BinaryIO, Callable, Iterable, Iterator, Sequence
+
+SOURCE_DATE_EPOCH_ENV = "SOURCE_DATE_EPOCH"
+
+_COPY_BUFFER_SIZE = 1 << 20
+# Files up to this size are read ahead in full by the reader threads. Larger
+# files are streamed from disk when they are written.
+_READ_AHEAD_MAX_FILE_SIZE = 1 << 20
+# Files read ahead per reader thread.
+_READ_AHEAD_PER_THREAD = 8
+
+
+def source_date_epoch(default: int | None = None) -> int | None:
+    """The `SOURCE_DATE_EPOCH` environment variable, or `default` if unset.
+
+    See https://reproducible-builds.org/specs/source-date-epoch/.
+    """
+    value = os.environ.get(SOURCE_DATE_EPOCH_ENV)
+    if not value:
+        return default
+    return int(value)
+
+
+class ReproducibleTarWriter:
+    """Writes a reproducible tar stream to `fileobj`.
+
+    Members are only collected by the `add_*` methods and are written on
+    `close()`, which also closes `fileobj`. Adding the same name twice keeps
+    the last one. Can be used as a context manager, which closes on success
+    and discards the archive (only closing `fileobj`) on error.
+
+    With `read_threads` > 1, small files are read ahead of the writer on that
+    many threads, so that writing many small files (e.g. a source tree) is
+    not bound by the latency of reading them one at a time.
+    """
+
+    def __init__(
+        self,
+        fileobj: BinaryIO,
+        *,
+        mtime: int,
+        clamp_mtime: bool = True,
+        read_threads: int = 1,
+    ):
+        self.fileobj = fileobj
+        self.mtime = mtime
+        self.clamp_mtime = clamp_mtime
+        self.read_threads = read_threads
+        self.size = 0
+        # arcname -> source path, or the header of a member not backed by a
+        # file with a function opening its contents (for regular files).
+        self._members: dict[
+            str, Path | tuple[tarfile.TarInfo, Callable[[], BinaryIO] | None]
+        ] = {}
+
+    def __enter__(self) -> "ReproducibleTarWriter":
+        return self
+
+    def __exit__(self, exc_type, exc_value, traceback):
+        if exc_type is None:
+            self.close()
+        else:
+            self.fileobj.close()
+
+    def add_file(self, path: Path, arcname: str):
+        """Adds a file, symlink or (empty) directory entry."""
+        self._members[arcname] = Path(path)
+
+    def add_text(self, text: str, arcname: str):
+        data = text.encode()
+        self.add_stream(arcname, len(data), lambda: io.BytesIO(data))
+
+    def add_stream(
+        self,
+        arcname: str,
+        size: int,
+        open_data: Callable[[], BinaryIO],
+        *,
+        executable: bool = False,
+    ):
+        """Adds a regular file of `size` bytes read from `open_data()`.
+
+        `open_data` is only called when the member is written, in member order.
+        """
+        info = tarfile.TarInfo(arcname)
+        info.size = size
+        info.mode = 0o755 if executable else 0o644
+        info.mtime = self.mtime
+        self._members[arcname] = (info, open_data)
+
+    def add_symlink(self, target: str, arcname: str):
+        info = tarfile.TarInfo(arcname)
+        info.type = tarfile.SYMTYPE
+        info.linkname = target
+        info.mtime = self.mtime
+        self._members[arcname] = (info, None)
+
+    def add_empty_directory(self, arcname: str):
+        info = tarfile.TarInfo(arcname)
+        info.type = tarfile.DIRTYPE
+        info.mtime = self.mtime
+        self._members[arcname] = (info, None)
+
+    def add_tree(self, root: Path, arcname: str = "."):
+        """Adds `root` and everything below it (not following symlinks)."""
+        root = Path(root)
+        self.add_file(root, arcname)
+        for dirpath, dirnames, filenames in os.walk(root):
+            dir_path = Path(dirpath)
+            dir_arcname = arcname
+            relpath = dir_path.relative_to(root).as_posix()
+            if relpath != ".":
+                dir_arcname = f"{arcname}/{relpath}"
+            for name in dirnames + filenames:
+                self.add_file(dir_path / name, f"{dir_arcname}/{name}")
+
+    def _normalize(self, info: tarfile.TarInfo):
+        info.uid = info.gid = 0
+        info.uname = info.gname = ""
+        if self.clamp_mtime:
+            info.mtime = min(int(info.mtime), self.mtime)
+        else:
+            info.mtime = self.mtime
+        if info.issym():
+            info.mode = 0o777
+        elif info.isdir() or info.mode & 0o111:
+            info.mode = 0o755
+        else:
+            info.mode = 0o644
+
+    def close(
+        self, progress: Callable[[Sequence[str]], Iterable[str]] = lambda names: names
+    ):
+        """Writes the archive, iterating member names through `progress`."""
+        try:
+            with tarfile.open(
+                fileobj=self, mode="w|", format=tarfile.GNU_FORMAT
+            ) as archive:
+                archive.copybufsize = _COPY_BUFFER_SIZE
+                names = progress(sorted(self._members))
+                for arcname, data in self._read_ahead(names):
+                    self._write_member(archive, arcname, self._members[arcname], data)
+        finally:
+            self.fileobj.close()
+
+    def _read_ahead(self, names: Iterable[str]) -> Iterator[tuple[str, bytes | None]]:
+        """Yields `names` with the contents of small files read ahead."""
+        if self.read_threads <= 1:
+            for arcname in names:
+                yield arcname, None
+            return
+        names = iter(names)
+        with concurrent.futures.ThreadPoolExecutor(
+            max_workers=self.read_threads, thread_name_prefix="tar-read"
+        ) as executor:
+            pending: collections.deque = collections.deque()
+            try:
+                while True:
+                    while len(pending) < self.read_threads * _READ_AHEAD_PER_THREAD:
+                        arcname = next(names, None)
+                        if arcname is None:
+                            break
+                        source = self._members[arcname]
+                        future = None
+                        if isinstance(source, Path):
+                            future = executor.submit(_read_small_file, source)
+                        pending.append((arcname, future))
+                    if not pending:
+                        break
+                    arcname, future = pending.popleft()
+                    yield arcname, future.result() if future else None
+            finally:
+                for _, future in pending:
+                    if future:
+                        future.cancel()
+
+    def _write_member(
+        self,
+        archive: tarfile.TarFile,
+        arcname: str,
+        source: Path | tuple[tarfile.TarInfo, Callable[[], BinaryIO] | None],
+        data: bytes | None,
+    ):
+        if isinstance(source, tuple):
+            info, open_data = source
+            self._normalize(info)
+            archive.addfile(info, open_data() if open_data else None)
+            return
+        # Hardlinks to files written earlier are stored as links.
+        info = archive.gettarinfo(str(source), arcname)
+        if info is None:
+            # Sockets and other unsupported file types.
+            return
+        self._normalize(info)
+        if not info.isreg():
+            archive.addfile(info)
+        elif data is not None and len(data) == info.size:
+            archive.addfile(info, io.BytesIO(data))
+        else:
+            with open(source, "rb") as f:
+                archive.addfile(info, f)
+
+    def write(self, b) -> int:
+        # Counts the uncompressed size for callers that report it.
+        self.size += len(b)
+        return self.fileobj.write(b)
+
+
+def _read_small_file(path: Path) -> bytes | None:
+    """Contents of `path` if it is a small regular file, otherwise None."""
+    try:
+        st = os.lstat(path)
+        if not stat.S_ISREG(st.st_mode) or st.st_size > _READ_AHEAD_MAX_FILE_SIZE:
+            return None
+        with open(path, "rb") as f:
+            return f.read()
+    except OSError:
+        # Reported when the member is written.
+        return None
@@ -0,0 +1,285 @@
+# Copyright Advanced Micro Devices, Inc.
+# SPDX-License-Identifier: MIT
+
+"""Run-level index of the artifacts pushed to a workflow run.
+
+Without an index, every consumer of a run (fetch, build_tarballs, the
+find_*_artifacts scripts) rediscovers what exists by paginating a listing of
+the whole run prefix (which also holds logs, manifests and packages) and by
+probing sidecars one request at a time.
+
+Each `artifact_manager.py push` therefore also uploads a run index fragment::
+
+    {run prefix}/artifact_index/{stage}.{family}+{family}....json
+
+listing every archive it pushed with its artifact name, component, target
+family, compressed size, sha256, uncompressed size, file count and the
+sidecars uploaded next to it. Pushes of a multi-arch run happen concurrently
+(one per stage and family), so each writes its own fragment rather than
+updating a shared object. Readers list the small `artifact_index/` directory
+and read its fragments (`load_run_index`), or only look at fragment names to
+see which stages and families have been pushed (`RunIndexFragmentName`).
+
+Fragments are only written once a push has uploaded all of its artifacts.
+"""
+
+import concurrent.futures
+from dataclasses import dataclass, field
+import json
+import os
+from pathlib import Path
+import tempfile
+from typing import TYPE_CHECKING, Dict, Iterable, Optional
+
+from .artifacts import ArtifactName
+
+if TYPE_CHECKING:
+    from .artifact_backend import ArtifactBackend, ArtifactStat
+
+# Directory (relative to the run prefix) holding the index fragments.
+RUN_INDEX_DIR = "artifact_index"
+RUN_INDEX_VERSION = 1
+
+_MAX_FRAGMENT_READERS = 16
+
+
+@dataclass
+class RunIndexEntry:
+    """One artifact archive of a run."""
+
+    artifact_key: str  # e.g. "blas_lib_gfx94X-dcgpu.tar.zst"
+    name: str
+    component: str
+    target_family: str
+    size: int
+    sha256: str
+    uncompressed_size: Optional[int] = None
+    file_count: Optional[int] = None
+    # Sidecar suffix (e.g. ".sha256sum") -> size of the uploaded sidecar
+    sidecars: Dict[str, int] = field(default_factory=dict)
+
+    def to_json(self) -> dict:
+        return {
+            "artifact_key": self.artifact_key,
+            "name": self.name,
+            "component": self.component,
+            "target_family": self.target_family,
+            "size": self.size,
+            "sha256": self.sha256,
+            "uncompressed_size": self.uncompressed_size,
+            "file_count": self.file_count,
+            "sidecars": self.sidecars,
+        }
+
+    @staticmethod
+    def from_json(d: dict) -> "RunIndexEntry":
+        return RunIndexEntry(
+            artifact_key=d["artifact_key"],
+            name=d["name"],
+            component=d["component"],
+            target_family=d["target_family"],
+            size=d["size"],
+            sha256=d["sha256"],
+            uncompressed_size=d.get("uncompressed_size"),
+            file_count=d.get("file_count"),
+            sidecars=dict(d.get("sidecars", {})),
+        )
+
+    @staticmethod
+    def for_archive(
+        artifact_key: str,
+        size: int,
+        sha256: str,
+        *,
+        uncompressed_size: Optional[int] = None,
+        file_count: Optional[int] = None,
+        sidecars: Optional[Dict[str, int]] = None,
+    ) -> "RunIndexEntry":
+        an = ArtifactName.from_filename(artifact_key)
+        if an is None:
+            raise ValueError(f"Not an artifact archive name: {artifact_key}")
+        return RunIndexEntry(
+            artifact_key=artifact_key,
+            name=an.name,
+            component=an.component,
+            target_family=an.target_family,
+            size=size,
+            sha256=sha256,
+            uncompressed_size=uncompressed_size,
+            file_count=file_count,
+            sidecars=dict(sidecars or {}),
+        )
+
+
+@dataclass(frozen=True)
+class RunIndexFragmentName:
+    """The stage and target families of one push, encoded in its file name."""
+
+    stage: str
+    target_families: tuple[str, ...]
+
+    @property
+    def filename(self) -> str:
+        return f"{self.stage}.{'+'.join(self.target_families)}.json"
+
+    @staticmethod
+    def parse(filename: str) -> Optional["RunIndexFragmentName"]:
+        if not filename.endswith(".json"):
+            return None
+        stage, sep, families = filename[: -len(".json")].partition(".")
+        if not sep or not stage or not families:
+            return None
+        return RunIndexFragmentName(stage, tuple(families.split("+")))
+
+
+@dataclass
+class RunIndex:
+    """The merged run index fragments of a run (or one fragment)."""
+
+    entries: Dict[str, RunIndexEntry] = field(default_factory=dict)
+    # Fragments merged into this index
+    fragments: list[RunIndexFragmentName] = field(default_factory=list)
+
+    def add(self, entry: RunIndexEntry):
+        self.entries[entry.artifact_key] = entry
+
+    def merge(self, other: "RunIndex"):
+        self.entries.update(other.entries)
+        self.fragments.extend(other.fragments)
+
+    @property
+    def stages(self) -> set[str]:
+        return {f.stage for f in self.fragments}
+
+    @property
+    def target_families(self) -> set[str]:
+        return {e.target_family for e in self.entries.values()}
+
+    def fragment_name(self, stage: str) -> RunIndexFragmentName:
+        """Name of the fragment a push of `stage` writes for this index."""
+        return RunIndexFragmentName(stage, tuple(sorted(self.target_families)))
+
+    def listing(self) -> Dict[str, "ArtifactStat"]:
+        """The run's archives and sidecars, as an `ArtifactBackend` listing."""
+        from .artifact_backend import ArtifactStat
+
+        files = {}
+        for key, entry in self.entries.items():
+            files[key] = ArtifactStat(size=entry.size)
+            for suffix, size in entry.sidecars.items():
+                files[f"{key}{suffix}"] = ArtifactStat(size=size)
+        return files
+
+    def dumps(self) -> str:
+        return json.dumps(
+            {
+                "version": RUN_INDEX_VERSION,
+                "fragments": [f.filename for f in self.fragments],
+                "artifacts": [self.entries[k].to_json() for k in sorted(self.entries)],
+            },
+            indent=1,
+        )
+
+    def dump(self, path: Path):
+        """Writes the index to `path` atomically (e.g. a cache file)."""
+        path = Path(path)
+        path.parent.mkdir(parents=True, exist_ok=True)
+        fd, tmp = tempfile.mkstemp(dir=path.parent, prefix=f".{path.name}.")
+        with os.fdopen(fd, "w") as f:
+            f.write(self.dumps())
+        os.replace(tmp, path)
+
+    @staticmethod
+    def loads(text: str) -> "RunIndex":
+        d = json.loads(text)
+        version = d.get("version")
+        if version != RUN_INDEX_VERSION:
+            raise ValueError(f"Unsupported run index version: {version}")
+        index = RunIndex()
+        for e in d["artifacts"]:
+            index.add(RunIndexEntry.from_json(e))
+        for name in d.get("fragments", []):
+            fragment = RunIndexFragmentName.parse(name)
+            if fragment is None:
+                raise ValueError(f"Invalid run index fragment name: {name}")
+            index.fragments.append(fragment)
+        return index
+
+    @staticmethod
+    def load(path: Path) -> "RunIndex":
+        return RunIndex.loads(Path(path).read_text())
+
+
+def list_run_index_fragments(
+    backend: "ArtifactBackend",
+) -> list[RunIndexFragmentName]:
+    """Lists the fragments of the run's index (one listing request)."""
+    names = []
+    for filename in sorted(backend.list_directory(RUN_INDEX_DIR)):
+        fragment = RunIndexFragmentName.parse(filename)
+        if fragment is not None:
+            names.append(fragment)
+    return names
+
+
+def load_run_index(backend: "ArtifactBackend") -> Optional[RunIndex]:
+    """Reads and merges the run's index fragments.
+
+    Returns None if the run has no index (e.g. it was pushed by an older
+    artifact_manager.py), in which case callers should list the run instead.
+    """
+    fragments = list_run_index_fragments(backend)
+    if not fragments:
+        return None
+
+    def read_fragment(fragment: RunIndexFragmentName) -> RunIndex:
+        body = backend.open_artifact(f"{RUN_INDEX_DIR}/{fragment.filename}")
+        try:
+            return RunIndex.loads(body.read().decode())
+        finally:
+            body.close()
+
+    index = RunIndex()
+    with concurrent.futures.ThreadPoolExecutor(
+        max_workers=min(len(fragments), _MAX_FRAGMENT_READERS)
+    ) as executor:
+        for fragment in executor.map(read_fragment, fragments):
+            index.merge(fragment)
+    return index
+
+
+def publish_run_index_fragment(
+    backend: "ArtifactBackend", index: RunIndex, stage: str, work_dir: Path
+) -> RunIndexFragmentName:
+    """Uploads `index` (the artifacts of one push) as a fragment of the run's index.
+
+    Raises ValueError if `index` is empty: its fragment name would list no
+    target families.
+    """
+    if not index.entries:
+        raise ValueError(f"No artifacts to index for stage {stage}")
+    fragment = index.fragment_name(stage)
+    index.fragments = [fragment]
+    path = Path(work_dir) / fragment.filename
+    index.dump(path)
+    backend.upload_artifact(path, f"{RUN_INDEX_DIR}/{fragment.filename}")
+    return fragment
+
+
+def missing_from_index(
+    index: RunIndex, needed: Iterable[tuple[str, Optional[str]]]
+) -> set[tuple[str, Optional[str]]]:
+    """Returns the (stage, target family) pairs of `needed` not in `index`.
+
+    Each push of a stage for some target families writes its own fragment,
+    so a stage pushed for one family may not have been pushed for another
+    yet. A pair is covered by a fragment of its stage listing its family, or,
+    for a family of None, by any fragment of its stage.
+    """
+    if "all" in index.stages:
+        return set()
+    pushed = set()
+    for fragment in index.fragments:
+        pushed.add((fragment.stage, None))
+        pushed.update((fragment.stage, family) for family in fragment.target_families)
+    return set(needed) - pushed
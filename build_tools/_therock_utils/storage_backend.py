@@ -30,6 +30,10 @@ import time
 from abc import ABC, abstractmethod
 from pathlib import Path
 
+from _therock_utils.adaptive_concurrency import (
+    DEFAULT_MAX_CONCURRENCY,
+    AdaptiveConcurrency,
+)
 from _therock_utils.storage_location import StorageLocation
 
 logger = logging.getLogger(__name__)
@@ -266,14 +270,40 @@ _S3_INITIAL_BACKOFF_SECONDS = 1.0
 _S3_DEFAULT_UPLOAD_CONCURRENCY = 10
 
 
-def _s3_retry(operation: str, location: str, func, *args, **kwargs):
-    """Call *func* with retries and exponential backoff on failure."""
+def _s3_retry(
+    operation: str,
+    location: str,
+    func,
+    *args,
+    concurrency: AdaptiveConcurrency | None = None,
+    **kwargs,
+):
+    """Call *func* with retries and exponential backoff on failure.
+
+    With *concurrency*, *func* is a boto3 managed transfer: it gets a
+    ``Callback`` counting the bytes it transfers, and the bytes of the
+    successful attempt are reported to *concurrency* (those of failed
+    attempts are sent again, so they don't count). Failures are reported
+    to it as well, so that it backs off on throttling.
+    """
     last_exc: Exception | None = None
     for attempt in range(_S3_MAX_RETRIES):
+        transferred = 0
+
+        def count_transferred(num_bytes: int):
+            nonlocal transferred
+            transferred += num_bytes
+
         try:
-            return func(*args, **kwargs)
+            if concurrency is None:
+                return func(*args, **kwargs)
+            result = func(*args, Callback=count_transferred, **kwargs)
+            concurrency.record(transferred)
+            return result
         except Exception as exc:
             last_exc = exc
+            if concurrency is not None:
+                concurrency.record_error(exc)
             if attempt < _S3_MAX_RETRIES - 1:
                 wait = _S3_INITIAL_BACKOFF_SECONDS * (2**attempt)
                 logger.warning(
@@ -292,16 +322,26 @@ def _s3_retry(operation: str, location: str, func, *args, **kwargs):
 
 
 class S3StorageBackend(StorageBackend):
-    """S3 storage backend using boto3."""
+    """S3 storage backend using boto3.
+
+    ``upload_files`` and ``copy_files`` start with *upload_concurrency*
+    parallel transfers and adapt that number to the achieved throughput, up
+    to *max_upload_concurrency* (see ``adaptive_concurrency.py``). Pass the
+    same value for both to keep it fixed.
+    """
 
     def __init__(
         self,
         *,
         dry_run: bool = False,
         upload_concurrency: int = _S3_DEFAULT_UPLOAD_CONCURRENCY,
+        max_upload_concurrency: int | None = None,
     ):
         self._dry_run = dry_run
         self._upload_concurrency = upload_concurrency
+        if max_upload_concurrency is None:
+            max_upload_concurrency = max(upload_concurrency, DEFAULT_MAX_CONCURRENCY)
+        self._max_upload_concurrency = max_upload_concurrency
         self._s3_client = None
 
     @property
@@ -329,7 +369,7 @@ class S3StorageBackend(StorageBackend):
 
             self._s3_client = boto3.client(
                 "s3",
-                config=Config(max_pool_connections=self._upload_concurrency),
+                config=Config(max_pool_connections=self._max_upload_concurrency),
             )
         return self._s3_client
 
@@ -362,29 +402,17 @@ class S3StorageBackend(StorageBackend):
     def copy_files(self, files: list[tuple[StorageLocation, StorageLocation]]) -> int:
         """Copy multiple files in parallel.
 
-        Uses a ``ThreadPoolExecutor`` with *upload_concurrency* workers.
-        Each individual file copy retries internally via ``_s3_retry``.
-        If any files still fail after retries, a ``RuntimeError`` is
-        raised listing the failures.
+        Runs up to *upload_concurrency* copies at a time, adapted to the
+        throughput (see the class docstring). Each individual file copy
+        retries internally via ``_s3_retry``. If any files still fail after
+        retries, a ``RuntimeError`` is raised listing the failures.
         """
         if not files:
             return 0
         if self._dry_run or len(files) == 1:
             return super().copy_files(files)
 
-        failed: list[tuple[StorageLocation, BaseException]] = []
-        with concurrent.futures.ThreadPoolExecutor(
-            max_workers=self._upload_concurrency,
-        ) as pool:
-            future_to_dest = {
-                pool.submit(self.copy_file, src, dst): dst for src, dst in files
-            }
-            for future in concurrent.futures.as_completed(future_to_dest):
-                dest = future_to_dest[future]
-                try:
-                    future.result()
-                except Exception as exc:
-                    failed.append((dest, exc))
+        failed = self._run_adaptive("copy", self._copy_file, files)
 
         if failed:
             first_loc, first_exc = failed[0]
@@ -397,39 +425,62 @@ class S3StorageBackend(StorageBackend):
     def upload_files(self, files: list[tuple[Path, StorageLocation]]) -> int:
         """Upload multiple files in parallel.
 
-        Uses a ``ThreadPoolExecutor`` with *upload_concurrency* workers.
-        Each individual file upload retries internally via ``_s3_retry``.
-        If any files still fail after retries, a ``RuntimeError`` is
-        raised listing the failures.
+        Runs up to *upload_concurrency* uploads at a time, adapted to the
+        throughput (see the class docstring). Each individual file upload
+        retries internally via ``_s3_retry``. If any files still fail after
+        retries, a ``RuntimeError`` is raised listing the failures.
         """
         if not files:
             return 0
         if self._dry_run or len(files) == 1:
             return super().upload_files(files)
 
+        failed = self._run_adaptive("upload", self._upload_file, files)
+
+        if failed:
+            first_loc, first_exc = failed[0]
+            raise RuntimeError(
+                f"Failed to upload {len(failed)}/{len(files)} files. "
+                f"First failure: {first_loc.s3_uri}: {first_exc}"
+            )
+        return len(files)
+
+    def _run_adaptive(self, operation: str, transfer, files: list) -> list:
+        """Runs ``transfer(src, dst, concurrency)`` for *files* in parallel.
+
+        Returns the ``(dest, exception)`` pairs of the failed transfers.
+        """
+        concurrency = AdaptiveConcurrency(
+            self._upload_concurrency, self._max_upload_concurrency
+        )
+
+        def run(src, dst):
+            with concurrency.slot():
+                transfer(src, dst, concurrency)
+
         failed: list[tuple[StorageLocation, BaseException]] = []
         with concurrent.futures.ThreadPoolExecutor(
-            max_workers=self._upload_concurrency,
+            max_workers=self._max_upload_concurrency,
         ) as pool:
-            future_to_dest = {
-                pool.submit(self.upload_file, src, dst): dst for src, dst in files
-            }
+            future_to_dest = {pool.submit(run, src, dst): dst for src, dst in files}
             for future in concurrent.futures.as_completed(future_to_dest):
                 dest = future_to_dest[future]
                 try:
                     future.result()
                 except Exception as exc:
                     failed.append((dest, exc))
-
-        if failed:
-            first_loc, first_exc = failed[0]
-            raise RuntimeError(
-                f"Failed to upload {len(failed)}/{len(files)} files. "
-                f"First failure: {first_loc.s3_uri}: {first_exc}"
-            )
-        return len(files)
+        logger.info("S3 %s throughput: %s", operation, concurrency.summary())
+        return failed
 
     def upload_file(self, source: Path, dest: StorageLocation) -> None:
+        self._upload_file(source, dest)
+
+    def _upload_file(
+        self,
+        source: Path,
+        dest: StorageLocation,
+        concurrency: AdaptiveConcurrency | None = None,
+    ) -> None:
         content_type = infer_content_type(source)
         if self._dry_run:
             logger.info("[DRY RUN] %s -> %s (%s)", source, dest.s3_uri, content_type)
@@ -444,9 +495,18 @@ class S3StorageBackend(StorageBackend):
             dest.bucket,
             dest.relative_path,
             ExtraArgs={"ContentType": content_type},
+            concurrency=concurrency,
         )
 
     def copy_file(self, source: StorageLocation, dest: StorageLocation) -> None:
+        self._copy_file(source, dest)
+
+    def _copy_file(
+        self,
+        source: StorageLocation,
+        dest: StorageLocation,
+        concurrency: AdaptiveConcurrency | None = None,
+    ) -> None:
         if self._dry_run:
             logger.info("[DRY RUN] copy %s -> %s", source.s3_uri, dest.s3_uri)
             return
@@ -461,6 +521,7 @@ class S3StorageBackend(StorageBackend):
             copy_source,
             dest.bucket,
             dest.relative_path,
+            concurrency=concurrency,
         )
 
 
@@ -542,8 +603,9 @@ def create_storage_backend(
             that copies files under this directory.  Otherwise returns an
             ``S3StorageBackend``.
         dry_run: If ``True``, the backend logs actions without writing.
-        upload_concurrency: Max concurrent uploads for S3 (default: 10).
-            Ignored for local backends.
+        upload_concurrency: Initial concurrent uploads for S3 (default: 10),
+            adapted up to ``DEFAULT_MAX_CONCURRENCY`` (or *upload_concurrency*
+            if larger). Ignored for local backends.
     """
     if staging_dir is not None:
         return LocalStorageBackend(staging_dir, dry_run=dry_run)
@@ -0,0 +1,217 @@
+# Copyright Advanced Micro Devices, Inc.
+# SPDX-License-Identifier: MIT
+
+"""Content indexes of flattened install trees.
+
+`index_trees` hashes every file of several trees (e.g. the per-family trees
+of a release), hashing files that are hardlinks of each other (such as the
+generic layer linked into each family tree) only once. The indexes are used
+to:
+
+* Report how many bytes the trees share (`DedupReport`): the contents of a
+  file found in several trees only need storing or transferring once, while
+  the family-unique bytes are what each tree adds.
+* Merge trees into one (`merge_trees`) by linking their files, instead of
+  fetching and extracting all of them again.
+"""
+
+from collections import defaultdict
+import concurrent.futures
+from dataclasses import dataclass, field
+import os
+from pathlib import Path
+import stat
+
+from .hash_util import calculate_hash
+from .os_util import link_tree, replace_with_link_or_copy
+
+
+def log(msg: str):
+    """Print message and flush."""
+    print(msg, flush=True)
+
+
+@dataclass(frozen=True)
+class TreeEntry:
+    """A path of a tree: a directory, a symlink (`target`) or a file."""
+
+    type: str  # One of "file", "dir", "symlink"
+    size: int = 0
+    sha256: str | None = None
+    executable: bool = False
+    target: str | None = None
+
+
+# Relative POSIX path -> entry.
+TreeIndex = dict[str, TreeEntry]
+
+
+def index_trees(trees: dict[str, Path], *, threads: int = 1) -> dict[str, TreeIndex]:
+    """Indexes each tree (name -> root), hashing files on `threads` threads."""
+    # (tree name, relpath, entry type, stat) of every path.
+    paths = []
+    for name, root in trees.items():
+        root = Path(root)
+        for dirpath, dirnames, filenames in os.walk(root):
+            dir_path = Path(dirpath)
+            for entry_name in dirnames + filenames:
+                path = dir_path / entry_name
+                relpath = path.relative_to(root).as_posix()
+                paths.append((name, relpath, path, os.lstat(path)))
+
+    # Hardlinked files are hashed once.
+    inode_paths: dict[tuple[int, int], Path] = {}
+    for _, _, path, st in paths:
+        if stat.S_ISREG(st.st_mode):
+            inode_paths.setdefault((st.st_dev, st.st_ino), path)
+    with concurrent.futures.ThreadPoolExecutor(max_workers=threads) as executor:
+        digests = dict(
+            zip(
+                inode_paths,
+                executor.map(
+                    lambda path: calculate_hash(path, "sha256").hexdigest(),
+                    inode_paths.values(),
+                ),
+            )
+        )
+
+    indexes: dict[str, TreeIndex] = {name: {} for name in trees}
+    for name, relpath, path, st in paths:
+        if stat.S_ISLNK(st.st_mode):
+            entry = TreeEntry("symlink", target=os.readlink(path))
+        elif stat.S_ISDIR(st.st_mode):
+            entry = TreeEntry("dir")
+        elif stat.S_ISREG(st.st_mode):
+            entry = TreeEntry(
+                "file",
+                size=st.st_size,
+                sha256=digests[(st.st_dev, st.st_ino)],
+                executable=bool(st.st_mode & 0o111),
+            )
+        else:
+            continue
+        indexes[name][relpath] = entry
+    return indexes
+
+
+@dataclass
+class DedupReport:
+    """Bytes of files shared between trees vs unique to each tree.
+
+    Contents are identified by hash, whatever their paths in each tree.
+    """
+
+    # Tree name -> bytes of all its files.
+    tree_bytes: dict[str, int] = field(default_factory=dict)
+    # Tree name -> bytes of contents found in no other tree.
+    unique_bytes: dict[str, int] = field(default_factory=dict)
+    # Bytes of the distinct contents found in several trees, counted once.
+    shared_bytes: int = 0
+    # Bytes of all distinct contents, counted once.
+    distinct_bytes: int = 0
+
+    @staticmethod
+    def from_indexes(indexes: dict[str, TreeIndex]) -> "DedupReport":
+        report = DedupReport()
+        # Content hash -> (size, names of the trees containing it).
+        contents: dict[str, tuple[int, set[str]]] = {}
+        for name, index in indexes.items():
+            report.tree_bytes[name] = 0
+            report.unique_bytes[name] = 0
+            for entry in index.values():
+                if entry.type != "file":
+                    continue
+                report.tree_bytes[name] += entry.size
+                contents.setdefault(entry.sha256, (entry.size, set()))[1].add(name)
+        for size, names in contents.values():
+            report.distinct_bytes += size
+            if len(names) > 1:
+                report.shared_bytes += size
+            else:
+                report.unique_bytes[next(iter(names))] += size
+        return report
+
+    @property
+    def total_bytes(self) -> int:
+        return sum(self.tree_bytes.values())
+
+    def to_json(self) -> dict:
+        return {
+            "total_bytes": self.total_bytes,
+            "distinct_bytes": self.distinct_bytes,
+            "shared_bytes": self.shared_bytes,
+            "trees": {
+                name: {
+                    "bytes": self.tree_bytes[name],
+                    "unique_bytes": self.unique_bytes[name],
+                }
+                for name in self.tree_bytes
+            },
+        }
+
+    def format(self) -> list[str]:
+        """Human readable summary lines."""
+        mb = 1024 * 1024
+        lines = [
+            f"{len(self.tree_bytes)} trees, {self.total_bytes / mb:.1f} MB in "
+            f"total, {self.distinct_bytes / mb:.1f} MB distinct "
+            f"({self.shared_bytes / mb:.1f} MB shared by several trees)"
+        ]
+        for name, size in self.tree_bytes.items():
+            unique = self.unique_bytes[name]
+            percent = 100 * unique / size if size else 0
+            lines.append(
+                f"  {name}: {size / mb:.1f} MB, {unique / mb:.1f} MB unique "
+                f"({percent:.1f}%)"
+            )
+        return lines
+
+
+def merge_trees(
+    *,
+    base_dir: Path,
+    base_index: TreeIndex,
+    overlays: dict[str, tuple[Path, TreeIndex]],
+    output_dir: Path,
+    mode: str = "hardlink",
+) -> dict[str, int]:
+    """Creates `output_dir` as `base_dir` with the changes of each overlay.
+
+    The changes of an overlay are its entries that differ from `base_index`
+    (typically the overlays are trees built on top of the base). Where
+    overlays change the same path in different ways, the last overlay wins,
+    as when the overlays are fetched into one directory in order, and the
+    conflict is logged. Files are materialized with `link_or_copy(mode)`.
+    Returns how many files were materialized with each method.
+    """
+    changes: dict[str, tuple[str, Path, TreeEntry]] = {}
+    for name, (root, index) in overlays.items():
+        for relpath, entry in index.items():
+            if base_index.get(relpath) == entry:
+                continue
+            existing = changes.get(relpath)
+            if existing is not None and existing[2] != entry:
+                log(
+                    f"WARNING: {relpath} differs between {existing[0]} and "
+                    f"{name}, using {name}"
+                )
+            changes[relpath] = (name, Path(root), entry)
+
+    counts: dict[str, int] = defaultdict(int)
+    for method, count in link_tree(base_dir, output_dir, mode).items():
+        counts[method] += count
+    # Sorted, so that directories are created before their contents.
+    for relpath, (_, root, entry) in sorted(changes.items()):
+        dest_path = output_dir / relpath
+        if entry.type == "dir":
+            dest_path.mkdir(parents=True, exist_ok=True)
+            continue
+        dest_path.parent.mkdir(parents=True, exist_ok=True)
+        if entry.type == "symlink":
+            if dest_path.is_symlink() or dest_path.exists():
+                dest_path.unlink()
+            dest_path.symlink_to(entry.target)
+            counts["symlink"] += 1
+        else:
+            counts[replace_with_link_or_copy(root / relpath, dest_path, mode)] += 1
+    return dict(counts)
@@ -24,6 +24,15 @@ Usage:
         --output-dir build/ \
         --flatten
 
+    # Same, but stream archives straight into extraction (no download cache)
+    python stage_artifact_manager.py fetch \
+        --stage math-libs \
+        --amdgpu-families gfx94X-dcgpu \
+        --run-id 12345 \
+        --output-dir build/ \
+        --flatten \
+        --stream-extract
+
     # Push produced artifacts after building (compresses and uploads in parallel)
     python stage_artifact_manager.py push \
         --stage math-libs \
@@ -44,18 +53,45 @@ Environment variables:
 
 import argparse
 import concurrent.futures
+import contextlib
+import dataclasses
 from dataclasses import dataclass
+import functools
+import hashlib
+import itertools
+import json
+import multiprocessing
 import os
 import platform as platform_module
 import shutil
 import sys
+import tempfile
 import threading
 import time
 from pathlib import Path
-from typing import List, Optional, Set
+from typing import (
+    BinaryIO,
+    Callable,
+    Iterable,
+    Iterator,
+    List,
+    Optional,
+    Sequence,
+    Set,
+)
 
-from _therock_utils.archive_util import open_archive_for_read
-from _therock_utils.os_util import rmtree_with_retry
+from _therock_utils.adaptive_concurrency import (
+    DEFAULT_MAX_CONCURRENCY,
+    AdaptiveConcurrency,
+)
+from _therock_utils.archive_util import (
+    ZSTD_DICT_EXTENSION,
+    ZSTD_DICT_MODES,
+    ZstdTarFile,
+    open_archive_for_read,
+    open_archive_stream_for_read,
+)
+from _therock_utils.os_util import LINK_MODES, file_lock, rmtree_with_retry
 from _therock_utils.cmake_amdgpu_targets import (
     amdgpu_family_map,
     expand_families,
@@ -63,13 +99,44 @@ from _therock_utils.cmake_amdgpu_targets import (
 from _therock_utils.build_topology import BuildTopology
 from _therock_utils.artifact_backend import (
     ArtifactBackend,
+    ArtifactStat,
     ARTIFACT_EXTENSIONS,
+    DEFAULT_PART_CONCURRENCY,
     LocalDirectoryBackend,
     S3Backend,
     create_backend_from_env,
 )
-from _therock_utils.artifacts import ArtifactName, ArtifactPopulator
-from _therock_utils.hash_util import calculate_hash
+from _therock_utils.artifacts import (
+    ArtifactContents,
+    ArtifactName,
+    ArtifactPopulator,
+    write_artifact_archive,
+)
+from _therock_utils.content_store import (
+    DELTA_SUFFIX,
+    INDEX_SUFFIX,
+    ArtifactFileIndex,
+    ContentStore,
+    populate_store_from_archive,
+)
+from _therock_utils.hash_util import calculate_hash, write_hash
+from _therock_utils.lazy_prefix import LazyArtifact, LazyPrefix, mount
+from _therock_utils.ranged_download import (
+    DEFAULT_MAX_CONNECTIONS_PER_OBJECT,
+    DEFAULT_PART_SIZE,
+    ConnectionBudget,
+    DownloadProgress,
+    discard_partial,
+    download_parts,
+    is_multipart_partial,
+)
+from _therock_utils.run_index import (
+    RunIndex,
+    RunIndexEntry,
+    load_run_index,
+    publish_run_index_fragment,
+    missing_from_index,
+)
 from _therock_utils.workflow_outputs import WorkflowOutputRoot
 
 # Component types that artifacts are split into
@@ -111,20 +178,23 @@ def get_topology(topology_path: Optional[Path] = None) -> BuildTopology:
 # =============================================================================
 
 
-def parse_target_families(args: argparse.Namespace) -> List[str]:
+def parse_target_families(
+    args: argparse.Namespace, expand_targets: bool = True
+) -> List[str]:
     """Parse target families from argparse args.
 
-    Returns a list starting with "generic", extended with any families and
-    individual targets from the args.
+    Returns a list starting with "generic" (unless skipped), extended with any
+    families and individual targets from the args (and, unless
+    `expand_targets` is False, the targets of families to expand).
     """
-    output_families = ["generic"]
+    output_families = [] if args.skip_generic else ["generic"]
     if args.generic_only:
         log("Using generic (host) artifacts only")
     else:
         if args.amdgpu_families:
             input_families = args.amdgpu_families.split(";")
             output_families.extend(input_families)
-            if args.expand_family_to_targets:
+            if expand_targets and args.expand_family_to_targets:
                 family_map = amdgpu_family_map()
                 for target in expand_families(input_families, family_map, strict=False):
                     if target not in output_families:
@@ -212,11 +282,41 @@ class DownloadRequest:
     artifact_key: str
     dest_path: Path
     backend: ArtifactBackend
+    # When set, the archive is only downloaded if the content store is missing
+    # some of its files (see _therock_utils/content_store.py).
+    content_store: Optional[ContentStore] = None
+    # When set, the download holds one of the budget's connections, and
+    # archives larger than `part_size` are fetched as ranged parts over up to
+    # `max_part_connections` connections (see _therock_utils/ranged_download.py).
+    budget: Optional[ConnectionBudget] = None
+    part_size: int = DEFAULT_PART_SIZE
+    max_part_connections: int = DEFAULT_MAX_CONNECTIONS_PER_OBJECT
+    # Size and ETag from the backend listing (saves a HEAD request).
+    stat: Optional[ArtifactStat] = None
+    # When set, written bytes are reported here so that extraction can read
+    # the download while it is in progress.
+    progress: Optional[DownloadProgress] = None
+    # sha256 from the run index (saves reading the .sha256sum sidecar).
+    expected_sha256: Optional[str] = None
+    # When set, downloaded bytes and errors are reported here, to adapt the
+    # number of concurrent connections of `budget`.
+    concurrency: Optional[AdaptiveConcurrency] = None
+    # When set, the download's start is recorded here once it has a
+    # connection (until then, it is still queued).
+    timeline: Optional["FetchTimeline"] = None
+    # Set once this fetch has downloaded (or verified) the file index sidecar.
+    index_fetched: bool = False
 
 
 @dataclass
 class ExtractRequest:
-    """Request to extract a downloaded artifact."""
+    """Request to extract a downloaded artifact.
+
+    `archive_path` is either an artifact archive or, when all of its files
+    were already in `content_store`, just its `.index.json` sidecar. When
+    `stream_backend` is set, nothing is on disk: the archive named
+    `archive_path.name` is streamed from that backend during extraction.
+    """
 
     archive_path: Path
     output_dir: Path
@@ -226,33 +326,394 @@ class ExtractRequest:
     # Shared state for parallel bootstrap extraction
     cleaned_paths: Optional[set] = None
     cleaned_paths_lock: Optional[threading.Lock] = None
+    content_store: Optional[ContentStore] = None
+    stream_backend: Optional[ArtifactBackend] = None
+    # When set, the archive is read from its download as the bytes arrive.
+    progress: Optional[DownloadProgress] = None
+    # Where dictionaries referenced by zstd archives are looked up.
+    zstd_dict_dirs: Sequence[Path] = ()
+
+
+def _index_path(archive_path: Path) -> Path:
+    return Path(f"{archive_path}{INDEX_SUFFIX}")
+
+
+def _delta_path(archive_path: Path) -> Path:
+    return Path(f"{archive_path}{DELTA_SUFFIX}")
+
+
+def _apply_delta_to_store(request: DownloadRequest, index: ArtifactFileIndex) -> bool:
+    """Adds the files of the artifact's delta sidecar (if any) to the store.
+
+    Returns True if the store then holds every file of the artifact. This is
+    the case when the store already had the files of the delta's base run.
+    """
+    delta_key = f"{request.artifact_key}{DELTA_SUFFIX}"
+    delta_path = _delta_path(request.dest_path)
+    try:
+        if not request.backend.artifact_exists(delta_key):
+            return False
+        log(f"  ++ Downloading {delta_key}")
+        request.backend.download_artifact(delta_key, delta_path)
+        with ZstdTarFile(delta_path, mode="rb") as tf:
+            populate_store_from_archive(
+                tf, index, request.content_store, require_complete=False
+            )
+    except Exception as e:
+        log(f"  ++ Ignoring delta for {request.artifact_key}: {e}")
+        return False
+    finally:
+        delta_path.unlink(missing_ok=True)
+    missing = index.missing_files(request.content_store)
+    if missing:
+        log(
+            f"  ++ Delta for {request.artifact_key} does not apply "
+            f"({len(missing)} files still missing), using full archive"
+        )
+        return False
+    log(f"  == Reconstructed {request.artifact_key} from content store + delta")
+    return True
+
+
+def _fetch_index_file(request: DownloadRequest) -> Optional[Path]:
+    """Downloads the artifact's file index sidecar, or returns None if it has
+    none.
+
+    An index already in the download dir may have been left by another run
+    sharing the cache, for an artifact of the same name. It is only reused if
+    it matches the backend's size and (MD5) ETag, and downloaded again
+    otherwise.
+    """
+    index_key = f"{request.artifact_key}{INDEX_SUFFIX}"
+    index_path = _index_path(request.dest_path)
+    if request.index_fetched and index_path.exists():
+        return index_path
+    stat = request.backend.stat_artifact(index_key)
+    if stat is None:
+        return None
+    with file_lock(Path(f"{index_path}{DOWNLOAD_LOCK_SUFFIX}")):
+        if (
+            index_path.exists()
+            and _is_md5_etag(stat.etag)
+            and _verify_download(index_path, stat, None) is None
+        ):
+            request.index_fetched = True
+            return index_path
+        partial_path = _partial_download_path(index_path)
+        discard_partial(partial_path)
+        request.backend.download_artifact(index_key, partial_path)
+        mismatch = _verify_download(partial_path, stat, None)
+        if mismatch is not None:
+            discard_partial(partial_path)
+            raise IOError(f"Download of {index_key} is corrupt: {mismatch}")
+        os.replace(partial_path, index_path)
+    request.index_fetched = True
+    return index_path
+
+
+def _download_index_if_complete(request: DownloadRequest) -> Optional[Path]:
+    """Fetches the artifact's file index and checks it against the store.
+
+    Returns the local index path if every file of the artifact is in the
+    content store, possibly after applying the artifact's delta sidecar (so
+    the archive itself need not be downloaded), or None if the archive is
+    needed (no index, or some blobs are missing).
+    """
+    index_path = _index_path(request.dest_path)
+    try:
+        if _fetch_index_file(request) is None:
+            return None
+        index = ArtifactFileIndex.load(index_path)
+    except Exception as e:
+        log(f"  ++ Ignoring file index for {request.artifact_key}: {e}")
+        index_path.unlink(missing_ok=True)
+        return None
+    missing = index.missing_files(request.content_store)
+    if missing:
+        missing_size = sum(e.size for e in missing)
+        log(
+            f"  ++ Content store has {len(index.files) - len(missing)}/"
+            f"{len(index.files)} files of {request.artifact_key} "
+            f"(missing {_format_bytes(missing_size)})"
+        )
+        # A delta can only help if the store has some of the base files.
+        if len(missing) < len(index.files) and _apply_delta_to_store(request, index):
+            return index_path
+        return None
+    log(
+        f"  == Content store has all {len(index.files)} files of "
+        f"{request.artifact_key} ({_format_bytes(index.total_file_size)})"
+    )
+    return index_path
+
+
+# Suffix of in-progress downloads. A download is only renamed to its final
+# name once verified, so a killed process leaves a resumable partial file
+# rather than a corrupt cache entry.
+PARTIAL_DOWNLOAD_SUFFIX = ".partial"
+# Lock held while downloading an artifact, as the download cache (and with it
+# the partial file) may be shared by concurrent fetches.
+DOWNLOAD_LOCK_SUFFIX = ".lock"
+_DOWNLOAD_CHUNK_SIZE = 1 << 20
+
+
+def _partial_download_path(dest_path: Path) -> Path:
+    return Path(f"{dest_path}{PARTIAL_DOWNLOAD_SUFFIX}")
+
+
+def _read_expected_sha256(backend: ArtifactBackend, artifact_key: str) -> Optional[str]:
+    """Returns the digest in the artifact's .sha256sum sidecar, if it has one."""
+    sha256_key = f"{artifact_key}.sha256sum"
+    listing = backend.cached_listing()
+    if listing is not None and sha256_key not in listing:
+        return None
+    try:
+        body = backend.open_artifact(sha256_key)
+    except FileNotFoundError:
+        return None
+    try:
+        tokens = body.read().decode().split()
+    finally:
+        body.close()
+    if not tokens:
+        raise ValueError(f"Empty sha256sum sidecar for {artifact_key}")
+    return tokens[0].lower()
+
+
+def _is_md5_etag(etag: Optional[str]) -> bool:
+    # Multipart uploads have "{md5 of part md5s}-{part count}" ETags, which
+    # can't be checked without knowing the part size.
+    return (
+        etag is not None
+        and len(etag) == 32
+        and all(c in "0123456789abcdef" for c in etag.lower())
+    )
+
+
+def _verify_download(
+    path: Path, stat: ArtifactStat, expected_sha256: Optional[str]
+) -> Optional[str]:
+    """Checks a local file against the artifact's sha256sum, or else its ETag.
+
+    Returns a description of the mismatch, or None if the file matches.
+    """
+    size = path.stat().st_size
+    if size != stat.size:
+        return f"size is {size} bytes, expected {stat.size}"
+    if expected_sha256 is not None:
+        actual = calculate_hash(path, "sha256").hexdigest()
+        if actual != expected_sha256:
+            return f"sha256 is {actual}, expected {expected_sha256}"
+    elif _is_md5_etag(stat.etag):
+        actual = calculate_hash(path, "md5").hexdigest()
+        if actual != stat.etag.lower():
+            return f"md5 is {actual}, expected ETag {stat.etag}"
+    return None
+
+
+def _verify_cached_download(request: DownloadRequest) -> Optional[str]:
+    """Checks a download cache hit. Returns a mismatch description or None."""
+    stat = request.stat or request.backend.stat_artifact(request.artifact_key)
+    if stat is None:
+        # Nothing to compare against (and nothing to download instead).
+        log(f"  ++ Cannot verify cached {request.artifact_key}: not in backend")
+        return None
+    expected_sha256 = request.expected_sha256 or _read_expected_sha256(
+        request.backend, request.artifact_key
+    )
+    return _verify_download(request.dest_path, stat, expected_sha256)
+
+
+def _check_cached_download(request: DownloadRequest) -> Optional[str]:
+    if not request.dest_path.exists():
+        return "removed"
+    try:
+        return _verify_cached_download(request)
+    except Exception as e:
+        return f"verification failed: {e}"
+
+
+def _download_parts(request: DownloadRequest, stat: ArtifactStat, partial_path: Path):
+    log(
+        f"  ++ Downloading {request.artifact_key} ({_format_bytes(stat.size)}) "
+        f"in {request.part_size >> 20} MiB parts"
+    )
+    download_parts(
+        lambda start, length: request.backend.open_artifact(
+            request.artifact_key, start=start, length=length
+        ),
+        stat.size,
+        partial_path,
+        request.budget,
+        part_size=request.part_size,
+        max_connections=request.max_part_connections,
+        identity=stat.etag,
+        progress=request.progress,
+        on_bytes=request.concurrency.record if request.concurrency else None,
+    )
+
+
+def _download_verified(request: DownloadRequest) -> bool:
+    """Downloads an artifact to a partial file, verifies it and renames it.
+
+    An existing partial file (from an earlier failed attempt or a killed
+    process) is resumed with a ranged read, or, for multipart downloads,
+    only its missing parts are fetched. A download that fails verification
+    is deleted, so that the next attempt starts over. Returns False if the
+    artifact doesn't exist.
+
+    The download holds a lock file next to it, so fetches sharing a download
+    cache never write the same partial file at once; whoever waited finds the
+    finished download instead.
+    """
+    stat = request.stat or request.backend.stat_artifact(request.artifact_key)
+    if stat is None:
+        return False
+    expected_sha256 = request.expected_sha256 or _read_expected_sha256(
+        request.backend, request.artifact_key
+    )
+
+    partial_path = _partial_download_path(request.dest_path)
+    with file_lock(Path(f"{request.dest_path}{DOWNLOAD_LOCK_SUFFIX}")):
+        if (
+            request.dest_path.exists()
+            and _verify_download(request.dest_path, stat, expected_sha256) is None
+        ):
+            # Downloaded by another fetch sharing the cache while we waited.
+            log(f"  == Cached {request.artifact_key} (downloaded concurrently)")
+            if request.progress is not None:
+                request.progress.start(request.dest_path, stat.size, [(0, stat.size)])
+            return True
+        if isinstance(request.backend, LocalDirectoryBackend):
+            _download_local(request, stat, partial_path)
+        elif (
+            request.budget is not None
+            and request.max_part_connections > 1
+            and stat.size > request.part_size
+        ):
+            _download_parts(request, stat, partial_path)
+        else:
+            _download_stream(request, stat, partial_path)
+
+        mismatch = _verify_download(partial_path, stat, expected_sha256)
+        if mismatch is not None:
+            discard_partial(partial_path)
+            raise IOError(f"Download of {request.artifact_key} is corrupt: {mismatch}")
+        os.replace(partial_path, request.dest_path)
+    return True
+
+
+def _download_local(request: DownloadRequest, stat: ArtifactStat, partial_path: Path):
+    """Links (or copies) an archive out of a local staging directory."""
+    discard_partial(partial_path)
+    method = request.backend.materialize_artifact(request.artifact_key, partial_path)
+    log(f"  ++ Staged {request.artifact_key} ({method})")
+    if request.progress is not None:
+        request.progress.start(partial_path, stat.size, [(0, stat.size)])
+
+
+def _download_stream(request: DownloadRequest, stat: ArtifactStat, partial_path: Path):
+    if is_multipart_partial(partial_path):
+        # Left by a multipart attempt: not a contiguous prefix.
+        discard_partial(partial_path)
+    offset = partial_path.stat().st_size if partial_path.exists() else 0
+    if offset > stat.size:
+        partial_path.unlink()
+        offset = 0
+    if offset:
+        log(
+            f"  ++ Resuming {request.artifact_key} at "
+            f"{_format_bytes(offset)} of {_format_bytes(stat.size)}"
+        )
+    else:
+        log(f"  ++ Downloading {request.artifact_key}")
+    progress = request.progress
+    if progress is not None:
+        progress.start(partial_path, stat.size, [(0, offset)])
+    with open(partial_path, "ab") as out_file:
+        if offset < stat.size:
+            body = request.backend.open_artifact(request.artifact_key, start=offset)
+            try:
+                while chunk := body.read(_DOWNLOAD_CHUNK_SIZE):
+                    out_file.write(chunk)
+                    if progress is not None:
+                        out_file.flush()
+                        progress.add(offset, len(chunk))
+                    if request.concurrency is not None:
+                        request.concurrency.record(len(chunk))
+                    offset += len(chunk)
+            finally:
+                body.close()
 
 
 def download_artifact(request: DownloadRequest) -> Optional[Path]:
     """Download a single artifact with retry logic.
 
-    Skips downloading if the file already exists in the download cache.
+    Skips downloading if the file already exists in the download cache and
+    still matches the backend's sha256sum sidecar (or size and ETag), or if a
+    content store is used and already holds all of the artifact's files (in
+    which case the path of the artifact's file index is returned). Failed
+    downloads are resumed where they stopped.
     """
-    # TODO: Validate cached file integrity (e.g. compare size against S3
-    # object metadata). A partial download from a killed process would pass
-    # this check. Consider adding a --no-cache flag to bypass.
+    result = None
+    try:
+        result = _download_artifact(request)
+    finally:
+        if request.budget is not None:
+            request.budget.dequeue(request.artifact_key)
+        if request.progress is not None:
+            if result is not None and result == request.dest_path:
+                request.progress.finish(result, result.stat().st_size)
+            else:
+                request.progress.fail(IOError(f"{request.artifact_key} not downloaded"))
+    return result
+
+
+def _download_artifact(request: DownloadRequest) -> Optional[Path]:
     if request.dest_path.exists():
-        log(f"  == Cached {request.artifact_key}")
-        return request.dest_path
+        if request.budget is not None:
+            # Don't hold up the downloads queued after this one.
+            request.budget.dequeue(request.artifact_key)
+        mismatch = _check_cached_download(request)
+        if mismatch is not None:
+            with file_lock(Path(f"{request.dest_path}{DOWNLOAD_LOCK_SUFFIX}")):
+                # Another fetch sharing the cache may have replaced it since.
+                mismatch = _check_cached_download(request)
+                if mismatch is not None:
+                    log(f"  ++ Discarding cached {request.artifact_key}: {mismatch}")
+                    request.dest_path.unlink(missing_ok=True)
+        if mismatch is None:
+            log(f"  == Cached {request.artifact_key}")
+            return request.dest_path
+
+    if request.content_store is not None:
+        request.dest_path.parent.mkdir(parents=True, exist_ok=True)
+        index_path = _download_index_if_complete(request)
+        if index_path is not None:
+            return index_path
 
     MAX_RETRIES = 3
     BASE_DELAY_SECONDS = 2
 
     for attempt in range(MAX_RETRIES):
         try:
-            log(f"  ++ Downloading {request.artifact_key}")
             request.dest_path.parent.mkdir(parents=True, exist_ok=True)
-            request.backend.download_artifact(request.artifact_key, request.dest_path)
+            with (
+                request.budget.connection(request.artifact_key)
+                if request.budget is not None
+                else contextlib.nullcontext()
+            ):
+                if request.timeline is not None and attempt == 0:
+                    request.timeline.mark(request.artifact_key, "download_start")
+                if not _download_verified(request):
+                    return None
             return request.dest_path
         except FileNotFoundError:
             # Artifact doesn't exist - not an error, just skip
             return None
         except Exception as e:
+            if request.concurrency is not None:
+                request.concurrency.record_error(e)
             if attempt < MAX_RETRIES - 1:
                 delay = BASE_DELAY_SECONDS * (2**attempt)
                 log(
@@ -279,8 +740,14 @@ class BootstrappingPopulator(ArtifactPopulator):
         verbose: bool = False,
         cleaned_paths: Optional[set] = None,
         cleaned_paths_lock: Optional[threading.Lock] = None,
+        zstd_dict_dirs: Sequence[Path] = (),
     ):
-        super().__init__(output_path=output_path, verbose=verbose, flatten=False)
+        super().__init__(
+            output_path=output_path,
+            verbose=verbose,
+            flatten=False,
+            zstd_dict_dirs=zstd_dict_dirs,
+        )
         self.created_markers: List[Path] = []
         self._cleaned_paths = cleaned_paths if cleaned_paths is not None else set()
         self._lock = (
@@ -308,49 +775,462 @@ class BootstrappingPopulator(ArtifactPopulator):
             self.created_markers.append(prebuilt_path)
 
 
-def extract_artifact(request: ExtractRequest) -> Optional[Path]:
-    """Extract a single artifact archive."""
-    try:
-        archive_path = request.archive_path
-        artifact_name, *_ = archive_path.name.partition(".")
-
-        if request.bootstrap:
-            # Bootstrap mode: use ArtifactPopulator with prebuilt markers
-            output_dir = request.output_dir
-            log(f"  ++ Bootstrapping {archive_path.name}")
-            populator = BootstrappingPopulator(
+def _populate_from_content_store(request: ExtractRequest, populator: ArtifactPopulator):
+    """Populates an artifact via the content store.
+
+    Any files missing from the store are first added from the archive.
+    """
+    if request.archive_path.name.endswith(INDEX_SUFFIX):
+        index_path = request.archive_path
+    else:
+        index_path = _index_path(request.archive_path)
+        index = ArtifactFileIndex.load(index_path)
+        with open_archive_for_read(
+            request.archive_path, zstd_dict_dirs=request.zstd_dict_dirs
+        ) as tf:
+            added = populate_store_from_archive(tf, index, request.content_store)
+        log(f"  ++ Added {added} files of {request.archive_path.name} to store")
+    index = ArtifactFileIndex.load(index_path)
+    populator.populate_from_index(index, request.content_store)
+    return index
+
+
+def _populate(request: ExtractRequest, populator: ArtifactPopulator, use_store: bool):
+    if use_store:
+        _populate_from_content_store(request, populator)
+    elif request.stream_backend is not None or request.progress is not None:
+        populator.populate_from_stream(
+            _open_extract_stream(request), request.archive_path.name
+        )
+    else:
+        populator(request.archive_path)
+
+
+def _open_extract_stream(request: ExtractRequest) -> BinaryIO:
+    if request.progress is not None:
+        return request.progress.open_reader()
+    return request.stream_backend.open_artifact(request.archive_path.name)
+
+
+def _extract_artifact(request: ExtractRequest) -> Path:
+    archive_path = request.archive_path
+    artifact_name, *_ = archive_path.name.partition(".")
+    use_store = request.content_store is not None and (
+        archive_path.name.endswith(INDEX_SUFFIX) or _index_path(archive_path).exists()
+    )
+
+    if request.bootstrap:
+        # Bootstrap mode: use ArtifactPopulator with prebuilt markers
+        output_dir = request.output_dir
+        log(f"  ++ Bootstrapping {archive_path.name}")
+        populator = BootstrappingPopulator(
+            output_path=output_dir,
+            verbose=False,
+            cleaned_paths=request.cleaned_paths,
+            cleaned_paths_lock=request.cleaned_paths_lock,
+            zstd_dict_dirs=request.zstd_dict_dirs,
+        )
+        _populate(request, populator, use_store)
+    elif request.flatten:
+        output_dir = request.output_dir
+        log(f"  ++ Flattening {archive_path.name} to {output_dir}")
+        flattener = ArtifactPopulator(
+            output_path=output_dir,
+            verbose=False,
+            flatten=True,
+            zstd_dict_dirs=request.zstd_dict_dirs,
+        )
+        _populate(request, flattener, use_store)
+    else:
+        output_dir = request.output_dir / artifact_name
+        if output_dir.exists():
+            rmtree_with_retry(output_dir)
+        log(f"  ++ Extracting {archive_path.name}")
+        if use_store:
+            populator = ArtifactPopulator(
                 output_path=output_dir,
                 verbose=False,
-                cleaned_paths=request.cleaned_paths,
-                cleaned_paths_lock=request.cleaned_paths_lock,
+                flatten=False,
+                zstd_dict_dirs=request.zstd_dict_dirs,
             )
-            populator(archive_path)
-        elif request.flatten:
-            output_dir = request.output_dir
-            log(f"  ++ Flattening {archive_path.name} to {output_dir}")
-            flattener = ArtifactPopulator(
-                output_path=output_dir, verbose=False, flatten=True
+            index = _populate_from_content_store(request, populator)
+            (output_dir / "artifact_manifest.txt").write_text(
+                "".join(f"{relpath}\n" for relpath in index.manifest)
             )
-            flattener(archive_path)
+        elif request.stream_backend is not None or request.progress is not None:
+            stream = _open_extract_stream(request)
+            with open_archive_stream_for_read(
+                stream, archive_path.name, zstd_dict_dirs=request.zstd_dict_dirs
+            ) as tf:
+                tf.extractall(output_dir, filter="tar")
         else:
-            output_dir = request.output_dir / artifact_name
-            if output_dir.exists():
-                rmtree_with_retry(output_dir)
-            log(f"  ++ Extracting {archive_path.name}")
-            with open_archive_for_read(archive_path) as tf:
+            with open_archive_for_read(
+                archive_path, zstd_dict_dirs=request.zstd_dict_dirs
+            ) as tf:
                 tf.extractall(output_dir, filter="tar")
 
-        if request.delete_archive:
-            archive_path.unlink()
+    if request.delete_archive:
+        archive_path.unlink()
+
+    return output_dir
 
-        return output_dir
+
+def extract_artifact(request: ExtractRequest) -> Optional[Path]:
+    """Extract a single artifact archive."""
+    try:
+        return _extract_artifact(request)
     except Exception as e:
         log(f"  !! Failed to extract {request.archive_path.name}: {e}")
         return None
 
 
+def extract_while_downloading(
+    request: ExtractRequest, download_future: concurrent.futures.Future
+) -> Optional[Path]:
+    """Extract an artifact from its download as the bytes arrive.
+
+    Waits for the download to complete either way: the stream may have been
+    read before the download failed verification. If reading the stream
+    failed, or the download was restarted (discarding bytes that may have
+    been extracted), extracts the verified archive again, overwriting the
+    partially extracted files.
+    """
+    try:
+        result = _extract_artifact(request)
+        error = None
+    except Exception as e:
+        result = None
+        error = e
+    if not download_future.result():
+        # Download failed or artifact missing, already logged.
+        return None
+    error = error or request.progress.error
+    if error is None:
+        return result
+    log(f"  ++ Extracting completed download of {request.archive_path.name}: {error}")
+    return extract_artifact(dataclasses.replace(request, progress=None))
+
+
+def stream_extract_artifact(request: ExtractRequest) -> Optional[Path]:
+    """Stream a single artifact from its backend into extraction, with retries.
+
+    Network, decompression and file writes overlap and the archive never
+    lands on disk. A failed attempt restarts from the beginning of the
+    stream (extraction overwrites partially extracted files).
+    """
+    MAX_RETRIES = 3
+    BASE_DELAY_SECONDS = 2
+
+    for attempt in range(MAX_RETRIES):
+        try:
+            log(f"  ++ Streaming {request.archive_path.name}")
+            return _extract_artifact(request)
+        except FileNotFoundError:
+            # Artifact doesn't exist - not an error, just skip
+            return None
+        except Exception as e:
+            if attempt < MAX_RETRIES - 1:
+                delay = BASE_DELAY_SECONDS * (2**attempt)
+                log(
+                    f"  ++ Retry {attempt + 1}/{MAX_RETRIES} for "
+                    f"{request.archive_path.name}: {e}"
+                )
+                _delay_for_retry(delay)
+            else:
+                log(f"  !! Failed to stream {request.archive_path.name}: {e}")
+                return None
+    return None
+
+
+def _stream_fetch(
+    args: argparse.Namespace,
+    backend: ArtifactBackend,
+    filenames: List[str],
+    output_dir: Path,
+):
+    """Fetch by streaming each archive from the backend into extraction.
+
+    Each worker handles one artifact end to end, so there is no separate
+    extract pool and no download cache.
+    """
+    if not filenames:
+        log("No matching artifacts found to download")
+        return
+
+    log(f"\nStreaming {len(filenames)} artifacts...")
+    bootstrap_cleaned_paths: set = set()
+    bootstrap_lock = threading.Lock()
+    requests = [
+        ExtractRequest(
+            archive_path=Path(filename),
+            output_dir=(
+                output_dir / "artifacts"
+                if not args.bootstrap and not args.flatten
+                else output_dir
+            ),
+            delete_archive=False,
+            flatten=args.flatten,
+            bootstrap=args.bootstrap,
+            cleaned_paths=bootstrap_cleaned_paths if args.bootstrap else None,
+            cleaned_paths_lock=bootstrap_lock if args.bootstrap else None,
+            stream_backend=backend,
+            zstd_dict_dirs=_zstd_dict_dirs(args),
+        )
+        for filename in filenames
+    ]
+    extracted_count = 0
+    with concurrent.futures.ThreadPoolExecutor(
+        max_workers=args.download_concurrency
+    ) as executor:
+        for future in concurrent.futures.as_completed(
+            [executor.submit(stream_extract_artifact, req) for req in requests]
+        ):
+            if future.result():
+                extracted_count += 1
+
+    log(f"\nStreamed and extracted {extracted_count} artifacts")
+    if extracted_count < len(requests):
+        log(
+            f"ERROR: Only extracted {extracted_count}/{len(requests)} artifacts - "
+            f"{len(requests) - extracted_count} failed"
+        )
+        sys.exit(1)
+
+
+def download_index_file(request: DownloadRequest) -> Optional[Path]:
+    """Downloads the artifact's file index sidecar next to its archive.
+
+    Returns its path, or None if the artifact has no index (or it could not be
+    downloaded, since indexes are optional).
+    """
+    try:
+        return _fetch_index_file(request)
+    except Exception as e:
+        log(f"  ++ Ignoring file index for {request.artifact_key}: {e}")
+        return None
+
+
+def _download_index(request: DownloadRequest) -> Optional[ArtifactFileIndex]:
+    """Downloads the artifact's file index sidecar, or None if it has none."""
+    index_path = _fetch_index_file(request)
+    return ArtifactFileIndex.load(index_path) if index_path is not None else None
+
+
+def _zstd_dict_dirs(args: argparse.Namespace) -> list[Path]:
+    return [args.zstd_dict_dir] if args.zstd_dict_dir else []
+
+
+def _fetch_for_lazy_mount(request: DownloadRequest) -> Path:
+    path = download_artifact(request)
+    if path is None:
+        raise IOError(f"Failed to download {request.artifact_key}")
+    return path
+
+
+def lazy_mount(
+    download_requests: list[DownloadRequest],
+    content_store: ContentStore,
+    mount_dir: Path,
+    concurrency: int,
+    *,
+    zstd_dict_dirs: Sequence[Path] = (),
+):
+    """Mounts the flattened artifacts read-only at `mount_dir` and serves them
+    until unmounted.
+
+    Only the file index sidecars are downloaded up front. Each archive is
+    downloaded (and added to the content store) when a file it provides is
+    first opened, unless the store already has its contents.
+    """
+    # Layered in a fixed order, like a flattened fetch of non-overlapping
+    # artifacts would produce in any order.
+    download_requests = sorted(download_requests, key=lambda r: r.artifact_key)
+    with concurrent.futures.ThreadPoolExecutor(max_workers=concurrency) as executor:
+        indexes = list(executor.map(_download_index, download_requests))
+    missing = [r.artifact_key for r, i in zip(download_requests, indexes) if i is None]
+    if missing:
+        log(
+            f"ERROR: --lazy-mount requires {INDEX_SUFFIX} sidecars, missing for: "
+            f"{', '.join(missing)}"
+        )
+        sys.exit(1)
+    prefix = LazyPrefix(
+        [
+            LazyArtifact(
+                req.artifact_key,
+                index,
+                functools.partial(_fetch_for_lazy_mount, req),
+            )
+            for req, index in zip(download_requests, indexes)
+        ],
+        content_store,
+        zstd_dict_dirs=zstd_dict_dirs,
+    )
+    total_size = sum(index.total_file_size for index in indexes)
+    log(
+        f"Mounting {len(indexes)} artifacts ({_format_bytes(total_size)}) at "
+        f"{mount_dir}, fetched on first access. Serving until unmounted with: "
+        f"fusermount -u {mount_dir}"
+    )
+    mount(prefix, mount_dir)
+
+
+def _listed_size(stats: dict, filename: str) -> int:
+    stat = stats.get(filename)
+    return stat.size if stat is not None else 0
+
+
+def _artifact_key_for_path(path: Path) -> str:
+    """Artifact key of a downloaded archive or of its index sidecar."""
+    name = path.name
+    return name[: -len(INDEX_SUFFIX)] if name.endswith(INDEX_SUFFIX) else name
+
+
+class FetchTimeline:
+    """When each artifact was queued, downloaded and extracted during fetch.
+
+    Times are seconds since the timeline was created. A download starts
+    when it gets a connection. The artifact that finishes last is the
+    critical path of the fetch.
+    """
+
+    PHASES = ("download", "extract")
+
+    def __init__(self):
+        self._origin = time.monotonic()
+        self._lock = threading.Lock()
+        self._events: dict[str, dict[str, float]] = {}
+
+    def mark(self, artifact_key: str, event: str):
+        now = time.monotonic() - self._origin
+        with self._lock:
+            self._events.setdefault(artifact_key, {})[event] = now
+
+    def timed(self, artifact_key: str, phase: str, fn, *args):
+        """Calls `fn(*args)`, recording `{phase}_start` and `{phase}_end`."""
+        self.mark(artifact_key, f"{phase}_start")
+        try:
+            return fn(*args)
+        finally:
+            self.mark(artifact_key, f"{phase}_end")
+
+    def _entries(self, stats: dict) -> list[dict]:
+        with self._lock:
+            events = {k: dict(v) for k, v in self._events.items()}
+        entries = []
+        for artifact_key, artifact_events in events.items():
+            stat = stats.get(artifact_key)
+            entry = {"artifact": artifact_key}
+            entry["size"] = stat.size if stat is not None else None
+            entry.update({k: round(v, 3) for k, v in artifact_events.items()})
+            entries.append(entry)
+        return sorted(
+            entries, key=lambda e: e.get("extract_end", e.get("download_end", 0))
+        )
+
+    def log_summary(self, stats: dict):
+        entries = self._entries(stats)
+        if not entries:
+            return
+        log("\nFetch timeline (seconds since start: queued, download, extract):")
+        for e in entries:
+            phases = "  ".join(
+                f"{phase} {e[f'{phase}_start']:7.1f}-{e[f'{phase}_end']:7.1f}"
+                for phase in self.PHASES
+                if f"{phase}_start" in e and f"{phase}_end" in e
+            )
+            log(
+                f"  {e['artifact']}: {_format_bytes(e['size'])}, "
+                f"queued {e.get('queued', 0):.1f}  {phases}"
+            )
+        last = entries[-1]
+        end = last.get("extract_end", last.get("download_end"))
+        log(f"Critical path: {last['artifact']} (done at {end:.1f}s)")
+
+    def write_json(self, path: Path, stats: dict):
+        Path(path).write_text(json.dumps(self._entries(stats), indent=2) + "\n")
+        log(f"Wrote fetch timeline to {path}")
+
+
+def load_covering_run_index(
+    backend: ArtifactBackend,
+    topology: BuildTopology,
+    artifact_names: Set[str],
+    cache_path: Optional[Path] = None,
+    target_families: Iterable[str] = (),
+) -> Optional[RunIndex]:
+    """Loads the run index if it covers every stage producing `artifact_names`.
+
+    Per-arch stages must also have published a fragment for each of the
+    non-generic `target_families` (a per-arch stage is pushed separately for
+    each family). Returns None (so the caller lists the run instead) if the
+    run has no index or something is not covered, e.g. when the run was
+    pushed by an older artifact_manager.py or copied from one, or some family
+    has not pushed a stage yet.
+    With `cache_path`, the index is read from that file if it exists and
+    written to it otherwise (to share one read between several fetches).
+    """
+    try:
+        if cache_path is not None and cache_path.exists():
+            index = RunIndex.load(cache_path)
+        else:
+            index = load_run_index(backend)
+            if index is None:
+                log("Run has no artifact index, listing artifacts")
+                return None
+            if cache_path is not None:
+                index.dump(cache_path)
+    except Exception as e:
+        log(f"Ignoring run index ({e}), listing artifacts")
+        return None
+    arch_families = [f for f in target_families if f != "generic"]
+    needed = set()
+    for stage in topology.get_build_stages():
+        if not set(topology.get_produced_artifacts(stage.name)) & artifact_names:
+            continue
+        if stage.type == "per-arch" and arch_families:
+            needed.update((stage.name, family) for family in arch_families)
+        else:
+            needed.add((stage.name, None))
+    missing = missing_from_index(index, needed)
+    if missing:
+        described = sorted(
+            stage if family is None else f"{stage} ({family})"
+            for stage, family in missing
+        )
+        log(
+            f"Run index has no fragment for stages {', '.join(described)}, "
+            "listing artifacts"
+        )
+        return None
+    log(
+        f"Using run index ({len(index.entries)} artifacts from "
+        f"{len(index.fragments)} pushes)"
+    )
+    return index
+
+
 def do_fetch(args: argparse.Namespace):
     """Fetch inbound artifacts for a stage with parallel download and extract."""
+    if args.stream_extract and (
+        args.no_extract
+        or args.download_cache_dir is not None
+        or args.content_store_dir is not None
+    ):
+        log(
+            "ERROR: --stream-extract cannot be combined with --no-extract, "
+            "--download-cache-dir or --content-store-dir"
+        )
+        sys.exit(1)
+    if args.lazy_mount and (
+        not args.flatten or args.content_store_dir is None or args.no_extract
+    ):
+        log(
+            "ERROR: --lazy-mount requires --flatten and --content-store-dir, "
+            "and cannot be combined with --no-extract"
+        )
+        sys.exit(1)
+
     topology = get_topology(args.topology)
 
     # Determine which artifacts to fetch
@@ -392,11 +1272,30 @@ def do_fetch(args: argparse.Namespace):
         run_id=args.run_id,
         github_repository=args.run_github_repo,
         platform=args.platform,
+        max_connections=_max_concurrency(
+            args.download_concurrency, args.max_download_concurrency
+        ),
     )
     log(f"Using backend: {backend.base_uri}")
 
-    # Get list of available artifacts
-    available = set(backend.list_artifacts())
+    # Get list of available artifacts, with sizes for scheduling. With a run
+    # index, this and the sidecar checks below need no listing requests.
+    run_index = None
+    if not args.no_run_index:
+        # Only the families asked for must have been pushed, not every target
+        # they expand to.
+        index_families = (
+            parse_target_families(args, expand_targets=False)
+            if args.expand_family_to_targets and not args.generic_only
+            else target_families
+        )
+        run_index = load_covering_run_index(
+            backend, topology, inbound, args.run_index_file, index_families
+        )
+        if run_index is not None:
+            backend.seed_listing(run_index.listing())
+    available_stats = backend.list_artifact_stats()
+    available = set(available_stats)
     log(f"Found {len(available)} artifacts in backend")
 
     # Build download requests
@@ -405,7 +1304,9 @@ def do_fetch(args: argparse.Namespace):
     download_dir = (
         args.download_cache_dir if shared_cache else output_dir / ".download_cache"
     )
-    download_dir.mkdir(parents=True, exist_ok=True)
+    if args.lazy_mount and not shared_cache:
+        # The output dir becomes the (read-only) mount point.
+        download_dir = args.content_store_dir / "downloads"
 
     excluded_components = parse_excluded_components(args.exclude_components)
     if excluded_components:
@@ -418,89 +1319,225 @@ def do_fetch(args: argparse.Namespace):
         excluded_components=excluded_components,
     )
 
-    download_requests = [
-        DownloadRequest(
-            artifact_key=filename,
-            dest_path=download_dir / filename,
-            backend=backend,
+    if args.stream_extract:
+        _stream_fetch(args, backend, matched_filenames, output_dir)
+        return
+    download_dir.mkdir(parents=True, exist_ok=True)
+
+    content_store = None
+    if args.content_store_dir is not None:
+        if args.no_extract:
+            log("Ignoring --content-store-dir with --no-extract")
+        else:
+            content_store = ContentStore(
+                args.content_store_dir, link_mode=args.content_store_link_mode
+            )
+            log(
+                f"Using content store: {args.content_store_dir} "
+                f"(link mode {args.content_store_link_mode})"
+            )
+
+    # Largest first: the biggest archives are the long poles of the fetch.
+    matched_filenames = sorted(
+        matched_filenames,
+        key=lambda f: (-_listed_size(available_stats, f), f),
+    )
+    # Extract while downloading, except where extraction needs the complete
+    # archive (content store) or the download can't be renamed while open.
+    progressive = not args.no_extract and content_store is None and os.name != "nt"
+    max_download_concurrency = _max_concurrency(
+        args.download_concurrency, args.max_download_concurrency
+    )
+    budget = ConnectionBudget(args.download_concurrency, max_download_concurrency)
+    store_use = contextlib.ExitStack()
+    try:
+        if content_store is not None:
+            # Keeps other fetches from pruning blobs while this one uses them.
+            store_use.enter_context(content_store.in_use())
+        timeline = FetchTimeline()
+        concurrency = AdaptiveConcurrency(
+            args.download_concurrency,
+            max_download_concurrency,
+            on_change=budget.set_limit,
         )
-        for filename in matched_filenames
-    ]
+        download_requests = [
+            DownloadRequest(
+                artifact_key=filename,
+                dest_path=download_dir / filename,
+                backend=backend,
+                content_store=content_store,
+                budget=budget,
+                part_size=args.download_part_size_mb << 20,
+                max_part_connections=args.download_part_concurrency,
+                stat=available_stats.get(filename),
+                progress=DownloadProgress() if progressive else None,
+                expected_sha256=(
+                    run_index.entries[filename].sha256
+                    if run_index is not None and filename in run_index.entries
+                    else None
+                ),
+                concurrency=concurrency,
+                timeline=timeline,
+            )
+            for filename in matched_filenames
+        ]
 
-    if not download_requests:
-        log("No matching artifacts found to download")
-        return
+        if not download_requests:
+            log("No matching artifacts found to download")
+            return
 
-    log(f"\nDownloading {len(download_requests)} artifacts...")
+        if args.lazy_mount:
+            lazy_mount(
+                download_requests,
+                content_store,
+                output_dir,
+                args.download_concurrency,
+                zstd_dict_dirs=_zstd_dict_dirs(args),
+            )
+            return
 
-    # Parallel download and extract pipeline
-    downloaded_count = 0
-    extracted_count = 0
+        log(f"\nDownloading {len(download_requests)} artifacts...")
+        # Hand out connections largest-first, however many download threads run.
+        budget.enqueue([req.artifact_key for req in download_requests])
+
+        # Parallel download and extract pipeline
+        downloaded_count = 0
+        extracted_count = 0
+
+        # For bootstrap mode, create shared state to coordinate parallel
+        # extractions that may write to overlapping paths
+        bootstrap_cleaned_paths: set = set()
+        bootstrap_lock = threading.Lock()
+
+        def make_extract_request(archive_path: Path, progress=None):
+            return ExtractRequest(
+                archive_path=archive_path,
+                output_dir=(
+                    output_dir / "artifacts"
+                    if not args.bootstrap and not args.flatten
+                    else output_dir
+                ),
+                # Don't delete during parallel extraction - cleanup
+                # happens after all extractions complete
+                delete_archive=False,
+                flatten=args.flatten,
+                bootstrap=args.bootstrap,
+                cleaned_paths=(bootstrap_cleaned_paths if args.bootstrap else None),
+                cleaned_paths_lock=(bootstrap_lock if args.bootstrap else None),
+                content_store=content_store,
+                progress=progress,
+                zstd_dict_dirs=_zstd_dict_dirs(args),
+            )
 
-    with concurrent.futures.ThreadPoolExecutor(
-        max_workers=args.download_concurrency
-    ) as download_executor:
-        download_futures = [
-            download_executor.submit(download_artifact, req)
-            for req in download_requests
-        ]
+        # Each download holds a connection of `budget`, whose limit follows
+        # `concurrency`, so the pool itself is sized for the maximum.
+        # Progressive extractions wait on their download's bytes, so they get
+        # their own pool rather than taking workers from other extractions.
+        with concurrent.futures.ThreadPoolExecutor(
+            max_workers=max_download_concurrency
+        ) as download_executor, concurrent.futures.ThreadPoolExecutor(
+            max_workers=args.extract_concurrency
+        ) as extract_executor, concurrent.futures.ThreadPoolExecutor(
+            max_workers=args.progressive_extract_concurrency
+        ) as progressive_executor:
+            # Artifact key -> download future (and, when progressive, the
+            # extraction following it), guarded by `futures_lock`.
+            download_futures: dict[str, concurrent.futures.Future] = {}
+            progressive_futures: dict[str, concurrent.futures.Future] = {}
+            futures_lock = threading.Lock()
+            progressive_slots = threading.BoundedSemaphore(
+                args.progressive_extract_concurrency
+            )
 
-        if args.no_extract:
-            # Just wait for downloads
-            for future in concurrent.futures.as_completed(download_futures):
-                result = future.result()
-                if result:
-                    downloaded_count += 1
-        else:
-            # Pipeline: extract as downloads complete
-            # For bootstrap mode, create shared state to coordinate parallel
-            # extractions that may write to overlapping paths
-            bootstrap_cleaned_paths: set = set()
-            bootstrap_lock = threading.Lock()
-
-            with concurrent.futures.ThreadPoolExecutor(
-                max_workers=args.extract_concurrency
-            ) as extract_executor:
-                extract_futures = []
-
-                for download_future in concurrent.futures.as_completed(
-                    download_futures
-                ):
-                    downloaded_path = download_future.result()
-                    if not downloaded_path or not downloaded_path.exists():
-                        continue
-                    downloaded_count += 1
-                    extract_futures.append(
-                        extract_executor.submit(
-                            extract_artifact,
-                            ExtractRequest(
-                                archive_path=downloaded_path,
-                                output_dir=(
-                                    output_dir / "artifacts"
-                                    if not args.bootstrap and not args.flatten
-                                    else output_dir
-                                ),
-                                # Don't delete during parallel extraction - cleanup
-                                # happens after all extractions complete
-                                delete_archive=False,
-                                flatten=args.flatten,
-                                bootstrap=args.bootstrap,
-                                cleaned_paths=(
-                                    bootstrap_cleaned_paths if args.bootstrap else None
-                                ),
-                                cleaned_paths_lock=(
-                                    bootstrap_lock if args.bootstrap else None
-                                ),
-                            ),
+            def start_progressive_extract(req: DownloadRequest):
+                """Follows a download that just started, if a slot is free.
+
+                Downloads started while all slots are taken are extracted
+                once complete instead.
+                """
+                # Also waits until all downloads were submitted.
+                with futures_lock:
+                    if not progressive_slots.acquire(blocking=False):
+                        return
+                    future = progressive_executor.submit(
+                        timeline.timed,
+                        req.artifact_key,
+                        "extract",
+                        extract_while_downloading,
+                        make_extract_request(req.dest_path, req.progress),
+                        download_futures[req.artifact_key],
+                    )
+                    future.add_done_callback(lambda _: progressive_slots.release())
+                    progressive_futures[req.artifact_key] = future
+
+            with futures_lock:
+                for req in download_requests:
+                    if progressive:
+                        req.progress.on_start = functools.partial(
+                            start_progressive_extract, req
                         )
+                    timeline.mark(req.artifact_key, "queued")
+                    download_futures[req.artifact_key] = download_executor.submit(
+                        timeline.timed,
+                        req.artifact_key,
+                        "download",
+                        download_artifact,
+                        req,
                     )
+            artifact_keys = {
+                future: artifact_key
+                for artifact_key, future in download_futures.items()
+            }
+
+            # Pipeline: extract as downloads complete (or, when progressive,
+            # as their bytes arrive).
+            extract_futures = []
+            for download_future in concurrent.futures.as_completed(artifact_keys):
+                downloaded_path = download_future.result()
+                if not downloaded_path or not downloaded_path.exists():
+                    continue
+                downloaded_count += 1
+                if args.no_extract:
+                    continue
+                with futures_lock:
+                    if artifact_keys[download_future] in progressive_futures:
+                        continue
+                extract_futures.append(
+                    extract_executor.submit(
+                        timeline.timed,
+                        _artifact_key_for_path(downloaded_path),
+                        "extract",
+                        extract_artifact,
+                        make_extract_request(downloaded_path),
+                    )
+                )
 
-                for future in concurrent.futures.as_completed(extract_futures):
-                    result = future.result()
-                    if result:
-                        extracted_count += 1
+            # Every download has started, so no progressive extraction is added.
+            extract_futures.extend(progressive_futures.values())
+            for future in concurrent.futures.as_completed(extract_futures):
+                result = future.result()
+                if result:
+                    extracted_count += 1
+    finally:
+        # Also stops multipart helpers if a download or extraction raised.
+        budget.shutdown()
+        store_use.close()
 
     log(f"\nDownloaded {downloaded_count} artifacts, extracted {extracted_count}")
+    log(f"Download throughput: {concurrency.summary()}")
+    timeline.log_summary(available_stats)
+    if args.timeline_json is not None:
+        timeline.write_json(args.timeline_json, available_stats)
+
+    if content_store is not None and args.content_store_max_size_gb is not None:
+        pruned = content_store.prune(int(args.content_store_max_size_gb * (1 << 30)))
+        if pruned is None:
+            log("Content store in use by another fetch, not pruning it")
+        elif pruned[0]:
+            log(
+                f"Pruned {pruned[0]} files ({_format_bytes(pruned[1])}) from the "
+                "content store"
+            )
 
     # Cleanup download cache (skip when using a shared cache dir)
     if download_dir.exists() and not args.no_extract and not shared_cache:
@@ -539,6 +1576,17 @@ class CompressRequest:
     compression_level: Optional[int] = (
         None  # None = use algorithm default (3 for zstd, 6 for xz)
     )
+    # Trained zstd dictionary for this artifact family (zstd only)
+    zstd_dict: Optional[Path] = None
+    zstd_dict_mode: str = "reference"
+    # Uncompressed bytes per independently compressed frame (single frame if 0)
+    frame_size: int = 0
+    # Backend of a previous run to write a file-level delta against
+    delta_base_backend: Optional[ArtifactBackend] = None
+    # Entries of `source_dir` (scanned when compressing if not set)
+    contents: Optional[ArtifactContents] = None
+    # Process pool to compress in (in this process if not set)
+    pool: Optional[concurrent.futures.Executor] = None
 
 
 @dataclass
@@ -548,23 +1596,25 @@ class UploadRequest:
     source_path: Path
     artifact_key: str
     backend: ArtifactBackend
+    # Run index of the push, to add the uploaded artifact to
+    run_index: Optional[RunIndex] = None
+    # When set, each attempt holds one of its slots, and uploaded bytes and
+    # errors are reported to it.
+    concurrency: Optional[AdaptiveConcurrency] = None
+    # Set when the archive itself was already uploaded while it was being
+    # compressed (its sha256); only the sidecars are left.
+    uploaded_sha256: Optional[str] = None
 
 
-def _format_bytes(size: Optional[int]) -> str:
-    return "unknown" if size is None else f"{size} bytes"
+def _max_concurrency(initial: int, maximum: Optional[int]) -> int:
+    """The adaptive concurrency ceiling for an `--*-concurrency` option."""
+    if maximum is None:
+        maximum = DEFAULT_MAX_CONCURRENCY
+    return max(initial, maximum)
 
 
-def _directory_file_count_and_size_sum(path: Path) -> Optional[tuple[int, int]]:
-    try:
-        count = 0
-        total = 0
-        for child in path.rglob("*"):
-            if child.is_file():
-                count += 1
-                total += child.stat().st_size
-        return count, total
-    except OSError:
-        return None
+def _format_bytes(size: Optional[int]) -> str:
+    return "unknown" if size is None else f"{size} bytes"
 
 
 def _hash_file_path(archive_path: Path) -> Path:
@@ -584,63 +1634,357 @@ def _read_sha256sum_value(hash_path: Path) -> str:
     return content.split()[0]
 
 
+def _write_artifact_archive(
+    contents: ArtifactContents,
+    archive_path: Path,
+    compression_type: str,
+    compression_level: Optional[int],
+    zstd_dict: Optional[Path],
+    zstd_dict_mode: str,
+    frame_size: int,
+    hash_path: Optional[Path],
+):
+    """Writes an archive like `fileset_tool.py artifact-archive` (in a worker)."""
+    write_artifact_archive(
+        contents,
+        archive_path,
+        compression_type,
+        compression_level,
+        zstd_dict_path=zstd_dict,
+        zstd_dict_mode=zstd_dict_mode,
+        frame_size=frame_size or None,
+        index_path=_index_path(archive_path),
+    )
+    if hash_path is not None:
+        write_hash(hash_path, calculate_hash(archive_path, "sha256"))
+
+
+def _submit_compression(
+    request: CompressRequest,
+    hash_path: Optional[Path],
+    pool: Optional[concurrent.futures.Executor],
+) -> concurrent.futures.Future:
+    """Starts writing the archive of `request` in `pool` (or right here)."""
+    if request.contents is None:
+        request.contents = ArtifactContents.scan([request.source_dir])
+    args = (
+        request.contents,
+        request.archive_path,
+        request.compression_type,
+        request.compression_level,
+        request.zstd_dict,
+        request.zstd_dict_mode,
+        request.frame_size,
+        hash_path,
+    )
+    if pool is not None:
+        return pool.submit(_write_artifact_archive, *args)
+    future = concurrent.futures.Future()
+    try:
+        future.set_result(_write_artifact_archive(*args))
+    except Exception as e:
+        future.set_exception(e)
+    return future
+
+
+def _log_compressed(request: CompressRequest, sha256: str):
+    log(
+        f"  ++ Compressed {request.source_dir.name} "
+        f"(files={request.contents.file_count}, "
+        f"uncompressed_size={_format_bytes(request.contents.file_size)}) "
+        f"-> {request.archive_path.name} "
+        f"(compressed_size={_format_bytes(request.archive_path.stat().st_size)}, "
+        f"sha256={sha256}"
+        + (f", zstd_dict={request.zstd_dict.name}" if request.zstd_dict else "")
+        + ")"
+    )
+
+
 def compress_artifact(request: CompressRequest) -> Optional[Path]:
-    """Compress a single artifact directory using fileset_tool.py artifact-archive."""
+    """Compress a single artifact directory (like fileset_tool.py artifact-archive)."""
     try:
         log(f"  ++ Compressing {request.source_dir.name}")
-        request.archive_path.parent.mkdir(parents=True, exist_ok=True)
         hash_path = _hash_file_path(request.archive_path)
+        _submit_compression(request, hash_path, request.pool).result()
+        _log_compressed(request, _read_sha256sum_value(hash_path))
+        if request.delta_base_backend is not None:
+            write_delta_archive(request)
+        return request.archive_path
+    except Exception as e:
+        log(f"  !! Failed to compress {request.source_dir.name}: {e}")
+        return None
 
-        # Use fileset_tool.py artifact-archive for proper archive creation
-        import subprocess
 
-        script_dir = Path(__file__).parent
-        fileset_tool = script_dir / "fileset_tool.py"
+def _follow_file(
+    path: Path,
+    is_finished: Callable[[], bool],
+    chunk_size: int = 1024 * 1024,
+    poll_seconds: float = 0.05,
+) -> Iterator[bytes]:
+    """Yields the contents of a file while another process appends to it.
+
+    Ends once `is_finished()` is true and everything written before has been
+    read.
+    """
+    while True:
+        try:
+            f = open(path, "rb")
+            break
+        except FileNotFoundError:
+            if is_finished():
+                raise
+            time.sleep(poll_seconds)
+    with f:
+        while True:
+            # Checked before reading, so that nothing written before the
+            # writer finished is missed.
+            finished = is_finished()
+            chunk = f.read(chunk_size)
+            if chunk:
+                yield chunk
+            elif finished:
+                return
+            else:
+                time.sleep(poll_seconds)
+
+
+def compress_and_stream_artifact(
+    request: CompressRequest, upload_request: UploadRequest
+) -> Optional[UploadRequest]:
+    """Compresses an artifact while uploading the archive as it is written.
+
+    The archive is read back as the compression worker writes it and handed
+    to the backend's streaming upload (S3 parts are sent as they fill), hashing it
+    on the way. The archive is still written to disk for the delta and as a
+    fallback: if streaming fails, the returned request uploads it normally.
+
+    Returns the upload request for what is left to upload (the sidecars, or
+    also the archive), or None if compression failed.
+    """
+    try:
+        return _compress_and_stream(request, upload_request)
+    except Exception as e:
+        log(f"  !! Failed to compress {request.source_dir.name}: {e}")
+        return None
+
+
+def _compress_and_stream(
+    request: CompressRequest, upload_request: UploadRequest
+) -> UploadRequest:
+    log(f"  ++ Compressing {request.source_dir.name} (streaming upload)")
+    request.archive_path.parent.mkdir(parents=True, exist_ok=True)
+    # The follower must not pick up an archive left by an earlier push.
+    request.archive_path.unlink(missing_ok=True)
+    hash_path = _hash_file_path(request.archive_path)
+    digest = hashlib.sha256()
+
+    with contextlib.ExitStack() as stack:
+        pool = request.pool
+        if pool is None:
+            # Compress on another thread while this one reads.
+            pool = stack.enter_context(
+                concurrent.futures.ThreadPoolExecutor(max_workers=1)
+            )
+        compression = _submit_compression(request, None, pool)
+        compressed_time = None
+
+        def archive_chunks() -> Iterator[bytes]:
+            nonlocal compressed_time
+            for chunk in _follow_file(request.archive_path, compression.done):
+                digest.update(chunk)
+                yield chunk
+            compressed_time = time.monotonic()
+            # Raises if compression failed, which aborts the upload.
+            compression.result()
+
+        concurrency = upload_request.concurrency
+        streamed = False
+        try:
+            chunks = archive_chunks()
+            # Only take a transfer slot once there is something to upload.
+            first_chunk = next(chunks, b"")
+            with (
+                concurrency.slot()
+                if concurrency is not None
+                else contextlib.nullcontext()
+            ):
+                stat = upload_request.backend.upload_artifact_stream(
+                    itertools.chain([first_chunk], chunks),
+                    upload_request.artifact_key,
+                )
+            if concurrency is not None:
+                # Paced by compression, so not a measure of upload throughput.
+                concurrency.record(stat.size, adapt=False)
+            streamed = True
+        except Exception as e:
+            if compression.exception() is None:
+                if concurrency is not None:
+                    concurrency.record_error(e)
+                log(
+                    f"  !! Streaming upload of {upload_request.artifact_key} "
+                    f"failed, uploading after compression: {e}"
+                )
+        if compression.exception() is not None:
+            request.archive_path.unlink(missing_ok=True)
+            raise compression.exception()
+
+    if streamed:
+        write_hash(hash_path, digest)
+        upload_request.uploaded_sha256 = digest.hexdigest()
+        log(
+            f"  ++ Streamed {upload_request.artifact_key} while compressing "
+            f"(upload done {time.monotonic() - compressed_time:.1f}s after "
+            f"compression)"
+        )
+    else:
+        write_hash(hash_path, calculate_hash(request.archive_path, "sha256"))
+    _log_compressed(request, _read_sha256sum_value(hash_path))
+    if request.delta_base_backend is not None:
+        write_delta_archive(request)
+    return upload_request
+
+
+def write_delta_archive(request: CompressRequest) -> Optional[Path]:
+    """Writes the artifact's delta sidecar against the base run, if useful.
+
+    The delta holds the files whose contents are not in the base run's index
+    of the same artifact. It is skipped (and fetch uses the full archive) if
+    the base has no index or the delta is not smaller than the full archive.
+    Failures are not fatal since the full archive is always uploaded.
+    """
+    import subprocess
+
+    artifact_key = request.archive_path.name
+    base_index_path = Path(f"{request.archive_path}.base{INDEX_SUFFIX}")
+    delta_path = _delta_path(request.archive_path)
+    try:
+        base_index_key = f"{artifact_key}{INDEX_SUFFIX}"
+        if not request.delta_base_backend.artifact_exists(base_index_key):
+            log(f"  ++ No base index for {artifact_key}, skipping delta")
+            return None
+        request.delta_base_backend.download_artifact(base_index_key, base_index_path)
 
         cmd = [
             sys.executable,
-            str(fileset_tool),
-            "artifact-archive",
+            str(Path(__file__).parent / "fileset_tool.py"),
+            "artifact-delta-archive",
+            "--index",
+            str(_index_path(request.archive_path)),
+            "--base-index",
+            str(base_index_path),
             "-o",
-            str(request.archive_path),
-            "--compression-type",
-            request.compression_type,
+            str(delta_path),
+            str(request.source_dir),
         ]
-        if request.compression_level is not None:
+        if request.compression_level is not None and request.compression_type == "zstd":
             cmd.extend(["--compression-level", str(request.compression_level)])
-        cmd.extend(
-            [
-                "--hash-file",
-                str(hash_path),
-                str(request.source_dir),
-            ]
-        )
-
         result = subprocess.run(cmd, capture_output=True, text=True)
         if result.returncode != 0:
             raise RuntimeError(
-                f"fileset_tool.py artifact-archive failed (returncode={result.returncode}): {result.stderr}"
+                f"fileset_tool.py artifact-delta-archive failed "
+                f"(returncode={result.returncode}): {result.stderr}"
             )
 
-        sha256 = _read_sha256sum_value(hash_path)
-        file_count_and_size = _directory_file_count_and_size_sum(request.source_dir)
-        if file_count_and_size is None:
-            file_count = "unknown"
-            uncompressed_size = None
-        else:
-            file_count, uncompressed_size = file_count_and_size
+        delta_size = delta_path.stat().st_size
+        full_size = request.archive_path.stat().st_size
+        if delta_size >= full_size:
+            log(
+                f"  ++ Delta for {artifact_key} is not smaller than the full "
+                f"archive ({_format_bytes(delta_size)}), skipping"
+            )
+            delta_path.unlink()
+            return None
         log(
-            f"  ++ Compressed {request.source_dir.name} "
-            f"(files={file_count}, "
-            f"uncompressed_size={_format_bytes(uncompressed_size)}) "
-            f"-> {request.archive_path.name} "
-            f"(compressed_size={_format_bytes(request.archive_path.stat().st_size)}, "
-            f"sha256={sha256})"
+            f"  ++ Wrote delta {delta_path.name} "
+            f"(compressed_size={_format_bytes(delta_size)}, "
+            f"full_compressed_size={_format_bytes(full_size)})"
         )
-        return request.archive_path
+        return delta_path
     except Exception as e:
-        log(f"  !! Failed to compress {request.source_dir.name}: {e}")
+        log(f"  !! WARNING: Failed to write delta for {artifact_key}: {e}")
+        delta_path.unlink(missing_ok=True)
+        return None
+    finally:
+        base_index_path.unlink(missing_ok=True)
+
+
+def find_zstd_dict(zstd_dict_dir: Optional[Path], an: ArtifactName) -> Optional[Path]:
+    """Find the trained dictionary for an artifact family, if any.
+
+    Dictionaries are per artifact family, named ``{name}_{component}.zdict``
+    (shared across target families), as produced by
+    ``fileset_tool.py artifact-zstd-dict``.
+    """
+    if zstd_dict_dir is None:
         return None
+    dict_path = zstd_dict_dir / f"{an.name}_{an.component}{ZSTD_DICT_EXTENSION}"
+    return dict_path if dict_path.exists() else None
+
+
+def _upload_with_sidecars(request: UploadRequest) -> int:
+    """Uploads an artifact and its sidecars. Returns the number of bytes sent."""
+    sidecars = {}
+    sha_path = _hash_file_path(request.source_path)
+    compressed_size = request.source_path.stat().st_size
+    uploaded_size = 0
+    if request.uploaded_sha256 is not None:
+        sha256 = request.uploaded_sha256
+    else:
+        # Upload the artifact itself.
+        sha256 = calculate_hash(request.source_path, "sha256").hexdigest()
+        log(
+            f"  ++ Uploading {request.artifact_key} "
+            f"(compressed_size={_format_bytes(compressed_size)}, "
+            f"sha256={sha256})"
+        )
+        request.backend.upload_artifact(request.source_path, request.artifact_key)
+        uploaded_size = compressed_size
+
+    # Upload the artifact's sha256sum file.
+    if sha_path.exists():
+        sha256sum_sha256 = _read_sha256sum_value(sha_path)
+        if sha256sum_sha256 != sha256:
+            log(
+                f"  !! WARNING: sha256 mismatch for {request.artifact_key}: "
+                f"computed_sha256={sha256}, sha256sum_sha256={sha256sum_sha256}"
+            )
+        log(
+            f"  ++ Uploading {request.artifact_key}.sha256sum "
+            f"(artifact_sha256={sha256sum_sha256}, "
+            f"size={_format_bytes(sha_path.stat().st_size)})"
+        )
+        request.backend.upload_artifact(sha_path, f"{request.artifact_key}.sha256sum")
+        sidecars[".sha256sum"] = sha_path.stat().st_size
+
+    # Upload the artifact's per-file index (for content store fetches).
+    index_path = _index_path(request.source_path)
+    if index_path.exists():
+        log(
+            f"  ++ Uploading {request.artifact_key}{INDEX_SUFFIX} "
+            f"(size={_format_bytes(index_path.stat().st_size)})"
+        )
+        request.backend.upload_artifact(
+            index_path, f"{request.artifact_key}{INDEX_SUFFIX}"
+        )
+        sidecars[INDEX_SUFFIX] = index_path.stat().st_size
+
+    # Upload the artifact's delta against the base run, if any.
+    delta_path = _delta_path(request.source_path)
+    if delta_path.exists():
+        log(
+            f"  ++ Uploading {request.artifact_key}{DELTA_SUFFIX} "
+            f"(compressed_size={_format_bytes(delta_path.stat().st_size)})"
+        )
+        request.backend.upload_artifact(
+            delta_path, f"{request.artifact_key}{DELTA_SUFFIX}"
+        )
+        sidecars[DELTA_SUFFIX] = delta_path.stat().st_size
+
+    if request.run_index is not None:
+        request.run_index.add(
+            _run_index_entry(request, compressed_size, sha256, sidecars)
+        )
+    return uploaded_size + sum(sidecars.values())
 
 
 def upload_artifact(request: UploadRequest) -> bool:
@@ -650,36 +1994,18 @@ def upload_artifact(request: UploadRequest) -> bool:
 
     for attempt in range(MAX_RETRIES):
         try:
-            # Upload the artifact itself.
-            sha_path = _hash_file_path(request.source_path)
-            sha256 = calculate_hash(request.source_path, "sha256").hexdigest()
-            compressed_size = request.source_path.stat().st_size
-            log(
-                f"  ++ Uploading {request.artifact_key} "
-                f"(compressed_size={_format_bytes(compressed_size)}, "
-                f"sha256={sha256})"
-            )
-            request.backend.upload_artifact(request.source_path, request.artifact_key)
-
-            # Upload the artifact's sha256sum file.
-            if sha_path.exists():
-                sha256sum_sha256 = _read_sha256sum_value(sha_path)
-                if sha256sum_sha256 != sha256:
-                    log(
-                        f"  !! WARNING: sha256 mismatch for {request.artifact_key}: "
-                        f"computed_sha256={sha256}, sha256sum_sha256={sha256sum_sha256}"
-                    )
-                log(
-                    f"  ++ Uploading {request.artifact_key}.sha256sum "
-                    f"(artifact_sha256={sha256sum_sha256}, "
-                    f"size={_format_bytes(sha_path.stat().st_size)})"
-                )
-                request.backend.upload_artifact(
-                    sha_path, f"{request.artifact_key}.sha256sum"
-                )
-
+            with (
+                request.concurrency.slot()
+                if request.concurrency is not None
+                else contextlib.nullcontext()
+            ):
+                uploaded_bytes = _upload_with_sidecars(request)
+            if request.concurrency is not None:
+                request.concurrency.record(uploaded_bytes)
             return True
         except Exception as e:
+            if request.concurrency is not None:
+                request.concurrency.record_error(e)
             if attempt < MAX_RETRIES - 1:
                 delay = BASE_DELAY_SECONDS * (2**attempt)
                 log(
@@ -692,6 +2018,31 @@ def upload_artifact(request: UploadRequest) -> bool:
     return False
 
 
+def _run_index_entry(
+    request: UploadRequest, size: int, sha256: str, sidecars: dict[str, int]
+) -> RunIndexEntry:
+    """Describes an uploaded archive for the run index.
+
+    The uncompressed size and file count come from the archive's file index
+    sidecar, when it has one.
+    """
+    uncompressed_size = None
+    file_count = None
+    index_path = _index_path(request.source_path)
+    if index_path.exists():
+        file_index = ArtifactFileIndex.load(index_path)
+        file_count = len(file_index.files)
+        uncompressed_size = file_index.total_file_size
+    return RunIndexEntry.for_archive(
+        request.artifact_key,
+        size,
+        sha256,
+        uncompressed_size=uncompressed_size,
+        file_count=file_count,
+        sidecars=sidecars,
+    )
+
+
 def do_push(args: argparse.Namespace):
     """Push produced artifacts after building with parallel compress and upload."""
     topology = get_topology(args.topology)
@@ -727,9 +2078,21 @@ def do_push(args: argparse.Namespace):
         run_id=args.run_id,
         github_repository=args.run_github_repo,
         platform=args.platform,
+        max_connections=_max_concurrency(
+            args.upload_concurrency, args.max_upload_concurrency
+        ),
     )
     log(f"Using backend: {backend.base_uri}")
 
+    delta_base_backend = None
+    if args.delta_base_run_id:
+        delta_base_backend = _create_source_backend(
+            source_run_id=args.delta_base_run_id,
+            platform=args.platform,
+            local_staging_dir=args.local_staging_dir,
+        )
+        log(f"Writing deltas against: {delta_base_backend.base_uri}")
+
     # Find artifact directories in build directory
     build_dir = Path(args.build_dir)
     artifacts_dir = build_dir / "artifacts"
@@ -765,6 +2128,14 @@ def do_push(args: argparse.Namespace):
                     archive_path=upload_dir / archive_name,
                     compression_type=args.compression_type,
                     compression_level=args.compression_level,
+                    zstd_dict=(
+                        find_zstd_dict(args.zstd_dict_dir, an)
+                        if args.compression_type == "zstd"
+                        else None
+                    ),
+                    zstd_dict_mode=args.zstd_dict_mode,
+                    frame_size=args.frame_size,
+                    delta_base_backend=delta_base_backend,
                 )
             )
         elif (item.suffix == ".xz" and item.name.endswith(".tar.xz")) or (
@@ -796,18 +2167,59 @@ def do_push(args: argparse.Namespace):
 
     compressed_count = 0
     uploaded_count = 0
+    run_index = RunIndex()
+    max_upload_concurrency = _max_concurrency(
+        args.upload_concurrency, args.max_upload_concurrency
+    )
+    concurrency = AdaptiveConcurrency(args.upload_concurrency, max_upload_concurrency)
+    for req in direct_upload_requests:
+        req.run_index = run_index
+        req.concurrency = concurrency
+
+    def compress(req: CompressRequest) -> Optional[UploadRequest]:
+        upload_request = UploadRequest(
+            source_path=req.archive_path,
+            artifact_key=req.archive_path.name,
+            backend=backend,
+            run_index=run_index,
+            concurrency=concurrency,
+        )
+        if args.stream_upload:
+            return compress_and_stream_artifact(req, upload_request)
+        archive_path = compress_artifact(req)
+        if not archive_path or not archive_path.exists():
+            return None
+        return upload_request
 
-    # Parallel compress and upload pipeline
-    with concurrent.futures.ThreadPoolExecutor(
-        max_workers=args.compress_concurrency
+    # Compress the largest artifacts first, since they bound the wall time.
+    # The walk that sizes them also feeds the archive writer.
+    for req in compress_requests:
+        try:
+            req.contents = ArtifactContents.scan([req.source_dir])
+        except OSError:
+            pass  # Reported when compressing it fails.
+    compress_requests.sort(
+        key=lambda req: req.contents.file_size if req.contents else 0, reverse=True
+    )
+
+    # Parallel compress and upload pipeline. Archives are written by worker
+    # processes (which import the archive code once), coordinated by threads
+    # that also write deltas and hand archives over to uploads.
+    with concurrent.futures.ProcessPoolExecutor(
+        max_workers=args.compress_concurrency,
+        mp_context=multiprocessing.get_context("spawn"),
+    ) as compress_pool, concurrent.futures.ThreadPoolExecutor(
+        max_workers=args.compress_concurrency or os.cpu_count()
     ) as compress_executor:
+        for req in compress_requests:
+            req.pool = compress_pool
         compress_futures = [
-            compress_executor.submit(compress_artifact, req)
-            for req in compress_requests
+            compress_executor.submit(compress, req) for req in compress_requests
         ]
 
+        # Uploads wait for a slot of `concurrency`.
         with concurrent.futures.ThreadPoolExecutor(
-            max_workers=args.upload_concurrency
+            max_workers=max_upload_concurrency
         ) as upload_executor:
             upload_futures = []
 
@@ -817,19 +2229,12 @@ def do_push(args: argparse.Namespace):
 
             # As compression completes, start uploads
             for compress_future in concurrent.futures.as_completed(compress_futures):
-                archive_path = compress_future.result()
-                if not archive_path or not archive_path.exists():
+                upload_request = compress_future.result()
+                if upload_request is None:
                     continue
                 compressed_count += 1
                 upload_futures.append(
-                    upload_executor.submit(
-                        upload_artifact,
-                        UploadRequest(
-                            source_path=archive_path,
-                            artifact_key=archive_path.name,
-                            backend=backend,
-                        ),
-                    )
+                    upload_executor.submit(upload_artifact, upload_request)
                 )
 
             # Wait for all uploads
@@ -838,6 +2243,24 @@ def do_push(args: argparse.Namespace):
                     uploaded_count += 1
 
     log(f"\nCompressed {compressed_count} artifacts, uploaded {uploaded_count}")
+    log(f"Upload throughput: {concurrency.summary()}")
+
+    # Publish the run index fragment for this push once everything is up, so
+    # readers never see an index entry for an artifact that isn't there yet.
+    if uploaded_count == total_artifacts and not run_index.entries:
+        log("No artifacts pushed, not publishing a run index fragment")
+    elif uploaded_count == total_artifacts:
+        try:
+            fragment = publish_run_index_fragment(
+                backend, run_index, args.stage, upload_dir
+            )
+            log(
+                f"Published run index fragment {fragment.filename} "
+                f"({len(run_index.entries)} artifacts)"
+            )
+        except Exception as e:
+            # Readers fall back to listing the run.
+            log(f"  !! WARNING: Failed to publish run index: {e}")
 
     # Cleanup upload cache
     if upload_dir.exists():
@@ -864,6 +2287,8 @@ class CopyRequest:
     artifact_key: str
     source_backend: ArtifactBackend
     dest_backend: ArtifactBackend
+    # Set when the destination already held an identical copy.
+    unchanged: bool = False
 
 
 def copy_single_artifact(request: CopyRequest) -> bool:
@@ -874,9 +2299,11 @@ def copy_single_artifact(request: CopyRequest) -> bool:
     for attempt in range(MAX_RETRIES):
         try:
             log(f"  ++ Copying {request.artifact_key}")
-            request.dest_backend.copy_artifact(
+            request.unchanged = not request.dest_backend.copy_artifact(
                 request.artifact_key, request.source_backend
             )
+            if request.unchanged:
+                log(f"  ++ {request.artifact_key} is unchanged in the destination")
             return True
         except Exception as e:
             if attempt < MAX_RETRIES - 1:
@@ -909,6 +2336,7 @@ def _create_source_backend(
         return LocalDirectoryBackend(
             staging_dir=staging,
             output_root=output_root,
+            link_mode=os.getenv("THEROCK_LOCAL_STAGING_LINK_MODE", "auto"),
         )
 
     output_root = WorkflowOutputRoot.from_workflow_run(
@@ -956,24 +2384,34 @@ def do_copy(args: argparse.Namespace):
     dest_backend = create_backend_from_env(
         run_id=args.run_id,
         platform=args.platform,
+        max_connections=args.concurrency + DEFAULT_PART_CONCURRENCY,
     )
 
     log(f"Source: {source_backend.base_uri}")
     log(f"Dest:   {dest_backend.base_uri}")
 
-    # List available artifacts in source
+    # List available artifacts in source (from its run index, if complete)
+    source_index = load_covering_run_index(source_backend, topology, produced)
+    if source_index is not None:
+        source_backend.seed_listing(source_index.listing())
     available = set(source_backend.list_artifacts())
     log(f"Found {len(available)} artifacts in source")
 
-    # Build copy requests from matched artifacts
+    # Build copy requests from matched artifacts, largest first so that the
+    # longest copies don't start last.
     matched_filenames = find_available_artifacts(produced, target_families, available)
+    source_stats = source_backend.list_artifact_stats()
     copy_requests = [
         CopyRequest(
             artifact_key=filename,
             source_backend=source_backend,
             dest_backend=dest_backend,
         )
-        for filename in matched_filenames
+        for filename in sorted(
+            matched_filenames,
+            key=lambda f: source_stats[f].size if f in source_stats else 0,
+            reverse=True,
+        )
     ]
 
     if not copy_requests:
@@ -986,8 +2424,18 @@ def do_copy(args: argparse.Namespace):
             log(f"  {req.artifact_key}")
         return
 
+    # One listing of the destination tells which artifacts are already there.
+    # Skipping those needs source ETags, which the run index doesn't have.
+    dest_listing = dest_backend.list_objects()
+    if source_index is not None and any(
+        filename in dest_listing and dest_listing[filename].etag
+        for filename in matched_filenames
+    ):
+        source_backend.list_objects(refresh=True)
+
     log(f"\nCopying {len(copy_requests)} artifacts...")
 
+    start_time = time.monotonic()
     failed_artifacts = []
     with concurrent.futures.ThreadPoolExecutor(
         max_workers=args.concurrency
@@ -999,8 +2447,23 @@ def do_copy(args: argparse.Namespace):
             if not future.result():
                 failed_artifacts.append(futures[future].artifact_key)
 
-    copied_count = len(copy_requests) - len(failed_artifacts)
-    log(f"\nCopied {copied_count}/{len(copy_requests)} artifacts")
+    elapsed = time.monotonic() - start_time
+    copied = [
+        req
+        for req in copy_requests
+        if not req.unchanged and req.artifact_key not in failed_artifacts
+    ]
+    unchanged_count = sum(1 for req in copy_requests if req.unchanged)
+    copied_bytes = sum(
+        source_stats[req.artifact_key].size
+        for req in copied
+        if req.artifact_key in source_stats
+    )
+    log(
+        f"\nCopied {len(copied) + unchanged_count}/{len(copy_requests)} artifacts "
+        f"({unchanged_count} unchanged, {_format_bytes(copied_bytes)} copied "
+        f"in {elapsed:.1f}s)"
+    )
 
     if failed_artifacts:
         log(f"ERROR: {len(failed_artifacts)} artifacts failed to copy:")
@@ -1008,6 +2471,38 @@ def do_copy(args: argparse.Namespace):
             log(f"  - {name}")
         sys.exit(1)
 
+    if source_index is not None:
+        _publish_copied_run_index(
+            topology, stage_names, matched_filenames, source_index, dest_backend
+        )
+
+
+def _publish_copied_run_index(
+    topology: BuildTopology,
+    stage_names: List[str],
+    copied_filenames: List[str],
+    source_index: RunIndex,
+    dest_backend: ArtifactBackend,
+):
+    """Publishes run index fragments for the copied artifacts of each stage."""
+    with tempfile.TemporaryDirectory() as work_dir:
+        for stage_name in stage_names:
+            produced = topology.get_produced_artifacts(stage_name)
+            stage_index = RunIndex()
+            for filename in copied_filenames:
+                entry = source_index.entries.get(filename)
+                if entry is not None and entry.name in produced:
+                    stage_index.add(entry)
+            if not stage_index.entries:
+                continue
+            try:
+                fragment = publish_run_index_fragment(
+                    dest_backend, stage_index, stage_name, Path(work_dir)
+                )
+                log(f"Published run index fragment {fragment.filename}")
+            except Exception as e:
+                log(f"  !! WARNING: Failed to publish run index: {e}")
+
 
 # =============================================================================
 # Info Commands
@@ -1099,6 +2594,14 @@ def _add_target_args(parser: argparse.ArgumentParser):
         action="store_true",
         help="Only use generic (host) artifacts, skip device-specific artifacts",
     )
+    parser.add_argument(
+        "--skip-generic",
+        action="store_true",
+        help=(
+            "Skip generic (host) artifacts, only use device-specific artifacts "
+            "(e.g. when the generic artifacts are fetched separately)"
+        ),
+    )
     parser.add_argument(
         "--amdgpu-targets",
         type=str,
@@ -1146,6 +2649,14 @@ def _add_backend_args(parser: argparse.ArgumentParser):
         default=os.getenv("THEROCK_LOCAL_STAGING_DIR"),
         help="Local staging directory (sets THEROCK_LOCAL_STAGING_DIR)",
     )
+    parser.add_argument(
+        "--local-staging-link-mode",
+        choices=LINK_MODES,
+        default=os.getenv("THEROCK_LOCAL_STAGING_LINK_MODE", "auto"),
+        help="How archives are transferred to/from/within the local staging "
+        "directory (sets THEROCK_LOCAL_STAGING_LINK_MODE; default: auto = "
+        "reflink, then hardlink, then copy_file_range copy)",
+    )
 
 
 def main(argv: Optional[List[str]] = None):
@@ -1190,6 +2701,13 @@ def main(argv: Optional[List[str]] = None):
         action="store_true",
         help="Download only, do not extract",
     )
+    fetch_parser.add_argument(
+        "--stream-extract",
+        action="store_true",
+        help="Stream archives from storage directly into extraction instead of "
+        "downloading them to disk first (overlaps network, decompression and "
+        "file writes). Uses --download-concurrency streams",
+    )
     fetch_parser.add_argument(
         "--download-cache-dir",
         type=Path,
@@ -1202,7 +2720,53 @@ def main(argv: Optional[List[str]] = None):
         "--download-concurrency",
         type=int,
         default=10,
-        help="Number of concurrent downloads (default: 10)",
+        help="Initial number of concurrent downloads, and of the total "
+        "connections shared with multipart downloads (default: 10)",
+    )
+    fetch_parser.add_argument(
+        "--max-download-concurrency",
+        type=int,
+        default=None,
+        help="Connections are added while download throughput improves and "
+        "halved on throttling, up to this many "
+        f"(default: {DEFAULT_MAX_CONCURRENCY}; set to --download-concurrency "
+        "for a fixed number)",
+    )
+    fetch_parser.add_argument(
+        "--download-part-size-mb",
+        type=int,
+        default=DEFAULT_PART_SIZE >> 20,
+        help="Archives larger than this are downloaded as ranged parts of this "
+        f"size in MiB (default: {DEFAULT_PART_SIZE >> 20})",
+    )
+    fetch_parser.add_argument(
+        "--download-part-concurrency",
+        type=int,
+        default=DEFAULT_MAX_CONNECTIONS_PER_OBJECT,
+        help="Maximum connections per archive for multipart downloads, taken "
+        "from idle --download-concurrency connections, largest archives first; "
+        f"1 disables multipart downloads (default: "
+        f"{DEFAULT_MAX_CONNECTIONS_PER_OBJECT})",
+    )
+    fetch_parser.add_argument(
+        "--run-index-file",
+        type=Path,
+        default=None,
+        help="Read the run's artifact index from this file if it exists, else "
+        "read it from the run and save it here (lets several fetches from one "
+        "run share a single read)",
+    )
+    fetch_parser.add_argument(
+        "--no-run-index",
+        action="store_true",
+        help="List the run instead of reading its artifact index",
+    )
+    fetch_parser.add_argument(
+        "--timeline-json",
+        type=Path,
+        default=None,
+        help="Write per-artifact queued/download/extract times (seconds since "
+        "the start of the fetch) to this JSON file",
     )
     fetch_parser.add_argument(
         "--extract-concurrency",
@@ -1210,6 +2774,14 @@ def main(argv: Optional[List[str]] = None):
         default=None,
         help="Number of concurrent extractions (default: auto)",
     )
+    fetch_parser.add_argument(
+        "--progressive-extract-concurrency",
+        type=int,
+        default=os.cpu_count() or 1,
+        help="Maximum extractions that follow a download as its bytes arrive; "
+        "downloads starting while all are busy are extracted once complete "
+        "(default: number of CPUs)",
+    )
     fetch_parser.add_argument(
         "--exclude-components",
         type=str,
@@ -1223,6 +2795,49 @@ def main(argv: Optional[List[str]] = None):
         default="",
         help="Comma- or semicolon-separated artifact names to exclude when fetching",
     )
+    fetch_parser.add_argument(
+        "--zstd-dict-dir",
+        type=Path,
+        default=None,
+        help="Directory of trained zstd dictionaries used to decompress archives "
+        "that reference (rather than embed) their dictionary",
+    )
+    fetch_parser.add_argument(
+        "--content-store-dir",
+        type=Path,
+        default=None,
+        help="Content-addressed store of artifact files, kept across fetches. "
+        "Artifacts whose files are all in the store are materialized from it "
+        "without downloading their archive (requires .index.json sidecars)",
+    )
+    fetch_parser.add_argument(
+        "--content-store-max-size-gb",
+        type=float,
+        default=None,
+        help="After fetching, remove the oldest files of the content store until "
+        "it holds at most this many GiB (skipped while another fetch uses the "
+        "store; files still hardlinked into fetched trees are kept) (default: "
+        "no limit)",
+    )
+    fetch_parser.add_argument(
+        "--content-store-link-mode",
+        choices=LINK_MODES,
+        default="auto",
+        help="How files are materialized from the content store. Hardlinked "
+        "files share an inode with the store and must not be modified in "
+        "place (default: auto = reflink, then hardlink, then copy)",
+    )
+    fetch_parser.add_argument(
+        "--lazy-mount",
+        action="store_true",
+        help="Instead of extracting, mount OUTPUT_DIR as a read-only view of the "
+        "flattened artifacts and serve it until unmounted (run in the "
+        "background, e.g. with &). Only file indexes are downloaded up "
+        "front; an archive is fetched into the content store when one of its "
+        "files is first opened. Requires --flatten, --content-store-dir, "
+        ".index.json sidecars, FUSE and the fusepy package from "
+        "requirements-lazy-mount.txt (no root needed)",
+    )
     fetch_parser.set_defaults(func=do_fetch)
 
     # push command
@@ -1258,11 +2873,57 @@ def main(argv: Optional[List[str]] = None):
         default=None,
         help="Number of concurrent compressions (default: auto)",
     )
+    push_parser.add_argument(
+        "--stream-upload",
+        action="store_true",
+        help="Upload each archive while it is being compressed (S3 multipart "
+        "parts are sent as they fill) instead of after compression",
+    )
     push_parser.add_argument(
         "--upload-concurrency",
         type=int,
         default=10,
-        help="Number of concurrent uploads (default: 10)",
+        help="Initial number of concurrent uploads (default: 10)",
+    )
+    push_parser.add_argument(
+        "--max-upload-concurrency",
+        type=int,
+        default=None,
+        help="Uploads are added while upload throughput improves and halved "
+        f"on throttling, up to this many (default: {DEFAULT_MAX_CONCURRENCY}; "
+        "set to --upload-concurrency for a fixed number)",
+    )
+    push_parser.add_argument(
+        "--zstd-dict-dir",
+        type=Path,
+        default=None,
+        help="Directory of trained zstd dictionaries named {name}_{component}.zdict "
+        "(see fileset_tool.py artifact-zstd-dict). Matching artifacts are "
+        "compressed against their family dictionary (zstd only)",
+    )
+    push_parser.add_argument(
+        "--zstd-dict-mode",
+        choices=ZSTD_DICT_MODES,
+        default="reference",
+        help="Only reference dictionaries by id (fetches then need "
+        "--zstd-dict-dir) or embed them, which adds their size to every "
+        "archive (default: reference)",
+    )
+    push_parser.add_argument(
+        "--frame-size",
+        type=int,
+        default=0,
+        help="Uncompressed bytes per independently compressed archive frame, so "
+        "that fetches can decompress in parallel (see fileset_tool.py "
+        "artifact-archive --frame-size) (default: 0, a single frame)",
+    )
+    push_parser.add_argument(
+        "--delta-base-run-id",
+        type=str,
+        default=None,
+        help="Previous run ID (e.g. the parent commit's run) to write file-level "
+        "delta sidecars against. Full archives are still uploaded; fetch "
+        "--content-store-dir uses a delta when its store has the base run's files",
     )
     push_parser.set_defaults(func=do_push)
 
@@ -1324,6 +2985,9 @@ def main(argv: Optional[List[str]] = None):
     local_staging_dir = getattr(args, "local_staging_dir", None)
     if local_staging_dir:
         os.environ["THEROCK_LOCAL_STAGING_DIR"] = str(local_staging_dir)
+    local_staging_link_mode = getattr(args, "local_staging_link_mode", None)
+    if local_staging_link_mode:
+        os.environ["THEROCK_LOCAL_STAGING_LINK_MODE"] = local_staging_link_mode
 
     args.func(args)
 
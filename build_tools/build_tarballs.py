@@ -9,13 +9,28 @@ For each GPU family in --dist-amdgpu-families, this script:
 2. Flattens them into a single install-prefix-like layout
 3. Compresses the result into a tarball
 
+The generic (host) artifacts are the bulk of every tarball and are the same
+for all families, so they are flattened only once. Each family's tree starts
+as reflinks/hardlinks of that generic layer (see `os_util.link_tree`), and
+only the family-specific artifacts are then fetched into it. Family fetches
+run concurrently (--fetch-workers), except for families that share GPU
+targets, which would download the same artifacts.
+
 When KPACK_SPLIT_ARTIFACTS is enabled in the build manifest, device-specific
 files are split by individual GPU target and don't conflict across families.
 In that case, this script also produces a combined multi-arch tarball
-containing all targets in a single install prefix.
+containing all targets in a single install prefix. That tree is assembled
+from links to the generic layer and the family trees (see
+`tree_dedup.merge_trees`) rather than fetched and flattened again.
+
+To do so, every file of the family trees is hashed (files linked from the
+generic layer only once), and a report of the bytes the families share vs
+add on their own is logged. ``--dedup-report FILE`` also writes it as JSON,
+and computes it without KPACK split too.
 
-A shared download cache avoids re-downloading generic (host) artifacts
-when processing multiple families.
+A shared download cache avoids re-downloading artifacts needed by several
+trees (e.g. the -tests variant of a family), and the run's artifact index is
+read once and shared by all fetches instead of each fetch listing the run.
 
 By default, generated tarballs exclude test artifacts and fftw3. Pass
 ``--include-test-tarballs`` to also generate full tarballs, named with a
@@ -25,6 +40,25 @@ Tarball naming follows the existing release convention:
     therock-dist-{platform}-{family}-{version}.tar.gz
     therock-dist-{platform}-multiarch-{version}.tar.gz  (KPACK split only)
 
+With ``--zstd``, each tarball is also produced as ``.tar.zst``. Tarballs are
+compressed concurrently (``--compress-workers``), with the compression
+threads (``--compress-threads``) split between them.
+
+Tarballs are reproducible: entries are sorted, owned by root and have their
+mtimes clamped to ``$SOURCE_DATE_EPOCH``, or if unset to the time of the
+commit the artifacts were built from, so the same artifacts always produce
+byte-identical tarballs.
+
+With ``--image=squashfs`` or ``--image=erofs``, all trees are additionally
+packed into one compressed filesystem image (built with ``mksquashfs`` or
+``mkfs.erofs``), with a top-level directory per tarball:
+    therock-dist-{platform}-{version}.squashfs
+        gfx94X-dcgpu/  gfx110X-all/  multiarch/  ...
+The image can be loop-mounted (or mounted with ``squashfuse``/``erofsfuse``)
+and used in place, without extracting it first. Files that are the same in
+several trees (most of them, as they come from the generic layer) are stored
+once, and reads of them share the page cache.
+
 Example
 -------
     python build_tools/build_tarballs.py \\
@@ -52,15 +86,39 @@ files (e.g. ``lib/hipblaslt/library/*.co``) only for the target family.
 """
 
 import argparse
-from concurrent.futures import ProcessPoolExecutor, as_completed
+from concurrent.futures import ProcessPoolExecutor, ThreadPoolExecutor, as_completed
+from datetime import datetime
 import json
+import os
 import shlex
+import shutil
 import subprocess
 import sys
+import time
 from pathlib import Path
 
+from _therock_utils.archive_util import open_compressed_for_write
+from _therock_utils.cmake_amdgpu_targets import amdgpu_family_map, expand_families
+from _therock_utils.git_objects import commit_time, git_dir_of, has_commit
+from _therock_utils.os_util import link_tree
+from _therock_utils.reproducible_tar import source_date_epoch
+from _therock_utils.tree_dedup import DedupReport, TreeIndex, index_trees, merge_trees
+
 DEFAULT_EXCLUDED_ARTIFACTS: list[str] = ["fftw3"]
 DEFAULT_EXCLUDED_COMPONENTS: list[str] = ["test"]
+DEFAULT_FETCH_WORKERS = 4
+# zstd level for the optional .tar.zst tarballs: a better ratio than gzip -6
+# at a comparable speed per thread.
+ZSTD_TARBALL_LEVEL = 9
+TAR_READ_SIZE = 1024 * 1024
+# Name of the generic layer directory in each work directory.
+GENERIC_LAYER_DIR = "_generic"
+# Tool building each --image format.
+IMAGE_TOOLS = {"squashfs": "mksquashfs", "erofs": "mkfs.erofs"}
+# Compressed block size of squashfs images. Larger blocks compress better, at
+# the cost of reading more for small random reads.
+SQUASHFS_BLOCK_SIZE = "1M"
+THEROCK_DIR = Path(__file__).resolve().parent.parent
 
 
 def log(msg: str) -> None:
@@ -80,12 +138,20 @@ def fetch_and_flatten(
     platform: str,
     output_dir: Path,
     download_cache_dir: Path,
+    run_index_file: Path | None = None,
     run_github_repo: str | None = None,
     exclude_components: list[str] | None = None,
     exclude_artifacts: list[str] | None = None,
+    generic_only: bool = False,
+    skip_generic: bool = False,
 ) -> None:
-    """Fetch artifacts for one or more families and flatten into output_dir."""
-    families_str = ";".join(amdgpu_families)
+    """Fetch artifacts for one or more families and flatten into output_dir.
+
+    With `generic_only`, only the generic (host) artifacts are fetched (and
+    `amdgpu_families` is ignored). With `skip_generic`, only the
+    family-specific ones are.
+    """
+    families_str = "generic" if generic_only else ";".join(amdgpu_families)
     log(f"\n{'='*60}")
     log(f"Fetching artifacts for {families_str}")
     if exclude_components:
@@ -100,13 +166,22 @@ def fetch_and_flatten(
         "fetch",
         f"--run-id={run_id}",
         "--stage=all",
-        f"--amdgpu-families={families_str}",
+    ]
+    if generic_only:
+        cmd.append("--generic-only")
+    else:
+        cmd.append(f"--amdgpu-families={families_str}")
+    if skip_generic:
+        cmd.append("--skip-generic")
+    cmd += [
         "--expand-family-to-targets",
         f"--platform={platform}",
         f"--output-dir={output_dir}",
         "--flatten",
         f"--download-cache-dir={download_cache_dir}",
     ]
+    if run_index_file:
+        cmd.append(f"--run-index-file={run_index_file}")
     if exclude_components:
         cmd.append(f"--exclude-components={','.join(exclude_components)}")
     if exclude_artifacts:
@@ -116,31 +191,353 @@ def fetch_and_flatten(
     run_command(cmd)
 
 
+def fetch_family_layer(*, generic_dir: Path, output_dir: Path, **fetch_kwargs) -> None:
+    """Links the flattened generic layer into output_dir, then fetches and
+    flattens the family-specific artifacts on top of it.
+
+    Flattening replaces files rather than writing into them, so files a family
+    overrides never write through a link into the generic layer.
+    """
+    if output_dir.exists():
+        shutil.rmtree(output_dir)
+    counts = link_tree(generic_dir, output_dir)
+    summary = ", ".join(f"{count} {method}" for method, count in sorted(counts.items()))
+    log(f"Linked generic layer into {output_dir} ({summary or 'empty'})")
+    fetch_and_flatten(output_dir=output_dir, skip_generic=True, **fetch_kwargs)
+
+
+def group_overlapping_families(families: list[str]) -> list[list[str]]:
+    """Groups families that share GPU targets, keeping the input order.
+
+    Fetches of overlapping families would download the same artifacts into the
+    shared download cache at the same time, so they must not run concurrently.
+    """
+    family_map = amdgpu_family_map()
+    groups: list[tuple[set[str], list[str]]] = []
+    for family in families:
+        targets = {family, *expand_families([family], family_map, strict=False)}
+        group_families = [family]
+        disjoint_groups = []
+        for group_targets, other_families in groups:
+            if group_targets & targets:
+                targets |= group_targets
+                group_families = other_families + group_families
+            else:
+                disjoint_groups.append((group_targets, other_families))
+        groups = disjoint_groups + [(targets, group_families)]
+    return sorted(
+        (sorted(group, key=families.index) for _, group in groups),
+        key=lambda group: families.index(group[0]),
+    )
+
+
+def _run_in_sequence(fetches: list[dict]) -> None:
+    for fetch_kwargs in fetches:
+        fetch_family_layer(**fetch_kwargs)
+
+
+def index_family_trees(
+    *, generic_dir: Path, family_dirs: dict[str, Path], threads: int = 1
+) -> dict[str, TreeIndex]:
+    """Indexes the generic layer (as `GENERIC_LAYER_DIR`) and family trees."""
+    start_time = time.monotonic()
+    indexes = index_trees(
+        {GENERIC_LAYER_DIR: generic_dir, **family_dirs}, threads=threads
+    )
+    log(
+        f"Hashed {len(indexes)} trees under {generic_dir.parent} in "
+        f"{time.monotonic() - start_time:.1f}s"
+    )
+    return indexes
+
+
+def assemble_multiarch_tree(
+    *,
+    generic_dir: Path,
+    family_dirs: dict[str, Path],
+    indexes: dict[str, TreeIndex],
+    output_dir: Path,
+) -> None:
+    """Builds the multi-arch tree from hardlinks to the family trees.
+
+    With KPACK split, families only add files for their own GPU targets, so
+    the multi-arch tree is the generic layer plus what each family tree adds
+    to it. Where two families change the same path differently, the last
+    family wins and the conflict is logged.
+    """
+    if output_dir.exists():
+        shutil.rmtree(output_dir)
+    counts = merge_trees(
+        base_dir=generic_dir,
+        base_index=indexes[GENERIC_LAYER_DIR],
+        overlays={
+            family: (family_dir, indexes[family])
+            for family, family_dir in family_dirs.items()
+        },
+        output_dir=output_dir,
+    )
+    summary = ", ".join(f"{count} {method}" for method, count in sorted(counts.items()))
+    log(
+        f"Assembled {output_dir} from {len(family_dirs)} family trees "
+        f"({summary or 'empty'})"
+    )
+
+
+def build_manifest_path(flatten_dir: Path) -> Path:
+    return flatten_dir / "share" / "therock" / "therock_manifest.json"
+
+
 def is_kpack_split(flatten_dir: Path) -> bool:
     """Check if KPACK_SPLIT_ARTIFACTS is enabled from the build manifest."""
-    manifest_path = flatten_dir / "share" / "therock" / "therock_manifest.json"
+    manifest_path = build_manifest_path(flatten_dir)
     if not manifest_path.exists():
         return False
     manifest = json.loads(manifest_path.read_text())
     return manifest.get("flags", {}).get("KPACK_SPLIT_ARTIFACTS", False)
 
 
-def compress_tarball(*, source_dir: Path, tarball_path: Path) -> None:
-    """Compress a directory into a .tar.gz tarball.
+def default_mtime(flatten_dir: Path, github_repo: str | None = None) -> int:
+    """The time tarballs and images of ``flatten_dir`` clamp mtimes to.
+
+    ``$SOURCE_DATE_EPOCH`` if set, otherwise the time of the TheRock commit
+    the artifacts were built from (``the_rock_commit`` of the tree's build
+    manifest). The time is looked up in the local checkout if it has the
+    commit, else from ``github_repo`` on GitHub. Extracted files carry the
+    time they were fetched, so the mtime must not come from the tree itself.
+    Falls back to 0 if the commit time is unknown.
+    """
+    mtime = source_date_epoch()
+    if mtime is not None:
+        return mtime
+    manifest_path = build_manifest_path(flatten_dir)
+    commit = None
+    if manifest_path.exists():
+        commit = json.loads(manifest_path.read_text()).get("the_rock_commit")
+    if not commit:
+        log("WARNING: No build manifest commit, clamping mtimes to 0")
+        return 0
+    try:
+        git_dir = git_dir_of(THEROCK_DIR)
+        if has_commit(git_dir, commit):
+            return commit_time(git_dir, commit)
+    except (OSError, subprocess.CalledProcessError):
+        pass
+    from github_actions.github_actions_api import GitHubAPIError, gha_send_request
+
+    github_repo = github_repo or os.environ.get("GITHUB_REPOSITORY", "ROCm/TheRock")
+    try:
+        response = gha_send_request(
+            f"https://api.github.com/repos/{github_repo}/commits/{commit}"
+        )
+        date = response["commit"]["committer"]["date"]
+    except (GitHubAPIError, KeyError, TypeError) as e:
+        log(f"WARNING: Time of commit {commit} unknown ({e}), clamping mtimes to 0")
+        return 0
+    return int(datetime.fromisoformat(date.replace("Z", "+00:00")).timestamp())
+
+
+def tar_command(mtime: int) -> list[str]:
+    """GNU ``tar`` writing the current directory reproducibly to stdout.
+
+    Members are sorted, owned by root, have mtimes clamped to ``mtime`` and
+    permissions normalized to 0755 (directories and executables) or 0644.
+    """
+    return [
+        "tar",
+        "cf",
+        "-",
+        "--format=gnu",
+        "--sort=name",
+        "--owner=0",
+        "--group=0",
+        "--numeric-owner",
+        f"--mtime=@{mtime}",
+        "--clamp-mtime",
+        "--mode=u=rwX,go=rX",
+        ".",
+    ]
+
+
+class _TeeWriter:
+    """Writes the same bytes to several streams."""
+
+    def __init__(self, streams):
+        self.streams = streams
+
+    def write(self, b) -> int:
+        for stream in self.streams:
+            stream.write(b)
+        return len(b)
+
+    def close(self):
+        for stream in self.streams:
+            stream.close()
 
-    Uses subprocess ``tar cfz`` rather than Python's ``tarfile`` module
-    (tarfile was significantly slower and produced larger output with default
-    settings — its ``compresslevel`` parameter may help but was not tuned).
 
-    Uses gzip to match the existing release tarball format. Switching to
-    zstd (``tar cf - . | zstd``) would be faster with better compression,
-    but requires downstream consumers to support ``.tar.zst``.
+def compress_tarball(
+    *,
+    source_dir: Path,
+    tarball_path: Path,
+    threads: int = 1,
+    zstd_tarball_path: Path | None = None,
+    mtime: int | None = None,
+) -> None:
+    """Compress a directory into a .tar.gz tarball (and optionally .tar.zst).
+
+    Uses subprocess ``tar cf -`` rather than Python's ``tarfile`` module to
+    archive the directory (tarfile was significantly slower). The tar stream
+    is reproducible (see ``tar_command``) with mtimes clamped to ``mtime``,
+    which defaults to ``default_mtime(source_dir)``, so an unchanged tree
+    always produces byte-identical tarballs. The stream is compressed with up
+    to ``threads`` threads:
+
+    * gzip with ``ParallelGzipWriter`` (pigz-style), to match the existing
+      release tarball format. The output is a standard gzip file.
+    * If ``zstd_tarball_path`` is given, also zstd from the same tar stream,
+      using zstd's worker threads. This is faster with better compression,
+      but requires downstream consumers to support ``.tar.zst``.
     """
-    log(f"\nCompressing {source_dir} -> {tarball_path}")
+    log(f"\nCompressing {source_dir} -> {tarball_path} ({threads} threads)")
     tarball_path.parent.mkdir(parents=True, exist_ok=True)
-    run_command(["tar", "cfz", str(tarball_path), "."], cwd=source_dir)
-    size_mb = tarball_path.stat().st_size / (1024 * 1024)
-    log(f"  Created {tarball_path.name} ({size_mb:.1f} MB)")
+    if mtime is None:
+        mtime = default_mtime(source_dir)
+    start_time = time.monotonic()
+    outputs = [tarball_path]
+    if zstd_tarball_path is not None:
+        outputs.append(zstd_tarball_path)
+    streams = []
+    tar_size = 0
+    try:
+        try:
+            streams.append(open_compressed_for_write(tarball_path, threads=threads))
+            if zstd_tarball_path is not None:
+                streams.append(
+                    open_compressed_for_write(
+                        zstd_tarball_path, ZSTD_TARBALL_LEVEL, threads=threads
+                    )
+                )
+            tee = _TeeWriter(streams)
+            with subprocess.Popen(
+                tar_command(mtime),
+                cwd=str(source_dir),
+                stdin=subprocess.DEVNULL,
+                stdout=subprocess.PIPE,
+            ) as proc:
+                while chunk := proc.stdout.read(TAR_READ_SIZE):
+                    tar_size += len(chunk)
+                    tee.write(chunk)
+            if proc.returncode != 0:
+                raise subprocess.CalledProcessError(proc.returncode, proc.args)
+        finally:
+            _TeeWriter(streams).close()
+    except BaseException:
+        # Closing the streams finishes them as valid (but truncated) files,
+        # which must not be mistaken for complete tarballs.
+        for output in outputs:
+            output.unlink(missing_ok=True)
+        raise
+    seconds = time.monotonic() - start_time
+    tar_mb = tar_size / (1024 * 1024)
+    for output in outputs:
+        size_mb = output.stat().st_size / (1024 * 1024)
+        log(
+            f"  Created {output.name} ({size_mb:.1f} MB from {tar_mb:.1f} MB, "
+            f"{tar_mb / seconds:.1f} MB/s)"
+        )
+
+
+def image_command(
+    image_format: str,
+    source_dir: Path,
+    image_path: Path,
+    *,
+    threads: int = 1,
+    mtime: int = 0,
+) -> list[str | Path]:
+    """The command packing ``source_dir`` into a reproducible image.
+
+    Owners are root, all timestamps are ``mtime`` and extended attributes are
+    dropped, like in the tarballs. Both tools store files with the same
+    contents (and hardlinked files) once.
+    """
+    tool = IMAGE_TOOLS[image_format]
+    if image_format == "squashfs":
+        return [
+            tool,
+            source_dir,
+            image_path,
+            "-noappend",
+            "-quiet",
+            "-comp",
+            "zstd",
+            "-Xcompression-level",
+            str(ZSTD_TARBALL_LEVEL),
+            "-b",
+            SQUASHFS_BLOCK_SIZE,
+            "-all-root",
+            "-no-xattrs",
+            "-mkfs-time",
+            str(mtime),
+            "-all-time",
+            str(mtime),
+            "-processors",
+            str(threads),
+        ]
+    # mkfs.erofs has no thread option in all supported versions; -Ededupe
+    # (erofs-utils 1.7+) also deduplicates compressed data within files.
+    return [
+        tool,
+        "-zlz4hc",
+        "-Ededupe",
+        "--all-root",
+        "-x-1",
+        f"-T{mtime}",
+        "--ignore-mtime",
+        "-U00000000-0000-0000-0000-000000000000",
+        image_path,
+        source_dir,
+    ]
+
+
+def build_image(
+    *,
+    trees: dict[str, Path],
+    image_path: Path,
+    image_format: str,
+    staging_dir: Path,
+    threads: int = 1,
+    mtime: int | None = None,
+) -> None:
+    """Packs ``trees`` (directory name in the image -> tree) into one image.
+
+    The trees are hardlinked into ``staging_dir`` under their names (see
+    ``os_util.link_tree``), which is removed again afterwards. Files shared by
+    several trees are stored once: as the same inode where the trees hardlink
+    the generic layer, otherwise by the tool's duplicate detection.
+    """
+    log(f"\nBuilding {image_format} image {image_path} ({threads} threads)")
+    if mtime is None:
+        mtime = max(default_mtime(tree) for tree in trees.values())
+    start_time = time.monotonic()
+    if staging_dir.exists():
+        shutil.rmtree(staging_dir)
+    try:
+        for name, tree in trees.items():
+            link_tree(tree, staging_dir / name, mode="hardlink")
+        image_path.parent.mkdir(parents=True, exist_ok=True)
+        image_path.unlink(missing_ok=True)
+        run_command(
+            image_command(
+                image_format, staging_dir, image_path, threads=threads, mtime=mtime
+            )
+        )
+    finally:
+        shutil.rmtree(staging_dir, ignore_errors=True)
+    size_mb = image_path.stat().st_size / (1024 * 1024)
+    log(
+        f"  Created {image_path.name} ({size_mb:.1f} MB, {len(trees)} trees, "
+        f"{time.monotonic() - start_time:.1f}s)"
+    )
 
 
 def main(argv: list[str] | None = None) -> None:
@@ -182,6 +579,46 @@ def main(argv: list[str] | None = None) -> None:
         action="store_true",
         help="Also produce -tests tarballs that include test artifacts",
     )
+    parser.add_argument(
+        "--zstd",
+        action="store_true",
+        help="Also produce .tar.zst tarballs next to the .tar.gz tarballs",
+    )
+    parser.add_argument(
+        "--image",
+        choices=sorted(IMAGE_TOOLS),
+        default=None,
+        help="Also pack all trees into one squashfs or erofs image (needs "
+        "mksquashfs or mkfs.erofs)",
+    )
+    parser.add_argument(
+        "--dedup-report",
+        type=Path,
+        default=None,
+        help="Write a JSON report of the bytes shared between family trees "
+        "vs unique to each family",
+    )
+    parser.add_argument(
+        "--compress-workers",
+        type=int,
+        default=None,
+        help="Number of tarballs to compress concurrently "
+        "(default: all of them, up to --compress-threads)",
+    )
+    parser.add_argument(
+        "--compress-threads",
+        type=int,
+        default=os.cpu_count() or 1,
+        help="Total number of compression threads, split across the "
+        "concurrently compressed tarballs (default: number of CPUs)",
+    )
+    parser.add_argument(
+        "--fetch-workers",
+        type=int,
+        default=DEFAULT_FETCH_WORKERS,
+        help="Number of family-specific fetches to run concurrently "
+        f"(default: {DEFAULT_FETCH_WORKERS})",
+    )
     args = parser.parse_args(argv)
     # Normalize empty string to None (workflow inputs default to "")
     args.run_github_repo = args.run_github_repo or None
@@ -189,10 +626,15 @@ def main(argv: list[str] | None = None) -> None:
     families = [f.strip() for f in args.dist_amdgpu_families.split(";") if f.strip()]
     if not families:
         raise ValueError("No GPU families specified")
+    if args.image and not shutil.which(IMAGE_TOOLS[args.image]):
+        parser.error(f"--image={args.image} requires {IMAGE_TOOLS[args.image]}")
 
     work_dir = args.output_dir / ".work"
     download_cache_dir = work_dir / "download-cache"
     download_cache_dir.mkdir(parents=True, exist_ok=True)
+    # Written by the first fetch, read by the others.
+    run_index_file = work_dir / "run_index.json"
+    run_index_file.unlink(missing_ok=True)
 
     log(f"Building tarballs for {len(families)} families: {', '.join(families)}")
     log(f"  Platform: {args.platform}")
@@ -200,101 +642,183 @@ def main(argv: list[str] | None = None) -> None:
     log(f"  Output: {args.output_dir}")
     log(f"  Include test tarballs: {args.include_test_tarballs}")
 
-    # Phase 1: Fetch and flatten sequentially.
-    # Sequential so the shared download cache avoids re-downloading generic
-    # (host) artifacts for each family.
-    family_dirs = []
-    compress_tasks = []
-    for family in families:
-        flatten_dir = work_dir / family
-        fetch_and_flatten(
-            run_id=args.run_id,
-            amdgpu_families=[family],
-            platform=args.platform,
-            output_dir=flatten_dir,
-            download_cache_dir=download_cache_dir,
-            run_github_repo=args.run_github_repo,
-            exclude_components=DEFAULT_EXCLUDED_COMPONENTS,
-            exclude_artifacts=DEFAULT_EXCLUDED_ARTIFACTS,
+    start_time = time.monotonic()
+    common_fetch_kwargs = dict(
+        run_id=args.run_id,
+        platform=args.platform,
+        download_cache_dir=download_cache_dir,
+        run_index_file=run_index_file,
+        run_github_repo=args.run_github_repo,
+    )
+    # (tarball name suffix, work directory, fetch exclusions) per tarball set.
+    variants = [
+        (
+            "",
+            work_dir,
+            dict(
+                exclude_components=DEFAULT_EXCLUDED_COMPONENTS,
+                exclude_artifacts=DEFAULT_EXCLUDED_ARTIFACTS,
+            ),
         )
-        family_dirs.append(flatten_dir)
-        tarball_name = (
-            f"therock-dist-{args.platform}-{family}-{args.package_version}.tar.gz"
+    ]
+    if args.include_test_tarballs:
+        variants.append(("-tests", work_dir / "tests", {}))
+
+    # Phase 1: Fetch and flatten the generic (host) layer once per variant.
+    # The first fetch also writes the run index read by all later fetches.
+    for _, variant_dir, excludes in variants:
+        fetch_and_flatten(
+            amdgpu_families=[],
+            output_dir=variant_dir / GENERIC_LAYER_DIR,
+            generic_only=True,
+            **common_fetch_kwargs,
+            **excludes,
         )
-        compress_tasks.append((flatten_dir, args.output_dir / tarball_name))
-        if args.include_test_tarballs:
-            tests_dir = work_dir / "tests" / family
-            fetch_and_flatten(
-                run_id=args.run_id,
-                amdgpu_families=[family],
-                platform=args.platform,
-                output_dir=tests_dir,
-                download_cache_dir=download_cache_dir,
-                run_github_repo=args.run_github_repo,
-            )
-            tests_tarball_name = (
-                f"therock-dist-{args.platform}-{family}-tests-"
-                f"{args.package_version}.tar.gz"
-            )
-            compress_tasks.append((tests_dir, args.output_dir / tests_tarball_name))
 
-    # Phase 1.5: If KPACK_SPLIT_ARTIFACTS is enabled, fetch all families
-    # into a single combined directory. With KPACK split, device-specific
-    # files are per individual GPU target and don't conflict, so all
-    # families can coexist in a single install prefix.
-    kpack_split = is_kpack_split(family_dirs[0])
+    # Phase 2: Link the generic layer into a tree per family and fetch the
+    # family-specific artifacts into it. Families run concurrently; fetches
+    # that share artifacts (the variants of a family, overlapping families)
+    # run in sequence so they don't download the same files at once.
+    compress_tasks = []
+    # Directory name in the image -> tree, for --image.
+    image_trees: dict[str, Path] = {}
+    fetch_sequences = []
+    for group in group_overlapping_families(families):
+        fetches = []
+        for family in group:
+            for suffix, variant_dir, excludes in variants:
+                flatten_dir = variant_dir / family
+                fetches.append(
+                    dict(
+                        generic_dir=variant_dir / GENERIC_LAYER_DIR,
+                        output_dir=flatten_dir,
+                        amdgpu_families=[family],
+                        **common_fetch_kwargs,
+                        **excludes,
+                    )
+                )
+                tarball_name = (
+                    f"therock-dist-{args.platform}-{family}{suffix}-"
+                    f"{args.package_version}.tar.gz"
+                )
+                compress_tasks.append((flatten_dir, args.output_dir / tarball_name))
+                image_trees[f"{family}{suffix}"] = flatten_dir
+        fetch_sequences.append(fetches)
+    log(
+        f"\nFetching {len(families)} families in {len(fetch_sequences)} "
+        f"concurrent sequences..."
+    )
+    with ThreadPoolExecutor(max_workers=args.fetch_workers) as executor:
+        futures = [
+            executor.submit(_run_in_sequence, fetches) for fetches in fetch_sequences
+        ]
+        for future in as_completed(futures):
+            future.result()  # Raises on failure
+
+    # Phase 2.5: If KPACK_SPLIT_ARTIFACTS is enabled, combine all families
+    # into a single directory. With KPACK split, device-specific files are
+    # per individual GPU target and don't conflict, so all families can
+    # coexist in a single install prefix. It is assembled from the family
+    # trees, using content hashes of all their files, which also give the
+    # dedup report.
+    kpack_split = is_kpack_split(work_dir / GENERIC_LAYER_DIR)
     if kpack_split:
         log("::: KPACK_SPLIT_ARTIFACTS detected — building multi-arch tarball")
-        multiarch_dir = work_dir / "multiarch"
-        fetch_and_flatten(
-            run_id=args.run_id,
-            amdgpu_families=families,
-            platform=args.platform,
-            output_dir=multiarch_dir,
-            download_cache_dir=download_cache_dir,
-            run_github_repo=args.run_github_repo,
-            exclude_components=DEFAULT_EXCLUDED_COMPONENTS,
-            exclude_artifacts=DEFAULT_EXCLUDED_ARTIFACTS,
-        )
-        tarball_name = (
-            f"therock-dist-{args.platform}-multiarch-{args.package_version}.tar.gz"
-        )
-        compress_tasks.append((multiarch_dir, args.output_dir / tarball_name))
-        if args.include_test_tarballs:
-            tests_multiarch_dir = work_dir / "tests" / "multiarch"
-            fetch_and_flatten(
-                run_id=args.run_id,
-                amdgpu_families=families,
-                platform=args.platform,
-                output_dir=tests_multiarch_dir,
-                download_cache_dir=download_cache_dir,
-                run_github_repo=args.run_github_repo,
-            )
-            tests_tarball_name = (
-                f"therock-dist-{args.platform}-multiarch-tests-"
-                f"{args.package_version}.tar.gz"
+    dedup_reports = {}
+    if kpack_split or args.dedup_report:
+        for suffix, variant_dir, _ in variants:
+            generic_dir = variant_dir / GENERIC_LAYER_DIR
+            family_dirs = {family: variant_dir / family for family in families}
+            indexes = index_family_trees(
+                generic_dir=generic_dir,
+                family_dirs=family_dirs,
+                threads=args.compress_threads,
             )
-            compress_tasks.append(
-                (tests_multiarch_dir, args.output_dir / tests_tarball_name)
+            report = DedupReport.from_indexes(
+                {family: indexes[family] for family in families}
             )
-
-    # Phase 2: Compress all tarballs in parallel.
-    # Each tar cfz is single-threaded, so running N families concurrently
-    # on a multi-core runner scales well with minimal per-job slowdown.
-    # TODO: Add --compress-workers flag to cap concurrency on smaller runners.
-    log(f"\nCompressing {len(compress_tasks)} tarballs in parallel...")
-    with ProcessPoolExecutor(max_workers=len(compress_tasks)) as executor:
+            variant_name = suffix.lstrip("-") or "default"
+            dedup_reports[variant_name] = report.to_json()
+            log(f"\nShared vs family-unique bytes ({variant_name} trees):")
+            for line in report.format():
+                log(f"  {line}")
+            if kpack_split:
+                multiarch_dir = variant_dir / "multiarch"
+                assemble_multiarch_tree(
+                    generic_dir=generic_dir,
+                    family_dirs=family_dirs,
+                    indexes=indexes,
+                    output_dir=multiarch_dir,
+                )
+                tarball_name = (
+                    f"therock-dist-{args.platform}-multiarch{suffix}-"
+                    f"{args.package_version}.tar.gz"
+                )
+                compress_tasks.append((multiarch_dir, args.output_dir / tarball_name))
+                image_trees[f"multiarch{suffix}"] = multiarch_dir
+    if args.dedup_report:
+        args.dedup_report.parent.mkdir(parents=True, exist_ok=True)
+        args.dedup_report.write_text(json.dumps(dedup_reports, indent=2) + "\n")
+    fetch_seconds = time.monotonic() - start_time
+
+    # Phase 3: Compress all tarballs in parallel. The thread budget is split
+    # across the tarballs compressed at the same time. All outputs share the
+    # time of the commit the artifacts were built from.
+    mtime = default_mtime(work_dir / GENERIC_LAYER_DIR, args.run_github_repo)
+    compress_workers = args.compress_workers or max(
+        1, min(len(compress_tasks), args.compress_threads)
+    )
+    threads_per_tarball = max(1, args.compress_threads // compress_workers)
+    log(
+        f"\nCompressing {len(compress_tasks)} tarballs, {compress_workers} at a "
+        f"time with {threads_per_tarball} threads each..."
+    )
+    with ProcessPoolExecutor(max_workers=compress_workers) as executor:
         futures = {
-            executor.submit(compress_tarball, source_dir=src, tarball_path=dst): dst
+            executor.submit(
+                compress_tarball,
+                source_dir=src,
+                tarball_path=dst,
+                threads=threads_per_tarball,
+                mtime=mtime,
+                zstd_tarball_path=(
+                    dst.with_name(dst.name.removesuffix(".gz") + ".zst")
+                    if args.zstd
+                    else None
+                ),
+            ): dst
             for src, dst in compress_tasks
         }
         for future in as_completed(futures):
             future.result()  # Raises on failure
 
+    if args.image:
+        build_image(
+            trees=image_trees,
+            image_path=args.output_dir
+            / f"therock-dist-{args.platform}-{args.package_version}.{args.image}",
+            image_format=args.image,
+            staging_dir=work_dir / "image",
+            threads=args.compress_threads,
+            mtime=mtime,
+        )
+
     log(f"\nDone. Tarballs in {args.output_dir}:")
-    for tb in sorted(args.output_dir.glob("*.tar.gz")):
+    tarballs = [
+        *args.output_dir.glob("*.tar.gz"),
+        *args.output_dir.glob("*.tar.zst"),
+    ]
+    if args.image:
+        tarballs += args.output_dir.glob(f"*.{args.image}")
+    for tb in sorted(tarballs):
         size_mb = tb.stat().st_size / (1024 * 1024)
         log(f"  {tb.name} ({size_mb:.1f} MB)")
+    total_seconds = time.monotonic() - start_time
+    log(
+        f"Built {len(compress_tasks)} tarballs for {len(families)} families in "
+        f"{total_seconds:.1f}s (fetch {fetch_seconds:.1f}s, "
+        f"compress {total_seconds - fetch_seconds:.1f}s)"
+    )
 
 
 if __name__ == "__main__":
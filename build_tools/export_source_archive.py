@@ -38,6 +38,16 @@ There are several special files and locations in export archives:
 These files are standard locations and the build system may be hard-wired to incorporate
 them in preference to other mechanisms of obtaining this information.
 
+Archives are reproducible: members are sorted, owned by root and have their mtime set
+to `$SOURCE_DATE_EPOCH` (defaulting to the exported commit time), so exporting the same
+commit always produces byte-identical archives.
+
+By default, files are read from the worktree, which requires all submodules to be
+checked out. With `--revision`, the given commit is instead exported straight from the
+git object stores of the super-project and its submodules (found in `.git/modules` or
+the bare mirrors of `setup_git_mirrors.py`, see `--mirror-dir`), producing the same
+archive without checking anything out.
+
 While not yet implemented, in the future, the cache of downloaded build deps will be
 stored in the `.build_dep_cache/` with file names keyed by a `BUILD_DEP_ID` in the build
 system. The build system will automatically use these if available.
@@ -45,39 +55,45 @@ system. The build system will automatically use these if available.
 
 from abc import ABC, abstractmethod
 import argparse
+import functools
+import os
 from pathlib import Path
 import subprocess
 import sys
-import tarfile
-import tempfile
 
+from _therock_utils.archive_util import open_compressed_for_write
+from _therock_utils.git_mirrors import MIRROR_DIR_ENV
+from _therock_utils.git_objects import (
+    BlobReader,
+    GitTreeEntry,
+    commit_time,
+    git_dir_of,
+    list_tree_recursive,
+    resolve_commit,
+)
 from _therock_utils.pattern_match import PatternMatcher
+from _therock_utils.reproducible_tar import ReproducibleTarWriter, source_date_epoch
 
 REPO_DIR = Path(__file__).resolve().parent.parent
 
 
 class ArchiveWriter(ABC):
     @staticmethod
-    def create(p: Path, compresslevel: int):
-        name = p.name
-        if name.endswith(".tar"):
-            return TarArchiveWriter(
-                tarfile.open(p, mode="w", compresslevel=compresslevel)
-            )
-        elif name.endswith(".tar.gz") or name.endswith(".tgz"):
-            return TarArchiveWriter(
-                tarfile.open(p, mode="w:gz", compresslevel=compresslevel)
+    def create(
+        p: Path,
+        compresslevel: int,
+        mtime: int,
+        threads: int | None = None,
+        read_threads: int = 1,
+    ):
+        return TarArchiveWriter(
+            ReproducibleTarWriter(
+                open_compressed_for_write(p, compresslevel, threads=threads),
+                mtime=mtime,
+                clamp_mtime=False,
+                read_threads=read_threads,
             )
-        elif name.endswith(".tar.bz2"):
-            return TarArchiveWriter(
-                tarfile.open(p, mode="w:bz2", compresslevel=compresslevel)
-            )
-        elif name.endswith(".tar.xz"):
-            return TarArchiveWriter(
-                tarfile.open(p, mode="w:xz", compresslevel=compresslevel)
-            )
-        else:
-            raise ValueError(f"Unsupported archive file extension for: {name}")
+        )
 
     @abstractmethod
     def close(self): ...
@@ -91,44 +107,101 @@ class ArchiveWriter(ABC):
     @abstractmethod
     def add_text(self, text: str, arcname: str): ...
 
+    @abstractmethod
+    def add_git_entries(self, entries: list[GitTreeEntry]): ...
+
 
 class TarArchiveWriter(ArchiveWriter):
-    def __init__(self, archive: tarfile.TarFile):
+    """Writes a reproducible tar archive (see `ReproducibleTarWriter`).
+
+    Files are only collected as they are added. `close()` writes the archive,
+    reading files ahead on several threads and compressing on several threads.
+    Git blobs are streamed from one `git cat-file --batch` per object store.
+    """
+
+    def __init__(self, archive: ReproducibleTarWriter):
         self.archive = archive
+        self.blob_readers: list[BlobReader] = []
 
     def close(self):
-        self.archive.close()
+        try:
+            self.archive.close(
+                progress=lambda names: progress_iter(names, desc="Writing archive")
+            )
+        finally:
+            for reader in self.blob_readers:
+                reader.close()
 
     def add_file(self, path: Path, arcname: str):
-        self.archive.add(str(path), arcname, recursive=False)
+        self.archive.add_file(path, arcname)
 
     def add_directory(self, path: Path, arcname: str):
-        self.archive.add(str(path), arcname, recursive=True)
+        self.archive.add_tree(path, arcname)
 
     def add_text(self, text: str, arcname: str):
-        with tempfile.NamedTemporaryFile(mode="wt") as tf:
-            tf.write(text)
-            self.archive.add(Path(tf.name), arcname)
+        self.archive.add_text(text, arcname)
+
+    def add_git_entries(self, entries: list[GitTreeEntry]):
+        # The archive writes members sorted by name, so blobs are requested
+        # from each object store in that order.
+        entries = sorted(entries, key=lambda e: e.path)
+        symlinks = [e for e in entries if e.is_symlink]
+        files = [e for e in entries if not e.is_symlink and not e.is_gitlink]
+        # Symlink targets are needed before writing starts.
+        for git_dir, group in _group_by_git_dir(symlinks).items():
+            reader = BlobReader(git_dir, [e.oid for e in group])
+            try:
+                for e in group:
+                    target = reader.read_blob(e.oid).decode()
+                    self.archive.add_symlink(target, e.path)
+            finally:
+                reader.close()
+        for git_dir, group in _group_by_git_dir(files).items():
+            reader = BlobReader(git_dir, [e.oid for e in group])
+            self.blob_readers.append(reader)
+            for e in group:
+                self.archive.add_stream(
+                    e.path,
+                    e.size,
+                    functools.partial(reader.open_blob, e.oid),
+                    executable=e.is_executable,
+                )
+        for e in entries:
+            if e.is_gitlink:
+                # Submodules that are not exported, like `git ls-files` lists them.
+                self.archive.add_empty_directory(e.path)
+
+
+def _group_by_git_dir(
+    entries: list[GitTreeEntry],
+) -> dict[Path, list[GitTreeEntry]]:
+    groups: dict[Path, list[GitTreeEntry]] = {}
+    for e in entries:
+        groups.setdefault(e.git_dir, []).append(e)
+    return groups
 
 
 def git_ls_files(repo_dir: Path, recurse_submodules: bool = False):
     cl = ["git", "ls-files"]
     if recurse_submodules:
         cl += ["--recurse-submodules"]
-    cl += [str(repo_dir)]
-    lines = subprocess.check_output(cl).decode()
+    lines = subprocess.check_output(cl, cwd=str(repo_dir)).decode()
     return lines.splitlines()
 
 
 def git_head_revision(repo_dir: Path) -> str:
     cl = ["git", "rev-parse", "HEAD"]
-    return subprocess.check_output(cl).decode().strip()
+    return subprocess.check_output(cl, cwd=str(repo_dir)).decode().strip()
 
 
 def git_origin(repo_dir: Path) -> str:
     cl = ["git", "remote", "get-url", "origin"]
     try:
-        return subprocess.check_output(cl).decode().strip()
+        return (
+            subprocess.check_output(cl, cwd=str(repo_dir), stderr=subprocess.DEVNULL)
+            .decode()
+            .strip()
+        )
     except subprocess.CalledProcessError:
         # It is legal for there to be no origin.
         return ""
@@ -148,10 +221,26 @@ def progress_iter(iterable, desc: str | None):
 
 
 def create_archive(
-    writer: ArchiveWriter, source_dir: Path, prebuilt_artifacts_dir: Path | None
+    writer: ArchiveWriter,
+    source_dir: Path,
+    prebuilt_artifacts_dir: Path | None,
+    *,
+    revision: str | None = None,
+    mirror_dir: Path | None = None,
 ):
+    """Adds the sources (and prebuilt artifacts) to `writer`.
+
+    By default, files are read from the worktree at `source_dir`. If
+    `revision` is given, that commit is exported straight from the git object
+    store of `source_dir` (which may be a bare repository) instead, with
+    submodules read from `.git/modules` or the mirrors in `mirror_dir`.
+    """
     # Write some metadata.
-    head_revision = git_head_revision(source_dir)
+    if revision is None:
+        head_revision = git_head_revision(source_dir)
+    else:
+        git_dir = git_dir_of(source_dir)
+        head_revision = resolve_commit(git_dir, revision)
     origin = git_origin(source_dir)
     writer.add_text(head_revision, "GIT_REVISION")
     writer.add_text(origin, "GIT_ORIGIN")
@@ -164,20 +253,27 @@ def create_archive(
 
     # Get the source files. If generating a pre-built archive, we do not
     # recurse submodules. Otherwise, we do.
-    source_files = git_ls_files(
-        source_dir, recurse_submodules=prebuilt_artifacts_dir is None
-    )
-    for source_file in progress_iter(source_files, desc="Adding source files"):
-        source_abs_path = source_dir / source_file
-        writer.add_file(source_abs_path, source_file)
+    recurse_submodules = prebuilt_artifacts_dir is None
+    if revision is None:
+        source_files = git_ls_files(source_dir, recurse_submodules=recurse_submodules)
+        for source_file in source_files:
+            source_abs_path = source_dir / source_file
+            writer.add_file(source_abs_path, source_file)
+    else:
+        writer.add_git_entries(
+            list_tree_recursive(
+                git_dir,
+                head_revision,
+                recurse_submodules=recurse_submodules,
+                mirror_dir=mirror_dir,
+            )
+        )
 
     if prebuilt_artifacts_dir:
         pm = PatternMatcher()
         pm.add_basedir(prebuilt_artifacts_dir)
         artifact_files = list(pm.matches())
-        for relpath, direntry in progress_iter(
-            artifact_files, desc="Adding prebuilt files"
-        ):
+        for relpath, direntry in artifact_files:
             # We canonically organize source tarballs to have artifacts in
             # build/artifacts, no matter where they came from.
             writer.add_file(Path(direntry.path), f"build/artifacts/{relpath}")
@@ -197,14 +293,55 @@ def main(argv: list[str]):
         type=Path,
         help="If specified, creates a tarball which contains pre-built artifacts vs sources (prebuilt)",
     )
+    p.add_argument(
+        "--revision",
+        help="Export this commit from the git object store instead of the worktree "
+        "(--source-dir may then be a bare repository)",
+    )
+    p.add_argument(
+        "--mirror-dir",
+        type=Path,
+        default=os.environ.get(MIRROR_DIR_ENV),
+        help="With --revision, also look up submodule commits in the bare mirrors "
+        f"maintained by setup_git_mirrors.py (default: ${MIRROR_DIR_ENV})",
+    )
     p.add_argument("-o", "--output", type=Path, required=True, help="Output tarball")
     p.add_argument(
         "--compress-level", type=int, default=4, help="Tar compression level"
     )
+    p.add_argument(
+        "--threads",
+        type=int,
+        default=os.cpu_count(),
+        help="Threads used to compress the archive (default: all CPUs)",
+    )
+    p.add_argument(
+        "--read-threads",
+        type=int,
+        default=1,
+        help="Threads reading small files ahead of the archive writer "
+        "(default: 1, read sequentially)",
+    )
     args = p.parse_args(argv)
-    writer = ArchiveWriter.create(args.output, compresslevel=args.compress_level)
+    mtime = source_date_epoch()
+    if mtime is None:
+        git_dir = git_dir_of(args.source_dir)
+        mtime = commit_time(git_dir, resolve_commit(git_dir, args.revision or "HEAD"))
+    writer = ArchiveWriter.create(
+        args.output,
+        compresslevel=args.compress_level,
+        mtime=mtime,
+        threads=args.threads,
+        read_threads=args.read_threads,
+    )
     try:
-        create_archive(writer, args.source_dir, args.prebuilt_artifacts)
+        create_archive(
+            writer,
+            args.source_dir,
+            args.prebuilt_artifacts,
+            revision=args.revision,
+            mirror_dir=args.mirror_dir,
+        )
     finally:
         writer.close()
 
@@ -49,8 +49,14 @@ from _therock_utils.artifacts import (
     ArtifactName,
     ArtifactPopulator,
 )
+from _therock_utils.content_store import ContentStore
 from _therock_utils.workflow_outputs import WorkflowOutputRoot
-from artifact_manager import DownloadRequest, download_artifact
+from artifact_manager import (
+    DownloadRequest,
+    download_artifact,
+    download_index_file,
+    lazy_mount,
+)
 
 
 # TODO(geomin12): switch out logging library
@@ -213,6 +219,14 @@ def extract_artifact(
         archive_file.unlink()
 
 
+def download(request: DownloadRequest, *, index_file: bool) -> Path | None:
+    """Downloads an artifact and, with `index_file`, its file index sidecar."""
+    path = download_artifact(request)
+    if path is not None and index_file:
+        download_index_file(request)
+    return path
+
+
 def run(args):
     run_github_repo = args.run_github_repo
     run_id = args.run_id
@@ -255,10 +269,14 @@ def run(args):
         log(f"Filtering artifacts for {run_id} resulted in an empty set. Exiting...")
         sys.exit(1)
 
+    # With --lazy-mount the output dir becomes the (read-only) mount point.
+    download_dir = (
+        args.content_store_dir / "downloads" if args.lazy_mount else output_dir
+    )
     download_requests = [
         DownloadRequest(
             artifact_key=artifact,
-            dest_path=output_dir / artifact,
+            dest_path=download_dir / artifact,
             backend=backend,
         )
         for artifact in sorted(filtered_artifacts)
@@ -273,6 +291,15 @@ def run(args):
         log("Skipping downloads since --dry-run was set")
         return
 
+    if args.lazy_mount:
+        lazy_mount(
+            download_requests,
+            ContentStore(args.content_store_dir),
+            output_dir,
+            args.download_concurrency,
+        )
+        return
+
     output_dir.mkdir(parents=True, exist_ok=True)
 
     # Download and extract in parallel.
@@ -280,7 +307,7 @@ def run(args):
         max_workers=args.download_concurrency
     ) as download_executor:
         download_futures = [
-            download_executor.submit(download_artifact, req)
+            download_executor.submit(download, req, index_file=args.index_files)
             for req in download_requests
         ]
 
@@ -380,6 +407,13 @@ def main(argv):
         action=argparse.BooleanOptionalAction,
     )
 
+    parser.add_argument(
+        "--index-files",
+        default=False,
+        action="store_true",
+        help="Also download each artifact's per-file index sidecar ({archive}.index.json), where the run has one",
+    )
+
     postprocess_group = parser.add_argument_group("Postprocessing")
     postprocess_p = postprocess_group.add_mutually_exclusive_group()
     postprocess_p.add_argument(
@@ -400,6 +434,21 @@ def main(argv):
         action="store_true",
         help="Flattens artifacts after fetching them",
     )
+    postprocess_p.add_argument(
+        "--lazy-mount",
+        default=False,
+        action="store_true",
+        help="Instead of flattening, mount OUTPUT_DIR as a read-only view of the "
+        "flattened artifacts and serve it until unmounted. Only file indexes "
+        "are downloaded up front; an archive is fetched into the content store "
+        "when one of its files is first opened (see artifact_manager.py fetch "
+        "--lazy-mount). Requires --content-store-dir",
+    )
+    postprocess_group.add_argument(
+        "--content-store-dir",
+        type=Path,
+        help="Content store that --lazy-mount fetches archives and their files into",
+    )
     postprocess_group.add_argument(
         "--delete-after-extract",
         default=True,
@@ -409,6 +458,9 @@ def main(argv):
 
     args = parser.parse_args(argv)
 
+    if args.lazy_mount and args.content_store_dir is None:
+        parser.error("--lazy-mount requires --content-store-dir")
+
     run(args)
 
 
@@ -21,8 +21,21 @@ import argparse
 from pathlib import Path
 import sys
 
-from _therock_utils.archive_util import open_archive_for_write
-from _therock_utils.artifacts import ArtifactPopulator
+from _therock_utils.archive_util import (
+    DEFAULT_XZ_FRAME_SIZE,
+    DEFAULT_ZSTD_DICT_MAX_SAMPLE_SIZE,
+    DEFAULT_ZSTD_DICT_SIZE,
+    DEFAULT_ZSTD_FRAME_SIZE,
+    ZSTD_DICT_MODES,
+    open_archive_for_write,
+    train_zstd_dict,
+)
+from _therock_utils.artifacts import (
+    ArtifactContents,
+    ArtifactPopulator,
+    write_artifact_archive,
+)
+from _therock_utils.content_store import ArtifactFileIndex, delta_files
 import _therock_utils.artifact_builder as artifact_builder
 from _therock_utils.hash_util import calculate_hash, write_hash
 from _therock_utils.os_util import rmtree_with_retry
@@ -78,40 +91,92 @@ def do_artifact(args):
         contents.write_artifact(output_dir)
 
 
+def _iter_artifact_entries(artifact_path: Path):
+    """Yields (arcname, dir_entry) for every entry of an artifact directory."""
+    manifest_path: Path = artifact_path / "artifact_manifest.txt"
+    relpaths = manifest_path.read_text().splitlines()
+    for relpath in relpaths:
+        if not relpath:
+            continue
+        source_dir = artifact_path / relpath
+        if not source_dir.exists():
+            continue
+        pm = PatternMatcher()
+        pm.add_basedir(source_dir)
+        for subpath, dir_entry in pm.all.items():
+            yield f"{relpath}/{subpath}", dir_entry
+
+
 def do_artifact_archive(args):
     output_path: Path = args.o
-    if output_path.exists():
-        output_path.unlink()
-    output_path.parent.mkdir(parents=True, exist_ok=True)
-
-    with open_archive_for_write(
-        output_path, args.compression_type, args.compression_level
-    ) as arc:
-        for artifact_path in args.artifact:
-            manifest_path: Path = artifact_path / "artifact_manifest.txt"
-            relpaths = manifest_path.read_text().splitlines()
-            # Important: The manifest must be stored first.
-            arc.add(manifest_path, arcname=manifest_path.name, recursive=False)
-            for relpath in relpaths:
-                if not relpath:
-                    continue
-                source_dir = artifact_path / relpath
-                if not source_dir.exists():
-                    continue
-                pm = PatternMatcher()
-                pm.add_basedir(source_dir)
-                for subpath, dir_entry in pm.all.items():
-                    fullpath = f"{relpath}/{subpath}"
-                    arc.add(dir_entry.path, arcname=fullpath, recursive=False)
+    write_artifact_archive(
+        ArtifactContents.scan(args.artifact),
+        output_path,
+        args.compression_type,
+        args.compression_level,
+        zstd_dict_path=args.zstd_dict,
+        zstd_dict_mode=args.zstd_dict_mode,
+        frame_size=args.frame_size or None,
+        index_path=args.index_file,
+    )
 
     if args.hash_file:
         digest = calculate_hash(output_path, args.hash_algorithm)
         write_hash(args.hash_file, digest)
 
 
+def do_artifact_delta_archive(args):
+    """Archives the files of an artifact whose contents are not in a base index.
+
+    The artifact's own index (from `artifact-archive --index-file`) maps member
+    names to contents; member names are paths relative to the artifact dir.
+    """
+    index = ArtifactFileIndex.load(args.index)
+    base_index = ArtifactFileIndex.load(args.base_index)
+    entries = delta_files(index, base_index)
+    output_path: Path = args.o
+    output_path.parent.mkdir(parents=True, exist_ok=True)
+    with open_archive_for_write(output_path, "zstd", args.compression_level) as arc:
+        for entry in entries:
+            arc.add(args.artifact / entry.path, arcname=entry.path, recursive=False)
+    delta_size = sum(e.size for e in entries)
+    print(
+        f"Delta of {len(entries)}/{len(index.files)} files "
+        f"({delta_size}/{index.total_file_size} bytes) -> {output_path}"
+    )
+
+
+def do_artifact_zstd_dict(args):
+    """Trains a zstd dictionary from the files of one or more artifact dirs.
+
+    Artifacts from the same family (i.e. the same name and component across
+    target families or CI runs) share most of their structure, so a dictionary
+    trained on one build can be used to compress the next.
+    """
+    sample_paths = [
+        Path(dir_entry.path)
+        for artifact_path in args.artifact
+        for _, dir_entry in _iter_artifact_entries(artifact_path)
+        if dir_entry.is_file(follow_symlinks=False)
+    ]
+    dict_content = train_zstd_dict(
+        sample_paths, args.dict_size, max_sample_size=args.max_sample_size
+    )
+    output_path: Path = args.o
+    output_path.parent.mkdir(parents=True, exist_ok=True)
+    output_path.write_bytes(dict_content)
+    print(
+        f"Trained {len(dict_content)} byte zstd dictionary from "
+        f"{len(sample_paths)} candidate files -> {output_path}"
+    )
+
+
 def _do_artifact_flatten(args):
     flattener = ArtifactPopulator(
-        output_path=args.o, verbose=args.verbose, flatten=True
+        output_path=args.o,
+        verbose=args.verbose,
+        flatten=True,
+        zstd_dict_dirs=args.zstd_dict_dir,
     )
     flattener(*args.artifact)
     relpaths = list(flattener.relpaths)
@@ -254,6 +319,28 @@ def main(cl_args: list[str]):
         default=None,
         help="Compression level (default: 3 for zstd, 6 for xz)",
     )
+    artifact_archive_p.add_argument(
+        "--zstd-dict",
+        type=Path,
+        help="Compress against this trained zstd dictionary (zstd only)",
+    )
+    artifact_archive_p.add_argument(
+        "--zstd-dict-mode",
+        choices=ZSTD_DICT_MODES,
+        default="reference",
+        help="Only reference the dictionary by id (readers then need it, e.g. "
+        "artifact_manager.py fetch --zstd-dict-dir) or embed it, which adds its "
+        "size to the archive (default: reference)",
+    )
+    artifact_archive_p.add_argument(
+        "--frame-size",
+        type=int,
+        default=0,
+        help="Uncompressed bytes per independently compressed frame, so that "
+        "readers can decompress in parallel, e.g. "
+        f"{DEFAULT_ZSTD_FRAME_SIZE} for zstd or {DEFAULT_XZ_FRAME_SIZE} for xz "
+        "(default: 0, a single frame)",
+    )
     artifact_archive_p.add_argument(
         "--hash-file",
         type=Path,
@@ -262,8 +349,68 @@ def main(cl_args: list[str]):
     artifact_archive_p.add_argument(
         "--hash-algorithm", default="sha256", help="Hash algorithm"
     )
+    artifact_archive_p.add_argument(
+        "--index-file",
+        type=Path,
+        help="Per-file index (JSON) to write for content-addressed fetching",
+    )
     artifact_archive_p.set_defaults(func=do_artifact_archive)
 
+    # 'artifact-delta-archive' command
+    artifact_delta_archive_p = sub_p.add_parser(
+        "artifact-delta-archive",
+        help="Creates a zstd archive of the files of an artifact directory whose "
+        "contents are not in a base artifact index",
+    )
+    artifact_delta_archive_p.add_argument(
+        "artifact", type=Path, help="Artifact directory"
+    )
+    artifact_delta_archive_p.add_argument(
+        "--index",
+        type=Path,
+        required=True,
+        help="Index of the artifact (from artifact-archive --index-file)",
+    )
+    artifact_delta_archive_p.add_argument(
+        "--base-index", type=Path, required=True, help="Index of the base artifact"
+    )
+    artifact_delta_archive_p.add_argument(
+        "-o", type=Path, required=True, help="Output archive name"
+    )
+    artifact_delta_archive_p.add_argument(
+        "--compression-level",
+        type=int,
+        default=None,
+        help="Zstd compression level (default: 3)",
+    )
+    artifact_delta_archive_p.set_defaults(func=do_artifact_delta_archive)
+
+    # 'artifact-zstd-dict' command
+    artifact_zstd_dict_p = sub_p.add_parser(
+        "artifact-zstd-dict",
+        help="Trains a zstd dictionary from one or more artifact directories",
+    )
+    artifact_zstd_dict_p.add_argument(
+        "artifact", nargs="+", type=Path, help="Artifact directory"
+    )
+    artifact_zstd_dict_p.add_argument(
+        "-o", type=Path, required=True, help="Output dictionary file (.zdict)"
+    )
+    artifact_zstd_dict_p.add_argument(
+        "--dict-size",
+        type=int,
+        default=DEFAULT_ZSTD_DICT_SIZE,
+        help=f"Maximum dictionary size in bytes (default: {DEFAULT_ZSTD_DICT_SIZE})",
+    )
+    artifact_zstd_dict_p.add_argument(
+        "--max-sample-size",
+        type=int,
+        default=DEFAULT_ZSTD_DICT_MAX_SAMPLE_SIZE,
+        help="Skip files larger than this many bytes when sampling "
+        f"(default: {DEFAULT_ZSTD_DICT_MAX_SAMPLE_SIZE})",
+    )
+    artifact_zstd_dict_p.set_defaults(func=do_artifact_zstd_dict)
+
     # 'artifact-flatten' command
     artifact_flatten_p = sub_p.add_parser(
         "artifact-flatten",
@@ -278,6 +425,14 @@ def main(cl_args: list[str]):
     artifact_flatten_p.add_argument(
         "--verbose", action="store_true", help="Print verbose status"
     )
+    artifact_flatten_p.add_argument(
+        "--zstd-dict-dir",
+        type=Path,
+        action="append",
+        default=[],
+        help="Directory of trained zstd dictionaries for archives that "
+        "reference their dictionary (may be repeated)",
+    )
     artifact_flatten_p.set_defaults(func=_do_artifact_flatten)
 
     # 'artifact-flatten-split' command
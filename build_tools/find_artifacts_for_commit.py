@@ -27,17 +27,25 @@ For script-to-script composition:
 
 import argparse
 from dataclasses import dataclass
+from pathlib import Path
 import platform as platform_module
 import sys
 import urllib.request
 import urllib.error
 
+from _therock_utils.artifact_backend import S3Backend
+from _therock_utils.build_topology import BuildTopology
+from _therock_utils.cmake_amdgpu_targets import amdgpu_family_map, expand_families
+from _therock_utils.run_index import RunIndexFragmentName, list_run_index_fragments
 from _therock_utils.workflow_outputs import WorkflowOutputRoot
 from github_actions.github_actions_api import (
     GitHubAPIError,
     gha_query_workflow_runs_for_commit,
 )
 
+THIS_SCRIPT_DIR = Path(__file__).resolve().parent
+THEROCK_DIR = THIS_SCRIPT_DIR.parent
+
 
 # TODO: wrap `ArtifactBackend` (or `S3Backend`) class here? Or use `BucketMetadata`?
 #       (we have a few classes tracking similar metadata and reimplementing URL schemes)
@@ -97,17 +105,49 @@ class ArtifactRunInfo:
         print(f"  S3 Index:            {self.s3_index_url}")
 
 
+def _run_index_fragments(info: ArtifactRunInfo) -> list[RunIndexFragmentName] | None:
+    """Returns the names of the run's index fragments (one per push so far).
+
+    Only the names of the run index fragments are listed (see
+    `_therock_utils/run_index.py`). Returns None if the run has no index or
+    it could not be listed.
+    """
+    backend = S3Backend(
+        WorkflowOutputRoot(
+            bucket=info.s3_bucket,
+            external_repo=info.external_repo,
+            run_id=info.workflow_run_id,
+            platform=info.platform,
+        )
+    )
+    try:
+        fragments = list_run_index_fragments(backend)
+    except Exception:
+        return None
+    return fragments or None
+
+
+def _per_arch_stages() -> set[str]:
+    """Returns the build stages that are pushed once per target family.
+
+    Read from this checkout's BUILD_TOPOLOGY.toml, which is assumed to match
+    the topology of the run.
+    """
+    topology = BuildTopology(str(THEROCK_DIR / "BUILD_TOPOLOGY.toml"))
+    return {
+        stage.name for stage in topology.get_build_stages() if stage.type == "per-arch"
+    }
+
+
 def check_if_artifacts_exist(info: ArtifactRunInfo) -> bool:
     """Checks if artifacts exist at the expected S3 location.
 
-    Performs an HTTP HEAD request to the S3 index URL to verify artifacts
-    have been uploaded. Note that this does not guarantee that all artifacts
-    exist. Artifacts could be partially uploaded.
-
-    TODO(scotttodd): plumb through a list of artifact keys to check for, then
-       use `ArtifactBackend::artifact_exists(artifact_key)`. With multi-arch CI
-       workflows and server-side indexing of artifacts, this method returns
-       `True` even if only early build stages have completed so far.
+    If the run publishes a run index, checks that every per-arch build stage
+    has been pushed for the requested group (or for its gfx targets), so a
+    multi-arch run where the group has only completed early build stages is
+    not reported. Otherwise performs an HTTP HEAD request to the S3 index URL
+    to verify artifacts have been uploaded. Note that this does not guarantee
+    that all artifacts exist. Artifacts could be partially uploaded.
 
     Args:
         info: ArtifactRunInfo with the S3 location to check
@@ -115,6 +155,22 @@ def check_if_artifacts_exist(info: ArtifactRunInfo) -> bool:
     Returns:
         True if artifacts are likely to exist, False otherwise
     """
+    fragments = _run_index_fragments(info)
+    if fragments is not None:
+        group = info.artifact_group
+        family_map = amdgpu_family_map()
+        families = {group}
+        if group in family_map:
+            families.update(expand_families([group], family_map, strict=False))
+        pushed_stages = {
+            f.stage for f in fragments if families & set(f.target_families)
+        }
+        if pushed_stages or group in family_map:
+            if "all" in pushed_stages:
+                return True
+            return bool(pushed_stages) and _per_arch_stages() <= pushed_stages
+        # Unknown group (e.g. a variant like "gfx950-dcgpu-asan"): fall back.
+
     try:
         request = urllib.request.Request(info.s3_index_url, method="HEAD")
         with urllib.request.urlopen(request, timeout=10) as response:
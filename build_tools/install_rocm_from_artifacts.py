@@ -85,6 +85,16 @@ Examples:
         --tests \
         --run-github-repo ROCm/rocm-libraries
     ```
+- Mounts the artifacts of CI workflow run 14474448215 read-only at `therock-build`,
+  fetching each artifact the first time one of its files is opened (unmount
+  with `fusermount -u therock-build`):
+    ```
+    python build_tools/install_rocm_from_artifacts.py \
+        --run-id 14474448215 \
+        --amdgpu-family gfx94X-dcgpu \
+        --lazy-mount \
+        --content-store-dir ~/.therock/content_store &
+    ```
 - Downloads and unpacks the latest nightly release for gfx110X:
     ```
     python build_tools/install_rocm_from_artifacts.py \
@@ -124,7 +134,13 @@ from botocore import UNSIGNED
 from botocore.config import Config
 from datetime import datetime
 from fetch_artifacts import main as fetch_artifacts_main
+from _therock_utils.archive_util import (
+    open_archive_for_read,
+    open_archive_stream_for_read,
+)
 from _therock_utils.cmake_amdgpu_targets import amdgpu_family_map, expand_families
+from _therock_utils.content_store import INDEX_SUFFIX, ArtifactFileIndex
+from _therock_utils.install_manifest import PrefixUpgrade
 from pathlib import Path
 import platform
 import re
@@ -132,6 +148,7 @@ import shutil
 import subprocess
 import sys
 import tarfile
+import time
 from typing import Optional
 
 PLATFORM = platform.system().lower()
@@ -292,20 +309,114 @@ def _create_output_directory(output_dir: Path):
     log(f"Created output directory '{output_dir.resolve()}'")
 
 
+def _upgrade_download_dir(output_dir: Path) -> Path:
+    """
+    Where archives are downloaded to when upgrading (outside of the output_dir)
+    """
+    return output_dir.parent / f".{output_dir.name}.download"
+
+
+def _upgrade_from_archives(output_dir: Path, archives, *, artifact: bool):
+    """
+    Upgrades the output_dir in place to the contents of the archives (open tar
+    files, each paired with its file index or None), only writing changed files.
+    See `PrefixUpgrade`.
+    """
+    with PrefixUpgrade(output_dir) as upgrade:
+        for tf, index in archives:
+            upgrade.add_archive(tf, artifact=artifact, index=index)
+        upgrade.commit()
+    log(f"Upgraded {str(output_dir)}: {upgrade.stats.summary()}")
+
+
+def _upgrade_from_artifact_archives(output_dir: Path, download_dir: Path):
+    archive_paths = sorted(
+        p for p in download_dir.iterdir() if p.name.endswith((".tar.xz", ".tar.zst"))
+    )
+
+    def load_index(archive_path: Path) -> Optional[ArtifactFileIndex]:
+        index_path = Path(f"{archive_path}{INDEX_SUFFIX}")
+        if not index_path.exists():
+            return None
+        try:
+            return ArtifactFileIndex.load(index_path)
+        except Exception as e:
+            log(f"++ Ignoring file index of '{archive_path.name}': {e}")
+            return None
+
+    def open_archives():
+        for archive_path in archive_paths:
+            log(f"++ Installing '{archive_path.name}'")
+            index = load_index(archive_path)
+            with open_archive_for_read(archive_path) as tf:
+                yield tf, index
+
+    _upgrade_from_archives(output_dir, open_archives(), artifact=True)
+    shutil.rmtree(download_dir)
+
+
+STREAM_EXTRACT_ATTEMPTS = 3
+
+
+def _stream_extract_s3_asset(
+    release_bucket, asset_name, output_dir: Path, upgrade: bool = False
+):
+    """
+    Extracts the asset to the output_dir while it downloads, without writing the
+    tarball to disk. Downloading, decompressing and extracting overlap.
+    """
+    for attempt in range(1, STREAM_EXTRACT_ATTEMPTS + 1):
+        log(f"Streaming {asset_name} into {str(output_dir)}")
+        try:
+            body = s3_client.get_object(Bucket=release_bucket, Key=asset_name)["Body"]
+            with open_archive_stream_for_read(body, asset_name) as tf:
+                if upgrade:
+                    _upgrade_from_archives(output_dir, [(tf, None)], artifact=False)
+                else:
+                    tf.extractall(output_dir)
+            return
+        except Exception as e:
+            if attempt == STREAM_EXTRACT_ATTEMPTS:
+                raise
+            # Files extracted so far are overwritten by the next attempt.
+            log(f"Streaming {asset_name} failed ({e}), retrying")
+            time.sleep(attempt)
+
+
 def _retrieve_s3_release_assets(
-    release_bucket, artifact_group, release_version, output_dir
+    release_bucket,
+    artifact_group,
+    release_version,
+    output_dir,
+    stream_extract=True,
+    upgrade=False,
 ):
     """
     Makes an API call to retrieve the release's assets, then retrieves the asset matching the amdgpu family
     """
     asset_name = f"therock-dist-{PLATFORM}-{artifact_group}-{release_version}.tar.gz"
-    destination = output_dir / asset_name
+    start = time.monotonic()
+
+    if stream_extract:
+        _stream_extract_s3_asset(release_bucket, asset_name, output_dir, upgrade)
+    elif upgrade:
+        download_dir = _upgrade_download_dir(output_dir)
+        download_dir.mkdir(parents=True, exist_ok=True)
+        destination = download_dir / asset_name
+        with open(destination, "wb") as f:
+            s3_client.download_fileobj(release_bucket, asset_name, f)
+        with tarfile.open(destination) as tf:
+            _upgrade_from_archives(output_dir, [(tf, None)], artifact=False)
+        shutil.rmtree(download_dir)
+    else:
+        destination = output_dir / asset_name
+        with open(destination, "wb") as f:
+            s3_client.download_fileobj(release_bucket, asset_name, f)
 
-    with open(destination, "wb") as f:
-        s3_client.download_fileobj(release_bucket, asset_name, f)
+        # After downloading the asset, untar-ing the file
+        _untar_files(output_dir, destination)
 
-    # After downloading the asset, untar-ing the file
-    _untar_files(output_dir, destination)
+    log(f"Installed {asset_name} in {time.monotonic() - start:.1f}s")
 
 
 def retrieve_artifacts_by_run_id(args):
@@ -319,10 +430,28 @@ def retrieve_artifacts_by_run_id(args):
         run_id,
         "--artifact-group",
         args.artifact_group,
-        "--output-dir",
-        str(args.output_dir),
-        "--flatten",
     ]
+    if args.upgrade:
+        # Download the archives next to the output_dir, then upgrade it from them.
+        download_dir = _upgrade_download_dir(args.output_dir)
+        if download_dir.exists() and not args.dry_run:
+            shutil.rmtree(download_dir)
+        argv.extend(
+            ["--output-dir", str(download_dir), "--no-extract", "--index-files"]
+        )
+    elif args.lazy_mount:
+        # Serves the output_dir until unmounted, fetching artifacts on first access.
+        argv.extend(
+            [
+                "--output-dir",
+                str(args.output_dir),
+                "--lazy-mount",
+                "--content-store-dir",
+                str(args.content_store_dir),
+            ]
+        )
+    else:
+        argv.extend(["--output-dir", str(args.output_dir), "--flatten"])
     if args.amdgpu_targets:
         argv.extend(["--amdgpu-targets", args.amdgpu_targets])
     else:
@@ -539,6 +668,8 @@ def retrieve_artifacts_by_run_id(args):
 
     log(f"\nCalling fetch_artifacts_main with args:\n  {' '.join(argv)}\n")
     fetch_artifacts_main(argv)
+    if args.upgrade and not args.dry_run:
+        _upgrade_from_artifact_archives(args.output_dir, download_dir)
 
     log(f"Retrieved artifacts for run ID {run_id}")
 
@@ -581,7 +712,12 @@ def retrieve_artifacts_by_release(args):
         return
 
     _retrieve_s3_release_assets(
-        release_bucket, artifact_group, release_version, output_dir
+        release_bucket,
+        artifact_group,
+        release_version,
+        output_dir,
+        stream_extract=args.stream_extract,
+        upgrade=args.upgrade,
     )
 
 
@@ -646,6 +782,8 @@ def retrieve_artifacts_by_latest_release(args):
         artifact_group=args.artifact_group,
         release_version=version,
         output_dir=args.output_dir,
+        stream_extract=args.stream_extract,
+        upgrade=args.upgrade,
     )
 
 
@@ -653,7 +791,9 @@ def run(args):
     log("### Installing TheRock using artifacts ###")
 
     # Skip directory creation for dry-run
-    if not args.dry_run:
+    if args.upgrade:
+        log(f"Upgrading '{args.output_dir.resolve()}' in place")
+    elif not args.dry_run:
         _create_output_directory(args.output_dir)
 
     if args.run_id:
@@ -712,6 +852,31 @@ def main(argv):
         help="Show what would be downloaded/copied without actually doing it",
     )
 
+    parser.add_argument(
+        "--stream-extract",
+        action=argparse.BooleanOptionalAction,
+        default=True,
+        help="Extract release tarballs while they download instead of saving them first (default: enabled)",
+    )
+
+    parser.add_argument(
+        "--upgrade",
+        action="store_true",
+        help="Upgrade an existing output directory in place, only writing files that changed (not supported with --input-dir)",
+    )
+
+    parser.add_argument(
+        "--lazy-mount",
+        action="store_true",
+        help="With --run-id, mount the output directory as a read-only view of the artifacts instead of extracting them, and serve it until unmounted (run in the background). Artifacts are fetched into --content-store-dir when one of their files is first opened. Requires FUSE and requirements-lazy-mount.txt",
+    )
+
+    parser.add_argument(
+        "--content-store-dir",
+        type=Path,
+        help="Content store for --lazy-mount",
+    )
+
     artifacts_group = parser.add_argument_group("artifacts_group")
     artifacts_group.add_argument(
         "--aqlprofile",
@@ -948,6 +1113,15 @@ def main(argv):
 
     args = parser.parse_args(argv)
 
+    if args.upgrade and args.input_dir:
+        parser.error("--upgrade is not supported with --input-dir")
+    if args.lazy_mount and (not args.run_id or args.upgrade):
+        parser.error(
+            "--lazy-mount requires --run-id and is not supported with --upgrade"
+        )
+    if args.lazy_mount and args.content_store_dir is None:
+        parser.error("--lazy-mount requires --content-store-dir")
+
     if not args.artifact_group:
         raise argparse.ArgumentTypeError(
             "Either --amdgpu-family or --artifact-group must be specified"
@@ -0,0 +1,177 @@
+# Copyright Advanced Micro Devices, Inc.
+# SPDX-License-Identifier: MIT
+
+import os
+from pathlib import Path
+import sys
+import threading
+import unittest
+
+sys.path.insert(0, os.fspath(Path(__file__).parent.parent))
+
+from botocore.exceptions import ClientError, ReadTimeoutError
+
+from _therock_utils.adaptive_concurrency import (
+    AdaptiveConcurrency,
+    is_throttling_error,
+)
+
+
+class _Clock:
+    def __init__(self):
+        self.now = 0.0
+
+    def __call__(self) -> float:
+        return self.now
+
+
+class AdaptiveConcurrencyTest(unittest.TestCase):
+    def setUp(self):
+        self.clock = _Clock()
+        self.changes = []
+
+    def _make(self, initial=4, maximum=64) -> AdaptiveConcurrency:
+        return AdaptiveConcurrency(
+            initial,
+            maximum,
+            window_seconds=1.0,
+            on_change=self.changes.append,
+            clock=self.clock,
+        )
+
+    def _window(self, concurrency: AdaptiveConcurrency, throughput: float):
+        """Reports `throughput` bytes per second over one window."""
+        self.clock.now += 1.0
+        concurrency.record(int(throughput))
+
+    def test_doubles_while_throughput_improves(self):
+        c = self._make()
+        c.record(0)
+        for throughput in [100, 200, 400]:
+            self._window(c, throughput)
+        self.assertEqual(self.changes, [8, 16, 32])
+
+    def test_reverts_increase_that_hurt_and_holds(self):
+        c = self._make()
+        c.record(0)
+        self._window(c, 100)  # 4 -> 8
+        self._window(c, 80)  # Worse: back to 4
+        self.assertEqual(c.limit, 4)
+        self._window(c, 80)  # Baseline at the reduced limit
+        self._window(c, 80)  # Plateau
+        self.assertEqual(self.changes, [8, 4])
+
+    def test_additive_increase_after_slow_start(self):
+        c = self._make()
+        c.record(0)
+        self._window(c, 100)  # 4 -> 8
+        self._window(c, 105)  # Plateau, slow start ends
+        self._window(c, 150)  # Improves: 8 -> 9
+        self.assertEqual(self.changes, [8, 9])
+
+    def test_collapse_halves_limit(self):
+        c = self._make(initial=16)
+        c.record(0)
+        self._window(c, 100)  # 16 -> 32
+        self._window(c, 20)  # Collapse: 32 -> 16
+        self.assertEqual(self.changes, [32, 16])
+
+    def test_throttling_halves_limit_once_per_window(self):
+        c = self._make(initial=16)
+        throttled = ClientError({"Error": {"Code": "SlowDown"}}, "PutObject")
+        c.record_error(throttled)
+        c.record_error(throttled)
+        self.assertEqual(self.changes, [8])
+        self.assertEqual(c.throttles, 2)
+        self.clock.now += 2.0
+        c.record_error(throttled)
+        self.assertEqual(self.changes, [8, 4])
+        c.record_error(ValueError("not throttling"))
+        self.assertEqual(c.throttles, 3)
+
+    def test_stays_within_bounds(self):
+        c = self._make(initial=4, maximum=6)
+        c.record(0)
+        for throughput in [100, 200, 400]:
+            self._window(c, throughput)
+        self.assertEqual(c.limit, 6)
+        throttled = ClientError({"Error": {"Code": "SlowDown"}}, "PutObject")
+        for _ in range(5):
+            self.clock.now += 2.0
+            c.record_error(throttled)
+        self.assertEqual(c.limit, 1)
+
+    def test_unadapted_bytes_only_count_in_summary(self):
+        c = self._make()
+        c.record(0)
+        for throughput in [100, 200, 400]:
+            self.clock.now += 1.0
+            c.record(throughput, adapt=False)
+        self.assertEqual(self.changes, [])
+        self.assertEqual(c.total_bytes, 700)
+
+    def test_fixed_limit(self):
+        c = self._make(initial=4, maximum=4)
+        c.record(0)
+        self._window(c, 100)
+        c.record_error(ClientError({"Error": {"Code": "SlowDown"}}, "PutObject"))
+        self.assertEqual(self.changes, [])
+        self.assertEqual(c.limit, 4)
+
+    def test_slot_blocks_at_limit(self):
+        c = self._make(initial=1, maximum=1)
+        entered = threading.Event()
+
+        def take_slot():
+            with c.slot():
+                entered.set()
+
+        with c.slot():
+            thread = threading.Thread(target=take_slot)
+            thread.start()
+            self.assertFalse(entered.wait(0.05))
+        self.assertTrue(entered.wait(5))
+        thread.join()
+
+    def test_summary(self):
+        c = self._make()
+        c.record(0)
+        self._window(c, 1024 * 1024)
+        self._window(c, 3 * 1024 * 1024)
+        self.assertEqual(
+            c.summary(),
+            "4.0 MiB in 2.0s (2.0 MiB/s), concurrency 4 -> 16 (peak 16)",
+        )
+
+
+class IsThrottlingErrorTest(unittest.TestCase):
+    def test_error_codes_and_status(self):
+        self.assertTrue(
+            is_throttling_error(ClientError({"Error": {"Code": "SlowDown"}}, "Get"))
+        )
+        self.assertTrue(
+            is_throttling_error(
+                ClientError(
+                    {"Error": {}, "ResponseMetadata": {"HTTPStatusCode": 503}}, "Get"
+                )
+            )
+        )
+        self.assertFalse(
+            is_throttling_error(ClientError({"Error": {"Code": "NoSuchKey"}}, "Get"))
+        )
+
+    def test_timeouts_and_causes(self):
+        timeout = ReadTimeoutError(endpoint_url="https://example.com")
+        self.assertTrue(is_throttling_error(timeout))
+        try:
+            try:
+                raise timeout
+            except Exception as e:
+                raise RuntimeError("upload failed") from e
+        except RuntimeError as wrapped:
+            self.assertTrue(is_throttling_error(wrapped))
+        self.assertFalse(is_throttling_error(IOError("disk full")))
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -2,15 +2,36 @@
 # Copyright Advanced Micro Devices, Inc.
 # SPDX-License-Identifier: MIT
 
+import gzip
+import io
 import os
 import platform
+import random
+import subprocess
+import shutil
+import struct
+import tarfile
 import tempfile
 import unittest
+from unittest import mock
 from pathlib import Path
+import zlib
 
+from _therock_utils import archive_util
 from _therock_utils.archive_util import (
+    ZSTD_DICT_FRAME_MAGIC,
+    ZSTD_DICT_FRAME_TAG,
+    ZSTD_DICT_REFERENCE,
+    ParallelGzipWriter,
+    _PrefetchBudget,
+    _ReadAheadReader,
+    _scan_xz_blocks,
+    _scan_zstd_frames,
     open_archive_for_read,
     open_archive_for_write,
+    open_archive_stream_for_read,
+    read_zstd_dict_frame,
+    train_zstd_dict,
 )
 
 IS_WINDOWS = platform.system() == "Windows"
@@ -59,6 +80,442 @@ class ArchiveRoundtripTest(unittest.TestCase):
                 self.assertIn("hello.txt", arc.getnames())
 
 
+class _NonSeekableReader:
+    """Minimal read-only stream, like an HTTP response body."""
+
+    def __init__(self, data: bytes, chunk_size: int = 1000):
+        self._data = data
+        self._pos = 0
+        self._chunk_size = chunk_size
+        self.closed = False
+
+    def read(self, size: int = -1) -> bytes:
+        # Return short reads, as network streams do.
+        if size < 0 or size > self._chunk_size:
+            size = self._chunk_size
+        data = self._data[self._pos : self._pos + size]
+        self._pos += len(data)
+        return data
+
+    def close(self):
+        self.closed = True
+
+
+class ArchiveStreamTest(unittest.TestCase):
+    """Test reading archives sequentially from non-seekable streams."""
+
+    def _stream_roundtrip(self, suffix: str, compression_type: str):
+        with tempfile.TemporaryDirectory() as tmp:
+            tmp = Path(tmp)
+            archive = tmp / f"test.tar.{suffix}"
+            with open_archive_for_write(archive, compression_type) as arc:
+                for i in range(20):
+                    src = tmp / f"file_{i}.txt"
+                    src.write_text(f"contents {i}\n" * 1000)
+                    arc.add(str(src), arcname=src.name)
+
+            stream = _NonSeekableReader(archive.read_bytes())
+            with open_archive_stream_for_read(stream, archive.name) as arc:
+                contents = {m.name: arc.extractfile(m).read() for m in arc}
+            self.assertEqual(len(contents), 20)
+            self.assertEqual(contents["file_3.txt"], b"contents 3\n" * 1000)
+            self.assertTrue(stream.closed)
+
+    def test_stream_zstd(self):
+        self._stream_roundtrip("zst", "zstd")
+
+    def test_stream_xz(self):
+        self._stream_roundtrip("xz", "xz")
+
+    def test_stream_gzip(self):
+        with tempfile.TemporaryDirectory() as tmp:
+            tmp = Path(tmp)
+            archive = tmp / "test.tar.gz"
+            with tarfile.open(archive, "w:gz") as arc:
+                for i in range(20):
+                    src = tmp / f"file_{i}.txt"
+                    src.write_text(f"contents {i}\n" * 1000)
+                    arc.add(str(src), arcname=src.name)
+
+            stream = _NonSeekableReader(archive.read_bytes())
+            with open_archive_stream_for_read(stream, archive.name) as arc:
+                contents = {m.name: arc.extractfile(m).read() for m in arc}
+            self.assertEqual(len(contents), 20)
+            self.assertEqual(contents["file_3.txt"], b"contents 3\n" * 1000)
+            self.assertTrue(stream.closed)
+
+    def test_stream_read_error_is_raised(self):
+        class FailingReader(_NonSeekableReader):
+            def read(self, size=-1):
+                if self._pos > 10000:
+                    raise ConnectionResetError("connection reset")
+                return super().read(size)
+
+        with tempfile.TemporaryDirectory() as tmp:
+            archive = Path(tmp) / "test.tar.gz"
+            with tarfile.open(archive, "w:gz") as arc:
+                src = Path(tmp) / "random.bin"
+                src.write_bytes(os.urandom(100000))
+                arc.add(str(src), arcname=src.name)
+            stream = FailingReader(archive.read_bytes())
+            with self.assertRaises(ConnectionResetError):
+                with open_archive_stream_for_read(stream, archive.name) as arc:
+                    for m in arc:
+                        arc.extractfile(m).read()
+            self.assertTrue(stream.closed)
+
+    def test_read_ahead_error_is_raised_on_every_read(self):
+        class FailingReader(_NonSeekableReader):
+            def read(self, size=-1):
+                if self._pos >= 3000:
+                    raise ConnectionResetError("connection reset")
+                return super().read(size)
+
+        reader = io.BufferedReader(
+            _ReadAheadReader(FailingReader(b"x" * 10000), chunk_size=1000)
+        )
+        self.assertEqual(reader.read(3000), b"x" * 3000)
+        for _ in range(2):
+            with self.assertRaises(ConnectionResetError):
+                reader.read(1000)
+        reader.close()
+
+    def test_read_ahead_close_waits_for_reads(self):
+        class TrackingReader(_NonSeekableReader):
+            reading = False
+
+            def read(self, size=-1):
+                if self.closed:
+                    raise ValueError("read after close")
+                self.reading = True
+                try:
+                    return super().read(size)
+                finally:
+                    self.reading = False
+
+        stream = TrackingReader(os.urandom(100000), chunk_size=10)
+        reader = _ReadAheadReader(stream, chunk_size=10, depth=1)
+        reader.read(10)
+        reader.close()
+        self.assertFalse(stream.reading)
+        stream.close()
+        self.assertFalse(reader._thread.is_alive())
+
+    def test_stream_unknown_extension_closes_stream(self):
+        stream = _NonSeekableReader(b"")
+        with self.assertRaises(ValueError):
+            open_archive_stream_for_read(stream, "test.tar.bz2")
+        self.assertTrue(stream.closed)
+
+
+def _write_header_samples(d: Path, count: int = 200) -> list[Path]:
+    """Writes many small, similar text files (like a dev/include tree)."""
+    paths = []
+    for i in range(count):
+        p = d / f"header_{i}.h"
+        p.write_text(
+            f"// Copyright Advanced Micro Devices, Inc.\n"
+            f"#ifndef ROCPRIM_DETAIL_HEADER_{i}_HPP_\n"
+            f"#define ROCPRIM_DETAIL_HEADER_{i}_HPP_\n"
+            f"namespace rocprim {{ namespace detail {{\n"
+            f"template <class T> struct block_helper_{i} {{ T value{i}; }};\n"
+            f"}} }}\n#endif\n"
+        )
+        paths.append(p)
+    return paths
+
+
+class ZstdDictTest(unittest.TestCase):
+    """Test dictionary-compressed zstd archives."""
+
+    def setUp(self):
+        self._tmp = tempfile.TemporaryDirectory()
+        self.tmp = Path(self._tmp.name)
+        self.samples_dir = self.tmp / "samples"
+        self.samples_dir.mkdir()
+        self.samples = _write_header_samples(self.samples_dir)
+        self.dict_dir = self.tmp / "dicts"
+        self.dict_dir.mkdir()
+        self.dict_path = self.dict_dir / "prim_dev.zdict"
+        self.dict_path.write_bytes(train_zstd_dict(self.samples, dict_size=4096))
+
+    def tearDown(self):
+        self._tmp.cleanup()
+
+    def _write(self, archive: Path, mode: str):
+        with open_archive_for_write(
+            archive, "zstd", zstd_dict_path=self.dict_path, zstd_dict_mode=mode
+        ) as arc:
+            for p in self.samples:
+                arc.add(str(p), arcname=p.name)
+
+    def _assert_readable(self, archive: Path, **kwargs):
+        with open_archive_for_read(archive, **kwargs) as arc:
+            member = arc.getmember("header_7.h")
+            self.assertEqual(
+                arc.extractfile(member).read(), self.samples[7].read_bytes()
+            )
+            self.assertEqual(len(arc.getnames()), len(self.samples))
+
+    def test_train_skips_oversized_samples(self):
+        with self.assertRaises(ValueError):
+            train_zstd_dict(self.samples, dict_size=4096, max_sample_size=1)
+
+    def test_embedded_dict_roundtrip(self):
+        archive = self.tmp / "embedded.tar.zst"
+        self._write(archive, "embed")
+        self.assertIsNotNone(read_zstd_dict_frame(archive))
+        self._assert_readable(archive)
+
+    def test_referenced_dict_roundtrip_with_dirs(self):
+        archive = self.tmp / "referenced.tar.zst"
+        self._write(archive, "reference")
+        self._assert_readable(archive, zstd_dict_dirs=[self.dict_dir])
+
+    def test_embedded_dict_stream(self):
+        archive = self.tmp / "embedded.tar.zst"
+        self._write(archive, "embed")
+        stream = _NonSeekableReader(archive.read_bytes())
+        with open_archive_stream_for_read(stream, archive.name) as arc:
+            names = [m.name for m in arc]
+        self.assertEqual(len(names), len(self.samples))
+
+    def test_referenced_dict_missing_raises(self):
+        archive = self.tmp / "referenced.tar.zst"
+        self._write(archive, "reference")
+        with self.assertRaises(FileNotFoundError):
+            open_archive_for_read(archive)
+        with self.assertRaises(FileNotFoundError):
+            open_archive_for_read(archive, zstd_dict_dirs=[self.samples_dir])
+
+    def test_malformed_dict_frame_raises(self):
+        for payload, frame_size in [
+            # Reference with a 2 byte id.
+            (ZSTD_DICT_FRAME_TAG + ZSTD_DICT_REFERENCE + b"\x01\x02", None),
+            # Frame header claiming more payload than the file has.
+            (ZSTD_DICT_FRAME_TAG + ZSTD_DICT_REFERENCE, 100),
+        ]:
+            archive = self.tmp / "malformed.tar.zst"
+            size = len(payload) if frame_size is None else frame_size
+            archive.write_bytes(
+                struct.pack("<II", ZSTD_DICT_FRAME_MAGIC, size) + payload
+            )
+            with self.assertRaisesRegex(IOError, "malformed.tar.zst"):
+                read_zstd_dict_frame(archive, [self.dict_dir])
+            with self.assertRaisesRegex(IOError, "malformed.tar.zst"):
+                open_archive_stream_for_read(
+                    _NonSeekableReader(archive.read_bytes()), archive.name
+                )
+
+    def test_reference_is_default(self):
+        archive = self.tmp / "default.tar.zst"
+        with open_archive_for_write(
+            archive, "zstd", zstd_dict_path=self.dict_path
+        ) as arc:
+            arc.add(str(self.samples[0]), arcname=self.samples[0].name)
+        with open(archive, "rb") as f:
+            header = f.read(8 + len(ZSTD_DICT_FRAME_TAG) + 1)
+        self.assertEqual(header[8:], ZSTD_DICT_FRAME_TAG + ZSTD_DICT_REFERENCE)
+
+    def test_referenced_dict_is_smaller_than_embedded(self):
+        embedded = self.tmp / "embedded.tar.zst"
+        referenced = self.tmp / "referenced.tar.zst"
+        self._write(embedded, "embed")
+        self._write(referenced, "reference")
+        self.assertLess(referenced.stat().st_size, embedded.stat().st_size)
+
+    def test_plain_archive_has_no_dict_frame(self):
+        archive = self.tmp / "plain.tar.zst"
+        with open_archive_for_write(archive, "zstd") as arc:
+            arc.add(str(self.samples[0]), arcname=self.samples[0].name)
+        self.assertIsNone(read_zstd_dict_frame(archive))
+
+    def test_xz_rejects_dict(self):
+        with self.assertRaises(ValueError):
+            open_archive_for_write(
+                self.tmp / "test.tar.xz", "xz", zstd_dict_path=self.dict_path
+            )
+
+
+class MultiFrameTest(unittest.TestCase):
+    """Test multi-frame archives and their parallel decompression."""
+
+    FRAME_SIZE = 64 * 1024
+
+    def setUp(self):
+        self.temp_context = tempfile.TemporaryDirectory()
+        self.temp_dir = Path(self.temp_context.name)
+        rng = random.Random(42)
+        self.contents = {}
+        for i in range(12):
+            # Mix of compressible and incompressible files spanning frames.
+            size = rng.randint(1, 3 * self.FRAME_SIZE)
+            data = rng.randbytes(size // 2) + b"x" * (size - size // 2)
+            self.contents[f"dir/file{i}.bin"] = data
+            src = self.temp_dir / "src" / f"file{i}.bin"
+            src.parent.mkdir(exist_ok=True)
+            src.write_bytes(data)
+
+    def tearDown(self):
+        self.temp_context.cleanup()
+
+    def _write(self, name: str, compression_type: str, **kwargs) -> Path:
+        archive = self.temp_dir / name
+        with open_archive_for_write(
+            archive, compression_type, frame_size=self.FRAME_SIZE, **kwargs
+        ) as arc:
+            for arcname in self.contents:
+                src = self.temp_dir / "src" / Path(arcname).name
+                arc.add(str(src), arcname=arcname)
+        return archive
+
+    def _assert_contents(self, archive: Path, **kwargs):
+        with open_archive_for_read(archive, threads=3, **kwargs) as arc:
+            names = []
+            for member in arc:
+                names.append(member.name)
+                with arc.extractfile(member) as f:
+                    self.assertEqual(f.read(), self.contents[member.name])
+        self.assertEqual(names, list(self.contents))
+
+    def test_zstd_roundtrip(self):
+        archive = self._write("test.tar.zst", "zstd")
+        with open(archive, "rb") as f:
+            frames = _scan_zstd_frames(f.read())
+        self.assertGreater(len(frames), 4)
+        self._assert_contents(archive)
+        # Single-threaded reads use the sequential decoder.
+        with open_archive_for_read(archive, threads=1) as arc:
+            self.assertEqual(arc.getnames(), list(self.contents))
+
+    def test_xz_roundtrip(self):
+        archive = self._write("test.tar.xz", "xz", compression_level=0)
+        with open(archive, "rb") as f:
+            frames = _scan_xz_blocks(f.read())
+        self.assertGreater(len(frames), 4)
+        self._assert_contents(archive)
+
+    def test_zstd_with_dict_roundtrip(self):
+        (self.temp_dir / "samples").mkdir()
+        samples = _write_header_samples(self.temp_dir / "samples")
+        dict_path = self.temp_dir / "test.dict"
+        dict_path.write_bytes(train_zstd_dict(samples, dict_size=4096))
+        archive = self._write(
+            "embedded.tar.zst", "zstd", zstd_dict_path=dict_path, zstd_dict_mode="embed"
+        )
+        self.assertIsNotNone(read_zstd_dict_frame(archive))
+        self._assert_contents(archive)
+
+    def test_prefetch_is_bounded(self):
+        archive = self._write("test.tar.zst", "zstd")
+
+        class PeakBudget(_PrefetchBudget):
+            peak = 0
+
+            def acquire(self, size):
+                super().acquire(size)
+                self.peak = max(self.peak, self.used)
+
+            def try_acquire(self, size):
+                acquired = super().try_acquire(size)
+                self.peak = max(self.peak, self.used)
+                return acquired
+
+        # Room for one frame beyond the one read next, shared by two readers.
+        budget = PeakBudget(self.FRAME_SIZE)
+        with mock.patch.object(archive_util, "_prefetch_budget", budget):
+            with open_archive_for_read(archive, threads=4) as arc1:
+                with open_archive_for_read(archive, threads=4) as arc2:
+                    for member1, member2 in zip(arc1, arc2):
+                        for arc, member in [(arc1, member1), (arc2, member2)]:
+                            with arc.extractfile(member) as f:
+                                self.assertEqual(f.read(), self.contents[member.name])
+        # Each reader may exceed the budget by the frame it reads next.
+        self.assertLessEqual(budget.peak, 3 * self.FRAME_SIZE)
+        self.assertGreater(budget.peak, 0)
+        self.assertEqual(budget.used, 0)
+
+    def test_random_access(self):
+        archive = self._write("test.tar.zst", "zstd")
+        names = list(self.contents)
+        with open_archive_for_read(archive, threads=2) as arc:
+            # Going backwards restarts decompression at the target frame.
+            for name in [names[-1], names[0], names[5], names[2]]:
+                with arc.extractfile(arc.getmember(name)) as f:
+                    self.assertEqual(f.read(), self.contents[name])
+
+    def test_empty_archive(self):
+        for suffix, compression_type in [("zst", "zstd"), ("xz", "xz")]:
+            archive = self.temp_dir / f"empty.tar.{suffix}"
+            with open_archive_for_write(
+                archive, compression_type, frame_size=self.FRAME_SIZE
+            ):
+                pass
+            with open_archive_for_read(archive, threads=2) as arc:
+                self.assertEqual(arc.getnames(), [])
+
+    def test_stream_reads_multi_frame(self):
+        for suffix, compression_type in [("zst", "zstd"), ("xz", "xz")]:
+            archive = self._write(f"test.tar.{suffix}", compression_type)
+            stream = _NonSeekableReader(archive.read_bytes())
+            with open_archive_stream_for_read(stream, archive.name) as arc:
+                for member in arc:
+                    with arc.extractfile(member) as f:
+                        self.assertEqual(f.read(), self.contents[member.name])
+
+    @unittest.skipUnless(shutil.which("xz"), "requires the xz tool")
+    def test_xz_tool_reads_multi_stream(self):
+        archive = self._write("test.tar.xz", "xz", compression_level=0)
+        subprocess.check_call(["xz", "-t", str(archive)])
+
+
+class ParallelGzipTest(unittest.TestCase):
+    def _compress(self, data: bytes, *writes: int, **kwargs) -> bytes:
+        out = io.BytesIO()
+        out.close = lambda: None  # Keep the buffer readable.
+        writer = ParallelGzipWriter(out, **kwargs)
+        pos = 0
+        for size in writes or [len(data)]:
+            writer.write(data[pos : pos + size])
+            pos += size
+        writer.close()
+        return out.getvalue()
+
+    def test_roundtrip_single_member(self):
+        rng = random.Random(42)
+        words = [bytes(rng.randrange(256) for _ in range(8)) for _ in range(500)]
+        data = b"".join(rng.choice(words) for _ in range(100000))
+        compressed = self._compress(
+            data, 1000, 300000, len(data), threads=4, block_size=64 * 1024
+        )
+        self.assertEqual(gzip.decompress(compressed), data)
+        # One gzip member, so that every gunzip reads all of it.
+        decompressor = zlib.decompressobj(31)
+        self.assertEqual(decompressor.decompress(compressed), data)
+        self.assertTrue(decompressor.eof)
+        self.assertEqual(decompressor.unused_data, b"")
+        # Priming each block with the previous one keeps the ratio.
+        self.assertLess(len(compressed), len(gzip.compress(data, 6)) * 1.01)
+
+    def test_deterministic(self):
+        data = os.urandom(100000) * 3
+        self.assertEqual(
+            self._compress(data, threads=1, block_size=32 * 1024),
+            self._compress(data, 7, len(data), threads=3, block_size=32 * 1024),
+        )
+
+    def test_empty(self):
+        self.assertEqual(gzip.decompress(self._compress(b"")), b"")
+
+    @unittest.skipUnless(shutil.which("gzip"), "requires the gzip tool")
+    def test_gzip_tool_reads_output(self):
+        data = os.urandom(50000) * 10
+        with tempfile.TemporaryDirectory() as tmp:
+            path = Path(tmp) / "test.gz"
+            path.write_bytes(self._compress(data, block_size=100000))
+            self.assertEqual(subprocess.check_output(["gzip", "-dc", str(path)]), data)
+
+
 class HandleLeakTest(unittest.TestCase):
     """Verify that closing a ZstdTarFile releases the OS file handle."""
 
@@ -4,6 +4,7 @@
 
 """Unit tests for artifact_backend.py."""
 
+import hashlib
 import os
 import socket
 import sys
@@ -17,12 +18,18 @@ sys.path.insert(0, os.fspath(Path(__file__).parent.parent))
 
 from _therock_utils.artifact_backend import (
     ArtifactBackend,
+    ArtifactStat,
     LocalDirectoryBackend,
     S3Backend,
     create_backend_from_env,
 )
 from _therock_utils.workflow_outputs import WorkflowOutputRoot
 
+try:
+    from moto import mock_aws
+except ImportError:
+    mock_aws = None
+
 
 def _make_local_root(run_id="test-run-123", platform="linux"):
     return WorkflowOutputRoot.for_local(run_id=run_id, platform=platform)
@@ -197,6 +204,28 @@ class TestLocalDirectoryBackend(unittest.TestCase):
         with self.assertRaises(FileNotFoundError):
             self.backend.download_artifact("nonexistent.tar.xz", dest_file)
 
+    def test_open_artifact(self):
+        """Test streaming an artifact from local staging."""
+        (self.backend.base_path / "test.tar.zst").write_bytes(b"archive bytes")
+        with self.backend.open_artifact("test.tar.zst") as f:
+            self.assertEqual(f.read(), b"archive bytes")
+
+    def test_open_nonexistent_artifact(self):
+        with self.assertRaises(FileNotFoundError):
+            self.backend.open_artifact("nonexistent.tar.zst")
+
+    def test_open_artifact_at_offset(self):
+        (self.backend.base_path / "test.tar.zst").write_bytes(b"archive bytes")
+        with self.backend.open_artifact("test.tar.zst", start=8) as f:
+            self.assertEqual(f.read(), b"bytes")
+
+    def test_stat_artifact(self):
+        (self.backend.base_path / "test.tar.zst").write_bytes(b"archive bytes")
+        stat = self.backend.stat_artifact("test.tar.zst")
+        self.assertEqual(stat.size, len(b"archive bytes"))
+        self.assertIsNone(stat.etag)
+        self.assertIsNone(self.backend.stat_artifact("nonexistent.tar.zst"))
+
     def test_upload_nonexistent_source(self):
         """Test that uploading a nonexistent source raises FileNotFoundError."""
         nonexistent = Path(self.temp_dir) / "nonexistent.tar.xz"
@@ -278,6 +307,107 @@ class TestLocalDirectoryBackend(unittest.TestCase):
         with self.assertRaises(FileNotFoundError):
             dest.copy_artifact("nonexistent.tar.zst", source)
 
+    def test_transfers_link_archives_and_copy_sidecars(self):
+        """Archives are hard-linked within a filesystem; sidecars are copied."""
+        backend = LocalDirectoryBackend(
+            staging_dir=Path(self.temp_dir),
+            output_root=self.output_root,
+            link_mode="hardlink",
+        )
+        source = Path(self.temp_dir) / "build" / "test_lib_generic.tar.zst"
+        source.parent.mkdir()
+        source.write_bytes(b"archive")
+        sidecar = Path(f"{source}.sha256sum")
+        sidecar.write_text("abc123  test_lib_generic.tar.zst\n")
+
+        backend.upload_artifact(source, "test_lib_generic.tar.zst")
+        staged = backend.base_path / "test_lib_generic.tar.zst"
+        self.assertTrue(os.path.samefile(source, staged))
+        self.assertFalse(os.path.samefile(sidecar, f"{staged}.sha256sum"))
+
+        dest = Path(self.temp_dir) / "fetch" / "test_lib_generic.tar.zst"
+        backend.download_artifact("test_lib_generic.tar.zst", dest)
+        self.assertTrue(os.path.samefile(staged, dest))
+        self.assertEqual(
+            (dest.parent / "test_lib_generic.tar.zst.sha256sum").read_text(),
+            sidecar.read_text(),
+        )
+
+    def test_reupload_replaces_linked_archive(self):
+        """Replacing a hard-linked archive leaves the other links untouched."""
+        backend = LocalDirectoryBackend(
+            staging_dir=Path(self.temp_dir),
+            output_root=self.output_root,
+            link_mode="hardlink",
+        )
+        source = Path(self.temp_dir) / "v1.tar.zst"
+        source.write_bytes(b"version 1")
+        backend.upload_artifact(source, "test_lib_generic.tar.zst")
+        fetched = Path(self.temp_dir) / "fetched.tar.zst"
+        backend.materialize_artifact("test_lib_generic.tar.zst", fetched)
+
+        source2 = Path(self.temp_dir) / "v2.tar.zst"
+        source2.write_bytes(b"version 2")
+        backend.upload_artifact(source2, "test_lib_generic.tar.zst")
+        self.assertEqual(
+            (backend.base_path / "test_lib_generic.tar.zst").read_bytes(),
+            b"version 2",
+        )
+        self.assertEqual(source.read_bytes(), b"version 1")
+        self.assertEqual(fetched.read_bytes(), b"version 1")
+
+    def test_copy_link_mode(self):
+        backend = LocalDirectoryBackend(
+            staging_dir=Path(self.temp_dir),
+            output_root=self.output_root,
+            link_mode="copy",
+        )
+        source = Path(self.temp_dir) / "test_lib_generic.tar.zst"
+        source.write_bytes(b"archive")
+        backend.upload_artifact(source, "test_lib_generic.tar.zst")
+        staged = backend.base_path / "test_lib_generic.tar.zst"
+        self.assertFalse(os.path.samefile(source, staged))
+        self.assertEqual(staged.read_bytes(), b"archive")
+
+    def test_invalid_link_mode(self):
+        with self.assertRaises(ValueError):
+            LocalDirectoryBackend(
+                staging_dir=Path(self.temp_dir),
+                output_root=self.output_root,
+                link_mode="symlink",
+            )
+
+    def test_listing_cached_until_ttl(self):
+        """Files added behind the backend's back appear once the listing is stale."""
+        (self.backend.base_path / "a_lib_generic.tar.zst").write_bytes(b"a")
+        self.assertEqual(self.backend.list_artifacts(), ["a_lib_generic.tar.zst"])
+
+        (self.backend.base_path / "b_lib_generic.tar.zst").write_bytes(b"bb")
+        self.assertFalse(self.backend.artifact_exists("b_lib_generic.tar.zst"))
+        self.assertIsNone(self.backend.stat_artifact("b_lib_generic.tar.zst"))
+
+        self.backend.listing_ttl_seconds = 0
+        self.assertTrue(self.backend.artifact_exists("b_lib_generic.tar.zst"))
+        self.assertEqual(self.backend.stat_artifact("b_lib_generic.tar.zst").size, 2)
+        self.assertEqual(
+            self.backend.list_artifacts(),
+            ["a_lib_generic.tar.zst", "b_lib_generic.tar.zst"],
+        )
+
+    def test_upload_updates_cached_listing(self):
+        self.assertEqual(self.backend.list_artifacts(), [])
+        source = Path(self.temp_dir) / "src.tar.zst"
+        source.write_bytes(b"abc")
+        Path(f"{source}.sha256sum").write_text("abc  src.tar.zst\n")
+        self.backend.upload_artifact(source, "test_lib_generic.tar.zst")
+        self.assertEqual(self.backend.list_artifacts(), ["test_lib_generic.tar.zst"])
+        self.assertTrue(
+            self.backend.artifact_exists("test_lib_generic.tar.zst.sha256sum")
+        )
+        self.assertEqual(
+            self.backend.stat_artifact("test_lib_generic.tar.zst"), ArtifactStat(size=3)
+        )
+
     def test_copy_artifact_wrong_backend_type_raises(self):
         """Test copy_artifact raises TypeError when source is a different backend type."""
         s3_source = S3Backend(
@@ -352,6 +482,86 @@ class TestS3Backend(unittest.TestCase):
         self.assertEqual(len(artifacts), 1)
         self.assertIn("blas_lib_gfx94X.tar.xz", artifacts)
 
+    @mock.patch.object(S3Backend, "s3_client", new_callable=mock.PropertyMock)
+    def test_list_directory(self, mock_client_prop):
+        """Test listing one subdirectory of the run with a delimiter."""
+        mock_client = mock.MagicMock()
+        mock_client_prop.return_value = mock_client
+        mock_paginator = mock.MagicMock()
+        mock_client.get_paginator.return_value = mock_paginator
+        mock_paginator.paginate.return_value = [
+            {
+                "Contents": [
+                    {
+                        "Key": "external/test-run-456-linux/artifact_index/a.json",
+                        "Size": 12,
+                    },
+                ]
+            }
+        ]
+
+        files = self.backend.list_directory("artifact_index")
+        self.assertEqual(files, {"a.json": ArtifactStat(size=12)})
+        mock_paginator.paginate.assert_called_once_with(
+            Bucket="test-bucket",
+            Prefix="external/test-run-456-linux/artifact_index/",
+            Delimiter="/",
+        )
+
+    @mock.patch.object(S3Backend, "s3_client", new_callable=mock.PropertyMock)
+    def test_queries_answered_from_cached_listing(self, mock_client_prop):
+        """After one listing, exists and stat queries make no requests."""
+        mock_client = mock.MagicMock()
+        mock_client_prop.return_value = mock_client
+        mock_paginator = mock.MagicMock()
+        mock_client.get_paginator.return_value = mock_paginator
+        mock_paginator.paginate.return_value = [
+            {
+                "Contents": [
+                    {
+                        "Key": "external/test-run-456-linux/blas_lib_gfx94X.tar.zst",
+                        "Size": 1234,
+                        "ETag": '"abc"',
+                    },
+                    {
+                        "Key": "external/test-run-456-linux/blas_lib_gfx94X.tar.zst.sha256sum",
+                        "Size": 90,
+                    },
+                ]
+            }
+        ]
+
+        self.assertEqual(
+            self.backend.list_artifact_stats(),
+            {"blas_lib_gfx94X.tar.zst": ArtifactStat(size=1234, etag="abc")},
+        )
+        self.assertTrue(self.backend.artifact_exists("blas_lib_gfx94X.tar.zst"))
+        self.assertTrue(
+            self.backend.artifact_exists("blas_lib_gfx94X.tar.zst.sha256sum")
+        )
+        self.assertFalse(self.backend.artifact_exists("blas_lib_gfx94X.tar.zst.delta"))
+        self.assertEqual(
+            self.backend.stat_artifact("blas_lib_gfx94X.tar.zst").size, 1234
+        )
+        self.assertEqual(self.backend.list_artifacts(), ["blas_lib_gfx94X.tar.zst"])
+        mock_client.head_object.assert_not_called()
+        self.assertEqual(mock_paginator.paginate.call_count, 1)
+
+        # Uploads through the backend are added to the listing.
+        with tempfile.TemporaryDirectory() as temp_dir:
+            source_path = Path(temp_dir) / "fft_lib_generic.tar.zst"
+            source_path.write_bytes(b"12345")
+            self.backend.upload_artifact(source_path, "fft_lib_generic.tar.zst")
+        self.assertEqual(self.backend.stat_artifact("fft_lib_generic.tar.zst").size, 5)
+        mock_client.head_object.assert_not_called()
+
+        # A stale listing is listed again.
+        self.backend.listing_ttl_seconds = 0
+        self.backend.list_artifacts()
+        self.assertEqual(mock_paginator.paginate.call_count, 2)
+        self.backend.artifact_exists("blas_lib_gfx94X.tar.zst")
+        mock_client.head_object.assert_called_once()
+
     @mock.patch.object(S3Backend, "s3_client", new_callable=mock.PropertyMock)
     def test_download_artifact_xz(self, mock_client_prop):
         """Test downloading a .tar.xz artifact from S3."""
@@ -368,6 +578,78 @@ class TestS3Backend(unittest.TestCase):
                 str(dest_path),
             )
 
+    @mock.patch.object(S3Backend, "s3_client", new_callable=mock.PropertyMock)
+    def test_open_artifact(self, mock_client_prop):
+        """Test streaming an artifact's object body from S3."""
+        mock_client = mock.MagicMock()
+        mock_client_prop.return_value = mock_client
+        body = mock.MagicMock()
+        mock_client.get_object.return_value = {"Body": body}
+
+        self.assertIs(self.backend.open_artifact("test.tar.zst"), body)
+        mock_client.get_object.assert_called_once_with(
+            Bucket="test-bucket", Key="external/test-run-456-linux/test.tar.zst"
+        )
+
+    @mock.patch.object(S3Backend, "s3_client", new_callable=mock.PropertyMock)
+    def test_open_artifact_at_offset(self, mock_client_prop):
+        """Test that resuming uses a ranged GET."""
+        mock_client = mock.MagicMock()
+        mock_client_prop.return_value = mock_client
+        mock_client.get_object.return_value = {"Body": mock.MagicMock()}
+
+        self.backend.open_artifact("test.tar.zst", start=1024)
+        mock_client.get_object.assert_called_once_with(
+            Bucket="test-bucket",
+            Key="external/test-run-456-linux/test.tar.zst",
+            Range="bytes=1024-",
+        )
+
+    @mock.patch.object(S3Backend, "s3_client", new_callable=mock.PropertyMock)
+    def test_open_artifact_range(self, mock_client_prop):
+        """Test that multipart downloads request closed byte ranges."""
+        mock_client = mock.MagicMock()
+        mock_client_prop.return_value = mock_client
+        mock_client.get_object.return_value = {"Body": mock.MagicMock()}
+
+        self.backend.open_artifact("test.tar.zst", start=0, length=1024)
+        mock_client.get_object.assert_called_once_with(
+            Bucket="test-bucket",
+            Key="external/test-run-456-linux/test.tar.zst",
+            Range="bytes=0-1023",
+        )
+
+    @mock.patch.object(S3Backend, "s3_client", new_callable=mock.PropertyMock)
+    def test_stat_artifact(self, mock_client_prop):
+        from botocore.exceptions import ClientError
+
+        mock_client = mock.MagicMock()
+        mock_client_prop.return_value = mock_client
+        mock_client.head_object.return_value = {
+            "ContentLength": 42,
+            "ETag": '"0123456789abcdef0123456789abcdef"',
+        }
+        stat = self.backend.stat_artifact("test.tar.zst")
+        self.assertEqual(stat.size, 42)
+        self.assertEqual(stat.etag, "0123456789abcdef0123456789abcdef")
+
+        mock_client.head_object.side_effect = ClientError(
+            {"Error": {"Code": "404"}}, "HeadObject"
+        )
+        self.assertIsNone(self.backend.stat_artifact("test.tar.zst"))
+
+    @mock.patch.object(S3Backend, "s3_client", new_callable=mock.PropertyMock)
+    def test_open_nonexistent_artifact(self, mock_client_prop):
+        from botocore.exceptions import ClientError
+
+        mock_client = mock.MagicMock()
+        mock_client_prop.return_value = mock_client
+        mock_client.get_object.side_effect = ClientError(
+            {"Error": {"Code": "NoSuchKey"}}, "GetObject"
+        )
+        with self.assertRaises(FileNotFoundError):
+            self.backend.open_artifact("test.tar.zst")
+
     @mock.patch.object(S3Backend, "s3_client", new_callable=mock.PropertyMock)
     def test_download_artifact_zst(self, mock_client_prop):
         """Test downloading a .tar.zst artifact from S3."""
@@ -443,8 +725,6 @@ class TestS3Backend(unittest.TestCase):
         """Test S3 server-side copy within the same bucket."""
         mock_client = mock.MagicMock()
         mock_client_prop.return_value = mock_client
-        # sha256sum exists in source
-        mock_client.head_object.return_value = {}
 
         source = S3Backend(
             output_root=_make_s3_root(
@@ -458,26 +738,45 @@ class TestS3Backend(unittest.TestCase):
         )
         # Share the mock client
         source._s3_client = mock_client
+        source.seed_listing(
+            {
+                "artifact_lib_generic.tar.zst": ArtifactStat(size=100, etag="a"),
+                "artifact_lib_generic.tar.zst.sha256sum": ArtifactStat(
+                    size=64, etag="b"
+                ),
+                "artifact_lib_generic.tar.zst.index.json": ArtifactStat(
+                    size=10, etag="c"
+                ),
+                "artifact_lib_generic.tar.zst.delta": ArtifactStat(size=10, etag="d"),
+            }
+        )
+        dest.seed_listing({})
 
-        dest.copy_artifact("artifact_lib_generic.tar.zst", source)
+        self.assertTrue(dest.copy_artifact("artifact_lib_generic.tar.zst", source))
 
-        # Verify both artifact and sha256sum were copied
-        self.assertEqual(mock_client.copy.call_count, 2)
-        mock_client.copy.assert_any_call(
-            {
+        # Verify the artifact and its sidecars (sha256sum, index, delta) were
+        # copied, with sidecars found in the listing rather than by HEAD.
+        mock_client.head_object.assert_not_called()
+        self.assertEqual(mock_client.copy_object.call_count, 4)
+        mock_client.copy_object.assert_any_call(
+            CopySource={
                 "Bucket": "test-bucket",
                 "Key": "source-run-linux/artifact_lib_generic.tar.zst",
             },
-            "test-bucket",
-            "dest-run-linux/artifact_lib_generic.tar.zst",
+            Bucket="test-bucket",
+            Key="dest-run-linux/artifact_lib_generic.tar.zst",
         )
-        mock_client.copy.assert_any_call(
-            {
+        mock_client.copy_object.assert_any_call(
+            CopySource={
                 "Bucket": "test-bucket",
                 "Key": "source-run-linux/artifact_lib_generic.tar.zst.sha256sum",
             },
-            "test-bucket",
-            "dest-run-linux/artifact_lib_generic.tar.zst.sha256sum",
+            Bucket="test-bucket",
+            Key="dest-run-linux/artifact_lib_generic.tar.zst.sha256sum",
+        )
+        self.assertEqual(
+            dest.stat_artifact("artifact_lib_generic.tar.zst"),
+            ArtifactStat(size=100, etag="a"),
         )
 
     @mock.patch.object(S3Backend, "s3_client", new_callable=mock.PropertyMock)
@@ -485,8 +784,6 @@ class TestS3Backend(unittest.TestCase):
         """Test S3 server-side copy across different buckets."""
         mock_client = mock.MagicMock()
         mock_client_prop.return_value = mock_client
-        # sha256sum does not exist in source
-        mock_client.head_object.side_effect = Exception("Not found")
 
         source = S3Backend(
             output_root=_make_s3_root(
@@ -503,19 +800,61 @@ class TestS3Backend(unittest.TestCase):
             )
         )
         source._s3_client = mock_client
+        # No sidecars in source
+        source.seed_listing(
+            {"artifact_lib_generic.tar.zst": ArtifactStat(size=100, etag="a")}
+        )
+        dest.seed_listing({})
 
         dest.copy_artifact("artifact_lib_generic.tar.zst", source)
 
-        # Only artifact copied (no sha256sum in source)
-        mock_client.copy.assert_called_once_with(
-            {
+        mock_client.copy_object.assert_called_once_with(
+            CopySource={
                 "Bucket": "therock-ci-artifacts",
                 "Key": "source-run-linux/artifact_lib_generic.tar.zst",
             },
-            "therock-ci-artifacts-external",
-            "ROCm-rocm-libraries/dest-run-linux/artifact_lib_generic.tar.zst",
+            Bucket="therock-ci-artifacts-external",
+            Key="ROCm-rocm-libraries/dest-run-linux/artifact_lib_generic.tar.zst",
         )
 
+    @mock.patch.object(S3Backend, "s3_client", new_callable=mock.PropertyMock)
+    def test_copy_artifact_skips_identical_objects(self, mock_client_prop):
+        """Objects with the same size and ETag in the destination are not copied."""
+        mock_client = mock.MagicMock()
+        mock_client_prop.return_value = mock_client
+        source = S3Backend(output_root=_make_s3_root(run_id="source-run"))
+        dest = S3Backend(output_root=_make_s3_root(run_id="dest-run"))
+        listing = {
+            "artifact_lib_generic.tar.zst": ArtifactStat(size=100, etag="a"),
+            "artifact_lib_generic.tar.zst.sha256sum": ArtifactStat(size=64, etag="b"),
+        }
+        source.seed_listing(listing)
+        dest.seed_listing(
+            {
+                "artifact_lib_generic.tar.zst": ArtifactStat(size=100, etag="a"),
+                "artifact_lib_generic.tar.zst.sha256sum": ArtifactStat(
+                    size=64, etag="old"
+                ),
+            }
+        )
+
+        self.assertTrue(dest.copy_artifact("artifact_lib_generic.tar.zst", source))
+        mock_client.copy_object.assert_called_once()
+        self.assertTrue(
+            mock_client.copy_object.call_args.kwargs["Key"].endswith(".sha256sum")
+        )
+
+        mock_client.copy_object.reset_mock()
+        self.assertFalse(dest.copy_artifact("artifact_lib_generic.tar.zst", source))
+        mock_client.copy_object.assert_not_called()
+
+    def test_copy_artifact_missing_from_source_raises(self):
+        source = S3Backend(output_root=_make_s3_root(run_id="source-run"))
+        source.seed_listing({})
+        self.backend.seed_listing({})
+        with self.assertRaises(FileNotFoundError):
+            self.backend.copy_artifact("missing_lib_generic.tar.zst", source)
+
     def test_copy_artifact_wrong_backend_type_raises(self):
         """Test copy_artifact raises TypeError when source is a different backend type."""
         import tempfile
@@ -529,6 +868,154 @@ class TestS3Backend(unittest.TestCase):
             self.backend.copy_artifact("test.tar.zst", local_source)
 
 
+@unittest.skipIf(mock_aws is None, "requires moto")
+class TestS3BackendMultipart(unittest.TestCase):
+    """Multipart copies and streamed uploads against a moto S3 stand-in."""
+
+    def setUp(self):
+        self.mock_aws = mock_aws()
+        self.mock_aws.start()
+        self.addCleanup(self.mock_aws.stop)
+        import boto3
+        from boto3.s3.transfer import TransferConfig
+
+        self.client = boto3.client("s3", region_name="us-east-1")
+        for bucket in ("source-bucket", "dest-bucket"):
+            self.client.create_bucket(Bucket=bucket)
+        self.source = S3Backend(
+            output_root=_make_s3_root(bucket="source-bucket", run_id="source-run")
+        )
+        self.dest = S3Backend(
+            output_root=_make_s3_root(bucket="dest-bucket", run_id="dest-run"),
+            part_concurrency=2,
+        )
+        self.source._s3_client = self.client
+        self.dest._s3_client = self.client
+
+        # 3 parts of 5 MiB (the S3 minimum), the last one shorter.
+        self.data = os.urandom(12 * 1024 * 1024)
+        with tempfile.NamedTemporaryFile() as f:
+            f.write(self.data)
+            f.flush()
+            self.client.upload_file(
+                f.name,
+                "source-bucket",
+                f"{self.source.s3_prefix}/blas_lib_gfx942.tar.zst",
+                Config=TransferConfig(
+                    multipart_threshold=5 * 1024 * 1024,
+                    multipart_chunksize=5 * 1024 * 1024,
+                ),
+            )
+        self.client.put_object(
+            Bucket="source-bucket",
+            Key=f"{self.source.s3_prefix}/blas_lib_gfx942.tar.zst.sha256sum",
+            Body=b"0" * 64,
+        )
+
+    def test_listing_has_only_direct_children(self):
+        prefix = self.source.s3_prefix
+        for key in [
+            f"{prefix}/artifact_index/blas_lib_gfx942.tar.zst",
+            f"{prefix}/artifact_index/stage.gfx942.json",
+            f"{prefix}-other/fft_lib_generic.tar.zst",
+        ]:
+            self.client.put_object(Bucket="source-bucket", Key=key, Body=b"x")
+
+        listing = self.source.list_objects(refresh=True)
+        self.assertEqual(
+            sorted(listing),
+            ["blas_lib_gfx942.tar.zst", "blas_lib_gfx942.tar.zst.sha256sum"],
+        )
+        self.assertEqual(listing["blas_lib_gfx942.tar.zst"].size, len(self.data))
+        self.assertEqual(self.source.list_artifacts(), ["blas_lib_gfx942.tar.zst"])
+
+    def test_copy_keeps_part_layout_and_etag(self):
+        self.assertTrue(self.dest.copy_artifact("blas_lib_gfx942.tar.zst", self.source))
+
+        dest_key = f"{self.dest.s3_prefix}/blas_lib_gfx942.tar.zst"
+        body = self.client.get_object(Bucket="dest-bucket", Key=dest_key)["Body"]
+        self.assertEqual(body.read(), self.data)
+        source_listing = self.source.list_objects(refresh=True)
+        dest_listing = self.dest.list_objects(refresh=True)
+        self.assertEqual(dest_listing, source_listing)
+        self.assertTrue(dest_listing["blas_lib_gfx942.tar.zst"].etag.endswith("-3"))
+
+        # Copying again finds identical objects and copies nothing.
+        with mock.patch.object(
+            self.client, "upload_part_copy", wraps=self.client.upload_part_copy
+        ) as upload_part_copy, mock.patch.object(
+            self.client, "copy_object", wraps=self.client.copy_object
+        ) as copy_object:
+            self.assertFalse(
+                self.dest.copy_artifact("blas_lib_gfx942.tar.zst", self.source)
+            )
+        upload_part_copy.assert_not_called()
+        copy_object.assert_not_called()
+
+    def test_failed_part_aborts_upload(self):
+        with mock.patch.object(
+            self.client, "upload_part_copy", side_effect=RuntimeError("part failed")
+        ):
+            with self.assertRaises(RuntimeError):
+                self.dest.copy_artifact("blas_lib_gfx942.tar.zst", self.source)
+        uploads = self.client.list_multipart_uploads(Bucket="dest-bucket")
+        self.assertEqual(uploads.get("Uploads", []), [])
+
+    def _chunks(self, data: bytes, chunk_size: int = 3 * 1024 * 1024 + 7):
+        for start in range(0, len(data), chunk_size):
+            yield data[start : start + chunk_size]
+
+    def test_upload_stream(self):
+        data = os.urandom(20 * 1024 * 1024)
+        stat = self.dest.upload_artifact_stream(
+            self._chunks(data), "rocm_lib_generic.tar.zst"
+        )
+        dest_key = f"{self.dest.s3_prefix}/rocm_lib_generic.tar.zst"
+        body = self.client.get_object(Bucket="dest-bucket", Key=dest_key)["Body"]
+        self.assertEqual(body.read(), data)
+        self.assertEqual(stat.size, len(data))
+        self.assertEqual(self.dest.stat_artifact("rocm_lib_generic.tar.zst"), stat)
+
+        # Same parts, so the same ETag, as boto3 uploading the file.
+        with tempfile.NamedTemporaryFile() as f:
+            f.write(data)
+            f.flush()
+            self.client.upload_file(f.name, "dest-bucket", "reference")
+        reference = self.client.head_object(Bucket="dest-bucket", Key="reference")
+        self.assertEqual(stat.etag, reference["ETag"].strip('"'))
+
+    def test_upload_stream_below_multipart_threshold(self):
+        data = os.urandom(3 * 1024 * 1024)
+        with mock.patch.object(
+            self.client,
+            "create_multipart_upload",
+            side_effect=AssertionError("multipart upload"),
+        ):
+            stat = self.dest.upload_artifact_stream(
+                self._chunks(data, chunk_size=1024 * 1024), "small_lib_generic.tar.zst"
+            )
+        # A single PUT, whose ETag is the MD5, as boto3 uploading the file.
+        self.assertEqual(stat.etag, hashlib.md5(data).hexdigest())
+        self.assertEqual(stat.size, len(data))
+
+    def test_upload_stream_of_empty_artifact(self):
+        stat = self.dest.upload_artifact_stream(iter([]), "empty_lib_generic.tar.zst")
+        self.assertEqual(stat.size, 0)
+
+    def test_failed_stream_aborts_upload(self):
+        def failing_chunks():
+            yield os.urandom(9 * 1024 * 1024)
+            raise RuntimeError("compression failed")
+
+        with self.assertRaises(RuntimeError):
+            self.dest.upload_artifact_stream(
+                failing_chunks(), "rocm_lib_generic.tar.zst"
+            )
+        uploads = self.client.list_multipart_uploads(Bucket="dest-bucket")
+        self.assertEqual(uploads.get("Uploads", []), [])
+        self.assertIsNone(self.dest.stat_artifact("rocm_lib_generic.tar.zst"))
+
+
 class TestS3BackendCredentials(unittest.TestCase):
     """Live tests for S3Backend credential resolution.
 
@@ -659,6 +1146,19 @@ class TestCreateBackendFromEnv(unittest.TestCase):
                 self.assertIsInstance(backend, LocalDirectoryBackend)
                 self.assertIn("env-run-id", backend.base_uri)
                 self.assertIn("windows", backend.base_uri)
+                self.assertEqual(backend.link_mode, "auto")
+
+    def test_local_backend_link_mode_from_env(self):
+        with tempfile.TemporaryDirectory() as temp_dir:
+            with mock.patch.dict(
+                os.environ,
+                {
+                    "THEROCK_LOCAL_STAGING_DIR": temp_dir,
+                    "THEROCK_LOCAL_STAGING_LINK_MODE": "copy",
+                },
+            ):
+                backend = create_backend_from_env()
+                self.assertEqual(backend.link_mode, "copy")
 
     def test_local_backend_with_overrides(self):
         """Test LocalDirectoryBackend with explicit run_id and platform."""
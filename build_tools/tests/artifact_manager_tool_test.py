@@ -9,10 +9,13 @@ particularly error handling and exit codes.
 """
 
 import hashlib
+import json
 import os
 import shutil
 import sys
 import tempfile
+import threading
+import time
 import unittest
 from pathlib import Path
 from typing import Optional
@@ -20,9 +23,20 @@ from unittest import mock
 
 sys.path.insert(0, os.fspath(Path(__file__).parent.parent))
 
-from _therock_utils.artifact_backend import ArtifactBackend, LocalDirectoryBackend
+from _therock_utils.artifact_backend import (
+    ARTIFACT_EXTENSIONS,
+    ArtifactBackend,
+    LocalDirectoryBackend,
+)
+from _therock_utils.lazy_prefix import LazyPrefixOperations
+from _therock_utils.ranged_download import ConnectionBudget
 from _therock_utils.workflow_outputs import WorkflowOutputRoot
 
+try:
+    from moto import mock_aws
+except ImportError:
+    mock_aws = None
+
 # Minimal topology TOML for testing push/fetch behavior.
 # Defines two stages: upstream-stage produces artifacts, downstream-stage consumes them.
 TEST_TOPOLOGY_TOML = """\
@@ -124,6 +138,21 @@ class FailingBackend(ArtifactBackend):
             return self._real_backend.list_artifacts(name_filter)
         return []
 
+    def _list_objects(self):
+        if self._real_backend:
+            return self._real_backend.list_objects()
+        return {}
+
+    def list_directory(self, subdir):
+        if self._real_backend:
+            return self._real_backend.list_directory(subdir)
+        return {}
+
+    def list_artifact_stats(self, name_filter=None):
+        if self._real_backend:
+            return self._real_backend.list_artifact_stats(name_filter)
+        return {}
+
     def download_artifact(self, artifact_key, dest_path):
         self.download_count += 1
         if (
@@ -139,6 +168,28 @@ class FailingBackend(ArtifactBackend):
             return self._real_backend.download_artifact(artifact_key, dest_path)
         raise FileNotFoundError(f"No backend configured: {artifact_key}")
 
+    def open_artifact(self, artifact_key, start=0, length=None):
+        # Small sidecar reads (e.g. .sha256sum) don't count as downloads.
+        if artifact_key.endswith(ARTIFACT_EXTENSIONS):
+            self.download_count += 1
+            if (
+                self.fail_downloads_after is not None
+                and self.download_count > self.fail_downloads_after
+            ):
+                raise RuntimeError(
+                    f"Simulated download failure for {artifact_key} "
+                    f"(download #{self.download_count}, configured to fail after "
+                    f"{self.fail_downloads_after})"
+                )
+        if self._real_backend:
+            return self._real_backend.open_artifact(artifact_key, start, length)
+        raise FileNotFoundError(f"No backend configured: {artifact_key}")
+
+    def stat_artifact(self, artifact_key):
+        if self._real_backend:
+            return self._real_backend.stat_artifact(artifact_key)
+        return None
+
     def upload_artifact(self, source_path, artifact_key):
         self.upload_count += 1
         if (
@@ -228,6 +279,16 @@ class ArtifactManagerTestBase(unittest.TestCase):
         (artifact_dir / "dummy.txt").write_text(f"Artifact: {artifact_name}\n")
         return artifact_dir
 
+    def _create_real_artifact_dir(self, name: str, component: str) -> Path:
+        """Create a generic artifact directory that can really be archived."""
+        artifact_dir = self.build_dir / "artifacts" / f"{name}_{component}_generic"
+        stage_dir = artifact_dir / "test" / "stage"
+        (stage_dir / "lib").mkdir(parents=True)
+        (artifact_dir / "artifact_manifest.txt").write_text("test/stage\n")
+        (stage_dir / "lib" / f"lib{component}.so").write_text(f"{component}\n")
+        (stage_dir / "README").write_text("shared\n")
+        return artifact_dir
+
     def _create_staged_artifact(
         self, name: str, component: str, target_family: str, run_id: str = "local"
     ) -> str:
@@ -435,6 +496,221 @@ class TestPushCompressionFailure(ArtifactManagerTestBase):
         mock_compress.assert_called_once()
 
 
+class TestPushStreamUpload(ArtifactManagerTestBase):
+    """Tests for push --stream-upload (uploading while compressing)."""
+
+    def _push(self, *extra_args):
+        import artifact_manager
+
+        artifact_manager.main(
+            [
+                "push",
+                "--stage",
+                "upstream-stage",
+                "--build-dir",
+                str(self.build_dir),
+                "--topology",
+                str(self.topology_path),
+                "--local-staging-dir",
+                str(self.staging_dir),
+                "--platform",
+                TEST_PLATFORM,
+                "--run-id",
+                "local",
+                "--stream-upload",
+                *extra_args,
+            ]
+        )
+
+    def _backend(self) -> LocalDirectoryBackend:
+        return LocalDirectoryBackend(
+            staging_dir=self.staging_dir,
+            output_root=WorkflowOutputRoot.for_local(
+                run_id="local", platform=TEST_PLATFORM
+            ),
+        )
+
+    def _assert_pushed(self):
+        from _therock_utils.hash_util import calculate_hash
+        from _therock_utils.run_index import load_run_index
+
+        backend = self._backend()
+        key = "test-artifact_lib_generic.tar.zst"
+        archive = backend.base_path / key
+        self.assertEqual(
+            (backend.base_path / f"{key}.sha256sum").read_text().strip(),
+            calculate_hash(archive, "sha256").hexdigest(),
+        )
+        self.assertTrue(backend.artifact_exists(f"{key}.index.json"))
+        self.assertFalse((backend.base_path / f"{key}.partial").exists())
+        self.assertIn(key, load_run_index(backend).entries)
+
+    def test_stream_upload(self):
+        self._create_real_artifact_dir("test-artifact", "lib")
+        with mock.patch.object(
+            LocalDirectoryBackend,
+            "upload_artifact",
+            autospec=True,
+            side_effect=LocalDirectoryBackend.upload_artifact,
+        ) as upload_artifact:
+            self._push()
+        # Only the sidecars are uploaded after compression.
+        self.assertNotIn(
+            "test-artifact_lib_generic.tar.zst",
+            [call.args[2] for call in upload_artifact.call_args_list],
+        )
+        self._assert_pushed()
+
+    def test_stream_upload_takes_a_transfer_slot(self):
+        """The slot is taken once compression has output, and the compression
+        bound upload is not part of the adaptive throughput signal."""
+        import artifact_manager
+        from _therock_utils.adaptive_concurrency import AdaptiveConcurrency
+
+        self._create_real_artifact_dir("test-artifact", "lib")
+        in_use_while_streaming = []
+        in_use_at_first_chunk = []
+        real_stream = LocalDirectoryBackend.upload_artifact_stream
+        real_follow_file = artifact_manager._follow_file
+
+        def follow_file(*args, **kwargs):
+            for chunk in real_follow_file(*args, **kwargs):
+                if not in_use_at_first_chunk:
+                    in_use_at_first_chunk.append(concurrency[0]._in_use)
+                yield chunk
+
+        def upload_artifact_stream(backend, chunks, artifact_key):
+            in_use_while_streaming.append(concurrency[0]._in_use)
+            return real_stream(backend, chunks, artifact_key)
+
+        concurrency = []
+
+        def make_concurrency(*args, **kwargs):
+            concurrency.append(AdaptiveConcurrency(*args, **kwargs))
+            return concurrency[-1]
+
+        with mock.patch(
+            "artifact_manager.AdaptiveConcurrency", side_effect=make_concurrency
+        ), mock.patch.object(
+            LocalDirectoryBackend,
+            "upload_artifact_stream",
+            autospec=True,
+            side_effect=upload_artifact_stream,
+        ), mock.patch.object(
+            artifact_manager, "_follow_file", side_effect=follow_file
+        ), mock.patch.object(
+            AdaptiveConcurrency,
+            "record",
+            autospec=True,
+            side_effect=AdaptiveConcurrency.record,
+        ) as record:
+            self._push()
+        self.assertEqual(in_use_at_first_chunk, [0])
+        self.assertEqual(in_use_while_streaming, [1])
+        self.assertGreater(concurrency[0].total_bytes, 0)
+        archive_size = (
+            (self._backend().base_path / "test-artifact_lib_generic.tar.zst")
+            .stat()
+            .st_size
+        )
+        self.assertIn(
+            mock.call(concurrency[0], archive_size, adapt=False), record.call_args_list
+        )
+        self._assert_pushed()
+
+    def test_falls_back_when_streaming_fails(self):
+        self._create_real_artifact_dir("test-artifact", "lib")
+        with mock.patch.object(
+            LocalDirectoryBackend,
+            "upload_artifact_stream",
+            side_effect=RuntimeError("connection reset"),
+        ):
+            self._push()
+        self._assert_pushed()
+
+    def test_fails_when_compression_fails(self):
+        # No artifact_manifest.txt, so fileset_tool.py fails.
+        self._create_fake_artifact_dir("test-artifact", "lib", "generic")
+        with self.assertRaises(SystemExit) as ctx:
+            self._push()
+        self.assertEqual(ctx.exception.code, 1)
+        self.assertFalse(
+            self._backend().artifact_exists("test-artifact_lib_generic.tar.zst")
+        )
+
+
+class TestPushScheduling(ArtifactManagerTestBase):
+    """Tests for the order and bookkeeping of compressions in push."""
+
+    def test_largest_artifacts_are_compressed_first(self):
+        import artifact_manager
+
+        self._create_real_artifact_dir("test-artifact", "lib")
+        dev_dir = self._create_real_artifact_dir("test-artifact", "dev")
+        (dev_dir / "test/stage/lib/libdev.a").write_bytes(b"x" * 100000)
+
+        compress_requests = []
+
+        def mock_compress(request):
+            compress_requests.append(request)
+            return None
+
+        argv = [
+            "push",
+            "--stage",
+            "upstream-stage",
+            "--build-dir",
+            str(self.build_dir),
+            "--topology",
+            str(self.topology_path),
+            "--local-staging-dir",
+            str(self.staging_dir),
+            "--platform",
+            TEST_PLATFORM,
+            "--compress-concurrency",
+            "1",
+        ]
+        with mock.patch("artifact_manager.compress_artifact", mock_compress):
+            with self.assertRaises(SystemExit):
+                artifact_manager.main(argv)
+
+        self.assertEqual(
+            [r.source_dir.name for r in compress_requests],
+            ["test-artifact_dev_generic", "test-artifact_lib_generic"],
+        )
+        # Sized by the walk that feeds the archive writer.
+        self.assertEqual(compress_requests[0].contents.file_count, 4)
+        self.assertGreater(compress_requests[0].contents.file_size, 100000)
+
+
+class TestFollowFile(unittest.TestCase):
+    def test_reads_appended_data_until_finished(self):
+        import artifact_manager
+
+        with tempfile.TemporaryDirectory() as temp_dir:
+            path = Path(temp_dir) / "growing.bin"
+            finished = threading.Event()
+
+            def write():
+                time.sleep(0.05)  # Created after the reader starts
+                with open(path, "wb") as f:
+                    for i in range(5):
+                        f.write(bytes([i]) * 1000)
+                        f.flush()
+                        time.sleep(0.01)
+                finished.set()
+
+            writer = threading.Thread(target=write)
+            writer.start()
+            data = b"".join(
+                artifact_manager._follow_file(
+                    path, finished.is_set, chunk_size=300, poll_seconds=0.005
+                )
+            )
+            writer.join()
+        self.assertEqual(data, b"".join(bytes([i]) * 1000 for i in range(5)))
+
+
 class TestPushStageAll(ArtifactManagerTestBase):
     """Tests that push --stage all collects produced artifacts from all stages."""
 
@@ -480,6 +756,121 @@ class TestPushStageAll(ArtifactManagerTestBase):
             )
 
 
+class TestPushZstdDict(ArtifactManagerTestBase):
+    """Tests for push --zstd-dict-dir."""
+
+    def test_push_uses_family_dictionary_when_present(self):
+        """Artifacts with a {name}_{component}.zdict get compressed against it."""
+        import artifact_manager
+
+        self._create_fake_artifact_dir("test-artifact", "lib", "generic")
+        self._create_fake_artifact_dir("test-artifact", "dev", "generic")
+        dict_dir = Path(self.temp_dir) / "dicts"
+        dict_dir.mkdir()
+        (dict_dir / "test-artifact_lib.zdict").write_bytes(b"unused")
+
+        compress_requests = []
+
+        def mock_compress(request):
+            compress_requests.append(request)
+            return None
+
+        argv = [
+            "push",
+            "--stage",
+            "upstream-stage",
+            "--build-dir",
+            str(self.build_dir),
+            "--topology",
+            str(self.topology_path),
+            "--local-staging-dir",
+            str(self.staging_dir),
+            "--platform",
+            TEST_PLATFORM,
+            "--run-id",
+            "local",
+            "--zstd-dict-dir",
+            str(dict_dir),
+            "--zstd-dict-mode",
+            "embed",
+        ]
+        with mock.patch("artifact_manager.compress_artifact", mock_compress):
+            with self.assertRaises(SystemExit):
+                artifact_manager.main(argv)
+
+        by_name = {r.source_dir.name: r for r in compress_requests}
+        self.assertEqual(
+            by_name["test-artifact_lib_generic"].zstd_dict,
+            dict_dir / "test-artifact_lib.zdict",
+        )
+        self.assertEqual(by_name["test-artifact_lib_generic"].zstd_dict_mode, "embed")
+        self.assertIsNone(by_name["test-artifact_dev_generic"].zstd_dict)
+
+    def test_fetch_resolves_referenced_dictionary(self):
+        """fetch --zstd-dict-dir is passed to readers, not through os.environ."""
+        import artifact_manager
+        from _therock_utils.archive_util import read_zstd_dict_frame, train_zstd_dict
+
+        self._create_real_artifact_dir("test-artifact", "lib")
+        samples_dir = Path(self.temp_dir) / "samples"
+        samples_dir.mkdir()
+        samples = []
+        for i in range(200):
+            samples.append(samples_dir / f"header_{i}.h")
+            samples[-1].write_text(
+                f"#ifndef HEADER_{i}_H\n#define HEADER_{i}_H\n"
+                f"struct helper_{i} {{ int value{i}; }};\n#endif\n"
+            )
+        dict_dir = Path(self.temp_dir) / "dicts"
+        dict_dir.mkdir()
+        (dict_dir / "test-artifact_lib.zdict").write_bytes(
+            train_zstd_dict(samples, dict_size=4096)
+        )
+        common_argv = [
+            "--topology",
+            str(self.topology_path),
+            "--local-staging-dir",
+            str(self.staging_dir),
+            "--platform",
+            TEST_PLATFORM,
+            "--run-id",
+            "local",
+        ]
+        artifact_manager.main(
+            [
+                "push",
+                "--stage",
+                "upstream-stage",
+                "--build-dir",
+                str(self.build_dir),
+                "--zstd-dict-dir",
+                str(dict_dir),
+            ]
+            + common_argv
+        )
+
+        (staged,) = self.staging_dir.rglob("test-artifact_lib_generic.tar.zst")
+        with self.assertRaises(FileNotFoundError):
+            read_zstd_dict_frame(staged)
+
+        environ = dict(os.environ)
+        artifact_manager.main(
+            [
+                "fetch",
+                "--stage",
+                "downstream-stage",
+                "--output-dir",
+                str(self.output_dir),
+                "--flatten",
+                "--zstd-dict-dir",
+                str(dict_dir),
+            ]
+            + common_argv
+        )
+        self.assertEqual((self.output_dir / "lib" / "liblib.so").read_text(), "lib\n")
+        self.assertEqual(dict(os.environ), environ)
+
+
 class TestFetchFailureExitCode(ArtifactManagerTestBase):
     """Tests that fetch command exits with non-zero code on download failures."""
 
@@ -1105,11 +1496,10 @@ class TestFetchDownloadCache(ArtifactManagerTestBase):
         # Second fetch with a FailingBackend. If the cache check works,
         # download_artifact() returns early before calling the backend,
         # so the failing backend is never hit.
-        failing_backend = FailingBackend(fail_downloads_after=0)
-        # Give it the same listing so artifact matching works
-        failing_backend.list_artifacts = lambda name_filter=None: [
-            f.name for f in first_cached
-        ]
+        # Cache hits are still verified against the backend's sha256sum.
+        failing_backend = FailingBackend(
+            fail_downloads_after=0, staging_dir=self.staging_dir, run_id="local"
+        )
 
         second_output = Path(self.temp_dir) / "output2"
         second_output.mkdir()
@@ -1128,6 +1518,1064 @@ class TestFetchDownloadCache(ArtifactManagerTestBase):
             artifact_manager.main(second_argv)
 
 
+class _DroppingReader:
+    """Body that raises a connection error after `limit` bytes."""
+
+    def __init__(self, body, limit: int):
+        self._body = body
+        self._remaining = limit
+
+    def read(self, size: int = -1) -> bytes:
+        if self._remaining <= 0:
+            raise ConnectionResetError("Simulated connection drop")
+        if size < 0 or size > self._remaining:
+            size = self._remaining
+        data = self._body.read(size)
+        self._remaining -= len(data)
+        return data
+
+    def close(self):
+        self._body.close()
+
+
+@unittest.skipIf(mock_aws is None, "requires moto")
+class TestResumableDownload(unittest.TestCase):
+    """Tests verified, resumable downloads against a moto S3 stand-in."""
+
+    ARTIFACT_KEY = "test-artifact_lib_generic.tar.zst"
+
+    def setUp(self):
+        self._saved_environ = os.environ.copy()
+        os.environ.update(
+            {
+                "AWS_ACCESS_KEY_ID": "testing",
+                "AWS_SECRET_ACCESS_KEY": "testing",
+                "AWS_DEFAULT_REGION": "us-east-1",
+            }
+        )
+        self.mock_aws = mock_aws()
+        self.mock_aws.start()
+        self.temp_dir = Path(tempfile.mkdtemp(prefix="resumable_download_test_"))
+        self.dest_path = self.temp_dir / "cache" / self.ARTIFACT_KEY
+        self.dest_path.parent.mkdir()
+
+        from _therock_utils.artifact_backend import S3Backend
+
+        self.backend = S3Backend(
+            WorkflowOutputRoot(
+                bucket="test-bucket", external_repo="", run_id="1", platform="linux"
+            )
+        )
+        self.backend.s3_client.create_bucket(Bucket="test-bucket")
+        self.content = os.urandom(3 * 1024 * 1024 + 123)
+        self._put(self.ARTIFACT_KEY, self.content)
+
+        # Connection drops to inject: byte limits for successive reads.
+        self.drops = []
+        self.starts = []
+        real_open = self.backend.open_artifact
+
+        def open_artifact(artifact_key, start=0, length=None):
+            body = real_open(artifact_key, start, length)
+            if artifact_key != self.ARTIFACT_KEY:
+                return body
+            self.starts.append(start)
+            if self.drops:
+                return _DroppingReader(body, self.drops.pop(0))
+            return body
+
+        self.backend.open_artifact = open_artifact
+
+    def tearDown(self):
+        self.mock_aws.stop()
+        shutil.rmtree(self.temp_dir, ignore_errors=True)
+        os.environ.clear()
+        os.environ.update(self._saved_environ)
+
+    def _put(self, key: str, data: bytes):
+        self.backend.s3_client.put_object(
+            Bucket="test-bucket", Key=f"{self.backend.s3_prefix}/{key}", Body=data
+        )
+
+    def _put_sha256sum(self, data: bytes):
+        digest = hashlib.sha256(data).hexdigest()
+        self._put(f"{self.ARTIFACT_KEY}.sha256sum", f"{digest}\n".encode())
+
+    def _download(self, **kwargs):
+        import artifact_manager
+
+        return artifact_manager.download_artifact(
+            artifact_manager.DownloadRequest(
+                artifact_key=self.ARTIFACT_KEY,
+                dest_path=self.dest_path,
+                backend=self.backend,
+                **kwargs,
+            )
+        )
+
+    @mock.patch("artifact_manager._delay_for_retry")
+    def test_resumes_after_connection_drops(self, mock_delay):
+        self._put_sha256sum(self.content)
+        self.drops = [1000000, 1500000]
+        self.assertEqual(self._download(), self.dest_path)
+        # Each retry continues where the previous attempt stopped.
+        self.assertEqual(self.starts, [0, 1000000, 2500000])
+        self.assertEqual(self.dest_path.read_bytes(), self.content)
+        self.assertFalse(Path(f"{self.dest_path}.partial").exists())
+
+    @mock.patch("artifact_manager._delay_for_retry")
+    def test_multipart_download_refetches_only_failed_part(self, mock_delay):
+        self._put_sha256sum(self.content)
+        self.drops = [100000]
+        budget = ConnectionBudget(4)
+        try:
+            result = self._download(
+                budget=budget, part_size=512 * 1024, max_part_connections=3
+            )
+        finally:
+            budget.shutdown()
+        self.assertEqual(result, self.dest_path)
+        self.assertEqual(self.dest_path.read_bytes(), self.content)
+        # 7 parts, one of which was dropped and fetched again.
+        self.assertEqual(len(set(self.starts)), 7)
+        self.assertEqual(len(self.starts), 8)
+        self.assertEqual(list(self.temp_dir.glob("cache/*.part*")), [])
+
+    @mock.patch("artifact_manager._delay_for_retry")
+    def test_corrupt_resume_restarts_from_zero(self, mock_delay):
+        """Without a sha256sum, the single-part upload's ETag (md5) is checked."""
+        partial_path = Path(f"{self.dest_path}.partial")
+        partial_path.write_bytes(b"garbage left by a killed process")
+        self.assertEqual(self._download(), self.dest_path)
+        self.assertEqual(self.starts, [len(b"garbage left by a killed process"), 0])
+        self.assertEqual(self.dest_path.read_bytes(), self.content)
+        self.assertFalse(partial_path.exists())
+
+    def test_corrupt_cache_hit_is_redownloaded(self):
+        self._put_sha256sum(self.content)
+        self.dest_path.write_bytes(b"\0" * len(self.content))
+        self.assertEqual(self._download(), self.dest_path)
+        self.assertEqual(self.starts, [0])
+        self.assertEqual(self.dest_path.read_bytes(), self.content)
+
+        # A verified cache hit is not downloaded again.
+        self.assertEqual(self._download(), self.dest_path)
+        self.assertEqual(self.starts, [0])
+
+    def test_cache_hit_replaced_after_verification_is_kept(self):
+        """A cache hit is only discarded after verifying it again under the lock."""
+        import artifact_manager
+
+        self._put_sha256sum(self.content)
+        self.dest_path.write_bytes(b"\0" * len(self.content))
+        real_verify = artifact_manager._verify_cached_download
+        replaced = []
+
+        def verify(request):
+            mismatch = real_verify(request)
+            if not replaced:
+                # Another fetch sharing the cache replaces it right after.
+                replaced.append(True)
+                self.dest_path.write_bytes(self.content)
+            return mismatch
+
+        with mock.patch.object(
+            artifact_manager, "_verify_cached_download", side_effect=verify
+        ):
+            self.assertEqual(self._download(), self.dest_path)
+        self.assertEqual(self.starts, [])
+        self.assertEqual(self.dest_path.read_bytes(), self.content)
+
+    @mock.patch("artifact_manager._delay_for_retry")
+    def test_sha256_mismatch_fails(self, mock_delay):
+        self._put_sha256sum(b"other contents")
+        self.assertIsNone(self._download())
+        self.assertFalse(self.dest_path.exists())
+        self.assertFalse(Path(f"{self.dest_path}.partial").exists())
+
+    def test_waits_for_concurrent_download_into_shared_cache(self):
+        """A fetch sharing the cache that holds the lock finishes the download."""
+        from _therock_utils.os_util import file_lock
+
+        self._put_sha256sum(self.content)
+        lock_path = Path(f"{self.dest_path}.lock")
+        locked = threading.Event()
+        release = threading.Event()
+
+        def other_fetch():
+            with file_lock(lock_path):
+                locked.set()
+                release.wait()
+                self.dest_path.write_bytes(self.content)
+
+        other = threading.Thread(target=other_fetch)
+        other.start()
+        locked.wait()
+        result = []
+        ours = threading.Thread(target=lambda: result.append(self._download()))
+        ours.start()
+        ours.join(timeout=0.5)
+        # Blocked on the lock rather than appending to the same partial file.
+        self.assertTrue(ours.is_alive())
+        release.set()
+        other.join()
+        ours.join()
+        self.assertEqual(result, [self.dest_path])
+        self.assertEqual(self.starts, [])
+        self.assertFalse(Path(f"{self.dest_path}.partial").exists())
+
+    def test_missing_artifact(self):
+        self.backend.s3_client.delete_object(
+            Bucket="test-bucket", Key=f"{self.backend.s3_prefix}/{self.ARTIFACT_KEY}"
+        )
+        self.assertIsNone(self._download())
+        self.assertEqual(self.starts, [])
+
+
+class TestFetchContentStore(ArtifactManagerTestBase):
+    """Tests for push index sidecars and fetch --content-store-dir."""
+
+    def test_second_fetch_materializes_from_store(self):
+        """Once the store has every file, fetch only downloads the index."""
+        import artifact_manager
+
+        self._create_real_artifact_dir("test-artifact", "lib")
+        common_argv = [
+            "--topology",
+            str(self.topology_path),
+            "--local-staging-dir",
+            str(self.staging_dir),
+            "--platform",
+            TEST_PLATFORM,
+            "--run-id",
+            "local",
+        ]
+        artifact_manager.main(
+            ["push", "--stage", "upstream-stage", "--build-dir", str(self.build_dir)]
+            + common_argv
+        )
+        staged = list(self.staging_dir.rglob("*.index.json"))
+        self.assertEqual(
+            [p.name for p in staged], ["test-artifact_lib_generic.tar.zst.index.json"]
+        )
+
+        store_dir = Path(self.temp_dir) / "store"
+        fetch_argv = [
+            "fetch",
+            "--stage",
+            "downstream-stage",
+            "--flatten",
+            "--content-store-dir",
+            str(store_dir),
+            "--content-store-link-mode",
+            "copy",
+        ] + common_argv
+        artifact_manager.main(fetch_argv + ["--output-dir", str(self.output_dir)])
+        self.assertEqual((self.output_dir / "lib" / "liblib.so").read_text(), "lib\n")
+        blobs = [p for p in (store_dir / "sha256").rglob("*") if p.is_file()]
+        self.assertEqual(len(blobs), 2)
+
+        # Second fetch: archive downloads fail, so the artifact must come
+        # entirely from the store.
+        backend = FailingBackend(staging_dir=self.staging_dir)
+        real_download = backend.download_artifact
+
+        def download_index_only(artifact_key, dest_path):
+            if not artifact_key.endswith(".index.json"):
+                raise RuntimeError(f"Unexpected archive download: {artifact_key}")
+            return real_download(artifact_key, dest_path)
+
+        backend.download_artifact = download_index_only
+        second_output = Path(self.temp_dir) / "output2"
+        with mock.patch(
+            "artifact_manager.create_backend_from_env", return_value=backend
+        ):
+            artifact_manager.main(fetch_argv + ["--output-dir", str(second_output)])
+        self.assertEqual((second_output / "README").read_text(), "shared\n")
+        self.assertEqual((second_output / "lib" / "liblib.so").read_text(), "lib\n")
+
+    def test_stale_cached_index_is_replaced(self):
+        """An index left in a shared download cache is checked, not trusted."""
+        import artifact_manager
+
+        self._create_real_artifact_dir("test-artifact", "lib")
+        common_argv = [
+            "--topology",
+            str(self.topology_path),
+            "--local-staging-dir",
+            str(self.staging_dir),
+            "--platform",
+            TEST_PLATFORM,
+            "--run-id",
+            "local",
+        ]
+        artifact_manager.main(
+            ["push", "--stage", "upstream-stage", "--build-dir", str(self.build_dir)]
+            + common_argv
+        )
+
+        # Another run left an index of the same name listing other contents,
+        # which are in the store.
+        store_dir = Path(self.temp_dir) / "store"
+        cache_dir = Path(self.temp_dir) / "cache"
+        cache_dir.mkdir()
+        index_name = "test-artifact_lib_generic.tar.zst.index.json"
+        index = json.loads(next(self.staging_dir.rglob(index_name)).read_text())
+        wrong = b"wrong\n"
+        wrong_sha256 = hashlib.sha256(wrong).hexdigest()
+        for entry in index["entries"]:
+            if entry["path"].endswith("lib/liblib.so"):
+                entry["sha256"] = wrong_sha256
+                entry["size"] = len(wrong)
+        (cache_dir / index_name).write_text(json.dumps(index))
+        blob_path = store_dir / "sha256" / wrong_sha256[:2] / wrong_sha256
+        blob_path.parent.mkdir(parents=True)
+        blob_path.write_bytes(wrong)
+
+        artifact_manager.main(
+            [
+                "fetch",
+                "--stage",
+                "downstream-stage",
+                "--flatten",
+                "--content-store-dir",
+                str(store_dir),
+                "--content-store-link-mode",
+                "copy",
+                "--download-cache-dir",
+                str(cache_dir),
+                "--output-dir",
+                str(self.output_dir),
+            ]
+            + common_argv
+        )
+        self.assertEqual((self.output_dir / "lib" / "liblib.so").read_text(), "lib\n")
+
+    def test_store_pruned_to_max_size(self):
+        import artifact_manager
+
+        self._create_real_artifact_dir("test-artifact", "lib")
+        common_argv = [
+            "--topology",
+            str(self.topology_path),
+            "--local-staging-dir",
+            str(self.staging_dir),
+            "--platform",
+            TEST_PLATFORM,
+            "--run-id",
+            "local",
+        ]
+        artifact_manager.main(
+            ["push", "--stage", "upstream-stage", "--build-dir", str(self.build_dir)]
+            + common_argv
+        )
+        store_dir = Path(self.temp_dir) / "store"
+        artifact_manager.main(
+            [
+                "fetch",
+                "--stage",
+                "downstream-stage",
+                "--flatten",
+                "--content-store-dir",
+                str(store_dir),
+                "--content-store-link-mode",
+                "copy",
+                "--content-store-max-size-gb",
+                "0",
+                "--output-dir",
+                str(self.output_dir),
+            ]
+            + common_argv
+        )
+        self.assertEqual((self.output_dir / "lib" / "liblib.so").read_text(), "lib\n")
+        self.assertEqual(
+            [p for p in (store_dir / "sha256").rglob("*") if p.is_file()], []
+        )
+
+    def _index_only_backend(self, run_id: str) -> FailingBackend:
+        """Backend for `run_id` on which full archive downloads fail."""
+        backend = FailingBackend(staging_dir=self.staging_dir, run_id=run_id)
+        real_download = backend.download_artifact
+
+        def download_sidecars_only(artifact_key, dest_path):
+            if artifact_key.endswith(".tar.zst"):
+                raise RuntimeError(f"Unexpected archive download: {artifact_key}")
+            return real_download(artifact_key, dest_path)
+
+        backend.download_artifact = download_sidecars_only
+        return backend
+
+    def test_delta_against_previous_run(self):
+        """A delta pushed against run 1 completes a store populated from run 1."""
+        import artifact_manager
+
+        artifact_dir = self._create_real_artifact_dir("test-artifact", "lib")
+        common_argv = [
+            "--topology",
+            str(self.topology_path),
+            "--local-staging-dir",
+            str(self.staging_dir),
+            "--platform",
+            TEST_PLATFORM,
+        ]
+        push_argv = ["push", "--stage", "upstream-stage"] + common_argv
+        artifact_manager.main(
+            push_argv + ["--build-dir", str(self.build_dir), "--run-id", "1"]
+        )
+        lib_path = artifact_dir / "test" / "stage" / "lib" / "liblib.so"
+        lib_path.write_text("lib v2\n" * 1000)
+        artifact_manager.main(
+            push_argv
+            + ["--build-dir", str(self.build_dir), "--run-id", "2"]
+            + ["--delta-base-run-id", "1"]
+        )
+        deltas = list(self.staging_dir.rglob("*.delta"))
+        self.assertEqual(
+            [p.relative_to(self.staging_dir).as_posix() for p in deltas],
+            ["2-linux/test-artifact_lib_generic.tar.zst.delta"],
+        )
+
+        def fetch_argv(store_dir: Path, output_dir: Path, run_id: str):
+            return [
+                "fetch",
+                "--stage",
+                "downstream-stage",
+                "--flatten",
+                "--content-store-dir",
+                str(store_dir),
+                "--output-dir",
+                str(output_dir),
+                "--run-id",
+                run_id,
+            ] + common_argv
+
+        store_dir = Path(self.temp_dir) / "store"
+        artifact_manager.main(fetch_argv(store_dir, self.output_dir, "1"))
+
+        second_output = Path(self.temp_dir) / "output2"
+        with mock.patch(
+            "artifact_manager.create_backend_from_env",
+            return_value=self._index_only_backend("2"),
+        ):
+            artifact_manager.main(fetch_argv(store_dir, second_output, "2"))
+        self.assertEqual(
+            (second_output / "lib" / "liblib.so").read_text(), "lib v2\n" * 1000
+        )
+
+        # With an empty store, the delta does not apply and fetch falls back
+        # to the full archive.
+        third_output = Path(self.temp_dir) / "output3"
+        empty_store_dir = Path(self.temp_dir) / "empty-store"
+        artifact_manager.main(fetch_argv(empty_store_dir, third_output, "2"))
+        self.assertEqual((third_output / "README").read_text(), "shared\n")
+
+
+class TestFetchScheduling(ArtifactManagerTestBase):
+    """Tests for largest-first fetch scheduling, progressive extraction and
+    the fetch timeline."""
+
+    def setUp(self):
+        super().setUp()
+        import artifact_manager
+
+        # main() exports --local-staging-* options to the environment.
+        env_patcher = mock.patch.dict(os.environ)
+        env_patcher.start()
+        self.addCleanup(env_patcher.stop)
+
+        self._create_real_artifact_dir("test-artifact", "lib")
+        large_dir = self._create_real_artifact_dir("second-artifact", "lib")
+        self.large_contents = os.urandom(2 * 1024 * 1024)
+        (large_dir / "test" / "stage" / "lib" / "libbig.so").write_bytes(
+            self.large_contents
+        )
+        for stage in ["upstream-stage", "second-upstream-stage"]:
+            artifact_manager.main(
+                ["push", "--stage", stage, "--build-dir", str(self.build_dir)]
+                + self._common_argv()
+            )
+        self.timeline_path = Path(self.temp_dir) / "timeline.json"
+
+    def _common_argv(self) -> list[str]:
+        return [
+            "--topology",
+            str(self.topology_path),
+            "--local-staging-dir",
+            str(self.staging_dir),
+            "--platform",
+            TEST_PLATFORM,
+            "--run-id",
+            "local",
+        ]
+
+    def _fetch(self, backend=None, extra_argv=()):
+        import artifact_manager
+
+        argv = [
+            "fetch",
+            "--stage",
+            "downstream-stage",
+            "--output-dir",
+            str(self.output_dir),
+            "--flatten",
+            "--download-concurrency",
+            "1",
+            "--timeline-json",
+            str(self.timeline_path),
+            *extra_argv,
+        ] + self._common_argv()
+        if backend is None:
+            artifact_manager.main(argv)
+        else:
+            with mock.patch(
+                "artifact_manager.create_backend_from_env", return_value=backend
+            ):
+                artifact_manager.main(argv)
+
+    def test_largest_first_with_timeline(self):
+        # Not a LocalDirectoryBackend, so archives are streamed, not linked.
+        # Every download gets a progressive extraction, however many CPUs.
+        self._fetch(
+            FailingBackend(staging_dir=self.staging_dir),
+            extra_argv=["--progressive-extract-concurrency", "2"],
+        )
+        self.assertEqual(
+            (self.output_dir / "lib" / "libbig.so").read_bytes(), self.large_contents
+        )
+        self.assertEqual((self.output_dir / "lib" / "liblib.so").read_text(), "lib\n")
+
+        timeline = json.loads(self.timeline_path.read_text())
+        by_start = sorted(timeline, key=lambda e: e["download_start"])
+        self.assertEqual(
+            [e["artifact"] for e in by_start],
+            [
+                "second-artifact_lib_generic.tar.zst",
+                "test-artifact_lib_generic.tar.zst",
+            ],
+        )
+        for entry in timeline:
+            self.assertLessEqual(entry["queued"], entry["download_start"])
+            self.assertLessEqual(entry["download_start"], entry["download_end"])
+            # Extraction starts before its download completes.
+            self.assertLessEqual(entry["extract_start"], entry["download_end"])
+            self.assertGreaterEqual(entry["extract_end"], entry["download_end"])
+
+    @mock.patch("artifact_manager._delay_for_retry")
+    def test_throttled_download_is_reported(self, mock_delay):
+        from botocore.exceptions import ClientError
+
+        backend = FailingBackend(staging_dir=self.staging_dir)
+        real_open = backend.open_artifact
+        throttled = []
+
+        def open_artifact(artifact_key, start=0, length=None):
+            if artifact_key.endswith(ARTIFACT_EXTENSIONS) and not throttled:
+                throttled.append(artifact_key)
+                raise ClientError({"Error": {"Code": "SlowDown"}}, "GetObject")
+            return real_open(artifact_key, start, length)
+
+        backend.open_artifact = open_artifact
+        with mock.patch("artifact_manager.log") as mock_log:
+            self._fetch(backend)
+
+        self.assertEqual(len(throttled), 1)
+        summary = [
+            c.args[0]
+            for c in mock_log.call_args_list
+            if c.args[0].startswith("Download throughput:")
+        ]
+        self.assertEqual(len(summary), 1)
+        self.assertIn("concurrency 1 -> 1", summary[0])
+        self.assertIn("1 throttled", summary[0])
+
+    def test_local_staging_archives_are_linked(self):
+        cache_dir = Path(self.temp_dir) / "cache"
+        self._fetch(
+            extra_argv=[
+                "--download-cache-dir",
+                str(cache_dir),
+                "--local-staging-link-mode",
+                "hardlink",
+            ]
+        )
+        self.assertEqual(
+            (self.output_dir / "lib" / "libbig.so").read_bytes(), self.large_contents
+        )
+        key = "second-artifact_lib_generic.tar.zst"
+        staged = self.staging_dir / "local-linux" / key
+        cached = cache_dir / key
+        self.assertTrue(os.path.samefile(staged, cached))
+        self.assertFalse(Path(f"{cached}.partial").exists())
+
+    @mock.patch("artifact_manager._delay_for_retry")
+    def test_progressive_extraction_recovers_from_corrupt_download(self, mock_delay):
+        """A download that fails verification is extracted again once complete."""
+        backend = FailingBackend(staging_dir=self.staging_dir)
+        real_open = backend.open_artifact
+        corrupted = []
+
+        class CorruptingStream:
+            def __init__(self, f):
+                self._f = f
+
+            def read(self, size=-1):
+                data = self._f.read(size)
+                if data and len(data) < size:
+                    # Flip the last byte of the object.
+                    data = data[:-1] + bytes([data[-1] ^ 0xFF])
+                return data
+
+            def close(self):
+                self._f.close()
+
+        def open_artifact(artifact_key, start=0, length=None):
+            f = real_open(artifact_key, start, length)
+            if artifact_key.startswith("second-artifact") and not corrupted:
+                if artifact_key.endswith(".tar.zst"):
+                    corrupted.append(artifact_key)
+                    return CorruptingStream(f)
+            return f
+
+        backend.open_artifact = open_artifact
+        self._fetch(backend)
+        self.assertEqual(corrupted, ["second-artifact_lib_generic.tar.zst"])
+        self.assertEqual(
+            (self.output_dir / "lib" / "libbig.so").read_bytes(), self.large_contents
+        )
+
+    def test_progressive_extractions_are_capped(self):
+        import artifact_manager
+
+        running = []
+        max_running = []
+        real_extract = artifact_manager.extract_while_downloading
+
+        def extract_while_downloading(request, download_future):
+            running.append(request.archive_path.name)
+            max_running.append(len(running))
+            try:
+                return real_extract(request, download_future)
+            finally:
+                running.remove(request.archive_path.name)
+
+        with mock.patch(
+            "artifact_manager.extract_while_downloading",
+            side_effect=extract_while_downloading,
+        ):
+            self._fetch(
+                FailingBackend(staging_dir=self.staging_dir),
+                extra_argv=[
+                    "--download-concurrency",
+                    "2",
+                    "--progressive-extract-concurrency",
+                    "1",
+                ],
+            )
+        self.assertLessEqual(max(max_running), 1)
+        # Downloads without a progressive extraction are extracted once done.
+        self.assertEqual(
+            (self.output_dir / "lib" / "libbig.so").read_bytes(), self.large_contents
+        )
+        self.assertEqual((self.output_dir / "lib" / "liblib.so").read_text(), "lib\n")
+
+    def test_progressive_extraction_redone_after_restarted_download(self):
+        """Bytes extracted before the download restarted are not trusted."""
+        import artifact_manager
+        from _therock_utils.ranged_download import DownloadProgress
+
+        staged = self.staging_dir / "local-linux"
+        download = Path(self.temp_dir) / "second-artifact_lib_generic.tar.zst"
+        # The stream is read completely before the download fails verification.
+        shutil.copy(staged / "test-artifact_lib_generic.tar.zst", download)
+        progress = DownloadProgress()
+        size = download.stat().st_size
+        progress.start(download, size, [(0, size)])
+        progress.finish(download, size)
+
+        def download_result():
+            progress.start(download, size)
+            shutil.copy(staged / "second-artifact_lib_generic.tar.zst", download)
+            progress.finish(download, download.stat().st_size)
+            return download
+
+        download_future = mock.Mock()
+        download_future.result.side_effect = download_result
+        request = artifact_manager.ExtractRequest(
+            archive_path=download,
+            output_dir=self.output_dir,
+            delete_archive=False,
+            flatten=True,
+            progress=progress,
+        )
+        self.assertIsNotNone(
+            artifact_manager.extract_while_downloading(request, download_future)
+        )
+        self.assertEqual(
+            (self.output_dir / "lib" / "libbig.so").read_bytes(), self.large_contents
+        )
+
+
+class TestFetchStreamExtract(ArtifactManagerTestBase):
+    """Tests for fetch --stream-extract."""
+
+    def setUp(self):
+        super().setUp()
+        import artifact_manager
+
+        self._create_real_artifact_dir("test-artifact", "lib")
+        artifact_manager.main(
+            [
+                "push",
+                "--stage",
+                "upstream-stage",
+                "--build-dir",
+                str(self.build_dir),
+            ]
+            + self._common_argv()
+        )
+
+    def _common_argv(self) -> list[str]:
+        return [
+            "--topology",
+            str(self.topology_path),
+            "--local-staging-dir",
+            str(self.staging_dir),
+            "--platform",
+            TEST_PLATFORM,
+            "--run-id",
+            "local",
+        ]
+
+    def _fetch_argv(self, *extra_args: str) -> list[str]:
+        return [
+            "fetch",
+            "--stage",
+            "downstream-stage",
+            "--output-dir",
+            str(self.output_dir),
+            "--stream-extract",
+            *extra_args,
+        ] + self._common_argv()
+
+    def test_stream_extract_flatten(self):
+        import artifact_manager
+
+        artifact_manager.main(self._fetch_argv("--flatten"))
+        self.assertEqual((self.output_dir / "lib" / "liblib.so").read_text(), "lib\n")
+        self.assertFalse((self.output_dir / ".download_cache").exists())
+
+    def test_stream_extract_without_flatten(self):
+        import artifact_manager
+
+        artifact_manager.main(self._fetch_argv())
+        artifact_dir = self.output_dir / "artifacts" / "test-artifact_lib_generic"
+        self.assertTrue((artifact_dir / "artifact_manifest.txt").exists())
+        self.assertEqual(
+            (artifact_dir / "test" / "stage" / "README").read_text(), "shared\n"
+        )
+
+    @mock.patch("artifact_manager._delay_for_retry")
+    def test_stream_extract_retries_after_midstream_failure(self, mock_delay):
+        import artifact_manager
+
+        backend = FailingBackend(staging_dir=self.staging_dir)
+        real_open = backend.open_artifact
+        attempts = []
+
+        class DroppedStream:
+            def __init__(self, f):
+                self._f = f
+
+            def read(self, size=-1):
+                data = self._f.read(size if 0 <= size < 64 else 64)
+                if self._f.tell() > 64:
+                    raise ConnectionError("Simulated connection reset")
+                return data
+
+            def close(self):
+                self._f.close()
+
+        def flaky_open(artifact_key):
+            f = real_open(artifact_key)
+            if not artifact_key.endswith(ARTIFACT_EXTENSIONS):
+                return f  # E.g. the run index
+            attempts.append(artifact_key)
+            return DroppedStream(f) if len(attempts) == 1 else f
+
+        backend.open_artifact = flaky_open
+        with mock.patch(
+            "artifact_manager.create_backend_from_env", return_value=backend
+        ):
+            artifact_manager.main(self._fetch_argv("--flatten"))
+        self.assertEqual(len(attempts), 2)
+        self.assertEqual(mock_delay.call_count, 1)
+        self.assertEqual((self.output_dir / "README").read_text(), "shared\n")
+
+    def test_stream_extract_rejects_download_cache(self):
+        import artifact_manager
+
+        with self.assertRaises(SystemExit):
+            artifact_manager.main(
+                self._fetch_argv(
+                    "--download-cache-dir", str(Path(self.temp_dir) / "cache")
+                )
+            )
+
+
+class TestFetchLazyMount(ArtifactManagerTestBase):
+    """Tests for fetch --lazy-mount (with the FUSE mount itself mocked)."""
+
+    def setUp(self):
+        super().setUp()
+        import artifact_manager
+
+        self._create_real_artifact_dir("test-artifact", "lib")
+        self._create_real_artifact_dir("second-artifact", "run")
+        for stage in ["upstream-stage", "second-upstream-stage"]:
+            artifact_manager.main(
+                ["push", "--stage", stage, "--build-dir", str(self.build_dir)]
+                + self._common_argv()
+            )
+        self.store_dir = Path(self.temp_dir) / "store"
+
+    def _common_argv(self) -> list[str]:
+        return [
+            "--topology",
+            str(self.topology_path),
+            "--local-staging-dir",
+            str(self.staging_dir),
+            "--platform",
+            TEST_PLATFORM,
+            "--run-id",
+            "local",
+        ]
+
+    def _fetch_argv(self, *extra_args: str) -> list[str]:
+        return [
+            "fetch",
+            "--stage",
+            "downstream-stage",
+            "--output-dir",
+            str(self.output_dir),
+            "--lazy-mount",
+            *extra_args,
+        ] + self._common_argv()
+
+    def test_archives_fetched_on_first_open(self):
+        import artifact_manager
+
+        backend = FailingBackend(staging_dir=self.staging_dir)
+        real_download = backend.download_artifact
+        real_open = backend.open_artifact
+        downloaded = []
+
+        def recording_download(artifact_key, dest_path):
+            downloaded.append(artifact_key)
+            return real_download(artifact_key, dest_path)
+
+        def recording_open(artifact_key, start=0, length=None):
+            if artifact_key.endswith(ARTIFACT_EXTENSIONS):
+                downloaded.append(artifact_key)
+            return real_open(artifact_key, start, length)
+
+        backend.download_artifact = recording_download
+        backend.open_artifact = recording_open
+        with mock.patch(
+            "artifact_manager.create_backend_from_env", return_value=backend
+        ), mock.patch("artifact_manager.mount") as mock_mount:
+            artifact_manager.main(
+                self._fetch_argv(
+                    "--flatten", "--content-store-dir", str(self.store_dir)
+                )
+            )
+        prefix, mount_dir = mock_mount.call_args.args
+        self.assertEqual(mount_dir, self.output_dir)
+        self.assertEqual(len(downloaded), 2)
+        self.assertTrue(all(key.endswith(".index.json") for key in downloaded))
+        self.assertEqual(sorted(prefix.listdir("lib")), ["liblib.so", "librun.so"])
+
+        # Serve reads the way the mount would, without mounting.
+        downloaded.clear()
+        ops = LazyPrefixOperations(prefix)
+        for _ in range(2):
+            fh = ops("open", "/lib/librun.so", os.O_RDONLY)
+            try:
+                self.assertEqual(ops("read", "/lib/librun.so", 100, 0, fh), b"run\n")
+                self.assertEqual(ops("read", "/lib/librun.so", 100, 2, fh), b"n\n")
+            finally:
+                ops("release", "/lib/librun.so", fh)
+        self.assertEqual(downloaded, ["second-artifact_run_generic.tar.zst"])
+        self.assertFalse((self.output_dir / ".download_cache").exists())
+
+    def test_requires_content_store(self):
+        import artifact_manager
+
+        with self.assertRaises(SystemExit):
+            artifact_manager.main(self._fetch_argv("--flatten"))
+
+
+class TestRunIndex(ArtifactManagerTestBase):
+    """Tests for the run index published by push and used by fetch and copy."""
+
+    def setUp(self):
+        super().setUp()
+        env_patcher = mock.patch.dict(os.environ)
+        env_patcher.start()
+        self.addCleanup(env_patcher.stop)
+        self._create_real_artifact_dir("test-artifact", "lib")
+        self._create_real_artifact_dir("second-artifact", "lib")
+
+    def _common_argv(self, run_id="local") -> list[str]:
+        return [
+            "--topology",
+            str(self.topology_path),
+            "--local-staging-dir",
+            str(self.staging_dir),
+            "--platform",
+            TEST_PLATFORM,
+            "--run-id",
+            run_id,
+        ]
+
+    def _push(self, stage: str):
+        import artifact_manager
+
+        artifact_manager.main(
+            ["push", "--stage", stage, "--build-dir", str(self.build_dir)]
+            + self._common_argv()
+        )
+
+    def _fetch(self, extra_argv=()):
+        import artifact_manager
+
+        artifact_manager.main(
+            [
+                "fetch",
+                "--stage",
+                "downstream-stage",
+                "--output-dir",
+                str(self.output_dir),
+                "--flatten",
+                *extra_argv,
+            ]
+            + self._common_argv()
+        )
+
+    def _backend(self, run_id="local") -> LocalDirectoryBackend:
+        return LocalDirectoryBackend(
+            staging_dir=self.staging_dir,
+            output_root=WorkflowOutputRoot.for_local(
+                run_id=run_id, platform=TEST_PLATFORM
+            ),
+        )
+
+    def test_push_publishes_fragment(self):
+        from _therock_utils.run_index import RunIndexFragmentName, load_run_index
+
+        self._push("upstream-stage")
+
+        index = load_run_index(self._backend())
+        self.assertEqual(
+            index.fragments, [RunIndexFragmentName("upstream-stage", ("generic",))]
+        )
+        entry = index.entries["test-artifact_lib_generic.tar.zst"]
+        archive = self.staging_dir / "local-linux" / "test-artifact_lib_generic.tar.zst"
+        self.assertEqual(entry.size, archive.stat().st_size)
+        self.assertEqual(entry.sha256, hashlib.sha256(archive.read_bytes()).hexdigest())
+        self.assertEqual(entry.file_count, 2)
+        self.assertIn(".sha256sum", entry.sidecars)
+
+    def test_fetch_uses_index_instead_of_listing(self):
+        self._push("upstream-stage")
+        self._push("second-upstream-stage")
+        index_file = Path(self.temp_dir) / "run_index.json"
+
+        with mock.patch.object(
+            LocalDirectoryBackend,
+            "_list_objects",
+            side_effect=AssertionError("run was listed"),
+        ):
+            self._fetch(["--run-index-file", str(index_file)])
+
+        self.assertTrue((self.output_dir / "lib" / "liblib.so").exists())
+        self.assertTrue(index_file.exists())
+
+    def test_fetch_lists_run_when_a_stage_has_no_fragment(self):
+        self._push("upstream-stage")
+        self._push("second-upstream-stage")
+        fragment = (
+            self.staging_dir
+            / "local-linux"
+            / "artifact_index"
+            / "second-upstream-stage.generic.json"
+        )
+        fragment.unlink()
+
+        with mock.patch.object(
+            LocalDirectoryBackend,
+            "_list_objects",
+            autospec=True,
+            side_effect=lambda backend: LocalDirectoryBackend._scan_files(
+                backend.base_path
+            ),
+        ) as list_objects:
+            self._fetch()
+        list_objects.assert_called()
+
+    def test_index_must_cover_each_family_of_per_arch_stages(self):
+        import artifact_manager
+        from _therock_utils.build_topology import BuildStage
+        from _therock_utils.run_index import (
+            RunIndex,
+            RunIndexEntry,
+            publish_run_index_fragment,
+        )
+
+        index = RunIndex()
+        index.add(RunIndexEntry.for_archive("blas_lib_gfx942.tar.zst", 10, "0" * 64))
+        publish_run_index_fragment(self._backend(), index, "math-libs", self.temp_dir)
+        topology = mock.Mock()
+        topology.get_build_stages.return_value = [
+            BuildStage("math-libs", "", ["math-libs"], type="per-arch")
+        ]
+        topology.get_produced_artifacts.return_value = {"blas"}
+
+        for families, covered in [
+            (["generic", "gfx942"], True),
+            (["generic", "gfx942", "gfx1100"], False),
+            (["generic"], True),
+        ]:
+            with self.subTest(families=families):
+                loaded = artifact_manager.load_covering_run_index(
+                    self._backend(), topology, {"blas"}, target_families=families
+                )
+                self.assertEqual(loaded is not None, covered)
+
+    def test_push_of_nothing_publishes_no_fragment(self):
+        from _therock_utils.run_index import list_run_index_fragments
+
+        for item in (self.build_dir / "artifacts").iterdir():
+            shutil.rmtree(item)
+        self._push("upstream-stage")
+        self.assertEqual(list_run_index_fragments(self._backend()), [])
+
+    @mock.patch("artifact_manager._delay_for_retry")
+    def test_copy_republishes_fragment(self, mock_delay):
+        import artifact_manager
+        from _therock_utils.run_index import load_run_index
+
+        self._push("upstream-stage")
+        artifact_manager.main(
+            ["copy", "--source-run-id", "local", "--stage", "upstream-stage"]
+            + self._common_argv(run_id="dest-run")
+        )
+
+        source_index = load_run_index(self._backend())
+        dest_index = load_run_index(self._backend("dest-run"))
+        self.assertEqual(dest_index.fragments, source_index.fragments)
+        self.assertEqual(dest_index.entries, source_index.entries)
+
+
 class TestCopy(ArtifactManagerTestBase):
     """Tests for the copy subcommand."""
 
@@ -1423,6 +2871,7 @@ class ParseTargetFamiliesTest(unittest.TestCase):
         amdgpu_families: str = "",
         amdgpu_targets: str = "",
         generic_only: bool = False,
+        skip_generic: bool = False,
         expand_family_to_targets: bool = False,
     ):
         import argparse
@@ -1431,6 +2880,7 @@ class ParseTargetFamiliesTest(unittest.TestCase):
             amdgpu_families=amdgpu_families,
             amdgpu_targets=amdgpu_targets,
             generic_only=generic_only,
+            skip_generic=skip_generic,
             expand_family_to_targets=expand_family_to_targets,
         )
 
@@ -1439,6 +2889,11 @@ class ParseTargetFamiliesTest(unittest.TestCase):
         result = self.am.parse_target_families(args)
         self.assertEqual(result, ["generic"])
 
+    def test_skip_generic(self):
+        args = self._make_args(amdgpu_families="gfx110X-all", skip_generic=True)
+        result = self.am.parse_target_families(args)
+        self.assertEqual(result, ["gfx110X-all"])
+
     def test_family_no_expansion(self):
         args = self._make_args(amdgpu_families="gfx110X-all")
         result = self.am.parse_target_families(args)
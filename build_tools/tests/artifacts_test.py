@@ -11,7 +11,13 @@ import sys
 
 sys.path.insert(0, os.fspath(Path(__file__).parent.parent))
 
-from _therock_utils.artifacts import ArtifactName
+from _therock_utils.artifacts import (
+    ArtifactContents,
+    ArtifactName,
+    write_artifact_archive,
+)
+from _therock_utils.archive_util import open_archive_for_read
+from _therock_utils.content_store import ArtifactFileIndex
 import _therock_utils.artifact_builder as builder
 
 
@@ -77,6 +83,51 @@ class ArtifactNameTest(TmpDirTestCase):
         self.assertIsNone(an_invalid2)
 
 
+class ArtifactContentsTest(TmpDirTestCase):
+    def _make_artifact(self) -> Path:
+        artifact_dir = self.temp_dir / "blas_lib_generic"
+        self.write_indented(
+            "blas_lib_generic/artifact_manifest.txt", "math-libs/stage\nmissing\n"
+        )
+        (artifact_dir / "math-libs/stage/lib").mkdir(parents=True)
+        (artifact_dir / "math-libs/stage/lib/libblas.so.1").write_bytes(b"x" * 100)
+        os.symlink("libblas.so.1", artifact_dir / "math-libs/stage/lib/libblas.so")
+        return artifact_dir
+
+    def testScan(self):
+        artifact_dir = self._make_artifact()
+        contents = ArtifactContents.scan([artifact_dir])
+        self.assertEqual(contents.manifest, ["math-libs/stage", "missing"])
+        arcnames = [arcname for arcname, _ in contents.entries]
+        self.assertEqual(arcnames[0], "artifact_manifest.txt")
+        self.assertEqual(
+            sorted(arcnames[1:]),
+            [
+                "math-libs/stage/lib",
+                "math-libs/stage/lib/libblas.so",
+                "math-libs/stage/lib/libblas.so.1",
+            ],
+        )
+        # The manifest and the library (not the symlink).
+        manifest_size = (artifact_dir / "artifact_manifest.txt").stat().st_size
+        self.assertEqual(contents.file_count, 2)
+        self.assertEqual(contents.file_size, 100 + manifest_size)
+
+    def testWriteArtifactArchive(self):
+        contents = ArtifactContents.scan([self._make_artifact()])
+        archive_path = self.temp_dir / "out" / "blas_lib_generic.tar.zst"
+        index_path = self.temp_dir / "out" / "blas_lib_generic.tar.zst.index.json"
+        write_artifact_archive(contents, archive_path, "zstd", index_path=index_path)
+
+        with open_archive_for_read(archive_path) as tf:
+            self.assertEqual(
+                sorted(tf.getnames()), sorted(a for a, _ in contents.entries)
+            )
+        index = ArtifactFileIndex.load(index_path)
+        self.assertEqual(index.manifest, contents.manifest)
+        self.assertEqual(index.total_file_size, 100)
+
+
 class ArtifactDescriptorTomlValidationTest(TmpDirTestCase):
     def testTopLevel(self):
         self.write_indented(
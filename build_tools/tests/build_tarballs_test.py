@@ -3,6 +3,8 @@
 
 import json
 import os
+import shutil
+import subprocess
 import sys
 import tarfile
 import tempfile
@@ -16,13 +18,29 @@ from unittest import mock
 
 sys.path.insert(0, os.fspath(Path(__file__).parent.parent))
 
-from build_tarballs import compress_tarball, is_kpack_split, main
+from _therock_utils.archive_util import open_archive_for_read
+from build_tarballs import (
+    build_image,
+    compress_tarball,
+    default_mtime,
+    fetch_and_flatten,
+    fetch_family_layer,
+    group_overlapping_families,
+    image_command,
+    is_kpack_split,
+    main,
+)
 
 
 class MainMocks(NamedTuple):
     fetch: mock.Mock
     compress: mock.Mock
     kpack: mock.Mock
+    multiarch: mock.Mock
+
+
+def _fake_indexes(*, generic_dir, family_dirs, threads):
+    return {"_generic": {}, **{family: {} for family in family_dirs}}
 
 
 class InlineProcessPoolExecutor:
@@ -97,6 +115,303 @@ class TestCompressTarball(unittest.TestCase):
                 self.assertIn("./bin/hello", names)
                 self.assertIn("./lib/libfoo.so", names)
 
+    def test_creates_zstd_tarball_alongside(self):
+        with tempfile.TemporaryDirectory() as tmpdir:
+            tmpdir = Path(tmpdir)
+            src = tmpdir / "src"
+            (src / "lib").mkdir(parents=True)
+            (src / "lib" / "libfoo.so").write_bytes(os.urandom(3 << 20))
+
+            tarball_path = tmpdir / "test.tar.gz"
+            zstd_tarball_path = tmpdir / "test.tar.zst"
+            compress_tarball(
+                source_dir=src,
+                tarball_path=tarball_path,
+                threads=2,
+                zstd_tarball_path=zstd_tarball_path,
+            )
+
+            with tarfile.open(tarball_path, "r:gz") as tf:
+                gz_data = tf.extractfile("./lib/libfoo.so").read()
+            with open_archive_for_read(zstd_tarball_path) as tf:
+                zstd_data = tf.extractfile("./lib/libfoo.so").read()
+            self.assertEqual(gz_data, (src / "lib" / "libfoo.so").read_bytes())
+            self.assertEqual(zstd_data, gz_data)
+
+    def test_unchanged_tree_gives_identical_tarball(self):
+        with tempfile.TemporaryDirectory() as tmpdir:
+            tmpdir = Path(tmpdir)
+            src = tmpdir / "src"
+            (src / "lib").mkdir(parents=True)
+            (src / "lib" / "libfoo.so").write_bytes(b"foo" * 1000)
+
+            compress_tarball(source_dir=src, tarball_path=tmpdir / "a.tar.gz")
+            # Same contents, rewritten later.
+            (src / "lib" / "libfoo.so").write_bytes(b"foo" * 1000)
+            os.utime(src / "lib" / "libfoo.so", (2_000_000_000, 2_000_000_000))
+            compress_tarball(
+                source_dir=src, tarball_path=tmpdir / "b.tar.gz", threads=2
+            )
+
+            self.assertEqual(
+                (tmpdir / "a.tar.gz").read_bytes(), (tmpdir / "b.tar.gz").read_bytes()
+            )
+
+    def test_tar_failure_raises(self):
+        with tempfile.TemporaryDirectory() as tmpdir:
+            tmpdir = Path(tmpdir)
+            with self.assertRaises(Exception):
+                compress_tarball(
+                    source_dir=tmpdir / "missing", tarball_path=tmpdir / "t.tar.gz"
+                )
+
+    def test_failure_removes_partial_tarballs(self):
+        with tempfile.TemporaryDirectory() as tmpdir:
+            tmpdir = Path(tmpdir)
+            src = tmpdir / "src"
+            src.mkdir()
+            (src / "file.txt").write_text("hello")
+            # tar writes part of the stream, then fails.
+            with mock.patch(
+                "build_tarballs.tar_command",
+                return_value=["sh", "-c", "printf partial; exit 2"],
+            ):
+                with self.assertRaises(subprocess.CalledProcessError):
+                    compress_tarball(
+                        source_dir=src,
+                        tarball_path=tmpdir / "t.tar.gz",
+                        zstd_tarball_path=tmpdir / "t.tar.zst",
+                    )
+            self.assertEqual(list(tmpdir.glob("t.*")), [])
+
+    def test_members_are_normalized(self):
+        with tempfile.TemporaryDirectory() as tmpdir:
+            tmpdir = Path(tmpdir)
+            src = tmpdir / "src"
+            (src / "bin").mkdir(parents=True)
+            (src / "bin" / "tool").write_text("#!/bin/sh\n")
+            (src / "bin" / "tool").chmod(0o775)
+            (src / "data.txt").write_text("data")
+            (src / "data.txt").chmod(0o664)
+            os.utime(src / "data.txt", (1000, 1000))
+
+            compress_tarball(
+                source_dir=src, tarball_path=tmpdir / "t.tar.gz", mtime=2000
+            )
+
+            with tarfile.open(tmpdir / "t.tar.gz", "r:gz") as tf:
+                members = {m.name: m for m in tf.getmembers()}
+            self.assertEqual(list(members), sorted(members))
+            for member in members.values():
+                self.assertEqual((member.uid, member.gid), (0, 0))
+            self.assertEqual(members["./bin/tool"].mode, 0o755)
+            self.assertEqual(members["./bin/tool"].mtime, 2000)
+            self.assertEqual(members["./data.txt"].mode, 0o644)
+            self.assertEqual(members["./data.txt"].mtime, 1000)
+
+
+class TestDefaultMtime(unittest.TestCase):
+    def test_source_date_epoch(self):
+        with tempfile.TemporaryDirectory() as tmpdir:
+            with mock.patch.dict(os.environ, {"SOURCE_DATE_EPOCH": "1234"}):
+                self.assertEqual(default_mtime(Path(tmpdir)), 1234)
+
+    def _write_manifest(self, tree: Path, commit: str):
+        manifest_path = tree / "share" / "therock" / "therock_manifest.json"
+        manifest_path.parent.mkdir(parents=True)
+        manifest_path.write_text(json.dumps({"the_rock_commit": commit}))
+
+    def test_local_commit_time(self):
+        with tempfile.TemporaryDirectory() as tmpdir:
+            tree = Path(tmpdir)
+            self._write_manifest(tree, "abc123")
+            with mock.patch.dict(os.environ), mock.patch(
+                "build_tarballs.has_commit", return_value=True
+            ), mock.patch(
+                "build_tarballs.commit_time", return_value=1_600_000_000
+            ) as commit_time_mock:
+                os.environ.pop("SOURCE_DATE_EPOCH", None)
+                self.assertEqual(default_mtime(tree), 1_600_000_000)
+            self.assertEqual(commit_time_mock.call_args.args[1], "abc123")
+
+    def test_github_commit_time(self):
+        with tempfile.TemporaryDirectory() as tmpdir:
+            tree = Path(tmpdir)
+            self._write_manifest(tree, "abc123")
+            # Fetching stamps files with the current time, which must not
+            # leak into the clamp time.
+            os.utime(
+                tree / "share" / "therock" / "therock_manifest.json",
+                (2_000_000_000, 2_000_000_000),
+            )
+            response = {"commit": {"committer": {"date": "2020-09-13T12:26:40Z"}}}
+            with mock.patch.dict(os.environ), mock.patch(
+                "build_tarballs.has_commit", return_value=False
+            ), mock.patch(
+                "github_actions.github_actions_api.gha_send_request",
+                return_value=response,
+            ) as request_mock:
+                os.environ.pop("SOURCE_DATE_EPOCH", None)
+                self.assertEqual(default_mtime(tree, "ROCm/TheRock"), 1_600_000_000)
+            request_mock.assert_called_once_with(
+                "https://api.github.com/repos/ROCm/TheRock/commits/abc123"
+            )
+
+    def test_no_manifest(self):
+        with tempfile.TemporaryDirectory() as tmpdir:
+            with mock.patch.dict(os.environ):
+                os.environ.pop("SOURCE_DATE_EPOCH", None)
+                self.assertEqual(default_mtime(Path(tmpdir)), 0)
+
+
+class TestBuildImage(unittest.TestCase):
+    def _make_trees(self, tmpdir: Path) -> dict[str, Path]:
+        generic = tmpdir / "_generic"
+        (generic / "lib").mkdir(parents=True)
+        (generic / "lib" / "libamdhip64.so").write_bytes(b"hip" * 1000)
+        trees = {}
+        for family in ["gfx94X-dcgpu", "gfx110X-all"]:
+            tree = tmpdir / family
+            shutil.copytree(generic, tree, copy_function=os.link)
+            (tree / "lib" / f"{family}.co").write_text(family)
+            trees[family] = tree
+        return trees
+
+    def test_squashfs_command(self):
+        cmd = image_command(
+            "squashfs", Path("src"), Path("out.squashfs"), threads=4, mtime=123
+        )
+        self.assertEqual(cmd[:3], ["mksquashfs", Path("src"), Path("out.squashfs")])
+        for flags in [
+            ["-all-time", "123"],
+            ["-mkfs-time", "123"],
+            ["-processors", "4"],
+            ["-comp", "zstd"],
+        ]:
+            self.assertIn(flags, [cmd[i : i + 2] for i in range(len(cmd))])
+        self.assertIn("-all-root", cmd)
+
+    def test_erofs_command(self):
+        cmd = image_command("erofs", Path("src"), Path("out.erofs"), mtime=123)
+        self.assertEqual(cmd[0], "mkfs.erofs")
+        self.assertEqual(cmd[-2:], [Path("out.erofs"), Path("src")])
+        self.assertIn("-T123", cmd)
+        self.assertIn("-Ededupe", cmd)
+
+    def test_stages_trees_with_shared_inodes(self):
+        with tempfile.TemporaryDirectory() as tmpdir:
+            tmpdir = Path(tmpdir)
+            trees = self._make_trees(tmpdir)
+            staging_dir = tmpdir / "image"
+            image_path = tmpdir / "out" / "dist.squashfs"
+            staged = {}
+
+            def fake_run(args, cwd=None):
+                for family in trees:
+                    path = staging_dir / family / "lib" / "libamdhip64.so"
+                    staged[family] = path.stat().st_ino
+                self.assertTrue((staging_dir / "gfx110X-all" / "lib").is_dir())
+                image_path.write_bytes(b"image")
+
+            with mock.patch("build_tarballs.run_command", side_effect=fake_run):
+                build_image(
+                    trees=trees,
+                    image_path=image_path,
+                    image_format="squashfs",
+                    staging_dir=staging_dir,
+                )
+
+            self.assertEqual(len(set(staged.values())), 1)
+            self.assertFalse(staging_dir.exists())
+
+    @unittest.skipUnless(
+        shutil.which("mksquashfs") and shutil.which("unsquashfs"),
+        "requires squashfs-tools",
+    )
+    def test_builds_identical_squashfs_images(self):
+        with tempfile.TemporaryDirectory() as tmpdir:
+            tmpdir = Path(tmpdir)
+            trees = self._make_trees(tmpdir)
+            for name in ["a.squashfs", "b.squashfs"]:
+                build_image(
+                    trees=trees,
+                    image_path=tmpdir / name,
+                    image_format="squashfs",
+                    staging_dir=tmpdir / "image",
+                )
+            self.assertEqual(
+                (tmpdir / "a.squashfs").read_bytes(),
+                (tmpdir / "b.squashfs").read_bytes(),
+            )
+            listing = subprocess.check_output(
+                ["unsquashfs", "-l", str(tmpdir / "a.squashfs")], text=True
+            )
+            self.assertIn("gfx94X-dcgpu/lib/libamdhip64.so", listing)
+            self.assertIn("gfx110X-all/lib/gfx110X-all.co", listing)
+
+
+class TestFetchAndFlatten(unittest.TestCase):
+    def _fetch_cmd(self, **kwargs) -> list[str]:
+        with mock.patch("build_tarballs.run_command") as run_mock:
+            fetch_and_flatten(
+                run_id="123",
+                platform="linux",
+                output_dir=Path("/tmp/out"),
+                download_cache_dir=Path("/tmp/cache"),
+                **kwargs,
+            )
+        return run_mock.call_args.args[0]
+
+    def test_generic_only(self):
+        cmd = self._fetch_cmd(amdgpu_families=[], generic_only=True)
+        self.assertIn("--generic-only", cmd)
+        self.assertFalse(any(c.startswith("--amdgpu-families") for c in cmd))
+
+    def test_skip_generic(self):
+        cmd = self._fetch_cmd(amdgpu_families=["gfx94X-dcgpu"], skip_generic=True)
+        self.assertIn("--amdgpu-families=gfx94X-dcgpu", cmd)
+        self.assertIn("--skip-generic", cmd)
+
+
+class TestFetchFamilyLayer(unittest.TestCase):
+    def test_links_generic_layer_then_fetches_family(self):
+        with tempfile.TemporaryDirectory() as tmpdir:
+            tmpdir = Path(tmpdir)
+            generic_dir = tmpdir / "_generic"
+            (generic_dir / "lib").mkdir(parents=True)
+            (generic_dir / "lib" / "libamdhip64.so").write_text("hip")
+            output_dir = tmpdir / "gfx94X-dcgpu"
+            (output_dir / "stale").mkdir(parents=True)
+
+            with mock.patch("build_tarballs.fetch_and_flatten") as fetch_mock:
+                fetch_family_layer(
+                    generic_dir=generic_dir,
+                    output_dir=output_dir,
+                    amdgpu_families=["gfx94X-dcgpu"],
+                )
+
+            self.assertEqual((output_dir / "lib" / "libamdhip64.so").read_text(), "hip")
+            self.assertFalse((output_dir / "stale").exists())
+            self.assertTrue(fetch_mock.call_args.kwargs["skip_generic"])
+            self.assertEqual(fetch_mock.call_args.kwargs["output_dir"], output_dir)
+
+
+class TestGroupOverlappingFamilies(unittest.TestCase):
+    def test_groups(self):
+        fake_map = {
+            "gfx94X-dcgpu": ["gfx942"],
+            "gfx110X-all": ["gfx1100", "gfx1101"],
+            "gfx1100": ["gfx1100"],
+            "gfx120X-all": ["gfx1200"],
+        }
+        with mock.patch("build_tarballs.amdgpu_family_map", return_value=fake_map):
+            groups = group_overlapping_families(
+                ["gfx94X-dcgpu", "gfx110X-all", "gfx120X-all", "gfx1100"]
+            )
+        self.assertEqual(
+            groups, [["gfx94X-dcgpu"], ["gfx110X-all", "gfx1100"], ["gfx120X-all"]]
+        )
+
 
 class TestMain(unittest.TestCase):
     def _run_main_with_mocks(
@@ -107,21 +422,25 @@ class TestMain(unittest.TestCase):
     ) -> MainMocks:
         patches = [
             mock.patch("build_tarballs.fetch_and_flatten"),
+            mock.patch("build_tarballs.link_tree", return_value={}),
             mock.patch("build_tarballs.compress_tarball"),
             mock.patch("build_tarballs.is_kpack_split", return_value=kpack_split),
             mock.patch("build_tarballs.ProcessPoolExecutor", InlineProcessPoolExecutor),
+            mock.patch("build_tarballs.index_family_trees", side_effect=_fake_indexes),
+            mock.patch("build_tarballs.assemble_multiarch_tree"),
         ]
-        with patches[0] as fetch_mock:
-            with patches[1] as compress_mock:
-                with patches[2] as kpack_mock:
-                    with patches[3]:
-                        main(argv)
-        return MainMocks(fetch_mock, compress_mock, kpack_mock)
+        with patches[0] as fetch_mock, patches[1]:
+            with patches[2] as compress_mock:
+                with patches[3] as kpack_mock:
+                    with patches[4], patches[5]:
+                        with patches[6] as multiarch_mock:
+                            main(argv)
+        return MainMocks(fetch_mock, compress_mock, kpack_mock, multiarch_mock)
 
     def test_default_builds_tarballs_without_tests_only(self) -> None:
         with tempfile.TemporaryDirectory() as tmpdir:
             output_dir = Path(tmpdir) / "tarballs"
-            fetch_mock, compress_mock, _ = self._run_main_with_mocks(
+            fetch_mock, compress_mock, *_ = self._run_main_with_mocks(
                 [
                     "--run-id=123",
                     "--dist-amdgpu-families=gfx94X-dcgpu",
@@ -131,9 +450,18 @@ class TestMain(unittest.TestCase):
                 ]
             )
 
-        self.assertEqual(fetch_mock.call_count, 1)
-        self.assertEqual(fetch_mock.call_args.kwargs["exclude_components"], ["test"])
-        self.assertEqual(fetch_mock.call_args.kwargs["exclude_artifacts"], ["fftw3"])
+        # The generic layer, then the family on top of it.
+        self.assertEqual(fetch_mock.call_count, 2)
+        generic_call, family_call = fetch_mock.call_args_list
+        self.assertTrue(generic_call.kwargs["generic_only"])
+        self.assertEqual(
+            generic_call.kwargs["output_dir"], output_dir / ".work" / "_generic"
+        )
+        self.assertTrue(family_call.kwargs["skip_generic"])
+        self.assertEqual(family_call.kwargs["amdgpu_families"], ["gfx94X-dcgpu"])
+        for call in fetch_mock.call_args_list:
+            self.assertEqual(call.kwargs["exclude_components"], ["test"])
+            self.assertEqual(call.kwargs["exclude_artifacts"], ["fftw3"])
 
         compressed_names = [
             call.kwargs["tarball_path"].name for call in compress_mock.call_args_list
@@ -146,7 +474,7 @@ class TestMain(unittest.TestCase):
     def test_kpack_builds_common_tarball_with_one_family(self) -> None:
         with tempfile.TemporaryDirectory() as tmpdir:
             output_dir = Path(tmpdir) / "tarballs"
-            fetch_mock, compress_mock, _ = self._run_main_with_mocks(
+            fetch_mock, compress_mock, _, multiarch_mock = self._run_main_with_mocks(
                 [
                     "--run-id=123",
                     "--dist-amdgpu-families=gfx94X-dcgpu",
@@ -157,7 +485,17 @@ class TestMain(unittest.TestCase):
                 kpack_split=True,
             )
 
+        # The multi-arch tree is assembled from the family tree, not fetched.
         self.assertEqual(fetch_mock.call_count, 2)
+        work_dir = output_dir / ".work"
+        multiarch_mock.assert_called_once()
+        self.assertEqual(
+            multiarch_mock.call_args.kwargs["family_dirs"],
+            {"gfx94X-dcgpu": work_dir / "gfx94X-dcgpu"},
+        )
+        self.assertEqual(
+            multiarch_mock.call_args.kwargs["output_dir"], work_dir / "multiarch"
+        )
 
         compressed_names = [
             call.kwargs["tarball_path"].name for call in compress_mock.call_args_list
@@ -170,10 +508,50 @@ class TestMain(unittest.TestCase):
             ],
         )
 
+    def test_compress_threads_are_split(self) -> None:
+        with tempfile.TemporaryDirectory() as tmpdir:
+            output_dir = Path(tmpdir) / "tarballs"
+            _, compress_mock, *_ = self._run_main_with_mocks(
+                [
+                    "--run-id=123",
+                    "--dist-amdgpu-families=gfx94X-dcgpu;gfx110X-all",
+                    "--platform=linux",
+                    "--package-version=7.13.0",
+                    f"--output-dir={output_dir}",
+                    "--compress-threads=16",
+                    "--zstd",
+                ]
+            )
+
+        self.assertEqual(compress_mock.call_count, 2)
+        for call in compress_mock.call_args_list:
+            self.assertEqual(call.kwargs["threads"], 8)
+            self.assertEqual(
+                call.kwargs["zstd_tarball_path"].name,
+                call.kwargs["tarball_path"].name.replace(".tar.gz", ".tar.zst"),
+            )
+
+    def test_compress_threads_below_one(self) -> None:
+        with tempfile.TemporaryDirectory() as tmpdir:
+            output_dir = Path(tmpdir) / "tarballs"
+            _, compress_mock, *_ = self._run_main_with_mocks(
+                [
+                    "--run-id=123",
+                    "--dist-amdgpu-families=gfx94X-dcgpu",
+                    "--platform=linux",
+                    "--package-version=7.13.0",
+                    f"--output-dir={output_dir}",
+                    "--compress-threads=0",
+                ]
+            )
+
+        compress_mock.assert_called_once()
+        self.assertEqual(compress_mock.call_args.kwargs["threads"], 1)
+
     def test_include_test_tarballs_builds_both_sets(self) -> None:
         with tempfile.TemporaryDirectory() as tmpdir:
             output_dir = Path(tmpdir) / "tarballs"
-            fetch_mock, compress_mock, _ = self._run_main_with_mocks(
+            fetch_mock, compress_mock, *_ = self._run_main_with_mocks(
                 [
                     "--run-id=123",
                     "--dist-amdgpu-families=gfx94X-dcgpu",
@@ -184,15 +562,16 @@ class TestMain(unittest.TestCase):
                 ]
             )
 
-        self.assertEqual(fetch_mock.call_count, 2)
-        self.assertEqual(
-            fetch_mock.call_args_list[0].kwargs["exclude_components"], ["test"]
-        )
-        self.assertEqual(
-            fetch_mock.call_args_list[0].kwargs["exclude_artifacts"], ["fftw3"]
-        )
-        self.assertNotIn("exclude_components", fetch_mock.call_args_list[1].kwargs)
-        self.assertNotIn("exclude_artifacts", fetch_mock.call_args_list[1].kwargs)
+        # Generic layers first, then the family's variants in sequence.
+        self.assertEqual(fetch_mock.call_count, 4)
+        for index in [0, 2]:
+            kwargs = fetch_mock.call_args_list[index].kwargs
+            self.assertEqual(kwargs["exclude_components"], ["test"])
+            self.assertEqual(kwargs["exclude_artifacts"], ["fftw3"])
+        for index in [1, 3]:
+            kwargs = fetch_mock.call_args_list[index].kwargs
+            self.assertNotIn("exclude_components", kwargs)
+            self.assertNotIn("exclude_artifacts", kwargs)
 
         compressed_names = [
             call.kwargs["tarball_path"].name for call in compress_mock.call_args_list
@@ -208,7 +587,7 @@ class TestMain(unittest.TestCase):
     def test_include_test_tarballs_builds_kpack_multiarch_variant(self) -> None:
         with tempfile.TemporaryDirectory() as tmpdir:
             output_dir = Path(tmpdir) / "tarballs"
-            fetch_mock, compress_mock, _ = self._run_main_with_mocks(
+            fetch_mock, compress_mock, _, multiarch_mock = self._run_main_with_mocks(
                 [
                     "--run-id=123",
                     "--dist-amdgpu-families=gfx94X-dcgpu;gfx110X-all",
@@ -221,14 +600,27 @@ class TestMain(unittest.TestCase):
             )
 
         self.assertEqual(fetch_mock.call_count, 6)
+        # All fetches share one read of the run index.
+        self.assertEqual(
+            {call.kwargs["run_index_file"] for call in fetch_mock.call_args_list},
+            {output_dir / ".work" / "run_index.json"},
+        )
+        # One multi-arch tree per variant, from that variant's family trees.
+        work_dir = output_dir / ".work"
         self.assertEqual(
-            fetch_mock.call_args_list[-2].kwargs["exclude_components"], ["test"]
+            [
+                (call.kwargs["generic_dir"], call.kwargs["output_dir"])
+                for call in multiarch_mock.call_args_list
+            ],
+            [
+                (work_dir / "_generic", work_dir / "multiarch"),
+                (work_dir / "tests" / "_generic", work_dir / "tests" / "multiarch"),
+            ],
         )
         self.assertEqual(
-            fetch_mock.call_args_list[-2].kwargs["exclude_artifacts"], ["fftw3"]
+            multiarch_mock.call_args_list[1].kwargs["family_dirs"]["gfx110X-all"],
+            work_dir / "tests" / "gfx110X-all",
         )
-        self.assertNotIn("exclude_components", fetch_mock.call_args_list[-1].kwargs)
-        self.assertNotIn("exclude_artifacts", fetch_mock.call_args_list[-1].kwargs)
 
         compressed_names = [
             call.kwargs["tarball_path"].name for call in compress_mock.call_args_list
@@ -245,6 +637,78 @@ class TestMain(unittest.TestCase):
             ],
         )
 
+    def test_dedup_report_without_kpack_split(self) -> None:
+        with tempfile.TemporaryDirectory() as tmpdir:
+            output_dir = Path(tmpdir) / "tarballs"
+            report_path = Path(tmpdir) / "dedup.json"
+            _, _, _, multiarch_mock = self._run_main_with_mocks(
+                [
+                    "--run-id=123",
+                    "--dist-amdgpu-families=gfx94X-dcgpu;gfx110X-all",
+                    "--platform=linux",
+                    "--package-version=7.13.0",
+                    f"--output-dir={output_dir}",
+                    f"--dedup-report={report_path}",
+                ]
+            )
+            report = json.loads(report_path.read_text())
+
+        multiarch_mock.assert_not_called()
+        self.assertEqual(list(report), ["default"])
+        self.assertEqual(
+            sorted(report["default"]["trees"]), ["gfx110X-all", "gfx94X-dcgpu"]
+        )
+
+    def test_image_packs_every_tree(self) -> None:
+        with tempfile.TemporaryDirectory() as tmpdir:
+            output_dir = Path(tmpdir) / "tarballs"
+            with mock.patch(
+                "build_tarballs.shutil.which", return_value="/usr/bin/mksquashfs"
+            ), mock.patch("build_tarballs.build_image") as image_mock:
+                self._run_main_with_mocks(
+                    [
+                        "--run-id=123",
+                        "--dist-amdgpu-families=gfx94X-dcgpu;gfx110X-all",
+                        "--platform=linux",
+                        "--package-version=7.13.0",
+                        f"--output-dir={output_dir}",
+                        "--image=squashfs",
+                        "--compress-threads=8",
+                    ],
+                    kpack_split=True,
+                )
+
+        image_mock.assert_called_once()
+        kwargs = image_mock.call_args.kwargs
+        self.assertEqual(
+            kwargs["image_path"],
+            output_dir / "therock-dist-linux-7.13.0.squashfs",
+        )
+        work_dir = output_dir / ".work"
+        self.assertEqual(
+            kwargs["trees"],
+            {
+                "gfx94X-dcgpu": work_dir / "gfx94X-dcgpu",
+                "gfx110X-all": work_dir / "gfx110X-all",
+                "multiarch": work_dir / "multiarch",
+            },
+        )
+        self.assertEqual(kwargs["threads"], 8)
+
+    def test_image_requires_tool(self) -> None:
+        with tempfile.TemporaryDirectory() as tmpdir:
+            with mock.patch("build_tarballs.shutil.which", return_value=None):
+                with self.assertRaises(SystemExit):
+                    main(
+                        [
+                            "--run-id=123",
+                            "--dist-amdgpu-families=gfx94X-dcgpu",
+                            "--package-version=7.13.0",
+                            f"--output-dir={tmpdir}",
+                            "--image=erofs",
+                        ]
+                    )
+
 
 if __name__ == "__main__":
     unittest.main()
@@ -0,0 +1,194 @@
+# Copyright Advanced Micro Devices, Inc.
+# SPDX-License-Identifier: MIT
+
+import hashlib
+import io
+import os
+from pathlib import Path
+import platform
+import sys
+import tarfile
+import tempfile
+import unittest
+
+sys.path.insert(0, os.fspath(Path(__file__).parent.parent))
+
+from _therock_utils.artifacts import ArtifactPopulator
+from _therock_utils.content_store import (
+    ArtifactFileIndex,
+    ContentStore,
+    add_to_archive_indexed,
+    delta_files,
+    populate_store_from_archive,
+)
+
+
+def write_text(p: Path, text: str):
+    p.parent.mkdir(exist_ok=True, parents=True)
+    p.write_text(text)
+
+
+class ContentStoreTest(unittest.TestCase):
+    def setUp(self):
+        self.temp_context = tempfile.TemporaryDirectory()
+        self.temp_dir = Path(self.temp_context.name)
+
+    def tearDown(self):
+        self.temp_context.cleanup()
+
+    def _make_indexed_archive(self, artifact_dir: Path, archive_path: Path):
+        """Archives `artifact_dir` (laid out like an artifact) with an index."""
+        index = ArtifactFileIndex()
+        manifest_path = artifact_dir / "artifact_manifest.txt"
+        with tarfile.open(archive_path, "w") as arc:
+            arc.add(manifest_path, arcname=manifest_path.name, recursive=False)
+            for relpath in manifest_path.read_text().splitlines():
+                index.manifest.append(relpath)
+                root = artifact_dir / relpath
+                for dirpath, dirnames, filenames in os.walk(root):
+                    dirnames.sort()
+                    for name in sorted(dirnames) + sorted(filenames):
+                        full = Path(dirpath) / name
+                        arcname = f"{relpath}/{full.relative_to(root).as_posix()}"
+                        add_to_archive_indexed(arc, full, arcname, index)
+        return index
+
+    def _make_artifact(self, name: str, lib_contents: str) -> Path:
+        artifact_dir = self.temp_dir / name
+        write_text(artifact_dir / "artifact_manifest.txt", "core/stage\n")
+        stage = artifact_dir / "core" / "stage"
+        write_text(stage / "lib" / "libfoo.so", lib_contents)
+        write_text(stage / "share" / "doc" / "README", "shared docs\n")
+        write_text(stage / "bin" / "tool", "#!/bin/sh\n")
+        if platform.system() != "Windows":
+            os.chmod(stage / "bin" / "tool", 0o755)
+            (stage / "lib" / "libfoo.so.1").symlink_to("libfoo.so")
+        return artifact_dir
+
+    def testIndexMatchesArchive(self):
+        artifact_dir = self._make_artifact("a", "lib v1\n")
+        index = self._make_indexed_archive(artifact_dir, self.temp_dir / "a.tar")
+        self.assertEqual(index.manifest, ["core/stage"])
+        by_path = {e.path: e for e in index.entries}
+        readme = by_path["core/stage/share/doc/README"]
+        self.assertEqual(readme.type, "file")
+        self.assertEqual(readme.size, len("shared docs\n"))
+        self.assertEqual(readme.sha256, hashlib.sha256(b"shared docs\n").hexdigest())
+        self.assertEqual(by_path["core/stage/share"].type, "dir")
+        round_tripped = ArtifactFileIndex.loads(index.dumps())
+        self.assertEqual(round_tripped, index)
+
+    def testPopulateFromIndex(self):
+        artifact_dir = self._make_artifact("a", "lib v1\n")
+        archive_path = self.temp_dir / "a.tar"
+        index = self._make_indexed_archive(artifact_dir, archive_path)
+        store = ContentStore(self.temp_dir / "store", link_mode="copy")
+        self.assertEqual(len(index.missing_files(store)), 3)
+
+        with tarfile.open(archive_path, "r") as arc:
+            self.assertEqual(populate_store_from_archive(arc, index, store), 3)
+        self.assertEqual(index.missing_files(store), [])
+
+        out_dir = self.temp_dir / "out"
+        populator = ArtifactPopulator(output_path=out_dir, flatten=True)
+        populator.populate_from_index(index, store)
+        self.assertEqual((out_dir / "lib" / "libfoo.so").read_text(), "lib v1\n")
+        self.assertEqual(
+            (out_dir / "share" / "doc" / "README").read_text(), "shared docs\n"
+        )
+        self.assertIn("core/stage", populator.relpaths)
+        if platform.system() != "Windows":
+            self.assertTrue(os.access(out_dir / "bin" / "tool", os.X_OK))
+            self.assertFalse(os.access(out_dir / "lib" / "libfoo.so", os.X_OK))
+            self.assertEqual(os.readlink(out_dir / "lib" / "libfoo.so.1"), "libfoo.so")
+
+    def testSecondArtifactOnlyAddsChangedFiles(self):
+        store = ContentStore(self.temp_dir / "store", link_mode="copy")
+        index_a = self._make_indexed_archive(
+            self._make_artifact("a", "lib v1\n"), self.temp_dir / "a.tar"
+        )
+        with tarfile.open(self.temp_dir / "a.tar", "r") as arc:
+            populate_store_from_archive(arc, index_a, store)
+
+        index_b = self._make_indexed_archive(
+            self._make_artifact("b", "lib v2\n"), self.temp_dir / "b.tar"
+        )
+        missing = index_b.missing_files(store)
+        self.assertEqual([e.path for e in missing], ["core/stage/lib/libfoo.so"])
+        with tarfile.open(self.temp_dir / "b.tar", "r") as arc:
+            self.assertEqual(populate_store_from_archive(arc, index_b, store), 1)
+
+    def testDeltaFiles(self):
+        index_a = self._make_indexed_archive(
+            self._make_artifact("a", "lib v1\n"), self.temp_dir / "a.tar"
+        )
+        artifact_b = self._make_artifact("b", "lib v2\n")
+        write_text(artifact_b / "core" / "stage" / "lib" / "libbar.so", "lib v2\n")
+        index_b = self._make_indexed_archive(artifact_b, self.temp_dir / "b.tar")
+        # Changed contents appear once, even if shared by several files.
+        self.assertEqual(
+            [e.path for e in delta_files(index_b, index_a)],
+            ["core/stage/lib/libbar.so"],
+        )
+        self.assertEqual(delta_files(index_a, index_a), [])
+
+        # The delta alone completes a store that has the base files.
+        store = ContentStore(self.temp_dir / "store", link_mode="copy")
+        with tarfile.open(self.temp_dir / "a.tar", "r") as arc:
+            populate_store_from_archive(arc, index_a, store)
+        with tarfile.open(self.temp_dir / "delta.tar", "w") as arc:
+            for entry in delta_files(index_b, index_a):
+                arc.add(artifact_b / entry.path, arcname=entry.path)
+        with tarfile.open(self.temp_dir / "delta.tar", "r") as arc:
+            populate_store_from_archive(arc, index_b, store, require_complete=False)
+        self.assertEqual(index_b.missing_files(store), [])
+
+    def testDigestMismatchIsRejected(self):
+        store = ContentStore(self.temp_dir / "store")
+        wrong_digest = hashlib.sha256(b"something else").hexdigest()
+        with self.assertRaises(IOError):
+            store.add_from_fileobj(
+                io.BytesIO(b"contents"),
+                expected_sha256=wrong_digest,
+                executable=False,
+            )
+        self.assertFalse(store.contains(wrong_digest, False))
+        self.assertEqual(list((self.temp_dir / "store" / "tmp").iterdir()), [])
+
+    def _add_blob(self, store: ContentStore, data: bytes, mtime: int) -> Path:
+        path = store.add_from_fileobj(
+            io.BytesIO(data),
+            expected_sha256=hashlib.sha256(data).hexdigest(),
+            executable=False,
+        )
+        os.utime(path, (mtime, mtime))
+        return path
+
+    def testPruneRemovesOldestBlobs(self):
+        store = ContentStore(self.temp_dir / "store")
+        oldest = self._add_blob(store, b"a" * 100, 1000)
+        linked = self._add_blob(store, b"b" * 100, 2000)
+        older = self._add_blob(store, b"c" * 100, 3000)
+        newest = self._add_blob(store, b"d" * 100, 4000)
+        if platform.system() != "Windows":
+            # Still in use by a fetched tree.
+            os.link(linked, self.temp_dir / "fetched")
+        self.assertEqual(store.prune(250), (2, 200))
+        self.assertFalse(oldest.exists())
+        self.assertFalse(older.exists())
+        self.assertTrue(newest.exists())
+        if platform.system() != "Windows":
+            self.assertTrue(linked.exists())
+
+    @unittest.skipIf(platform.system() == "Windows", "shared locks are exclusive")
+    def testPruneSkippedWhileInUse(self):
+        store = ContentStore(self.temp_dir / "store")
+        blob = self._add_blob(store, b"a" * 100, 1000)
+        with store.in_use(), ContentStore(self.temp_dir / "store").in_use():
+            self.assertIsNone(store.prune(0))
+        self.assertTrue(blob.exists())
+        self.assertEqual(store.prune(0), (1, 100))
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,132 @@
+# Copyright Advanced Micro Devices, Inc.
+# SPDX-License-Identifier: MIT
+
+import os
+from pathlib import Path
+import platform
+import shutil
+import subprocess
+import sys
+import tarfile
+import tempfile
+import unittest
+
+sys.path.insert(0, os.fspath(Path(__file__).parent.parent))
+
+from _therock_utils.git_mirrors import url_to_mirror_relpath
+from export_source_archive import ArchiveWriter, create_archive
+
+MTIME = 1_700_000_000
+
+_GIT_ENV = {
+    **os.environ,
+    "GIT_AUTHOR_NAME": "Test",
+    "GIT_AUTHOR_EMAIL": "test@example.com",
+    "GIT_COMMITTER_NAME": "Test",
+    "GIT_COMMITTER_EMAIL": "test@example.com",
+}
+
+
+def _git(cwd: Path, *args: str):
+    subprocess.check_call(
+        ["git", "-c", "protocol.file.allow=always", *args],
+        cwd=str(cwd),
+        env=_GIT_ENV,
+        stdout=subprocess.DEVNULL,
+        stderr=subprocess.DEVNULL,
+    )
+
+
+@unittest.skipUnless(shutil.which("git"), "requires git")
+@unittest.skipIf(platform.system() == "Windows", "uses symlinks and exec bits")
+class ExportFromGitObjectsTest(unittest.TestCase):
+    def setUp(self):
+        self.temp_context = tempfile.TemporaryDirectory()
+        self.temp_dir = Path(self.temp_context.name)
+
+        self.sub_dir = self.temp_dir / "sub"
+        (self.sub_dir / "bin").mkdir(parents=True)
+        (self.sub_dir / "a.txt").write_text("sub file")
+        (self.sub_dir / "bin" / "run.sh").write_text("#!/bin/sh\n")
+        (self.sub_dir / "bin" / "run.sh").chmod(0o755)
+        (self.sub_dir / "link").symlink_to("a.txt")
+        _git(self.sub_dir, "init", "-q")
+        _git(self.sub_dir, "add", "-A")
+        _git(self.sub_dir, "commit", "-q", "-m", "sub")
+
+        self.super_dir = self.temp_dir / "super"
+        (self.super_dir / "tools").mkdir(parents=True)
+        (self.super_dir / "README.md").write_text("readme")
+        (self.super_dir / "tools" / "big.bin").write_bytes(os.urandom(3 << 20))
+        _git(self.super_dir, "init", "-q")
+        _git(self.super_dir, "submodule", "add", str(self.sub_dir), "deps/sub")
+        _git(self.super_dir, "add", "-A")
+        _git(self.super_dir, "commit", "-q", "-m", "super")
+
+    def tearDown(self):
+        self.temp_context.cleanup()
+
+    def _export(self, name: str, source_dir: Path, **kwargs) -> bytes:
+        output = self.temp_dir / name
+        writer = ArchiveWriter.create(output, compresslevel=4, mtime=MTIME)
+        try:
+            create_archive(writer, source_dir, kwargs.pop("prebuilt", None), **kwargs)
+        finally:
+            writer.close()
+        return output.read_bytes()
+
+    def test_same_archive_as_worktree_export(self):
+        worktree = self._export("worktree.tar.gz", self.super_dir)
+        objects = self._export("objects.tar.gz", self.super_dir, revision="HEAD")
+        self.assertEqual(worktree, objects)
+        with tarfile.open(self.temp_dir / "objects.tar.gz") as tf:
+            self.assertEqual(
+                tf.extractfile("deps/sub/a.txt").read().decode(), "sub file"
+            )
+            self.assertEqual(tf.getmember("deps/sub/link").linkname, "a.txt")
+            self.assertEqual(tf.getmember("deps/sub/bin/run.sh").mode, 0o755)
+            self.assertEqual(
+                tf.extractfile("tools/big.bin").read(),
+                (self.super_dir / "tools" / "big.bin").read_bytes(),
+            )
+
+    def test_export_from_bare_mirrors(self):
+        worktree = self._export("worktree.tar.gz", self.super_dir)
+        bare_dir = self.temp_dir / "super.git"
+        _git(self.temp_dir, "clone", "-q", "--bare", str(self.super_dir), "super.git")
+        _git(bare_dir, "remote", "remove", "origin")
+        mirror_dir = self.temp_dir / "mirrors"
+        sub_mirror = mirror_dir / url_to_mirror_relpath(str(self.sub_dir))
+        sub_mirror.parent.mkdir(parents=True)
+        _git(self.temp_dir, "clone", "-q", "--mirror", str(self.sub_dir), sub_mirror)
+
+        objects = self._export(
+            "objects.tar.gz", bare_dir, revision="HEAD", mirror_dir=mirror_dir
+        )
+        self.assertEqual(worktree, objects)
+
+    def test_missing_submodule_objects(self):
+        bare_dir = self.temp_dir / "super.git"
+        _git(self.temp_dir, "clone", "-q", "--bare", str(self.super_dir), "super.git")
+        with self.assertRaisesRegex(LookupError, "deps/sub"):
+            self._export("objects.tar.gz", bare_dir, revision="HEAD")
+
+    def test_prebuilt_does_not_recurse(self):
+        artifacts_dir = self.temp_dir / "artifacts"
+        artifacts_dir.mkdir()
+        (artifacts_dir / "core.tar.xz").write_bytes(b"artifact")
+        worktree = self._export(
+            "worktree.tar.gz", self.super_dir, prebuilt=artifacts_dir
+        )
+        objects = self._export(
+            "objects.tar.gz", self.super_dir, prebuilt=artifacts_dir, revision="HEAD"
+        )
+        self.assertEqual(worktree, objects)
+        with tarfile.open(self.temp_dir / "objects.tar.gz") as tf:
+            self.assertTrue(tf.getmember("deps/sub").isdir())
+            self.assertIn("build/artifacts/core.tar.xz", tf.getnames())
+            self.assertNotIn("deps/sub/a.txt", tf.getnames())
+
+
+if __name__ == "__main__":
+    unittest.main()
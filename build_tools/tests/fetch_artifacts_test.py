@@ -5,11 +5,13 @@ from pathlib import Path
 import os
 import sys
 import unittest
+from unittest import mock
 from unittest.mock import MagicMock
 
 sys.path.insert(0, os.fspath(Path(__file__).parent.parent))
 
 from _therock_utils.artifact_backend import ArtifactBackend
+import fetch_artifacts
 from fetch_artifacts import (
     list_artifacts_for_group,
     filter_artifacts,
@@ -260,5 +262,51 @@ class ArtifactsIndexPageTest(unittest.TestCase):
         self.assertNotIn("bar_run", filtered)
 
 
+class LazyMountTest(unittest.TestCase):
+    def _main(self, argv):
+        with mock.patch.object(
+            fetch_artifacts, "WorkflowOutputRoot"
+        ), mock.patch.object(fetch_artifacts, "S3Backend"), mock.patch.object(
+            fetch_artifacts,
+            "list_artifacts_for_group",
+            return_value={"base_lib_generic.tar.zst", "core_lib_generic.tar.zst"},
+        ), mock.patch.object(
+            fetch_artifacts, "ContentStore"
+        ) as mock_store, mock.patch.object(
+            fetch_artifacts, "lazy_mount"
+        ) as mock_mount, mock.patch.object(
+            fetch_artifacts, "download_artifact"
+        ) as mock_download:
+            fetch_artifacts.main(["--run-id", "12345"] + argv)
+        mock_download.assert_not_called()
+        return mock_store, mock_mount
+
+    def testLazyMount_MountsOutputDirWithDownloadsInStore(self):
+        mock_store, mock_mount = self._main(
+            [
+                "--output-dir",
+                "/tmp/out",
+                "--lazy-mount",
+                "--content-store-dir",
+                "/tmp/store",
+            ]
+        )
+        mock_store.assert_called_once_with(Path("/tmp/store"))
+        requests, store, mount_dir, _ = mock_mount.call_args.args
+        self.assertIs(store, mock_store.return_value)
+        self.assertEqual(mount_dir, Path("/tmp/out"))
+        self.assertEqual(
+            [r.dest_path for r in requests],
+            [
+                Path("/tmp/store/downloads/base_lib_generic.tar.zst"),
+                Path("/tmp/store/downloads/core_lib_generic.tar.zst"),
+            ],
+        )
+
+    def testLazyMount_RequiresContentStore(self):
+        with self.assertRaises(SystemExit):
+            self._main(["--lazy-mount"])
+
+
 if __name__ == "__main__":
     unittest.main()
@@ -215,6 +215,67 @@ class FilesetToolTest(unittest.TestCase):
         if not is_windows():
             self.assertTrue(is_executable(flat2_dir / "share" / "doc" / "executable"))
 
+    def testZstdDictArtifactArchive(self):
+        """Train a dictionary from an artifact dir, archive with it, flatten."""
+        artifact_dir = self.temp_dir / "prim_dev_generic"
+        dict_file = self.temp_dir / "dicts" / "prim_dev.zdict"
+        artifact_archive = self.temp_dir / "prim_dev_generic.tar.zst"
+        flat_dir = self.temp_dir / "flat"
+        write_text(artifact_dir / "artifact_manifest.txt", "prim/stage\n")
+        for i in range(100):
+            write_text(
+                artifact_dir / "prim" / "stage" / "include" / f"block_{i}.hpp",
+                f"#pragma once\nnamespace rocprim {{\n"
+                f"template <class T> struct block_{i} {{ T item_{i}; }};\n}}\n",
+            )
+
+        run_command(
+            [
+                sys.executable,
+                FILESET_TOOL,
+                "artifact-zstd-dict",
+                artifact_dir,
+                "-o",
+                dict_file,
+                "--dict-size",
+                "4096",
+            ]
+        )
+        self.assertTrue(dict_file.exists())
+
+        run_command(
+            [
+                sys.executable,
+                FILESET_TOOL,
+                "artifact-archive",
+                artifact_dir,
+                "-o",
+                artifact_archive,
+                "--compression-type",
+                "zstd",
+                "--zstd-dict",
+                dict_file,
+            ]
+        )
+
+        # The archive references the dictionary by id.
+        run_command(
+            [
+                sys.executable,
+                FILESET_TOOL,
+                "artifact-flatten",
+                artifact_archive,
+                "-o",
+                flat_dir,
+                "--zstd-dict-dir",
+                dict_file.parent,
+            ]
+        )
+        self.assertEqual(
+            (flat_dir / "include" / "block_42.hpp").read_text(),
+            (artifact_dir / "prim" / "stage" / "include" / "block_42.hpp").read_text(),
+        )
+
     @unittest.skipIf(is_windows(), "Hardlinks not supported the same way on Windows")
     def testHardlinkPreservation(self):
         """Test that hardlinks are preserved through archive/flatten cycle."""
@@ -11,8 +11,11 @@ sys.path.insert(0, os.fspath(Path(__file__).parent.parent))
 
 from find_artifacts_for_commit import (
     ArtifactRunInfo,
+    _per_arch_stages,
+    check_if_artifacts_exist,
     find_artifacts_for_commit,
 )
+from _therock_utils.run_index import RunIndexFragmentName
 from _therock_utils.workflow_outputs import WorkflowOutputRoot
 from github_actions.github_actions_api import (
     GitHubAPIError,
@@ -239,6 +242,71 @@ class FindArtifactsForCommitTest(unittest.TestCase):
             self.assertIn("rate limit", str(ctx.exception).lower())
 
 
+class CheckIfArtifactsExistTest(unittest.TestCase):
+    """Tests for check_if_artifacts_exist() with a run index (no network)."""
+
+    def _info(self, group: str) -> ArtifactRunInfo:
+        return ArtifactRunInfo(
+            git_commit_sha="abc123",
+            github_repository_name="ROCm/TheRock",
+            external_repo="",
+            platform="linux",
+            artifact_group=group,
+            workflow_file_name="multi_arch_ci.yml",
+            workflow_run_id="12345",
+            workflow_run_status="in_progress",
+            workflow_run_conclusion=None,
+            workflow_run_html_url="",
+            s3_bucket="therock-ci-artifacts",
+        )
+
+    @mock.patch("find_artifacts_for_commit.urllib.request.urlopen")
+    @mock.patch(
+        "find_artifacts_for_commit._per_arch_stages", return_value={"math-libs"}
+    )
+    @mock.patch("find_artifacts_for_commit._run_index_fragments")
+    def test_uses_pushed_stages_from_run_index(
+        self, mock_fragments, mock_stages, mock_urlopen
+    ):
+        mock_fragments.return_value = [
+            RunIndexFragmentName("compiler-runtime", ("generic",)),
+            RunIndexFragmentName("math-libs", ("generic", "gfx942")),
+        ]
+        self.assertTrue(check_if_artifacts_exist(self._info("gfx94X-dcgpu")))
+        self.assertFalse(check_if_artifacts_exist(self._info("gfx120X-all")))
+        mock_urlopen.assert_not_called()
+
+    @mock.patch("find_artifacts_for_commit.urllib.request.urlopen")
+    @mock.patch(
+        "find_artifacts_for_commit._per_arch_stages",
+        return_value={"math-libs", "ml-libs"},
+    )
+    @mock.patch("find_artifacts_for_commit._run_index_fragments")
+    def test_group_with_only_early_stages_is_not_reported(
+        self, mock_fragments, mock_stages, mock_urlopen
+    ):
+        mock_fragments.return_value = [
+            RunIndexFragmentName("math-libs", ("generic", "gfx1100")),
+            RunIndexFragmentName("math-libs", ("generic", "gfx942")),
+            RunIndexFragmentName("ml-libs", ("gfx942",)),
+        ]
+        self.assertTrue(check_if_artifacts_exist(self._info("gfx94X-dcgpu")))
+        self.assertFalse(check_if_artifacts_exist(self._info("gfx110X-all")))
+        mock_urlopen.assert_not_called()
+
+    def test_per_arch_stages_from_topology(self):
+        self.assertIn("math-libs", _per_arch_stages())
+
+    @mock.patch("find_artifacts_for_commit.urllib.request.urlopen")
+    @mock.patch("find_artifacts_for_commit._run_index_fragments", return_value=None)
+    def test_falls_back_to_index_page_without_run_index(
+        self, mock_pushed, mock_urlopen
+    ):
+        mock_urlopen.return_value.__enter__.return_value.status = 200
+        self.assertTrue(check_if_artifacts_exist(self._info("gfx120X-all")))
+        mock_urlopen.assert_called_once()
+
+
 class FindArtifactsForCommitMultiGroupTest(unittest.TestCase):
     """Tests for multi-group behavior of find_artifacts_for_commit()."""
 
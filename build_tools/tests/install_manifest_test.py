@@ -0,0 +1,298 @@
+# Copyright Advanced Micro Devices, Inc.
+# SPDX-License-Identifier: MIT
+
+import hashlib
+import io
+import os
+from pathlib import Path
+import platform
+import stat
+import sys
+import tarfile
+import tempfile
+import unittest
+from unittest import mock
+
+sys.path.insert(0, os.fspath(Path(__file__).parent.parent))
+
+from _therock_utils import install_manifest
+from _therock_utils.content_store import ArtifactFileIndex, FileIndexEntry
+from _therock_utils.install_manifest import (
+    INSTALL_MANIFEST_NAME,
+    InstallManifest,
+    PrefixUpgrade,
+)
+
+
+def _make_archive(files: dict[str, bytes], symlinks: dict[str, str] = {}) -> bytes:
+    buffer = io.BytesIO()
+    with tarfile.open(fileobj=buffer, mode="w:gz") as tf:
+        for name, data in files.items():
+            info = tarfile.TarInfo(name)
+            info.size = len(data)
+            info.mode = 0o755 if name.startswith("bin/") else 0o644
+            tf.addfile(info, io.BytesIO(data))
+        for name, target in symlinks.items():
+            info = tarfile.TarInfo(name)
+            info.type = tarfile.SYMTYPE
+            info.linkname = target
+            tf.addfile(info)
+    return buffer.getvalue()
+
+
+class PrefixUpgradeTest(unittest.TestCase):
+    def setUp(self):
+        self.temp_context = tempfile.TemporaryDirectory()
+        self.temp_dir = Path(self.temp_context.name)
+        self.prefix = self.temp_dir / "install"
+
+    def tearDown(self):
+        self.temp_context.cleanup()
+
+    def _upgrade(self, archive: bytes, **kwargs) -> PrefixUpgrade:
+        with PrefixUpgrade(self.prefix) as upgrade:
+            with tarfile.open(fileobj=io.BytesIO(archive), mode="r|gz") as tf:
+                upgrade.add_archive(tf, **kwargs)
+            upgrade.commit()
+        return upgrade
+
+    def test_fresh_install(self):
+        upgrade = self._upgrade(
+            _make_archive(
+                {"bin/hipcc": b"hipcc", "lib/libfoo.so.1": b"foo"},
+                {"lib/libfoo.so": "libfoo.so.1"},
+            )
+        )
+        self.assertEqual((self.prefix / "bin" / "hipcc").read_bytes(), b"hipcc")
+        self.assertEqual((self.prefix / "lib" / "libfoo.so").read_bytes(), b"foo")
+        self.assertEqual(upgrade.stats.written_files, 2)
+        manifest = InstallManifest.load(self.prefix)
+        self.assertEqual(
+            sorted(manifest.entries), ["bin/hipcc", "lib/libfoo.so", "lib/libfoo.so.1"]
+        )
+        self.assertEqual(manifest.entries["lib/libfoo.so"].type, "symlink")
+        self.assertFalse(upgrade.staging_dir.exists())
+        if platform.system() != "Windows":
+            self.assertTrue(os.access(self.prefix / "bin" / "hipcc", os.X_OK))
+
+    def test_upgrade_only_writes_changed_files(self):
+        self._upgrade(
+            _make_archive(
+                {
+                    "bin/hipcc": b"hipcc",
+                    "lib/same.so": b"s" * 3_000_000,
+                    "lib/changed.so": b"a" * 3_000_000,
+                    "lib/removed.so": b"removed",
+                }
+            )
+        )
+        same_inode = (self.prefix / "lib" / "same.so").stat().st_ino
+        changed_inode = (self.prefix / "lib" / "changed.so").stat().st_ino
+        # Not installed by us, must be kept.
+        (self.prefix / "local.cfg").write_text("user config")
+
+        upgrade = self._upgrade(
+            _make_archive(
+                {
+                    "bin/hipcc": b"hipcc",
+                    "lib/same.so": b"s" * 3_000_000,
+                    # Differs only after the first compared chunk.
+                    "lib/changed.so": b"a" * 2_000_000 + b"b" * 1_000_000,
+                    "lib/added.so": b"added",
+                }
+            )
+        )
+
+        self.assertEqual(upgrade.stats.unchanged_files, 2)
+        self.assertEqual(upgrade.stats.written_files, 2)
+        self.assertEqual(upgrade.stats.removed_files, 1)
+        self.assertEqual(upgrade.stats.kept_files, 1)
+        self.assertEqual((self.prefix / "lib" / "same.so").stat().st_ino, same_inode)
+        self.assertNotEqual(
+            (self.prefix / "lib" / "changed.so").stat().st_ino, changed_inode
+        )
+        self.assertEqual(
+            (self.prefix / "lib" / "changed.so").read_bytes(),
+            b"a" * 2_000_000 + b"b" * 1_000_000,
+        )
+        self.assertFalse((self.prefix / "lib" / "removed.so").exists())
+        self.assertEqual((self.prefix / "lib" / "added.so").read_bytes(), b"added")
+        self.assertEqual((self.prefix / "local.cfg").read_text(), "user config")
+        manifest = InstallManifest.load(self.prefix)
+        self.assertNotIn("lib/removed.so", manifest.entries)
+        self.assertNotIn("local.cfg", manifest.entries)
+
+    def test_failed_upgrade_leaves_prefix_untouched(self):
+        self._upgrade(_make_archive({"bin/hipcc": b"old"}))
+        with self.assertRaises(RuntimeError):
+            with PrefixUpgrade(self.prefix) as upgrade:
+                upgrade.add_file("bin/hipcc", io.BytesIO(b"new"), size=3, mode=0o755)
+                raise RuntimeError("download failed")
+        self.assertEqual((self.prefix / "bin" / "hipcc").read_bytes(), b"old")
+        self.assertFalse(upgrade.staging_dir.exists())
+
+    def test_artifact_archive_is_flattened(self):
+        self._upgrade(
+            _make_archive(
+                {
+                    "artifact_manifest.txt": b"core/stage\n",
+                    "core/stage/bin/hipcc": b"hipcc",
+                }
+            ),
+            artifact=True,
+        )
+        self.assertEqual((self.prefix / "bin" / "hipcc").read_bytes(), b"hipcc")
+        self.assertNotIn(
+            "artifact_manifest.txt", InstallManifest.load(self.prefix).entries
+        )
+
+    def test_refuses_paths_outside_prefix(self):
+        with PrefixUpgrade(self.prefix) as upgrade:
+            with self.assertRaises(IOError):
+                upgrade.add_file("../evil", io.BytesIO(b""), size=0, mode=0o644)
+
+    def test_prefix_without_manifest_counts_as_installed(self):
+        (self.prefix / "lib").mkdir(parents=True)
+        (self.prefix / "lib" / "old.so").write_bytes(b"old")
+        upgrade = self._upgrade(_make_archive({"lib/new.so": b"new"}))
+        self.assertEqual(upgrade.stats.removed_files, 1)
+        self.assertFalse((self.prefix / "lib" / "old.so").exists())
+        self.assertTrue((self.prefix / "lib" / "new.so").exists())
+        self.assertTrue((self.prefix / INSTALL_MANIFEST_NAME).exists())
+
+    @unittest.skipIf(platform.system() == "Windows", "POSIX modes")
+    def test_modes_and_mtimes_are_applied(self):
+        buffer = io.BytesIO()
+        with tarfile.open(fileobj=buffer, mode="w:gz") as tf:
+            info = tarfile.TarInfo("share")
+            info.type = tarfile.DIRTYPE
+            info.mode = 0o555
+            info.mtime = 1_000_000
+            tf.addfile(info)
+            info = tarfile.TarInfo("share/data.txt")
+            info.size = 4
+            info.mode = 0o600
+            info.mtime = 2_000_000
+            tf.addfile(info, io.BytesIO(b"data"))
+        for _ in range(2):
+            # Installed, then linked from the previous install.
+            self._upgrade(buffer.getvalue())
+            data_st = (self.prefix / "share" / "data.txt").stat()
+            self.assertEqual(stat.S_IMODE(data_st.st_mode), 0o600)
+            self.assertEqual(data_st.st_mtime, 2_000_000)
+            share_st = (self.prefix / "share").stat()
+            self.assertEqual(stat.S_IMODE(share_st.st_mode), 0o555)
+            self.assertEqual(share_st.st_mtime, 1_000_000)
+        (self.prefix / "share").chmod(0o755)
+
+    def test_index_hashes_skip_unchanged_files(self):
+        files = {
+            "artifact_manifest.txt": b"core/stage\n",
+            "core/stage/lib/same.so": b"same",
+            "core/stage/lib/changed.so": b"old",
+        }
+        self._upgrade(_make_archive(files), artifact=True)
+        same_inode = (self.prefix / "lib" / "same.so").stat().st_ino
+
+        files["core/stage/lib/changed.so"] = b"new"
+        index = ArtifactFileIndex(
+            manifest=["core/stage"],
+            entries=[
+                FileIndexEntry(
+                    name,
+                    "file",
+                    size=len(data),
+                    sha256=hashlib.sha256(data).hexdigest(),
+                )
+                for name, data in files.items()
+                if name != "artifact_manifest.txt"
+            ],
+        )
+        opened = []
+
+        def tracking_open(path, *args, **kwargs):
+            opened.append(Path(path))
+            return open(path, *args, **kwargs)
+
+        with mock.patch.object(
+            install_manifest, "open", side_effect=tracking_open, create=True
+        ):
+            upgrade = self._upgrade(_make_archive(files), artifact=True, index=index)
+
+        self.assertEqual(upgrade.stats.unchanged_files, 1)
+        self.assertEqual(upgrade.stats.written_files, 1)
+        # Neither file was read from the installed prefix to compare it.
+        self.assertFalse([p for p in opened if self.prefix in p.parents])
+        self.assertEqual((self.prefix / "lib" / "same.so").stat().st_ino, same_inode)
+        self.assertEqual((self.prefix / "lib" / "changed.so").read_bytes(), b"new")
+
+    def test_index_mismatch_fails_upgrade(self):
+        files = {
+            "artifact_manifest.txt": b"core/stage\n",
+            "core/stage/lib/foo.so": b"foo",
+        }
+        index = ArtifactFileIndex(
+            manifest=["core/stage"],
+            entries=[
+                FileIndexEntry("core/stage/lib/foo.so", "file", size=3, sha256="0" * 64)
+            ],
+        )
+        with self.assertRaises(IOError):
+            self._upgrade(_make_archive(files), artifact=True, index=index)
+        self.assertFalse(self.prefix.exists())
+
+    @unittest.skipIf(platform.system() == "Windows", "POSIX mtimes")
+    def test_linked_files_are_not_touched(self):
+        def archive(mtime: int) -> bytes:
+            buffer = io.BytesIO()
+            with tarfile.open(fileobj=buffer, mode="w:gz") as tf:
+                info = tarfile.TarInfo("lib/libfoo.so")
+                info.size = 3
+                info.mtime = mtime
+                tf.addfile(info, io.BytesIO(b"foo"))
+            return buffer.getvalue()
+
+        self._upgrade(archive(1_000_000))
+        installed_path = self.prefix / "lib" / "libfoo.so"
+        with PrefixUpgrade(self.prefix) as upgrade:
+            with tarfile.open(
+                fileobj=io.BytesIO(archive(2_000_000)), mode="r|gz"
+            ) as tf:
+                upgrade.add_archive(tf)
+            # Still the live install, which must not change before the swap.
+            self.assertEqual(installed_path.stat().st_mtime, 1_000_000)
+            upgrade.commit()
+        self.assertEqual(upgrade.stats.unchanged_files, 1)
+        self.assertEqual(installed_path.stat().st_mtime, 1_000_000)
+
+    def test_prefix_is_replaced_without_exchange(self):
+        self._upgrade(_make_archive({"bin/hipcc": b"old"}))
+        with mock.patch.object(install_manifest, "exchange_paths", return_value=False):
+            upgrade = self._upgrade(_make_archive({"bin/hipcc": b"new"}))
+        self.assertEqual((self.prefix / "bin" / "hipcc").read_bytes(), b"new")
+        self.assertFalse(upgrade.staging_dir.exists())
+        self.assertFalse(upgrade._backup_dir.exists())
+
+    def test_prefix_is_exchanged_when_supported(self):
+        self._upgrade(_make_archive({"bin/hipcc": b"old"}))
+        exchanged = []
+        real_exchange_paths = install_manifest.exchange_paths
+
+        def exchange_paths(a, b):
+            exchanged.append(real_exchange_paths(a, b))
+            return exchanged[-1]
+
+        with mock.patch.object(
+            install_manifest, "exchange_paths", side_effect=exchange_paths
+        ), mock.patch.object(os, "rename", wraps=os.rename) as rename:
+            upgrade = self._upgrade(_make_archive({"bin/hipcc": b"new"}))
+        self.assertEqual((self.prefix / "bin" / "hipcc").read_bytes(), b"new")
+        self.assertFalse(upgrade.staging_dir.exists())
+        self.assertEqual(len(exchanged), 1)
+        if exchanged[0]:
+            # The prefix was never missing.
+            rename.assert_not_called()
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -6,15 +6,28 @@
 
 import argparse
 from datetime import datetime
+import hashlib
+import io
 from pathlib import Path
 import os
+import shutil
 import sys
+import tarfile
+import tempfile
 import unittest
 from unittest import mock
 
+import boto3
+from moto import mock_aws
+
 sys.path.insert(0, os.fspath(Path(__file__).parent.parent))
 
 import install_rocm_from_artifacts as mod
+from _therock_utils.content_store import (
+    INDEX_SUFFIX,
+    ArtifactFileIndex,
+    FileIndexEntry,
+)
 
 
 class TestRetrieveArtifactsByRunId(unittest.TestCase):
@@ -68,6 +81,22 @@ class TestRetrieveArtifactsByRunId(unittest.TestCase):
         argv = self._run_main(["--mirage"])
         self.assertIn("mirage_run", argv)
 
+    def test_lazy_mount_forwarded(self):
+        argv = self._run_main(["--lazy-mount", "--content-store-dir", "/tmp/store"])
+        self.assertIn("--lazy-mount", argv)
+        self.assertEqual(argv[argv.index("--content-store-dir") + 1], "/tmp/store")
+        self.assertNotIn("--flatten", argv)
+
+    def test_lazy_mount_requires_content_store(self):
+        with self.assertRaises(SystemExit):
+            self._run_main(["--lazy-mount"])
+
+    def test_lazy_mount_rejects_upgrade(self):
+        with self.assertRaises(SystemExit):
+            self._run_main(
+                ["--lazy-mount", "--content-store-dir", "/tmp/store", "--upgrade"]
+            )
+
 
 class TestReleaseDiscovery(unittest.TestCase):
     def test_extract_version_ignores_test_tarball(self) -> None:
@@ -130,6 +159,87 @@ class TestReleaseDiscovery(unittest.TestCase):
         self.assertEqual(families, {"gfx94X-dcgpu"})
 
 
+@mock_aws
+class TestRetrieveReleaseAssets(unittest.TestCase):
+    BUCKET = "therock-nightly-tarball"
+
+    def setUp(self):
+        self.s3_client = boto3.client("s3", region_name="us-east-1")
+        self.s3_client.create_bucket(Bucket=self.BUCKET)
+        self.asset_name = f"therock-dist-{mod.PLATFORM}-gfx94X-dcgpu-7.13.0.tar.gz"
+        buffer = io.BytesIO()
+        with tarfile.open(fileobj=buffer, mode="w:gz") as tf:
+            for name, data in [("bin/hipcc", b"hipcc"), ("lib/libfoo.so", b"foo")]:
+                info = tarfile.TarInfo(name)
+                info.size = len(data)
+                tf.addfile(info, io.BytesIO(data))
+        self.s3_client.put_object(
+            Bucket=self.BUCKET, Key=self.asset_name, Body=buffer.getvalue()
+        )
+        temp_dir = Path(tempfile.mkdtemp())
+        self.addCleanup(shutil.rmtree, temp_dir)
+        self.output_dir = temp_dir / "therock-build"
+        self.output_dir.mkdir()
+
+    def _retrieve(self, **kwargs):
+        with mock.patch.object(mod, "s3_client", self.s3_client):
+            mod._retrieve_s3_release_assets(
+                self.BUCKET, "gfx94X-dcgpu", "7.13.0", self.output_dir, **kwargs
+            )
+
+    def _assert_installed(self):
+        self.assertEqual((self.output_dir / "bin" / "hipcc").read_bytes(), b"hipcc")
+        self.assertEqual((self.output_dir / "lib" / "libfoo.so").read_bytes(), b"foo")
+        self.assertFalse((self.output_dir / self.asset_name).exists())
+
+    def test_stream_extract(self) -> None:
+        with mock.patch.object(
+            self.s3_client, "download_fileobj", side_effect=AssertionError
+        ), mock.patch.object(mod, "_untar_files", side_effect=AssertionError):
+            self._retrieve()
+        self._assert_installed()
+
+    def test_stream_extract_retries(self) -> None:
+        get_object = self.s3_client.get_object
+        calls = []
+
+        def flaky_get_object(**kwargs):
+            calls.append(kwargs)
+            if len(calls) == 1:
+                raise ConnectionResetError("connection reset")
+            return get_object(**kwargs)
+
+        with mock.patch.object(
+            self.s3_client, "get_object", side_effect=flaky_get_object
+        ), mock.patch.object(mod.time, "sleep"):
+            self._retrieve()
+        self.assertEqual(len(calls), 2)
+        self._assert_installed()
+
+    def test_download_then_extract(self) -> None:
+        self._retrieve(stream_extract=False)
+        self._assert_installed()
+
+    def test_upgrade(self) -> None:
+        self._retrieve()
+        unchanged_inode = (self.output_dir / "bin" / "hipcc").stat().st_ino
+        (self.output_dir / "lib" / "libfoo.so").write_bytes(b"stale")
+        (self.output_dir / "lib" / "removed.so").write_bytes(b"removed")
+
+        for stream_extract in [True, False]:
+            self._retrieve(stream_extract=stream_extract, upgrade=True)
+            self._assert_installed()
+            self.assertEqual(
+                (self.output_dir / "bin" / "hipcc").stat().st_ino, unchanged_inode
+            )
+            # The prefix had no install manifest, so all of it was installed.
+            self.assertFalse((self.output_dir / "lib" / "removed.so").exists())
+            self.assertEqual(
+                sorted(p.name for p in self.output_dir.parent.iterdir()),
+                [self.output_dir.name],
+            )
+
+
 def _make_run_id_args(**overrides) -> argparse.Namespace:
     """Return a minimal args namespace suitable for retrieve_artifacts_by_run_id."""
     defaults = dict(
@@ -139,6 +249,9 @@ def _make_run_id_args(**overrides) -> argparse.Namespace:
         # Non-empty amdgpu_targets skips the expand_families call.
         amdgpu_targets="gfx1100",
         dry_run=False,
+        upgrade=False,
+        lazy_mount=False,
+        content_store_dir=None,
         run_github_repo=None,
         base_only=False,
         aqlprofile=False,
@@ -184,6 +297,63 @@ def _captured_fetch_argv(args: argparse.Namespace) -> list[str]:
     return argv
 
 
+class TestUpgradeByRunId(unittest.TestCase):
+    def test_upgrade_from_artifact_archives(self) -> None:
+        temp_dir = Path(tempfile.mkdtemp())
+        self.addCleanup(shutil.rmtree, temp_dir)
+        output_dir = temp_dir / "therock-build"
+        output_dir.mkdir()
+        (output_dir / "bin").mkdir()
+        (output_dir / "bin" / "old-tool").write_bytes(b"old")
+
+        def fake_fetch(argv):
+            download_dir = Path(argv[argv.index("--output-dir") + 1])
+            self.assertIn("--no-extract", argv)
+            self.assertIn("--index-files", argv)
+            self.assertNotIn("--flatten", argv)
+            download_dir.mkdir(parents=True)
+            archive_path = download_dir / "core_lib_generic.tar.xz"
+            with tarfile.open(archive_path, "w:xz") as tf:
+                for name, data in [
+                    ("artifact_manifest.txt", b"core/stage\n"),
+                    ("core/stage/bin/hipcc", b"hipcc"),
+                ]:
+                    info = tarfile.TarInfo(name)
+                    info.size = len(data)
+                    tf.addfile(info, io.BytesIO(data))
+            ArtifactFileIndex(
+                manifest=["core/stage"],
+                entries=[
+                    FileIndexEntry(
+                        "core/stage/bin/hipcc",
+                        "file",
+                        size=5,
+                        sha256=hashlib.sha256(b"hipcc").hexdigest(),
+                    )
+                ],
+            ).dump(Path(f"{archive_path}{INDEX_SUFFIX}"))
+
+        args = _make_run_id_args(output_dir=output_dir, upgrade=True)
+        with mock.patch.object(mod, "fetch_artifacts_main", side_effect=fake_fetch):
+            mod.retrieve_artifacts_by_run_id(args)
+
+        self.assertEqual((output_dir / "bin" / "hipcc").read_bytes(), b"hipcc")
+        self.assertFalse((output_dir / "bin" / "old-tool").exists())
+        self.assertEqual([p.name for p in temp_dir.iterdir()], ["therock-build"])
+
+    def test_upgrade_rejects_input_dir(self) -> None:
+        with self.assertRaises(SystemExit):
+            mod.main(
+                [
+                    "--input-dir",
+                    "/tmp/therock",
+                    "--amdgpu-family",
+                    "gfx110X-all",
+                    "--upgrade",
+                ]
+            )
+
+
 class TestDebugToolsAmdLlvmDev(unittest.TestCase):
     """Tests that --debug-tools pulls amd-llvm_dev (required for rocgdb testing)."""
 
@@ -0,0 +1,197 @@
+# Copyright Advanced Micro Devices, Inc.
+# SPDX-License-Identifier: MIT
+
+import errno
+import os
+from pathlib import Path
+import platform
+import shutil
+import stat
+import subprocess
+import sys
+import tarfile
+import tempfile
+import threading
+import time
+import unittest
+
+sys.path.insert(0, os.fspath(Path(__file__).parent.parent))
+
+from _therock_utils.content_store import (
+    ArtifactFileIndex,
+    ContentStore,
+    add_to_archive_indexed,
+)
+from _therock_utils.lazy_prefix import (
+    LazyArtifact,
+    LazyPrefix,
+    LazyPrefixOperations,
+    mount,
+)
+
+
+def fuse_unavailable() -> str | None:
+    """Why a FUSE mount can't be tested here, or None if it can."""
+    try:
+        import fuse  # noqa: F401
+    except (ImportError, OSError):
+        return "requires fusepy and libfuse"
+    if not os.access("/dev/fuse", os.R_OK | os.W_OK):
+        return "requires /dev/fuse"
+    if not shutil.which("fusermount"):
+        return "requires fusermount"
+    return None
+
+
+FUSE_UNAVAILABLE = fuse_unavailable()
+
+
+def write_text(p: Path, text: str):
+    p.parent.mkdir(exist_ok=True, parents=True)
+    p.write_text(text)
+
+
+@unittest.skipIf(platform.system() == "Windows", "uses symlinks and hardlinks")
+class LazyPrefixTest(unittest.TestCase):
+    def setUp(self):
+        self.temp_context = tempfile.TemporaryDirectory()
+        self.temp_dir = Path(self.temp_context.name)
+        self.store = ContentStore(self.temp_dir / "store", link_mode="copy")
+        self.fetches: list[str] = []
+
+    def tearDown(self):
+        self.temp_context.cleanup()
+
+    def _stage_dir(self, name: str, files: dict[str, str]) -> Path:
+        stage = self.temp_dir / name / "core" / "stage"
+        for relpath, text in files.items():
+            write_text(stage / relpath, text)
+        return stage
+
+    def _make_artifact(self, name: str) -> LazyArtifact:
+        """An indexed archive of the artifact staged by `_stage_dir(name)`."""
+        stage = self.temp_dir / name / "core" / "stage"
+        archive_path = self.temp_dir / f"{name}.tar.xz"
+        index = ArtifactFileIndex(manifest=["core/stage"])
+        with tarfile.open(archive_path, "w:xz") as arc:
+            for dirpath, dirnames, filenames in os.walk(stage):
+                dirnames.sort()
+                for entry_name in sorted(dirnames) + sorted(filenames):
+                    full = Path(dirpath) / entry_name
+                    arcname = f"core/stage/{full.relative_to(stage).as_posix()}"
+                    add_to_archive_indexed(arc, full, arcname, index)
+
+        def fetch_archive() -> Path:
+            self.fetches.append(name)
+            return archive_path
+
+        return LazyArtifact(name, index, fetch_archive)
+
+    def _make_prefix(self) -> LazyPrefix:
+        stage = self._stage_dir(
+            "base",
+            {
+                "lib/libfoo.so": "foo v1\n",
+                "share/README": "readme\n",
+                "bin/tool": "#!/bin/sh\n",
+            },
+        )
+        (stage / "lib" / "libfoo.so.1").symlink_to("libfoo.so")
+        (stage / "bin" / "tool").chmod(0o755)
+        os.link(stage / "bin" / "tool", stage / "bin" / "tool-alias")
+        self._stage_dir("update", {"lib/libfoo.so": "foo v2\n"})
+        artifacts = [self._make_artifact("base"), self._make_artifact("update")]
+        return LazyPrefix(artifacts, self.store)
+
+    def test_listing_does_not_fetch(self):
+        ops = LazyPrefixOperations(self._make_prefix())
+        self.assertEqual(
+            sorted(ops("readdir", "/", None)), [".", "..", "bin", "lib", "share"]
+        )
+        self.assertEqual(
+            sorted(ops("readdir", "/lib", None)),
+            [".", "..", "libfoo.so", "libfoo.so.1"],
+        )
+        attrs = ops("getattr", "/lib/libfoo.so")
+        self.assertTrue(stat.S_ISREG(attrs["st_mode"]))
+        self.assertEqual(attrs["st_size"], len("foo v2\n"))
+        self.assertTrue(stat.S_ISDIR(ops("getattr", "/share")["st_mode"]))
+        self.assertEqual(ops("readlink", "/lib/libfoo.so.1"), "libfoo.so")
+        self.assertEqual(ops("access", "/bin/tool", os.X_OK), 0)
+        self.assertEqual(self.fetches, [])
+
+    def test_open_fetches_artifact_once(self):
+        prefix = self._make_prefix()
+        ops = LazyPrefixOperations(prefix)
+        fh = ops("open", "/lib/libfoo.so", os.O_RDONLY)
+        try:
+            self.assertEqual(ops("read", "/lib/libfoo.so", 100, 0, fh), b"foo v2\n")
+        finally:
+            ops("release", "/lib/libfoo.so", fh)
+        self.assertEqual(self.fetches, ["update"])
+
+        for path in ["/share/README", "/bin/tool", "/bin/tool-alias"]:
+            fh = ops("open", path, os.O_RDONLY)
+            ops("release", path, fh)
+        self.assertEqual(self.fetches, ["update", "base"])
+        self.assertEqual(prefix.fetched, {"base", "update"})
+        self.assertEqual(prefix.blob_path("bin/tool-alias").read_text(), "#!/bin/sh\n")
+
+    def test_read_only_errors(self):
+        ops = LazyPrefixOperations(self._make_prefix())
+        for op, args, expected_errno in [
+            ("open", ("/lib/libfoo.so", os.O_WRONLY), errno.EROFS),
+            ("access", ("/lib/libfoo.so", os.W_OK), errno.EROFS),
+            ("getattr", ("/lib/missing.so",), errno.ENOENT),
+            ("open", ("/lib/missing.so", os.O_RDONLY), errno.ENOENT),
+            ("readdir", ("/share/README", None), errno.ENOTDIR),
+            ("mkdir", ("/new", 0o755), errno.ENOSYS),
+        ]:
+            with self.subTest(op=op, args=args):
+                with self.assertRaises(OSError) as cm:
+                    ops(op, *args)
+                self.assertEqual(cm.exception.errno, expected_errno)
+        self.assertEqual(self.fetches, [])
+
+    def test_failed_fetch_is_io_error(self):
+        self._stage_dir("broken", {"lib/libbar.so": "bar\n"})
+        artifact = self._make_artifact("broken")
+
+        def fail() -> Path:
+            raise IOError("backend unavailable")
+
+        artifact.fetch_archive = fail
+        ops = LazyPrefixOperations(LazyPrefix([artifact], self.store))
+        with self.assertRaises(OSError) as cm:
+            ops("open", "/lib/libbar.so", os.O_RDONLY)
+        self.assertEqual(cm.exception.errno, errno.EIO)
+
+    @unittest.skipIf(FUSE_UNAVAILABLE, FUSE_UNAVAILABLE)
+    def test_mount(self):
+        mount_dir = self.temp_dir / "mnt"
+        thread = threading.Thread(target=mount, args=(self._make_prefix(), mount_dir))
+        thread.start()
+        try:
+            deadline = time.monotonic() + 30
+            while not os.path.ismount(mount_dir):
+                self.assertTrue(thread.is_alive(), "mount failed")
+                self.assertLess(time.monotonic(), deadline, "mount timed out")
+                time.sleep(0.1)
+            self.assertEqual(
+                sorted(os.listdir(mount_dir / "lib")), ["libfoo.so", "libfoo.so.1"]
+            )
+            self.assertEqual(self.fetches, [])
+            self.assertEqual(
+                (mount_dir / "lib" / "libfoo.so.1").read_text(), "foo v2\n"
+            )
+            self.assertEqual(self.fetches, ["update"])
+            with self.assertRaises(OSError):
+                (mount_dir / "new.txt").write_text("x")
+        finally:
+            subprocess.run(["fusermount", "-u", str(mount_dir)], check=False)
+            thread.join(timeout=30)
+        self.assertFalse(thread.is_alive())
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -2,6 +2,7 @@
 # Copyright Advanced Micro Devices, Inc.
 # SPDX-License-Identifier: MIT
 
+import os
 import platform
 import shutil
 import subprocess
@@ -9,9 +10,17 @@ import sys
 import tempfile
 import textwrap
 import unittest
+from unittest import mock
 from pathlib import Path
 
-from _therock_utils.os_util import rmtree_with_retry
+from _therock_utils.os_util import (
+    copy_file,
+    exchange_paths,
+    link_or_copy,
+    link_tree,
+    replace_with_link_or_copy,
+    rmtree_with_retry,
+)
 
 IS_WINDOWS = platform.system() == "Windows"
 
@@ -118,5 +127,128 @@ class RmtreeWithRetryTest(unittest.TestCase):
                 holder.wait()
 
 
+class LinkOrCopyTest(unittest.TestCase):
+    def test_hardlink(self):
+        with tempfile.TemporaryDirectory() as tmp:
+            src = Path(tmp) / "src.txt"
+            dst = Path(tmp) / "out" / "dst.txt"
+            src.write_text("hello")
+            dst.parent.mkdir()
+            self.assertEqual(link_or_copy(src, dst, "hardlink"), "hardlink")
+            self.assertEqual(src.stat().st_ino, dst.stat().st_ino)
+
+    def test_copy(self):
+        with tempfile.TemporaryDirectory() as tmp:
+            src = Path(tmp) / "src.txt"
+            dst = Path(tmp) / "dst.txt"
+            src.write_text("hello")
+            self.assertEqual(link_or_copy(src, dst, "copy"), "copy")
+            self.assertNotEqual(src.stat().st_ino, dst.stat().st_ino)
+            self.assertEqual(dst.read_text(), "hello")
+
+    def test_auto_produces_same_contents(self):
+        """Whatever method is picked, the destination has the source contents."""
+        with tempfile.TemporaryDirectory() as tmp:
+            src = Path(tmp) / "src.txt"
+            dst = Path(tmp) / "dst.txt"
+            src.write_text("hello")
+            method = link_or_copy(src, dst)
+            self.assertIn(method, ("reflink", "hardlink", "copy"))
+            self.assertEqual(dst.read_text(), "hello")
+
+    def test_copy_file_large(self):
+        with tempfile.TemporaryDirectory() as tmp:
+            src = Path(tmp) / "src.bin"
+            dst = Path(tmp) / "dst.bin"
+            data = os.urandom(3 * 1024 * 1024 + 5)
+            src.write_bytes(data)
+            copy_file(src, dst)
+            self.assertEqual(dst.read_bytes(), data)
+
+    def test_copy_file_falls_back_when_unsupported(self):
+        with tempfile.TemporaryDirectory() as tmp:
+            src = Path(tmp) / "src.txt"
+            dst = Path(tmp) / "dst.txt"
+            src.write_text("hello")
+            with mock.patch.object(
+                os, "copy_file_range", side_effect=OSError(18, "EXDEV"), create=True
+            ):
+                copy_file(src, dst)
+            self.assertEqual(dst.read_text(), "hello")
+
+    def test_copy_file_falls_back_when_nothing_copied(self):
+        with tempfile.TemporaryDirectory() as tmp:
+            src = Path(tmp) / "src.txt"
+            dst = Path(tmp) / "dst.txt"
+            src.write_text("hello")
+            with mock.patch.object(os, "copy_file_range", return_value=0, create=True):
+                copy_file(src, dst)
+            self.assertEqual(dst.read_text(), "hello")
+
+    def test_exchange_paths(self):
+        with tempfile.TemporaryDirectory() as tmp:
+            a = Path(tmp) / "a"
+            b = Path(tmp) / "b"
+            a.mkdir()
+            b.mkdir()
+            (a / "from_a").touch()
+            if not exchange_paths(a, b):
+                self.skipTest("renameat2(RENAME_EXCHANGE) not supported")
+            self.assertTrue((b / "from_a").exists())
+            self.assertEqual(list(a.iterdir()), [])
+            with self.assertRaises(FileNotFoundError):
+                exchange_paths(a, Path(tmp) / "missing")
+
+    def test_replace_does_not_write_through_hardlink(self):
+        with tempfile.TemporaryDirectory() as tmp:
+            original = Path(tmp) / "original.txt"
+            linked = Path(tmp) / "linked.txt"
+            new = Path(tmp) / "new.txt"
+            original.write_text("old")
+            os.link(original, linked)
+            new.write_text("new")
+            replace_with_link_or_copy(new, linked, "copy")
+            self.assertEqual(linked.read_text(), "new")
+            self.assertEqual(original.read_text(), "old")
+            self.assertEqual(
+                sorted(p.name for p in Path(tmp).iterdir()),
+                ["linked.txt", "new.txt", "original.txt"],
+            )
+
+    def test_invalid_mode(self):
+        with tempfile.TemporaryDirectory() as tmp:
+            src = Path(tmp) / "src.txt"
+            src.write_text("hello")
+            with self.assertRaises(ValueError):
+                link_or_copy(src, Path(tmp) / "dst.txt", "symlink")
+
+    @unittest.skipIf(IS_WINDOWS, "Symlinks need privileges on Windows")
+    def test_link_tree(self):
+        with tempfile.TemporaryDirectory() as tmp:
+            src = Path(tmp) / "src"
+            dst = Path(tmp) / "dst"
+            (src / "lib" / "empty").mkdir(parents=True)
+            (src / "lib" / "libfoo.so.1").write_text("foo")
+            (src / "lib" / "libfoo.so").symlink_to("libfoo.so.1")
+            (src / "lib64").symlink_to("lib")
+            (dst / "lib").mkdir(parents=True)
+            (dst / "lib" / "libfoo.so.1").write_text("existing")
+
+            counts = link_tree(src, dst, "hardlink")
+
+            self.assertEqual(counts, {"symlink": 2})
+            self.assertEqual((dst / "lib" / "libfoo.so.1").read_text(), "existing")
+            self.assertTrue((dst / "lib" / "empty").is_dir())
+            self.assertEqual(os.readlink(dst / "lib64"), "lib")
+
+            (dst / "lib" / "libfoo.so.1").unlink()
+            counts = link_tree(src, dst, "hardlink")
+            self.assertEqual(counts, {"hardlink": 1})
+            self.assertEqual(
+                (dst / "lib" / "libfoo.so.1").stat().st_ino,
+                (src / "lib" / "libfoo.so.1").stat().st_ino,
+            )
+
+
 if __name__ == "__main__":
     unittest.main()
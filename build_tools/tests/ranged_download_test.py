@@ -0,0 +1,316 @@
+# Copyright Advanced Micro Devices, Inc.
+# SPDX-License-Identifier: MIT
+
+import io
+import os
+from pathlib import Path
+import sys
+import tempfile
+import threading
+import time
+import unittest
+
+sys.path.insert(0, os.fspath(Path(__file__).parent.parent))
+
+from _therock_utils.ranged_download import (
+    ConnectionBudget,
+    DownloadProgress,
+    _MultipartJob,
+    _Part,
+    download_parts,
+    is_multipart_partial,
+)
+
+
+class _FakeObject:
+    """In-memory object that records concurrent and total range reads."""
+
+    def __init__(self, data: bytes, delay: float = 0.0):
+        self.data = data
+        self.delay = delay
+        self.ranges = []
+        self.fail_starts = set()
+        self._lock = threading.Lock()
+        self._active = 0
+        self.max_active = 0
+
+    def open_range(self, start: int, length: int):
+        with self._lock:
+            self.ranges.append((start, length))
+            self._active += 1
+            self.max_active = max(self.max_active, self._active)
+        try:
+            time.sleep(self.delay)
+            if start in self.fail_starts:
+                self.fail_starts.discard(start)
+                raise ConnectionResetError("Simulated connection drop")
+        finally:
+            with self._lock:
+                self._active -= 1
+        return io.BytesIO(self.data[start : start + length])
+
+
+class RangedDownloadTest(unittest.TestCase):
+    def setUp(self):
+        self.temp_context = tempfile.TemporaryDirectory()
+        self.temp_dir = Path(self.temp_context.name)
+        self.budget = ConnectionBudget(4)
+
+    def tearDown(self):
+        self.budget.shutdown()
+        self.temp_context.cleanup()
+
+    def _download(self, obj: _FakeObject, path: Path, **kwargs):
+        with self.budget.connection():
+            return download_parts(
+                obj.open_range, len(obj.data), path, self.budget, **kwargs
+            )
+
+    def testPartsCoverObject(self):
+        obj = _FakeObject(os.urandom(10 * 1000 + 7), delay=0.01)
+        path = self.temp_dir / "out"
+        self._download(obj, path, part_size=1000, max_connections=3)
+        self.assertEqual(path.read_bytes(), obj.data)
+        self.assertEqual(sorted(obj.ranges)[-1], (10000, 7))
+        self.assertEqual(len(obj.ranges), 11)
+        self.assertGreater(obj.max_active, 1)
+        self.assertLessEqual(obj.max_active, 3)
+        self.assertFalse(is_multipart_partial(path))
+        self.assertEqual(self.budget.in_use, 0)
+
+    def testResumeOnlyFetchesMissingParts(self):
+        obj = _FakeObject(os.urandom(8 * 1000))
+        obj.fail_starts = {3000}
+        path = self.temp_dir / "out"
+        with self.assertRaises(ConnectionResetError):
+            self._download(obj, path, part_size=1000, max_connections=1)
+        self.assertTrue(is_multipart_partial(path))
+
+        obj.ranges.clear()
+        self._download(obj, path, part_size=1000, max_connections=1)
+        self.assertEqual(path.read_bytes(), obj.data)
+        self.assertNotIn((0, 1000), obj.ranges)
+        self.assertIn((3000, 1000), obj.ranges)
+
+    def testChangedObjectRestarts(self):
+        obj = _FakeObject(os.urandom(4 * 1000))
+        obj.fail_starts = {2000}
+        path = self.temp_dir / "out"
+        with self.assertRaises(ConnectionResetError):
+            self._download(
+                obj, path, part_size=1000, max_connections=1, identity="etag-1"
+            )
+        obj.ranges.clear()
+        self._download(obj, path, part_size=1000, max_connections=1, identity="etag-2")
+        self.assertEqual(len(obj.ranges), 4)
+        self.assertEqual(path.read_bytes(), obj.data)
+
+    def testConcurrentDownloadsStayWithinBudget(self):
+        objects = {
+            name: _FakeObject(os.urandom(size), delay=0.005)
+            for name, size in [("a", 30 * 1000), ("b", 10 * 1000), ("c", 5 * 1000)]
+        }
+        in_use = []
+        for obj in objects.values():
+            real_open = obj.open_range
+
+            def open_range(start, length, real_open=real_open):
+                in_use.append(self.budget.in_use)
+                return real_open(start, length)
+
+            obj.open_range = open_range
+
+        threads = [
+            threading.Thread(
+                target=self._download,
+                args=(obj, self.temp_dir / name),
+                kwargs={"part_size": 1000, "max_connections": 4},
+            )
+            for name, obj in objects.items()
+        ]
+        for t in threads:
+            t.start()
+        for t in threads:
+            t.join()
+        for name, obj in objects.items():
+            self.assertEqual((self.temp_dir / name).read_bytes(), obj.data)
+        self.assertLessEqual(max(in_use), self.budget.limit)
+        self.assertEqual(self.budget.in_use, 0)
+
+    def testIdleConnectionsGoToLargestDownload(self):
+        gate = threading.Event()
+
+        def make_job(part_count: int, part_size: int) -> _MultipartJob:
+            parts = [_Part(i, i * part_size, part_size) for i in range(part_count)]
+            return _MultipartJob(parts, lambda part: gate.wait(), max_connections=4)
+
+        small = make_job(4, 1000)
+        large = make_job(4, 10000)
+        connections = [self.budget.connection() for _ in range(4)]
+        for c in connections:
+            c.__enter__()
+        # The budget is full: registering only queues the jobs.
+        self.budget._add_job(small)
+        self.budget._add_job(large)
+        self.assertEqual((small.connections, large.connections), (1, 1))
+
+        # Two downloads finish: both idle connections go to the large one.
+        connections.pop().__exit__(None, None, None)
+        connections.pop().__exit__(None, None, None)
+        self.assertEqual((small.connections, large.connections), (1, 3))
+
+        gate.set()
+        for job in (small, large):
+            self.budget._remove_job(job)
+            job.wait_for_helpers()
+        for c in connections:
+            c.__exit__(None, None, None)
+        self.assertEqual(self.budget.in_use, 0)
+
+    def testRaisedLimitHandsOutIdleConnections(self):
+        budget = ConnectionBudget(1, max_limit=3)
+        self.addCleanup(budget.shutdown)
+        gate = threading.Event()
+        job = _MultipartJob(
+            [_Part(i, i * 1000, 1000) for i in range(4)],
+            lambda part: gate.wait(),
+            max_connections=4,
+        )
+        with budget.connection():
+            budget._add_job(job)
+            self.assertEqual(job.connections, 1)
+            budget.set_limit(3)
+            self.assertEqual(job.connections, 3)
+            gate.set()
+            budget._remove_job(job)
+            job.wait_for_helpers()
+        self.assertEqual(budget.in_use, 0)
+        with self.assertRaises(ValueError):
+            budget.set_limit(4)
+
+    def testDispatchAfterShutdownKeepsCountsBalanced(self):
+        budget = ConnectionBudget(2)
+        budget.shutdown()
+        fetched = []
+        job = _MultipartJob(
+            [_Part(i, i * 1000, 1000) for i in range(4)],
+            fetched.append,
+            max_connections=4,
+        )
+        with budget.connection():
+            budget._add_job(job)
+            # No helper could be started, so the job's own thread does it all.
+            self.assertEqual(job.connections, 1)
+            job.run()
+            budget._remove_job(job)
+            job.wait_for_helpers()
+        self.assertEqual(len(fetched), 4)
+        self.assertEqual(budget.in_use, 0)
+
+    def testQueuedDownloadsGetConnectionsInOrder(self):
+        budget = ConnectionBudget(1)
+        self.addCleanup(budget.shutdown)
+        budget.enqueue(["large", "medium", "small"])
+        budget.dequeue("medium")  # e.g. already cached
+        order = []
+
+        def download(key):
+            with budget.connection(key):
+                order.append(key)
+
+        with budget.connection():
+            threads = [
+                threading.Thread(target=download, args=(key,))
+                for key in ["small", "large"]
+            ]
+            for t in threads:
+                t.start()
+                time.sleep(0.02)
+        for t in threads:
+            t.join()
+        self.assertEqual(order, ["large", "small"])
+
+    def testBytesAreReported(self):
+        obj = _FakeObject(os.urandom(5 * 1000 + 3))
+        reported = []
+        self._download(
+            obj,
+            self.temp_dir / "out",
+            part_size=1000,
+            max_connections=2,
+            on_bytes=reported.append,
+        )
+        self.assertEqual(sum(reported), len(obj.data))
+
+
+class DownloadProgressTest(unittest.TestCase):
+    def setUp(self):
+        self.temp_context = tempfile.TemporaryDirectory()
+        self.path = Path(self.temp_context.name) / "out"
+        self.data = os.urandom(3000)
+        with open(self.path, "wb") as f:
+            f.truncate(len(self.data))
+
+    def tearDown(self):
+        self.temp_context.cleanup()
+
+    def _write(self, progress: DownloadProgress, start: int, length: int):
+        with open(self.path, "r+b") as f:
+            f.seek(start)
+            f.write(self.data[start : start + length])
+        progress.add(start, length)
+
+    def testReaderFollowsOutOfOrderParts(self):
+        progress = DownloadProgress()
+        progress.start(self.path, len(self.data))
+        result = []
+        reader = threading.Thread(
+            target=lambda: result.append(progress.open_reader().read())
+        )
+        reader.start()
+        for start in (2000, 1000, 0):
+            self._write(progress, start, 1000)
+            time.sleep(0.01)
+        progress.finish(self.path, len(self.data))
+        reader.join()
+        self.assertEqual(result, [self.data])
+
+    def testReaderStartsFromKeptParts(self):
+        progress = DownloadProgress()
+        self._write(progress, 0, 3000)
+        progress.start(self.path, len(self.data), [(0, 1000), (1000, 2000)])
+        stream = progress.open_reader()
+        self.assertEqual(stream.read(3000), self.data)
+
+    def testRestartAfterReadFails(self):
+        progress = DownloadProgress()
+        progress.start(self.path, len(self.data))
+        self._write(progress, 0, 1000)
+        stream = progress.open_reader()
+        self.assertEqual(stream.read1(1000), self.data[:1000])
+        # A new attempt discards bytes that were already read.
+        progress.start(self.path, len(self.data))
+        with self.assertRaises(IOError):
+            stream.read()
+
+    def testOnStartCalledOnceOutsideLock(self):
+        starts = []
+        progress = DownloadProgress(
+            on_start=lambda: starts.append(progress.error is None)
+        )
+        progress.start(self.path, len(self.data))
+        self._write(progress, 0, 1000)
+        progress.start(self.path, len(self.data))
+        self.assertEqual(starts, [True])
+        self.assertIsNotNone(progress.error)
+
+    def testFailUnblocksReader(self):
+        progress = DownloadProgress()
+        progress.start(self.path, len(self.data))
+        threading.Timer(0.05, progress.fail, [ConnectionResetError("drop")]).start()
+        with self.assertRaises(IOError):
+            progress.open_reader().read()
+
+
+if __name__ == "__main__":
+    unittest.main()
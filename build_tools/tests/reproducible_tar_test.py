@@ -0,0 +1,163 @@
+# Copyright Advanced Micro Devices, Inc.
+# SPDX-License-Identifier: MIT
+
+import hashlib
+import os
+from pathlib import Path
+import platform
+import sys
+import tarfile
+import tempfile
+import unittest
+from unittest import mock
+
+sys.path.insert(0, os.fspath(Path(__file__).parent.parent))
+
+from _therock_utils.archive_util import open_compressed_for_write
+from _therock_utils.reproducible_tar import (
+    SOURCE_DATE_EPOCH_ENV,
+    ReproducibleTarWriter,
+    source_date_epoch,
+)
+
+MTIME = 1_700_000_000
+
+
+class ReproducibleTarWriterTest(unittest.TestCase):
+    def setUp(self):
+        self.temp_context = tempfile.TemporaryDirectory()
+        self.temp_dir = Path(self.temp_context.name)
+
+    def tearDown(self):
+        self.temp_context.cleanup()
+
+    def _make_tree(self, name: str, file_mtime: int) -> Path:
+        root = self.temp_dir / name
+        # Created in a different order than they are archived.
+        (root / "lib").mkdir(parents=True)
+        (root / "lib" / "libfoo.so.1").write_bytes(b"foo" * 1000)
+        (root / "bin").mkdir()
+        (root / "bin" / "hipcc").write_text("#!/bin/sh\n")
+        (root / "bin" / "hipcc").chmod(0o775)
+        (root / "README").write_text("readme")
+        (root / "README").chmod(0o600)
+        if platform.system() != "Windows":
+            (root / "lib" / "libfoo.so").symlink_to("libfoo.so.1")
+        for path in [root, *root.rglob("*")]:
+            os.utime(path, (file_mtime, file_mtime), follow_symlinks=False)
+        return root
+
+    def _archive(self, root: Path, name: str, threads: int = 1) -> Path:
+        path = self.temp_dir / name
+        with ReproducibleTarWriter(
+            open_compressed_for_write(path, threads=threads),
+            mtime=MTIME,
+            read_threads=threads,
+        ) as writer:
+            writer.add_text("abc123", "GIT_REVISION")
+            writer.add_tree(root)
+        return path
+
+    def test_byte_identical_for_same_contents(self):
+        first = self._archive(self._make_tree("a", MTIME + 100), "a.tar.gz")
+        second = self._archive(self._make_tree("b", MTIME + 200), "b.tar.gz")
+        self.assertEqual(
+            hashlib.sha256(first.read_bytes()).hexdigest(),
+            hashlib.sha256(second.read_bytes()).hexdigest(),
+        )
+
+    def test_members_are_normalized_and_sorted(self):
+        path = self._archive(self._make_tree("a", MTIME + 100), "a.tar")
+        with tarfile.open(path) as tf:
+            members = tf.getmembers()
+        names = [m.name for m in members]
+        self.assertEqual(names, sorted(names))
+        self.assertIn("./bin/hipcc", names)
+        self.assertIn("GIT_REVISION", names)
+        for member in members:
+            self.assertEqual((member.uid, member.gid), (0, 0))
+            self.assertEqual((member.uname, member.gname), ("", ""))
+            self.assertEqual(member.mtime, MTIME)
+        by_name = {m.name: m for m in members}
+        self.assertEqual(by_name["./README"].mode, 0o644)
+        self.assertEqual(by_name["./lib"].mode, 0o755)
+        if platform.system() != "Windows":
+            self.assertEqual(by_name["./bin/hipcc"].mode, 0o755)
+            self.assertTrue(by_name["./lib/libfoo.so"].issym())
+
+    def test_older_mtimes_are_kept(self):
+        path = self._archive(self._make_tree("a", MTIME - 100), "a.tar")
+        with tarfile.open(path) as tf:
+            self.assertEqual(tf.getmember("./README").mtime, MTIME - 100)
+            self.assertEqual(tf.getmember("GIT_REVISION").mtime, MTIME)
+
+    def test_mtimes_set_without_clamping(self):
+        root = self._make_tree("a", MTIME - 100)
+        path = self.temp_dir / "a.tar"
+        with ReproducibleTarWriter(
+            open(path, "wb"), mtime=MTIME, clamp_mtime=False
+        ) as writer:
+            writer.add_tree(root)
+        with tarfile.open(path) as tf:
+            self.assertEqual({m.mtime for m in tf.getmembers()}, {MTIME})
+
+    def test_hardlinks_within_archive(self):
+        if platform.system() == "Windows":
+            self.skipTest("hardlinks")
+        root = self.temp_dir / "tree"
+        root.mkdir()
+        (root / "b").write_bytes(b"data")
+        os.link(root / "b", root / "a")
+        path = self._archive(root, "t.tar")
+        with tarfile.open(path) as tf:
+            self.assertTrue(tf.getmember("./a").isfile())
+            self.assertTrue(tf.getmember("./b").islnk())
+            self.assertEqual(tf.getmember("./b").linkname, "./a")
+
+    def test_error_discards_archive(self):
+        path = self.temp_dir / "t.tar"
+        with self.assertRaises(RuntimeError):
+            with ReproducibleTarWriter(open(path, "wb"), mtime=MTIME) as writer:
+                writer.add_text("text", "a")
+                raise RuntimeError("failed")
+        self.assertEqual(path.read_bytes(), b"")
+
+    def test_compressed_formats_are_deterministic(self):
+        root = self._make_tree("a", MTIME)
+        # Larger than one read-ahead file and one bzip2 block.
+        (root / "lib" / "big.so").write_bytes(os.urandom(1_500_000) * 2)
+        for suffix in [".tar.gz", ".tar.bz2", ".tar.xz", ".tar.zst"]:
+            with self.subTest(suffix=suffix):
+                first = self._archive(root, "first" + suffix, threads=1)
+                second = self._archive(root, "second" + suffix, threads=3)
+                self.assertEqual(first.read_bytes(), second.read_bytes())
+                if suffix != ".tar.zst":
+                    with tarfile.open(first) as tf:
+                        self.assertEqual(
+                            tf.extractfile("./lib/big.so").read(),
+                            (root / "lib" / "big.so").read_bytes(),
+                        )
+
+    def test_read_ahead_archive_contents(self):
+        root = self._make_tree("a", MTIME)
+        for i in range(100):
+            (root / f"file{i:03}").write_bytes(os.urandom(i * 100))
+        path = self._archive(root, "a.tar.xz", threads=4)
+        with tarfile.open(path) as tf:
+            for i in range(100):
+                self.assertEqual(
+                    tf.extractfile(f"./file{i:03}").read(),
+                    (root / f"file{i:03}").read_bytes(),
+                )
+
+
+class SourceDateEpochTest(unittest.TestCase):
+    def test_env_overrides_default(self):
+        with mock.patch.dict(os.environ, {SOURCE_DATE_EPOCH_ENV: "1234"}):
+            self.assertEqual(source_date_epoch(default=5), 1234)
+        with mock.patch.dict(os.environ, {SOURCE_DATE_EPOCH_ENV: ""}):
+            self.assertEqual(source_date_epoch(default=5), 5)
+
+
+if __name__ == "__main__":
+    unittest.main()
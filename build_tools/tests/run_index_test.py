@@ -0,0 +1,156 @@
+# Copyright Advanced Micro Devices, Inc.
+# SPDX-License-Identifier: MIT
+
+import os
+from pathlib import Path
+import sys
+import tempfile
+import unittest
+
+sys.path.insert(0, os.fspath(Path(__file__).parent.parent))
+
+from _therock_utils.artifact_backend import ArtifactStat, LocalDirectoryBackend
+from _therock_utils.run_index import (
+    RUN_INDEX_DIR,
+    RunIndex,
+    RunIndexEntry,
+    RunIndexFragmentName,
+    list_run_index_fragments,
+    load_run_index,
+    publish_run_index_fragment,
+    missing_from_index,
+)
+from _therock_utils.workflow_outputs import WorkflowOutputRoot
+
+
+def _entry(key: str, size: int = 10) -> RunIndexEntry:
+    return RunIndexEntry.for_archive(
+        key,
+        size,
+        "0" * 64,
+        uncompressed_size=4 * size,
+        file_count=2,
+        sidecars={".sha256sum": 99},
+    )
+
+
+class RunIndexEntryTest(unittest.TestCase):
+    def test_for_archive_parses_name(self):
+        entry = _entry("blas_lib_gfx94X-dcgpu.tar.zst")
+        self.assertEqual(entry.name, "blas")
+        self.assertEqual(entry.component, "lib")
+        self.assertEqual(entry.target_family, "gfx94X-dcgpu")
+
+    def test_for_archive_rejects_non_archive(self):
+        with self.assertRaises(ValueError):
+            RunIndexEntry.for_archive("index.html", 1, "0" * 64)
+
+    def test_json_round_trip(self):
+        entry = _entry("blas_lib_gfx94X-dcgpu.tar.zst")
+        self.assertEqual(RunIndexEntry.from_json(entry.to_json()), entry)
+
+
+class RunIndexFragmentNameTest(unittest.TestCase):
+    def test_round_trip(self):
+        name = RunIndexFragmentName("math-libs", ("gfx1100", "gfx942"))
+        self.assertEqual(name.filename, "math-libs.gfx1100+gfx942.json")
+        self.assertEqual(RunIndexFragmentName.parse(name.filename), name)
+
+    def test_parse_rejects_other_files(self):
+        self.assertIsNone(RunIndexFragmentName.parse("notes.txt"))
+        self.assertIsNone(RunIndexFragmentName.parse("nofamilies.json"))
+
+
+class RunIndexTest(unittest.TestCase):
+    def test_dumps_loads_round_trip(self):
+        index = RunIndex()
+        index.add(_entry("blas_lib_generic.tar.zst"))
+        index.fragments.append(RunIndexFragmentName("foundation", ("generic",)))
+        loaded = RunIndex.loads(index.dumps())
+        self.assertEqual(loaded.entries, index.entries)
+        self.assertEqual(loaded.fragments, index.fragments)
+
+    def test_loads_rejects_unknown_version(self):
+        with self.assertRaises(ValueError):
+            RunIndex.loads('{"version": 999, "artifacts": []}')
+
+    def test_listing_includes_sidecars(self):
+        index = RunIndex()
+        index.add(_entry("blas_lib_generic.tar.zst", size=10))
+        self.assertEqual(
+            index.listing(),
+            {
+                "blas_lib_generic.tar.zst": ArtifactStat(size=10),
+                "blas_lib_generic.tar.zst.sha256sum": ArtifactStat(size=99),
+            },
+        )
+
+    def test_missing_stages_and_families(self):
+        index = RunIndex()
+        index.fragments.append(RunIndexFragmentName("foundation", ("generic",)))
+        index.fragments.append(RunIndexFragmentName("math-libs", ("generic", "gfx942")))
+        self.assertEqual(
+            missing_from_index(
+                index,
+                [
+                    ("foundation", None),
+                    ("math-libs", "gfx942"),
+                    ("math-libs", "gfx1100"),
+                    ("comm-libs", None),
+                ],
+            ),
+            {("math-libs", "gfx1100"), ("comm-libs", None)},
+        )
+        index.fragments.append(RunIndexFragmentName("all", ("generic",)))
+        self.assertEqual(missing_from_index(index, [("math-libs", "gfx1100")]), set())
+
+
+class PublishAndLoadTest(unittest.TestCase):
+    def setUp(self):
+        self._temp_dir = tempfile.TemporaryDirectory()
+        self.addCleanup(self._temp_dir.cleanup)
+        self.temp_dir = Path(self._temp_dir.name)
+        self.backend = LocalDirectoryBackend(
+            staging_dir=self.temp_dir / "staging",
+            output_root=WorkflowOutputRoot.for_local(run_id="1", platform="linux"),
+        )
+
+    def test_load_without_fragments_returns_none(self):
+        self.assertIsNone(load_run_index(self.backend))
+
+    def test_fragments_of_concurrent_pushes_are_merged(self):
+        for stage, key in [
+            ("foundation", "base_lib_generic.tar.zst"),
+            ("math-libs", "blas_lib_gfx942.tar.zst"),
+            ("math-libs", "blas_lib_gfx1100.tar.zst"),
+        ]:
+            index = RunIndex()
+            index.add(_entry(key))
+            publish_run_index_fragment(self.backend, index, stage, self.temp_dir)
+
+        self.assertEqual(
+            [f.filename for f in list_run_index_fragments(self.backend)],
+            [
+                "foundation.generic.json",
+                "math-libs.gfx1100.json",
+                "math-libs.gfx942.json",
+            ],
+        )
+        merged = load_run_index(self.backend)
+        self.assertEqual(len(merged.entries), 3)
+        self.assertEqual(merged.stages, {"foundation", "math-libs"})
+        # Fragments are not artifacts of the run.
+        self.assertNotIn(
+            f"{RUN_INDEX_DIR}/foundation.generic.json", self.backend.list_artifacts()
+        )
+
+    def test_empty_index_is_not_published(self):
+        with self.assertRaises(ValueError):
+            publish_run_index_fragment(
+                self.backend, RunIndex(), "foundation", self.temp_dir
+            )
+        self.assertEqual(list_run_index_fragments(self.backend), [])
+
+
+if __name__ == "__main__":
+    unittest.main()
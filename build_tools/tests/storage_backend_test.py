@@ -4,12 +4,15 @@
 import os
 import sys
 import tempfile
+import threading
+import time
 import unittest
 from pathlib import Path
 from unittest import mock
 
 sys.path.insert(0, os.fspath(Path(__file__).parent.parent))
 
+from _therock_utils.adaptive_concurrency import DEFAULT_MAX_CONCURRENCY
 from _therock_utils.workflow_outputs import WorkflowOutputRoot
 from _therock_utils.storage_location import StorageLocation
 from _therock_utils.storage_backend import (
@@ -657,7 +660,7 @@ class TestS3StorageBackendUploadFiles(unittest.TestCase):
 
 
 class TestS3StorageBackendMaxPoolConnections(unittest.TestCase):
-    def test_default_pool_connections_match_concurrency(self):
+    def test_default_pool_connections_match_max_concurrency(self):
         with mock.patch("boto3.client") as mock_boto3:
             backend = S3StorageBackend()
             _ = backend.s3_client
@@ -665,16 +668,101 @@ class TestS3StorageBackendMaxPoolConnections(unittest.TestCase):
             mock_boto3.assert_called_once()
             config = mock_boto3.call_args.kwargs.get("config")
             self.assertIsNotNone(config)
-            self.assertEqual(config.max_pool_connections, 10)
+            self.assertEqual(config.max_pool_connections, DEFAULT_MAX_CONCURRENCY)
 
     def test_custom_concurrency_sets_pool_connections(self):
         with mock.patch("boto3.client") as mock_boto3:
-            backend = S3StorageBackend(upload_concurrency=20)
+            backend = S3StorageBackend(upload_concurrency=20, max_upload_concurrency=20)
             _ = backend.s3_client
 
             config = mock_boto3.call_args.kwargs.get("config")
             self.assertEqual(config.max_pool_connections, 20)
 
+    def test_initial_concurrency_above_default_max(self):
+        with mock.patch("boto3.client") as mock_boto3:
+            backend = S3StorageBackend(upload_concurrency=100)
+            _ = backend.s3_client
+
+            config = mock_boto3.call_args.kwargs.get("config")
+            self.assertEqual(config.max_pool_connections, 100)
+
+
+class TestS3StorageBackendAdaptiveConcurrency(unittest.TestCase):
+    def test_upload_files_reports_bytes_and_limits_concurrency(self):
+        backend = S3StorageBackend(upload_concurrency=2, max_upload_concurrency=2)
+        lock = threading.Lock()
+        active = []
+        peak = []
+
+        def upload(filename, bucket, key, **kwargs):
+            with lock:
+                active.append(key)
+                peak.append(len(active))
+            time.sleep(0.01)
+            kwargs["Callback"](100)
+            with lock:
+                active.remove(key)
+
+        backend._s3_client = mock.MagicMock()
+        backend._s3_client.upload_file.side_effect = upload
+        files = [
+            (Path(f"/tmp/{i}.log"), StorageLocation("bucket", f"run-1/{i}.log"))
+            for i in range(6)
+        ]
+        with self.assertLogs("_therock_utils.storage_backend", "INFO") as logs:
+            self.assertEqual(backend.upload_files(files), 6)
+
+        self.assertLessEqual(max(peak), 2)
+        self.assertIn("S3 upload throughput: 600.0 B in", logs.output[-1])
+
+    def test_copy_failures_report_throttling(self):
+        from botocore.exceptions import ClientError
+
+        backend = S3StorageBackend(upload_concurrency=8, max_upload_concurrency=16)
+        throttled = ClientError({"Error": {"Code": "SlowDown"}}, "CopyObject")
+        backend._s3_client = mock.MagicMock()
+        backend._s3_client.copy.side_effect = throttled
+        files = [
+            (StorageLocation("src", f"a/{i}"), StorageLocation("dst", f"b/{i}"))
+            for i in range(2)
+        ]
+
+        with (
+            mock.patch("_therock_utils.storage_backend.time.sleep"),
+            self.assertLogs("_therock_utils.storage_backend", "INFO") as logs,
+        ):
+            with self.assertRaises(RuntimeError):
+                backend.copy_files(files)
+
+        self.assertIn("throttled", logs.output[-1])
+
+    def test_retried_upload_counts_bytes_once(self):
+        backend = S3StorageBackend(upload_concurrency=1, max_upload_concurrency=1)
+        attempts = []
+
+        def upload(filename, bucket, key, **kwargs):
+            attempts.append(key)
+            kwargs["Callback"](100)
+            if attempts.count(key) == 1 and key.endswith("0.log"):
+                raise ConnectionResetError("dropped after 100 bytes")
+            kwargs["Callback"](100)
+
+        backend._s3_client = mock.MagicMock()
+        backend._s3_client.upload_file.side_effect = upload
+        files = [
+            (Path(f"/tmp/{i}.log"), StorageLocation("bucket", f"run-1/{i}.log"))
+            for i in range(2)
+        ]
+        with (
+            mock.patch("_therock_utils.storage_backend.time.sleep"),
+            self.assertLogs("_therock_utils.storage_backend", "INFO") as logs,
+        ):
+            self.assertEqual(backend.upload_files(files), 2)
+
+        self.assertEqual(len(attempts), 3)
+        # The 100 bytes of the failed attempt are not counted.
+        self.assertIn("S3 upload throughput: 400.0 B in", logs.output[-1])
+
 
 # ---------------------------------------------------------------------------
 # LocalStorageBackend.list_files
@@ -1054,7 +1142,7 @@ class TestS3StorageBackendCopyFiles(unittest.TestCase):
         backend = S3StorageBackend()
         mock_client = mock.MagicMock()
 
-        def copy_side_effect(copy_source, bucket, key):
+        def copy_side_effect(copy_source, bucket, key, **kwargs):
             if "bad" in key:
                 raise Exception("persistent failure")
 
@@ -0,0 +1,145 @@
+# Copyright Advanced Micro Devices, Inc.
+# SPDX-License-Identifier: MIT
+
+import os
+from pathlib import Path
+import platform
+import shutil
+import sys
+import tempfile
+import unittest
+from unittest import mock
+
+sys.path.insert(0, os.fspath(Path(__file__).parent.parent))
+
+from _therock_utils import tree_dedup
+from _therock_utils.tree_dedup import (
+    DedupReport,
+    index_trees,
+    merge_trees,
+)
+
+
+def write_bytes(p: Path, data: bytes):
+    p.parent.mkdir(exist_ok=True, parents=True)
+    p.write_bytes(data)
+
+
+@unittest.skipIf(platform.system() == "Windows", "uses symlinks and hardlinks")
+class TreeDedupTest(unittest.TestCase):
+    def setUp(self):
+        self.temp_context = tempfile.TemporaryDirectory()
+        self.temp_dir = Path(self.temp_context.name)
+        # A generic layer and two families linked from it (like
+        # build_tarballs.py), each adding files for its own targets.
+        self.generic = self.temp_dir / "_generic"
+        write_bytes(self.generic / "lib" / "libamdhip64.so", b"h" * 1000)
+        write_bytes(self.generic / "bin" / "hipcc", b"#!/bin/sh\n")
+        (self.generic / "bin" / "hipcc").chmod(0o755)
+        (self.generic / "lib" / "libamdhip64.so.7").symlink_to("libamdhip64.so")
+        self.families = {}
+        for family, size in [("gfx942", 300), ("gfx1100", 200)]:
+            family_dir = self.temp_dir / family
+            shutil.copytree(
+                self.generic, family_dir, symlinks=True, copy_function=os.link
+            )
+            write_bytes(family_dir / "lib" / "rocblas" / f"{family}.co", b"k" * size)
+            self.families[family] = family_dir
+        # The same contents in both families, at different paths.
+        write_bytes(self.families["gfx942"] / "share" / "a.dat", b"s" * 50)
+        write_bytes(self.families["gfx1100"] / "share" / "b.dat", b"s" * 50)
+
+    def tearDown(self):
+        self.temp_context.cleanup()
+
+    def _index(self):
+        return index_trees({"_generic": self.generic, **self.families}, threads=2)
+
+    def test_hardlinked_files_hashed_once(self):
+        with mock.patch.object(
+            tree_dedup, "calculate_hash", wraps=tree_dedup.calculate_hash
+        ) as hash_mock:
+            indexes = self._index()
+        # 2 generic files, 2 family kernels, 2 copies of the shared data.
+        self.assertEqual(hash_mock.call_count, 6)
+        hipcc = indexes["gfx942"]["bin/hipcc"]
+        self.assertEqual(indexes["_generic"]["bin/hipcc"], hipcc)
+        self.assertTrue(hipcc.executable)
+        self.assertEqual(indexes["gfx1100"]["lib/libamdhip64.so.7"].type, "symlink")
+        self.assertEqual(indexes["gfx1100"]["lib/rocblas"].type, "dir")
+
+    def test_report(self):
+        indexes = self._index()
+        report = DedupReport.from_indexes(
+            {family: indexes[family] for family in self.families}
+        )
+        generic_bytes = 1000 + len(b"#!/bin/sh\n")
+        self.assertEqual(report.tree_bytes["gfx942"], generic_bytes + 300 + 50)
+        self.assertEqual(report.unique_bytes, {"gfx942": 300, "gfx1100": 200})
+        self.assertEqual(report.shared_bytes, generic_bytes + 50)
+        self.assertEqual(report.distinct_bytes, generic_bytes + 50 + 500)
+        self.assertEqual(
+            report.to_json()["trees"]["gfx1100"],
+            {"bytes": generic_bytes + 250, "unique_bytes": 200},
+        )
+        self.assertEqual(len(report.format()), 3)
+
+    def test_merge_links_family_files(self):
+        # A family replacing a generic file (flattening replaces, not writes).
+        override = self.families["gfx942"] / "lib" / "libamdhip64.so"
+        override.unlink()
+        override.write_bytes(b"patched")
+        indexes = self._index()
+        output_dir = self.temp_dir / "multiarch"
+        counts = merge_trees(
+            base_dir=self.generic,
+            base_index=indexes["_generic"],
+            overlays={
+                family: (family_dir, indexes[family])
+                for family, family_dir in self.families.items()
+            },
+            output_dir=output_dir,
+        )
+        self.assertNotIn("copy", counts)
+
+        merged = index_trees({"multiarch": output_dir})["multiarch"]
+        for family in self.families:
+            for relpath, entry in indexes[family].items():
+                if relpath != "lib/libamdhip64.so":
+                    self.assertEqual(merged[relpath], entry)
+        self.assertEqual(
+            (output_dir / "lib" / "libamdhip64.so").read_bytes(), b"patched"
+        )
+        for family, family_dir in self.families.items():
+            kernel = f"lib/rocblas/{family}.co"
+            self.assertTrue((output_dir / kernel).samefile(family_dir / kernel))
+        self.assertTrue(
+            (output_dir / "bin" / "hipcc").samefile(self.generic / "bin" / "hipcc")
+        )
+        # The generic layer is left alone.
+        self.assertEqual(
+            (self.generic / "lib" / "libamdhip64.so").read_bytes(), b"h" * 1000
+        )
+
+    def test_merge_conflict_last_overlay_wins(self):
+        write_bytes(self.families["gfx942"] / "share" / "common.txt", b"one")
+        write_bytes(self.families["gfx1100"] / "share" / "common.txt", b"two")
+        indexes = self._index()
+        output_dir = self.temp_dir / "multiarch"
+        with mock.patch.object(tree_dedup, "log") as mock_log:
+            merge_trees(
+                base_dir=self.generic,
+                base_index=indexes["_generic"],
+                overlays={
+                    family: (self.families[family], indexes[family])
+                    for family in ["gfx942", "gfx1100"]
+                },
+                output_dir=output_dir,
+            )
+        self.assertEqual((output_dir / "share" / "common.txt").read_bytes(), b"two")
+        mock_log.assert_called_once()
+        self.assertIn("share/common.txt", mock_log.call_args.args[0])
+
+
+if __name__ == "__main__":
+    unittest.main()